@@ -23,8 +23,9 @@
 
 #include <globus_gridftp_server.h>
 #include <lio/lio.h>
+#include <gop/gop.h>
+#include <tbx/adler32.h>
 #include <time.h>
-#include <zlib.h>
 
 #include "lstore_dsi.h"
 #include "version.h"
@@ -475,23 +476,139 @@ static int my_max(int a, int b) {
 /*
  * These functions exist instead of just the user_ functions because they are
  * callbacks triggerd by Globus.
+ *
+ * Each in-flight block is counted in h->outstanding_count from the moment it
+ * is allocated until its buffer goes back to the pool, so the count covers
+ * both the Globus and the LIO half of the pipeline. Sends read a block with
+ * lio_read_gop() and hand the same buffer to Globus when the read lands.
+ * Receives hand the buffer Globus filled straight to lio_write_gop(). The
+ * LIO ops are always started after h->mutex is dropped since a failed op can
+ * complete, and run its callback, inside gop_start_execution().
  */
 #define MAX_CONCURRENCY_PER_LOOP ((int) 32)
+
+/*
+ * Finishes the transfer once it's marked done and the pipeline has drained.
+ * Must be called with h->mutex held. Returns 1 if the transfer was finished.
+ */
+static int gfs_xfer_try_finish(lstore_handle_t *h) {
+    if (!h->done || (h->outstanding_count > 0) || h->finished) {
+        return 0;
+    }
+    h->finished = 1;
+    user_xfer_close(h);
+    if (h->error == XFER_ERROR_NONE) {
+        globus_gfs_log_message(GLOBUS_GFS_LOG_INFO, "[lstore] xfer success: %s\n", h->path);
+        globus_gridftp_server_finished_transfer(h->op, GLOBUS_SUCCESS);
+    } else {
+        globus_gfs_log_message(GLOBUS_GFS_LOG_INFO, "[lstore] xfer failure: %s\n", h->path);
+        globus_gridftp_server_finished_transfer(h->op, GLOBUS_FAILURE);
+    }
+    return 1;
+}
+
+/*
+ * Drops a block that never made it through the pipeline
+ */
+static void gfs_block_release(lstore_handle_t *h, globus_byte_t *buffer) {
+    user_buffer_put(h, buffer);
+    --(h->outstanding_count);
+}
+
+/*
+ * Wraps a LIO op so its completion runs fn(blk) and the gop cleans itself up
+ */
+static gop_op_generic_t *gfs_block_gop(lstore_block_t *blk,
+                                        gop_op_generic_t *gop,
+                                        gop_callback_fn_t fn) {
+    STATSD_TIMER_RESET(blk->timer);
+    gop_set_auto_destroy(gop, 1);
+    gop_cb_set(&(blk->cb), fn, blk);
+    gop_callback_append(gop, &(blk->cb));
+    return gop;
+}
+
+static void gfs_read_done(void *priv, int value) {
+    lstore_block_t *blk = (lstore_block_t *) priv;
+    lstore_handle_t *h = blk->h;
+    globus_result_t rc;
+
+    globus_mutex_lock(&h->mutex);
+    STATSD_TIMER_POST("lfs_read_time", blk->timer);
+    STATSD_COUNT("lfs_bytes_read", (int) blk->nbytes);
+    if (value != OP_STATE_SUCCESS) {
+        user_handle_done(h, XFER_ERROR_DEFAULT);
+    }
+    if (h->error != XFER_ERROR_NONE) {
+        gfs_block_release(h, blk->buffer);
+        gfs_xfer_try_finish(h);
+        globus_mutex_unlock(&h->mutex);
+        return;
+    }
+    rc = globus_gridftp_server_register_write(h->op,
+                                                blk->buffer,
+                                                blk->nbytes,
+                                                blk->offset,
+                                                -1,
+                                                gfs_send_callback,
+                                                h);
+    if (rc != GLOBUS_SUCCESS) {
+        // failed to add the write
+        user_handle_done(h, XFER_ERROR_DEFAULT);
+        gfs_block_release(h, blk->buffer);
+        gfs_xfer_try_finish(h);
+    }
+    globus_mutex_unlock(&h->mutex);
+}
+
+static void gfs_write_done(void *priv, int value) {
+    lstore_block_t *blk = (lstore_block_t *) priv;
+    lstore_handle_t *h = blk->h;
+    int pump;
+
+    globus_mutex_lock(&h->mutex);
+    STATSD_TIMER_POST("lfs_write_time", blk->timer);
+    STATSD_COUNT("lfs_bytes_written", (value == OP_STATE_SUCCESS) ? (int) blk->nbytes : 0);
+    if (value != OP_STATE_SUCCESS) {
+        user_handle_done(h, XFER_ERROR_DEFAULT);
+    } else {
+        globus_gridftp_server_update_bytes_written(h->op, blk->offset, blk->nbytes);
+    }
+    gfs_block_release(h, blk->buffer);
+    pump = (!gfs_xfer_try_finish(h) && !h->done);
+    globus_mutex_unlock(&h->mutex);
+
+    if (pump) {
+        gfs_xfer_pump(h);
+    }
+}
+
 static void gfs_xfer_pump(lstore_handle_t *h) {
     GlobusGFSName(gfs_xfer_pump);
+    gop_op_generic_t *gop[MAX_CONCURRENCY_PER_LOOP];
+    int n_gop = 0;
     globus_mutex_lock(&h->mutex);
     
     globus_result_t rc = GLOBUS_SUCCESS;
-    int concurrency_needed =  h->optimal_count - h->outstanding_count;
+    int concurrency_needed =  h->pipeline_depth - h->outstanding_count;
     concurrency_needed = my_min(MAX_CONCURRENCY_PER_LOOP, concurrency_needed);
     concurrency_needed = my_max(0, concurrency_needed);
     // for pump (concur && (!done, read)
     for (int i = 0; i < concurrency_needed; ++i) {
-        if ((h->xfer_direction == XFER_SEND) && h->done) {
+        if (h->done) {
             break;
         }
-        // alloc (USER CODE)
-        globus_byte_t *buf = globus_malloc(h->block_size);
+        if ((h->xfer_direction == XFER_SEND) && (h->offset >= h->read_end)) {
+            // Everything has been requested so just drain what's in flight
+            user_handle_done(h, XFER_ERROR_NONE);
+            break;
+        }
+        globus_byte_t *buf = user_buffer_get(h);
+        if (!buf) {
+            user_handle_done(h, XFER_ERROR_DEFAULT);
+            break;
+        }
+        ++(h->outstanding_count);
         
         // if recv
         if (h->xfer_direction == XFER_RECV) {
@@ -501,62 +618,40 @@ static void gfs_xfer_pump(lstore_handle_t *h) {
                                        h->block_size,
                                        gfs_recv_callback,
                                        h);
-            if (rc == GLOBUS_SUCCESS) {
-                // inc outstanding
-                ++(h->outstanding_count);
-            } else {
+            if (rc != GLOBUS_SUCCESS) {
                 // failed to register
                 user_handle_done(h, XFER_ERROR_DEFAULT);
+                gfs_block_release(h, buf);
             }
         } else {
-            // if send
-            // do read (USER CODE)
-            globus_size_t read_length;
-            if (h->xfer_length < 0 || h->xfer_length > h->block_size) {
-                read_length = h->block_size;
-            } else {
-                read_length = h->xfer_length;
-            }
-            globus_off_t offset = h->offset;
-            time_t read_timer;
-            STATSD_TIMER_RESET(read_timer);
-            int nbytes = lio_read(h->fd,
-                                            (char *)buf,
-                                            read_length,
-                                            offset,
-                                            NULL);
-            STATSD_TIMER_POST("lfs_read_time", read_timer);
-            STATSD_COUNT("lfs_bytes_read", nbytes);
-            //   if bytes = 0
-            if (nbytes == 0) {
-                // done eof
-                user_handle_done(h, XFER_ERROR_NONE);
-            } else if (nbytes < 0) {
-                // bad read
+            // if send, queue up the read and register the write when it lands
+            lstore_block_t *blk = globus_malloc(sizeof(lstore_block_t));
+            if (!blk) {
                 user_handle_done(h, XFER_ERROR_DEFAULT);
-            } else {
-                // more coming
-                                // int offset
-                h->offset += nbytes;
-                // register read
-                rc = globus_gridftp_server_register_write(h->op,
-                                                            buf,
-                                                            nbytes,
-                                                            h->offset,
-                                                            -1,
-                                                            gfs_send_callback,
-                                                            h);
-                if (rc == GLOBUS_SUCCESS) {
-                    // inc outstanding
-                    ++(h->outstanding_count);
-                } else {
-                    // failed to add the write
-                    user_handle_done(h, XFER_ERROR_DEFAULT);
-                }
+                gfs_block_release(h, buf);
+                break;
             }
+            blk->h = h;
+            blk->buffer = buf;
+            blk->offset = h->offset;
+            blk->nbytes = h->block_size;
+            if (h->read_end - h->offset < (globus_off_t) blk->nbytes) {
+                blk->nbytes = h->read_end - h->offset;
+            }
+            h->offset += blk->nbytes;
+            gop[n_gop++] = gfs_block_gop(blk,
+                                    lio_read_gop(h->fd, (char *)buf, blk->nbytes, blk->offset, NULL),
+                                    gfs_read_done);
         }
     }
+    if (n_gop == 0) {
+        gfs_xfer_try_finish(h);
+    }
     globus_mutex_unlock(&h->mutex);
+
+    for (int i = 0; i < n_gop; ++i) {
+        gop_start_execution(gop[i]);
+    }
 }
 
 static void gfs_send_callback(globus_gfs_operation_t op,
@@ -586,11 +681,18 @@ static void gfs_xfer_callback(globus_gfs_operation_t op,
                                 void * user_arg) {
     GlobusGFSName(gfs_recv_callback);
     lstore_handle_t *h = (lstore_handle_t *) user_arg;
+    gop_op_generic_t *gop = NULL;
+    uint32_t adler32_accum = 0;
+    int pump;
     if (((offset == 0) && (h->xfer_direction == XFER_RECV)) || (result != 0) || (eof != 0)) {
         globus_gfs_log_message(GLOBUS_GFS_LOG_INFO,
                                 "[lstore] gfs_CB xf: %d res: %d nb: %d off: %d eof: %d\n",
                                 h->xfer_direction, result, nbytes, offset, eof);
     }
+    if ((nbytes > 0) && (h->xfer_direction == XFER_RECV)) {
+        // Checksum outside the lock so blocks are summed in parallel
+        adler32_accum = tbx_adler32(1, buffer, nbytes);
+    }
     globus_mutex_lock(&h->mutex);
     if (result != 0) {
         user_handle_done(h, XFER_ERROR_DEFAULT);
@@ -598,16 +700,8 @@ static void gfs_xfer_callback(globus_gfs_operation_t op,
     if (eof) {
         user_handle_done(h, XFER_ERROR_NONE);
     }
-    if ((nbytes > 0) && (h->xfer_direction == XFER_RECV)) {
-        // write (USER CODE)
-        // if written != nbytes
-            // done -> error
-        // else
-            // update_bytes_written
-
+    if ((nbytes > 0) && (h->xfer_direction == XFER_RECV) && (h->error == XFER_ERROR_NONE)) {
         // Store the adler32 for this block
-        uint32_t adler32_accum = adler32(0L, Z_NULL, 0);
-        adler32_accum = adler32(adler32_accum, (const Bytef *)buffer, nbytes);
         size_t adler32_idx = offset / h->block_size;
         while (h->cksum_nbytes[adler32_idx] != 0) {
             ++adler32_idx;
@@ -621,48 +715,37 @@ static void gfs_xfer_callback(globus_gfs_operation_t op,
         if (offset + nbytes > h->cksum_total_len) {
             h->cksum_total_len = offset + nbytes;
         }
-        time_t write_timer;
-        STATSD_TIMER_RESET(write_timer);
-        globus_size_t written = lio_write(h->fd,
-                                            (char *)buffer,
-                                            nbytes,
-                                            offset,
-                                            NULL);
-        STATSD_TIMER_POST("lfs_write_time", write_timer);
-        STATSD_COUNT("lfs_bytes_written", written);
-        if (written != nbytes) {
-            user_handle_done(h, XFER_ERROR_DEFAULT);
+
+        // Hand the buffer to LIO. It stays outstanding until the write lands
+        lstore_block_t *blk = globus_malloc(sizeof(lstore_block_t));
+        if (blk) {
+            blk->h = h;
+            blk->buffer = buffer;
+            blk->offset = offset;
+            blk->nbytes = nbytes;
+            gop = gfs_block_gop(blk,
+                                lio_write_gop(h->fd, (char *)buffer, nbytes, offset, NULL),
+                                gfs_write_done);
         } else {
-            globus_gridftp_server_update_bytes_written(h->op, offset, nbytes);
+            user_handle_done(h, XFER_ERROR_DEFAULT);
         }
-
     }
-    // free buffer (USER CORE)
-    globus_free(buffer);
-    // dec outstanding
-    --(h->outstanding_count);
+    if (!gop) {
+        // recycle buffer and dec outstanding
+        gfs_block_release(h, buffer);
+    }
     /*
      * The transfer is done when h->done is set and h->outstanding_count reaches
      * zero
-     *
-     * Unlock within the if statements since the conditions are protected by
-     * mutex
      */
-    if (h->done && (h->outstanding_count == 0)) {
-        user_xfer_close(h);
-        if (h->error == XFER_ERROR_NONE) {
-            globus_gfs_log_message(GLOBUS_GFS_LOG_INFO, "[lstore] xfer success: %s\n", h->path);
-            globus_gridftp_server_finished_transfer(h->op, GLOBUS_SUCCESS);
-        } else {
-            globus_gfs_log_message(GLOBUS_GFS_LOG_INFO, "[lstore] xfer failure: %s\n", h->path);
-            globus_gridftp_server_finished_transfer(h->op, GLOBUS_FAILURE);
-        }
-        globus_mutex_unlock(&h->mutex);
-    } else if (!h->done) {
-        globus_mutex_unlock(&h->mutex);
+    pump = (!gfs_xfer_try_finish(h) && !h->done);
+    globus_mutex_unlock(&h->mutex);
+
+    if (gop) {
+        gop_start_execution(gop);
+    }
+    if (pump) {
         gfs_xfer_pump(h);
-    } else {
-        globus_mutex_unlock(&h->mutex);
     }
 
     return;
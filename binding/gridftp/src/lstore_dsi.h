@@ -21,6 +21,7 @@
  */
 
 #include <globus_gridftp_server.h>
+#include <gop/callback.h>
 #include <lio/lio.h>
 
 #include "statsd-client.h"
@@ -28,6 +29,7 @@
 // Typedefs
 typedef struct lstore_handle_t lstore_handle_t;
 typedef struct lstore_reg_info_t lstore_reg_info_t;
+typedef struct lstore_block_t lstore_block_t;
 typedef enum xfer_direction_t xfer_direction_t;
 typedef enum xfer_error_t xfer_error_t;
 
@@ -179,6 +181,35 @@ void user_handle_done2(lstore_handle_t *h, xfer_error_t error, char *file, int l
  */
 lstore_handle_t *user_handle_new(int *retval_ext);
 
+/**
+ * Returns a block_size buffer from the handle's pool, allocating an aligned
+ * one if the pool is empty. Caller must hold h->mutex
+ * @param h Session handle
+ * @returns Buffer on success, NULL otherwise
+ */
+globus_byte_t *user_buffer_get(lstore_handle_t *h);
+
+/**
+ * Returns a buffer to the handle's pool for reuse. Caller must hold h->mutex
+ * @param h Session handle
+ * @param buffer Buffer from user_buffer_get()
+ */
+void user_buffer_put(lstore_handle_t *h, globus_byte_t *buffer);
+
+/**
+ * Frees every buffer held in the handle's pool
+ * @param h Session handle
+ */
+void user_buffer_pool_free(lstore_handle_t *h);
+
+/**
+ * Picks how many blocks to keep in flight. Enough blocks are used to cover
+ * two full stripes of the file so every device in the stripe stays busy
+ * @param h Session handle with an open file
+ * @returns Pipeline depth
+ */
+int user_pipeline_depth(lstore_handle_t *h);
+
 int user_recv_init(lstore_handle_t *h,
                     globus_gfs_transfer_info_t * transfer_info);
 
@@ -234,6 +265,10 @@ int user_xfer_pump(lstore_handle_t *h,
  */
 int user_close(lstore_handle_t *h);
 
+// Preprocessor constants
+#define LSTORE_BUFFER_ALIGN 4096
+#define LSTORE_MAX_PIPELINE_DEPTH 64
+
 // Enumerations
 enum xfer_direction_t {
     XFER_NEITHER = 0,
@@ -264,6 +299,15 @@ struct lstore_handle_t {
     char *expected_checksum;
     globus_mutex_t mutex;
     xfer_direction_t xfer_direction;
+    int finished;
+
+    // Pipelining
+    int pipeline_depth;
+    globus_size_t pipeline_block_size;
+    globus_off_t read_end;
+    globus_byte_t **buf_pool;
+    int buf_pool_count;
+    int buf_pool_size;
 
     // Checksumming
     globus_size_t cksum_total_len;
@@ -274,6 +318,15 @@ struct lstore_handle_t {
     globus_size_t *cksum_nbytes;
 };
 
+struct lstore_block_t {
+    gop_callback_t cb;      // Must be first since the gop frees it
+    lstore_handle_t *h;
+    globus_byte_t *buffer;
+    globus_size_t nbytes;
+    globus_off_t offset;
+    time_t timer;
+};
+
 struct lstore_reg_info_t {
     globus_byte_t *buffer;
     globus_size_t nbytes;
@@ -21,6 +21,7 @@
 
 #include <lio/lio.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <zlib.h>
 
 #include "lstore_dsi.h"
@@ -230,6 +231,60 @@ int user_send_init(lstore_handle_t *h,
     return 0;
 }
 
+int user_pipeline_depth(lstore_handle_t *h) {
+    globus_off_t stripe = lio_stripe_size(h->fd);
+    globus_off_t depth = (2 * stripe + h->block_size - 1) / h->block_size;
+    if (depth < h->optimal_count) {
+        depth = h->optimal_count;
+    }
+    if (depth > LSTORE_MAX_PIPELINE_DEPTH) {
+        depth = LSTORE_MAX_PIPELINE_DEPTH;
+    }
+    return (depth > 0) ? depth : 1;
+}
+
+globus_byte_t *user_buffer_get(lstore_handle_t *h) {
+    void *buffer;
+    if (h->buf_pool_count > 0) {
+        --(h->buf_pool_count);
+        return h->buf_pool[h->buf_pool_count];
+    }
+    if (posix_memalign(&buffer, LSTORE_BUFFER_ALIGN, h->block_size) != 0) {
+        return NULL;
+    }
+    return (globus_byte_t *)buffer;
+}
+
+void user_buffer_put(lstore_handle_t *h, globus_byte_t *buffer) {
+    if (!buffer) {
+        return;
+    }
+    if (h->buf_pool_count >= h->buf_pool_size) {
+        int new_size = (h->pipeline_depth > h->buf_pool_size) ?
+                            h->pipeline_depth : 2 * h->buf_pool_size + 1;
+        globus_byte_t **pool = realloc(h->buf_pool, new_size * sizeof(globus_byte_t *));
+        if (!pool) {
+            free(buffer);
+            return;
+        }
+        h->buf_pool = pool;
+        h->buf_pool_size = new_size;
+    }
+    h->buf_pool[h->buf_pool_count] = buffer;
+    ++(h->buf_pool_count);
+}
+
+void user_buffer_pool_free(lstore_handle_t *h) {
+    int i;
+    for (i = 0; i < h->buf_pool_count; ++i) {
+        free(h->buf_pool[i]);
+    }
+    free(h->buf_pool);
+    h->buf_pool = NULL;
+    h->buf_pool_count = 0;
+    h->buf_pool_size = 0;
+}
+
 static void human_readable_adler32(char *adler32_human, uLong adler32) {
     unsigned int i;
     unsigned char * adler32_char = (unsigned char*)&adler32;
@@ -471,5 +526,6 @@ void user_handle_del(lstore_handle_t *h) {
     if (h->cksum_nbytes) {
         globus_free(h->cksum_nbytes);
     }
+    user_buffer_pool_free(h);
     globus_free(h);
 }
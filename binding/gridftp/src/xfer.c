@@ -63,6 +63,25 @@ int plugin_xfer_init(lstore_handle_t *h,
     if (transfer_info->alloc_size > 0) {
         gop_sync_exec(lio_truncate_op(h->fd, -transfer_info->alloc_size));
     }
+
+    // Reset the pipeline for this transfer. The pool is kept between
+    // transfers unless the block size changed.
+    if (h->pipeline_block_size != h->block_size) {
+        user_buffer_pool_free(h);
+    }
+    h->pipeline_block_size = h->block_size;
+    if (direction == XFER_SEND) {
+        // Stop reading at the end of the requested range or the file
+        globus_off_t size = lio_size(h->fd);
+        if ((h->xfer_length >= 0) && (h->offset + h->xfer_length < size)) {
+            h->read_end = h->offset + h->xfer_length;
+        } else {
+            h->read_end = size;
+        }
+    }
+    h->pipeline_depth = user_pipeline_depth(h);
+    h->outstanding_count = 0;
+    h->finished = 0;
     return retval;
 
 error_open:
@@ -0,0 +1,31 @@
+# -*- cmake -*-
+
+# - Find LZ4 libraries and C includes
+#
+# This module defines
+#    LZ4_INCLUDE_DIR - where to find the header files
+#    LZ4_LIBRARY - the libraries needed.
+#    LZ4_FOUND - If false didn't find LZ4
+
+# Find the include path
+find_path(LZ4_INCLUDE_DIR lz4frame.h)
+
+find_library(LZ4_LIBRARY NAMES lz4)
+
+if (LZ4_LIBRARY AND LZ4_INCLUDE_DIR)
+    SET(LZ4_FOUND "YES")
+endif ()
+
+
+if (LZ4_FOUND)
+   message(STATUS "Found LZ4: ${LZ4_LIBRARY} ${LZ4_INCLUDE_DIR}")
+else ()
+   message(STATUS "Could not find LZ4 library")
+endif ()
+
+
+MARK_AS_ADVANCED(
+  LZ4_LIBRARY
+  LZ4_INCLUDE_DIR
+  LZ4_FOUND
+)
@@ -0,0 +1,31 @@
+# -*- cmake -*-
+
+# - Find Zstandard libraries and C includes
+#
+# This module defines
+#    ZSTD_INCLUDE_DIR - where to find the header files
+#    ZSTD_LIBRARY - the libraries needed.
+#    ZSTD_FOUND - If false didn't find Zstandard
+
+# Find the include path
+find_path(ZSTD_INCLUDE_DIR zstd.h)
+
+find_library(ZSTD_LIBRARY NAMES zstd)
+
+if (ZSTD_LIBRARY AND ZSTD_INCLUDE_DIR)
+    SET(ZSTD_FOUND "YES")
+endif ()
+
+
+if (ZSTD_FOUND)
+   message(STATUS "Found Zstandard: ${ZSTD_LIBRARY} ${ZSTD_INCLUDE_DIR}")
+else ()
+   message(STATUS "Could not find Zstandard library")
+endif ()
+
+
+MARK_AS_ADVANCED(
+  ZSTD_LIBRARY
+  ZSTD_INCLUDE_DIR
+  ZSTD_FOUND
+)
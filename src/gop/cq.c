@@ -0,0 +1,243 @@
+/*
+   Copyright 2016 Vanderbilt University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+//***********************************************************************
+// Completion queue with a pollable file descriptor.  Gops added to the
+// queue are submitted for execution and, as they finish, are placed on
+// the queue's finished list.  The descriptor is readable whenever there
+// are gops waiting to be reaped so an application's event loop can
+// drive them with gop_reap() instead of blocking threads in gop_waitany().
+//***********************************************************************
+
+#define _log_module_index 106
+
+#include <apr_pools.h>
+#include <apr_thread_mutex.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tbx/assert_result.h>
+#include <tbx/log.h>
+#include <tbx/stack.h>
+#include <tbx/type_malloc.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include "callback.h"
+#include "gop.h"
+#include "gop/cq.h"
+#include "gop/types.h"
+
+void _gop_start_execution(gop_op_generic_t *g);
+
+typedef struct {      //** Completion callback.  cb has to be 1st since callback_destroy() frees it
+    gop_callback_t cb;
+    gop_cq_t *cq;
+    gop_op_generic_t *gop;
+} cq_callback_t;
+
+//*************************************************************
+// _cq_signal - Makes the fd readable
+//   NOTE: The cq lock should be held
+//*************************************************************
+
+void _cq_signal(gop_cq_t *cq)
+{
+    uint64_t one = 1;
+    ssize_t n;
+
+    if (cq->signaled == 1) return;
+
+    do {
+        n = write(cq->fd[1], &one, (cq->fd[0] == cq->fd[1]) ? sizeof(one) : 1);
+    } while ((n < 0) && (errno == EINTR));
+
+    cq->signaled = 1;
+}
+
+//*************************************************************
+// _cq_clear - Drains the fd so it's no longer readable
+//   NOTE: The cq lock should be held
+//*************************************************************
+
+void _cq_clear(gop_cq_t *cq)
+{
+    uint64_t buf[8];
+    ssize_t n;
+
+    if (cq->signaled == 0) return;
+
+    do {
+        n = read(cq->fd[0], buf, sizeof(buf));
+    } while ((n > 0) || ((n < 0) && (errno == EINTR)));
+
+    cq->signaled = 0;
+}
+
+//*************************************************************
+// _cq_cb - Callback executed when a gop in the queue completes
+//*************************************************************
+
+void _cq_cb(void *v, int mode)
+{
+    cq_callback_t *ccb = (cq_callback_t *)v;
+    gop_cq_t *cq = ccb->cq;
+    gop_op_generic_t *gop = ccb->gop;
+
+    apr_thread_mutex_lock(cq->lock);
+    tbx_stack_move_to_bottom(cq->finished);
+    tbx_stack_insert_below(cq->finished, gop);
+    _cq_signal(cq);
+    log_printf(15, "gid=%d n_finished=%d n_pending=%d\n", gop_id(gop), tbx_stack_count(cq->finished), cq->n_pending);
+    apr_thread_mutex_unlock(cq->lock);
+}
+
+//*************************************************************
+// gop_cq_add - Adds the gop to the completion queue and starts it.
+//    The gop shouldn't be part of an opque or have been started.
+//*************************************************************
+
+int gop_cq_add(gop_cq_t *cq, gop_op_generic_t *gop)
+{
+    cq_callback_t *ccb;
+
+    tbx_type_malloc(ccb, cq_callback_t, 1);
+    gop_cb_set(&(ccb->cb), _cq_cb, (void *)ccb);
+    ccb->cq = cq;
+    ccb->gop = gop;
+
+    apr_thread_mutex_lock(cq->lock);
+    cq->n_pending++;
+    apr_thread_mutex_unlock(cq->lock);
+
+    lock_gop(gop);
+    callback_append(&(gop->base.cb), &(ccb->cb));
+    if ((gop_get_type(gop) == Q_TYPE_OPERATION) && (gop->base.state == 1)) {  //** Already done
+        unlock_gop(gop);
+        _cq_cb(ccb, gop->base.status.op_status);
+        return(0);
+    }
+    _gop_start_execution(gop);
+    unlock_gop(gop);
+
+    return(0);
+}
+
+//*************************************************************
+// gop_reap - Returns the next completed gop or NULL if none are ready.
+//    Never blocks.  The caller owns the returned gop.
+//*************************************************************
+
+gop_op_generic_t *gop_reap(gop_cq_t *cq)
+{
+    gop_op_generic_t *gop;
+
+    apr_thread_mutex_lock(cq->lock);
+    gop = (gop_op_generic_t *)tbx_stack_pop(cq->finished);
+    if (gop != NULL) cq->n_pending--;
+    if (tbx_stack_count(cq->finished) == 0) _cq_clear(cq);
+    apr_thread_mutex_unlock(cq->lock);
+
+    //** The completion callback runs with the gop locked so make sure
+    //** it's fully marked as completed before handing it back
+    if (gop != NULL) {
+        lock_gop(gop);
+        unlock_gop(gop);
+    }
+
+    return(gop);
+}
+
+//*************************************************************
+// gop_cq_pending - Returns the number of gops added and not yet reaped
+//*************************************************************
+
+int gop_cq_pending(gop_cq_t *cq)
+{
+    int n;
+
+    apr_thread_mutex_lock(cq->lock);
+    n = cq->n_pending;
+    apr_thread_mutex_unlock(cq->lock);
+
+    return(n);
+}
+
+//*************************************************************
+// gop_cq_fd - Returns the descriptor to poll for readability
+//*************************************************************
+
+int gop_cq_fd(gop_cq_t *cq)
+{
+    return(cq->fd[0]);
+}
+
+//*************************************************************
+// gop_cq_new - Creates a new completion queue
+//*************************************************************
+
+gop_cq_t *gop_cq_new()
+{
+    gop_cq_t *cq;
+    int i;
+
+    tbx_type_malloc_clear(cq, gop_cq_t, 1);
+
+    assert_result(apr_pool_create(&(cq->mpool), NULL), APR_SUCCESS);
+    apr_thread_mutex_create(&(cq->lock), APR_THREAD_MUTEX_DEFAULT, cq->mpool);
+    cq->finished = tbx_stack_new();
+
+#ifdef __linux__
+    cq->fd[0] = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+    cq->fd[1] = cq->fd[0];
+    if (cq->fd[0] == -1) {
+        log_printf(1, "WARNING: eventfd failed errno=%d.  Using a pipe\n", errno);
+#endif
+        FATAL_UNLESS(pipe(cq->fd) == 0);
+        for (i=0; i<2; i++) {
+            fcntl(cq->fd[i], F_SETFL, fcntl(cq->fd[i], F_GETFL) | O_NONBLOCK);
+            fcntl(cq->fd[i], F_SETFD, FD_CLOEXEC);
+        }
+#ifdef __linux__
+    }
+#endif
+
+    return(cq);
+}
+
+//*************************************************************
+// gop_cq_destroy - Destroys the completion queue.  Any gops still
+//    outstanding are left untouched so they should be reaped first.
+//*************************************************************
+
+void gop_cq_destroy(gop_cq_t *cq)
+{
+    if (cq->n_pending > 0) {
+        log_printf(0, "WARNING: Destroying cq with gops still pending! n_pending=%d\n", cq->n_pending);
+    }
+
+    close(cq->fd[0]);
+    if (cq->fd[1] != cq->fd[0]) close(cq->fd[1]);
+
+    tbx_stack_free(cq->finished, 0);
+    apr_thread_mutex_destroy(cq->lock);
+    apr_pool_destroy(cq->mpool);
+    free(cq);
+}
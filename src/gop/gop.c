@@ -32,7 +32,7 @@
 
 //** Defined in opque.c
 void _opque_start_execution(gop_opque_t *que);
-void _opque_print_stack(tbx_stack_t *stack);
+gop_op_generic_t *_opque_finished_pop(gop_que_data_t *q);
 extern tbx_pc_t *_gop_control;
 
 gop_op_status_t gop_success_status = {OP_STATE_SUCCESS, 0};
@@ -44,6 +44,39 @@ gop_op_status_t op_invalid_host_status = {OP_STATE_INVALID_HOST, 0};
 gop_op_status_t op_cant_connect_status = {OP_STATE_FAILURE, OP_STATE_CANT_CONNECT};
 gop_op_status_t gop_error_status = {OP_STATE_ERROR, 0};
 
+//*************************************************************
+// gop_control_wait - Sleeps on the control's condition.  The lock
+//    must be held.  Registers as a waiter so completions know if
+//    they need to broadcast.
+//*************************************************************
+
+void gop_control_wait(gop_control_t *ctl)
+{
+    tbx_atomic_inc(ctl->n_waiters);
+    apr_thread_cond_wait(ctl->cond, ctl->lock);
+    tbx_atomic_dec(ctl->n_waiters);
+}
+
+//*************************************************************
+// gop_control_timedwait - Same as gop_control_wait but with a timeout
+//*************************************************************
+
+void gop_control_timedwait(gop_control_t *ctl, apr_interval_time_t dt)
+{
+    tbx_atomic_inc(ctl->n_waiters);
+    apr_thread_cond_timedwait(ctl->cond, ctl->lock, dt);
+    tbx_atomic_dec(ctl->n_waiters);
+}
+
+//*************************************************************
+// gop_control_broadcast - Wakes up any waiters.  The lock must be held
+//*************************************************************
+
+void gop_control_broadcast(gop_control_t *ctl)
+{
+    if (tbx_atomic_get(ctl->n_waiters) > 0) apr_thread_cond_broadcast(ctl->cond);
+}
+
 //*************************************************************
 //  gop_callback_append
 //*************************************************************
@@ -111,7 +144,7 @@ gop_op_generic_t *gop_get_next_finished(gop_op_generic_t *g)
 
     lock_gop(g);
     if (gop_get_type(g) == Q_TYPE_QUE) {
-        gop = (gop_op_generic_t *)tbx_stack_pop(g->q->finished);
+        gop = _opque_finished_pop(g->q);
     } else {
         gop = NULL;
         if (g->base.failure_mode != OP_FM_GET_END) {
@@ -178,7 +211,7 @@ int gop_tasks_finished(gop_op_generic_t *g)
 
     lock_gop(g);
     if (gop_get_type(g) == Q_TYPE_QUE) {
-        nf = tbx_stack_count(g->q->finished);
+        nf = tbx_atomic_get(g->q->n_finished);
     } else {
         nf = (g->base.state == 1) ? 1 : 0;
     }
@@ -198,7 +231,7 @@ int gop_tasks_left(gop_op_generic_t *g)
 
     lock_gop(g);
     if (gop_get_type(g) == Q_TYPE_QUE) {
-        n = g->q->nleft;
+        n = tbx_atomic_get(g->q->nleft);
     } else {
         n = (g->base.state == 1) ? 0 : 1;
     }
@@ -257,8 +290,8 @@ void gop_finished_submission(gop_op_generic_t *g)
         g->q->finished_submission = 1;
 
         //** If nothing left to do trigger the condition in case anyone's waiting
-        if (g->q->nleft == 0) {
-            apr_thread_cond_broadcast(g->base.ctl->cond);
+        if (tbx_atomic_get(g->q->nleft) == 0) {
+            gop_control_broadcast(g->base.ctl);
         }
     }
     unlock_gop(g);
@@ -274,7 +307,7 @@ int gop_wait(gop_op_generic_t *gop)
     lock_gop(gop);
     while (gop->base.state == 0) {
         log_printf(15, "gop_wait: WHILE gid=%d state=%d\n", gop_id(gop), gop->base.state);
-        apr_thread_cond_wait(gop->base.ctl->cond, gop->base.ctl->lock); //** Sleep until something completes
+        gop_control_wait(gop->base.ctl); //** Sleep until something completes
     }
 
     status = gop_get_status(gop);
@@ -332,7 +365,7 @@ int gop_will_block(gop_op_generic_t *g)
 
     lock_gop(g);
     if (gop_get_type(g) == Q_TYPE_QUE) {
-        if ((tbx_stack_count(g->q->finished) == 0) && (g->q->nleft > 0)) status = 1;
+        if ((tbx_atomic_get(g->q->n_finished) == 0) && (tbx_atomic_get(g->q->nleft) > 0)) status = 1;
     } else {
         if (g->base.state == 0) status = 1;
     }
@@ -362,13 +395,20 @@ gop_op_generic_t *gop_waitany(gop_op_generic_t *g)
             log_printf(15, "sync_exec_que -- waiting for pgid=%d cgid=%d to complete\n", gop_id(g), gop_id(gop));
             unlock_gop(g);
             gop_waitany(gop);
-            tbx_stack_pop(g->q->finished); //** Remove it from the finished list.
+            lock_gop(g);
+            _opque_finished_pop(g->q); //** Remove it from the finished list.
+            unlock_gop(g);
             return(gop);
         } else {
             _gop_start_execution(g);  //** Make sure things have been submitted
-            while (((gop = (gop_op_generic_t *)tbx_stack_pop(g->q->finished)) == NULL) && (g->q->nleft > 0)) {
+
+            //** Register as a waiter *before* checking the finished list.  Completions can push
+            //** onto it without the lock and only broadcast if they see a waiter.
+            tbx_atomic_inc(g->base.ctl->n_waiters);
+            while (((gop = _opque_finished_pop(g->q)) == NULL) && (tbx_atomic_get(g->q->nleft) > 0)) {
                 apr_thread_cond_wait(g->base.ctl->cond, g->base.ctl->lock); //** Sleep until something completes
             }
+            tbx_atomic_dec(g->base.ctl->n_waiters);
         }
 
         if (gop != NULL) log_printf(15, "POP finished qid=%d gid=%d\n", gop_id(g), gop_id(gop));
@@ -386,7 +426,7 @@ gop_op_generic_t *gop_waitany(gop_op_generic_t *g)
             _gop_start_execution(g);  //** Make sure things have been submitted
             lock_gop(g);  //** but we do need it for detecting when we're finished.
             while (g->base.state == 0) {
-                apr_thread_cond_wait(g->base.ctl->cond, g->base.ctl->lock); //** Sleep until something completes
+                gop_control_wait(g->base.ctl); //** Sleep until something completes
             }
         }
         log_printf(15, "gop_waitany: AFTER (type=op) While gid=%d state=%d\n", gop_id(g), g->base.state);
@@ -425,8 +465,8 @@ int gop_waitall(gop_op_generic_t *g)
             return(status);
         } else {  //** Got to submit it normally
             _gop_start_execution(g);  //** Make sure things have been submitted
-            while (g->q->nleft > 0) {
-                apr_thread_cond_wait(g->base.ctl->cond, g->base.ctl->lock); //** Sleep until something completes
+            while (tbx_atomic_get(g->q->nleft) > 0) {
+                gop_control_wait(g->base.ctl); //** Sleep until something completes
             }
         }
     } else {     //** Got a single task
@@ -441,7 +481,7 @@ int gop_waitall(gop_op_generic_t *g)
             _gop_start_execution(g);  //** Make sure things have been submitted
             while (g->base.state == 0) {
                 log_printf(15, "gop_waitall: WHILE gid=%d state=%d\n", gop_id(g), g->base.state);
-                apr_thread_cond_wait(g->base.ctl->cond, g->base.ctl->lock); //** Sleep until something completes
+                gop_control_wait(g->base.ctl); //** Sleep until something completes
             }
         }
     }
@@ -471,13 +511,16 @@ gop_op_generic_t *gop_waitany_timed(gop_op_generic_t *g, int dt)
 
     loop = 0;
     if (gop_get_type(g) == Q_TYPE_QUE) {
-        while (((gop = (gop_op_generic_t *)tbx_stack_pop(g->q->finished)) == NULL) && (g->q->nleft > 0) && (loop == 0)) {
+        //** Register as a waiter before checking the finished list just like gop_waitany
+        tbx_atomic_inc(g->base.ctl->n_waiters);
+        while (((gop = _opque_finished_pop(g->q)) == NULL) && (tbx_atomic_get(g->q->nleft) > 0) && (loop == 0)) {
             apr_thread_cond_timedwait(g->base.ctl->cond, g->base.ctl->lock, adt); //** Sleep until something completes
             loop++;
         }
+        tbx_atomic_dec(g->base.ctl->n_waiters);
     } else {
         while ((g->base.state == 0) && (loop == 0)) {
-            apr_thread_cond_timedwait(g->base.ctl->cond, g->base.ctl->lock, adt); //** Sleep until something completes
+            gop_control_timedwait(g->base.ctl, adt); //** Sleep until something completes
             loop++;
         }
 
@@ -505,15 +548,15 @@ int gop_timed_waitall(gop_op_generic_t *g, int dt)
 
     loop = 0;
     if (gop_get_type(g) == Q_TYPE_QUE) {
-        while ((g->q->nleft > 0) && (loop == 0)) {
-            apr_thread_cond_timedwait(g->base.ctl->cond, g->base.ctl->lock, adt); //** Sleep until something completes
+        while ((tbx_atomic_get(g->q->nleft) > 0) && (loop == 0)) {
+            gop_control_timedwait(g->base.ctl, adt); //** Sleep until something completes
             loop++;
         }
 
-        status = (g->q->nleft > 0) ? OP_STATE_RETRY : _gop_completed_successfully(g);
+        status = (tbx_atomic_get(g->q->nleft) > 0) ? OP_STATE_RETRY : _gop_completed_successfully(g);
     } else {
         while ((g->base.state == 0) && (loop == 0)) {
-            apr_thread_cond_timedwait(g->base.ctl->cond, g->base.ctl->lock, adt); //** Sleep until something completes
+            gop_control_timedwait(g->base.ctl, adt); //** Sleep until something completes
             loop++;
         }
 
@@ -555,7 +598,7 @@ void single_gop_mark_completed(gop_op_generic_t *gop, gop_op_status_t status)
     base->state = 1;
 
     //** Lastly trigger the signal. for anybody listening
-    apr_thread_cond_broadcast(gop->base.ctl->cond);
+    gop_control_broadcast(gop->base.ctl);
 
     log_printf(15, "gop_mark_completed: after brodcast gid=%d\n", gop_id(gop));
 
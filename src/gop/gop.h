@@ -38,6 +38,7 @@ extern "C" {
 struct gop_control_t {
     apr_thread_mutex_t *lock;  //** shared lock
     apr_thread_cond_t *cond;   //** shared condition variable
+    tbx_atomic_unit32_t n_waiters;  //** Threads sleeping on the cond.  Only broadcast if someone's there
     tbx_pch_t  pch;   //** Pigeon coop hole for the lock and cond
 };
 
@@ -47,6 +48,10 @@ extern tbx_atomic_unit32_t _opque_counter;
 
 void gop_simple_cb(void *v, int mode);
 
+void gop_control_wait(gop_control_t *ctl);
+void gop_control_timedwait(gop_control_t *ctl, apr_interval_time_t dt);
+void gop_control_broadcast(gop_control_t *ctl);
+
 void gop_set_success_state(gop_op_generic_t *g, gop_op_status_t state);
 int gop_will_block(gop_op_generic_t *g);
 int gop_timed_waitall(gop_op_generic_t *g, int dt);
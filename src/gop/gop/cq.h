@@ -0,0 +1,60 @@
+/*
+Copyright 2016 Vanderbilt University
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/** \file
+* Autogenerated public API
+*/
+
+#ifndef ACCRE_GOP_CQ_H_INCLUDED
+#define ACCRE_GOP_CQ_H_INCLUDED
+
+#include <apr_pools.h>
+#include <apr_thread_mutex.h>
+#include <gop/gop.h>
+#include <gop/visibility.h>
+#include <gop/types.h>
+#include <tbx/stack.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Typedefs
+typedef struct gop_cq_t gop_cq_t;
+
+// Functions
+GOP_API gop_cq_t *gop_cq_new();
+GOP_API void gop_cq_destroy(gop_cq_t *cq);
+GOP_API int gop_cq_fd(gop_cq_t *cq);
+GOP_API int gop_cq_add(gop_cq_t *cq, gop_op_generic_t *gop);
+GOP_API int gop_cq_pending(gop_cq_t *cq);
+GOP_API gop_op_generic_t *gop_reap(gop_cq_t *cq);
+
+// Exported types. To be obscured.
+struct gop_cq_t {        //** Pollable completion queue
+    apr_pool_t *mpool;
+    apr_thread_mutex_t *lock;
+    tbx_stack_t *finished;   //** Completed gops waiting to be reaped
+    int n_pending;           //** Added but not reaped
+    int fd[2];               //** fd[0] is polled.  Same as fd[1] for an eventfd otherwise it's a pipe
+    int signaled;            //** The fd is currently readable
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ^ ACCRE_GOP_CQ_H_INCLUDED ^ */
@@ -150,6 +150,7 @@ struct gop_op_common_t {
     int execution_mode;    //** Execution mode OP_EXEC_QUEUE | OP_EXEC_DIRECT
     bool auto_destroy;      //** If 1 then automatically call the free fn to destroy the object
     gop_control_t *ctl;    //** Lock and condition struct
+    gop_op_generic_t *finished_next;  //** Link used by the parent que's lock-free finished list
     void *user_priv;           //** Optional user supplied handle
     gop_op_free_fn_t free;
     gop_portal_context_t *pc;
@@ -33,6 +33,9 @@ typedef struct gop_mq_stream_t gop_mq_stream_t;
 
 // Functions
 GOP_API int gop_mqs_id(gop_mq_stream_t *mqs);
+GOP_API char gop_mqs_pack_negotiate(char *host_id, int hid_len, const char *preferred);
+GOP_API void gop_mqs_pack_offer(char *buffer, int bufsize);
+GOP_API int gop_mqs_pack_type(char tbx_pack_type);
 GOP_API gop_mq_stream_t *gop_mq_stream_read_create(gop_mq_context_t *mqc,  gop_mq_ongoing_t *ongoing, char *host_id, int hid_len, gop_mq_frame_t *fdata, mq_msg_t *remote_host, int to);
 GOP_API int64_t gop_mq_stream_read_varint(gop_mq_stream_t *mqs, int *error);
 GOP_API gop_mq_stream_t *gop_mq_stream_write_create(gop_mq_context_t *mqc, gop_mq_portal_t *server_portal, gop_mq_ongoing_t *ongoing, char tbx_pack_type, int max_size, int timeout, mq_msg_t *address, gop_mq_frame_t *fid, gop_mq_frame_t *hid, bool launch_flusher);
@@ -45,6 +48,10 @@ GOP_API void gop_mqs_server_more_cb(void *arg, gop_mq_task_t *task);
 // Preprocessor constants
 #define MQS_PACK_RAW 'R'
 #define MQS_PACK_COMPRESS 'Z'
+#define MQS_PACK_ZSTD 'S'
+#define MQS_PACK_LZ4 'L'
+#define MQS_PACK_PREFERRED "SLZR"   //** Default order of preference when negotiating
+#define MQS_PACK_KEY "pack="        //** Host ID field listing the pack types a client can read
 
 #define MQS_MORE_DATA_KEY  "mqs_more"
 #define MQS_MORE_DATA_SIZE sizeof(MQS_MORE_DATA_KEY)
@@ -26,6 +26,7 @@ limitations under the License.
 #include <gop/visibility.h>
 #include <gop/types.h>
 #include <stdbool.h>
+#include <tbx/atomic_counter.h>
 #include <tbx/stack.h>
 
 #ifdef __cplusplus
@@ -68,9 +69,12 @@ GOP_API void gop_shutdown();
 // Exported types. To be obscured.
 struct gop_que_data_t {
     tbx_stack_t *list;         //** List of tasks
-    tbx_stack_t *finished;     //** lists that have completed and not yet processed
+    tbx_stack_t *finished;     //** lists that have completed and not yet processed.  Consumer side, protected by the que lock
+    volatile void *finished_head; //** Lock-free producer side of the finished list.  Newest first
+    tbx_atomic_unit32_t n_finished; //** Number of tasks on either side of the finished list
     tbx_stack_t *failed;       //** All lists that fail are also placed here
-    int nleft;             //** Number of lists left to be processed
+    tbx_atomic_unit32_t nleft; //** Number of lists left to be processed.  Only drops to 0 with the que lock held
+    tbx_atomic_unit32_t n_cb;  //** Number of completion callbacks running that may not hold the que lock
     int nsubmitted;        //** Nunmber of submitted tasks (doesn't count sub q's)
     bool finished_submission; //** No more tasks will be submitted so it's safe to free the data when finished
     gop_callback_t failure_cb;   //** Only used if a task fails
@@ -47,6 +47,80 @@ int gop_mqs_id(gop_mq_stream_t *mqs)
   return(mqs->msid);
 }
 
+//***********************************************************************
+// gop_mqs_pack_type - Maps the stream's pack type to the tbx_pack type.
+//    Returns -1 if the type isn't known or wasn't compiled in.
+//***********************************************************************
+
+int gop_mqs_pack_type(char tbx_pack_type)
+{
+    int ptype;
+
+    switch (tbx_pack_type) {
+    case MQS_PACK_RAW:
+        ptype = PACK_NONE;
+        break;
+    case MQS_PACK_COMPRESS:
+        ptype = PACK_COMPRESS;
+        break;
+    case MQS_PACK_ZSTD:
+        ptype = PACK_ZSTD;
+        break;
+    case MQS_PACK_LZ4:
+        ptype = PACK_LZ4;
+        break;
+    default:
+        return(-1);
+    }
+
+    return((tbx_pack_type_supported(ptype) == 1) ? ptype : -1);
+}
+
+//***********************************************************************
+// gop_mqs_pack_offer - Stores the pack types we can read, in order of
+//    preference, as a string for sending to the remote side.
+//***********************************************************************
+
+void gop_mqs_pack_offer(char *buffer, int bufsize)
+{
+    const char *all = MQS_PACK_PREFERRED;
+    int i, n;
+
+    n = 0;
+    for (i=0; (all[i] != 0) && (n < bufsize-1); i++) {
+        if (gop_mqs_pack_type(all[i]) >= 0) buffer[n++] = all[i];
+    }
+    buffer[n] = 0;
+}
+
+//***********************************************************************
+// gop_mqs_pack_negotiate - Picks the pack type to use for a stream.  The
+//    host ID can carry the types the remote side can read after
+//    MQS_PACK_KEY.  The first type in preferred that we both support is
+//    used.  Hosts that don't send a list get MQS_PACK_COMPRESS.
+//***********************************************************************
+
+char gop_mqs_pack_negotiate(char *host_id, int hid_len, const char *preferred)
+{
+    char *offer, *end;
+    int i, n;
+
+    if ((host_id == NULL) || (preferred == NULL)) return(MQS_PACK_COMPRESS);
+
+    end = memchr(host_id, 0, hid_len);
+    if (end == NULL) return(MQS_PACK_COMPRESS);
+    offer = strstr(host_id, MQS_PACK_KEY);
+    if (offer == NULL) return(MQS_PACK_COMPRESS);
+    offer += sizeof(MQS_PACK_KEY) - 1;
+    n = strcspn(offer, ":");
+
+    for (i=0; preferred[i] != 0; i++) {
+        if ((memchr(offer, preferred[i], n) != NULL) && (gop_mqs_pack_type(preferred[i]) >= 0)) return(preferred[i]);
+    }
+
+    return(MQS_PACK_COMPRESS);
+}
+
 //***********************************************************************
 // mqs_response_client_more - Handles a response for more data from the server
 //***********************************************************************
@@ -385,9 +459,15 @@ gop_mq_stream_t *gop_mq_stream_read_create(gop_mq_context_t *mqc, gop_mq_ongoing
     tbx_type_malloc(mqs->stream_id, char, mqs->sid_len);
     memcpy(mqs->stream_id, &(mqs->data[MQS_HANDLE_INDEX]), mqs->sid_len);
 
-    ptype = (mqs->data[MQS_PACK_INDEX] == MQS_PACK_COMPRESS) ? PACK_COMPRESS : PACK_NONE;
+    ptype = gop_mqs_pack_type(mqs->data[MQS_PACK_INDEX]);
     log_printf(1, "msid=%d ptype=%d tbx_pack_type=%c\n", mqs->msid, ptype, mqs->data[MQS_PACK_INDEX]);
-    mqs->pack = tbx_pack_create(ptype, PACK_READ, &(mqs->data[MQS_HEADER]), mqs->len - MQS_HEADER);
+    mqs->pack = (ptype < 0) ? NULL : tbx_pack_create(ptype, PACK_READ, &(mqs->data[MQS_HEADER]), mqs->len - MQS_HEADER);
+    if (mqs->pack == NULL) {  //** Can't unpack it so don't ask for more and let the reads fail
+        log_printf(0, "ERROR: msid=%d unsupported tbx_pack_type=%c\n", mqs->msid, mqs->data[MQS_PACK_INDEX]);
+        mqs->data[MQS_STATE_INDEX] = MQS_FINISHED;
+        mqs->want_more = MQS_ABORT;
+        mqs->pack = tbx_pack_create(PACK_NONE, PACK_READ, &(mqs->data[MQS_HEADER]), 0);
+    }
 
     log_printf(5, "data_len=%d more=%c MQS_HEADER=%lu\n", mqs->len, mqs->data[MQS_STATE_INDEX], MQS_HEADER);
 
@@ -938,9 +1018,14 @@ gop_mq_stream_t *gop_mq_stream_write_create(gop_mq_context_t *mqc, gop_mq_portal
     mqs->data[MQS_HANDLE_SIZE_INDEX] = sizeof(intptr_t);
     key = (intptr_t)mqs;
     memcpy(&(mqs->data[MQS_HANDLE_INDEX]), &key, sizeof(key));
-    ptype = (mqs->data[MQS_PACK_INDEX] == MQS_PACK_COMPRESS) ? PACK_COMPRESS : PACK_NONE;
+    ptype = gop_mqs_pack_type(mqs->data[MQS_PACK_INDEX]);
+    mqs->pack = (ptype < 0) ? NULL : tbx_pack_create(ptype, PACK_WRITE, &(mqs->data[MQS_HEADER]), mqs->len-MQS_HEADER);
+    if (mqs->pack == NULL) {  //** Not available here so fall back to zlib
+        mqs->data[MQS_PACK_INDEX] = MQS_PACK_COMPRESS;
+        ptype = PACK_COMPRESS;
+        mqs->pack = tbx_pack_create(ptype, PACK_WRITE, &(mqs->data[MQS_HEADER]), mqs->len-MQS_HEADER);
+    }
     log_printf(1, "msid=%d ptype=%d tbx_pack_type=%c\n", mqs->msid, ptype, mqs->data[MQS_PACK_INDEX]);
-    mqs->pack = tbx_pack_create(ptype, PACK_WRITE, &(mqs->data[MQS_HEADER]), mqs->len-MQS_HEADER);
 
     log_printf(5, "initial used bpos=%d\n", tbx_pack_used(mqs->pack));
 
@@ -16,10 +16,12 @@
 
 #define _log_module_index 128
 
+#include <apr_atomic.h>
 #include <apr_errno.h>
 #include <apr_pools.h>
 #include <apr_thread_cond.h>
 #include <apr_thread_mutex.h>
+#include <apr_thread_proc.h>
 #include <stdlib.h>
 #include <string.h>
 #include <tbx/assert_result.h>
@@ -137,8 +139,70 @@ void gop_shutdown()
     }
 }
 
+//*************************************************************
+// _opque_finished_push - Adds the task to the finished list.  Lock-free
+//    so completing tasks don't have to fight over the que lock.
+//*************************************************************
+
+void _opque_finished_push(gop_que_data_t *q, gop_op_generic_t *gop)
+{
+    void *head;
+
+    tbx_atomic_inc(q->n_finished);
+    do {
+        head = apr_atomic_casptr(&(q->finished_head), NULL, NULL);  //** Just a fenced read
+        gop->base.finished_next = (gop_op_generic_t *)head;
+    } while (apr_atomic_casptr(&(q->finished_head), gop, head) != head);
+}
+
+//*************************************************************
+// _opque_finished_pop - Returns the oldest finished task or NULL
+//   NOTE: The que lock should be held
+//*************************************************************
+
+gop_op_generic_t *_opque_finished_pop(gop_que_data_t *q)
+{
+    gop_op_generic_t *gop, *next;
+
+    gop = (gop_op_generic_t *)tbx_stack_pop(q->finished);
+    if (gop == NULL) {  //** Grab everything that's been pushed
+        gop = (gop_op_generic_t *)apr_atomic_xchgptr(&(q->finished_head), NULL);
+        if (gop == NULL) return(NULL);
+
+        //** It's newest first so pushing them leaves the oldest on top
+        for (; gop != NULL; gop = next) {
+            next = gop->base.finished_next;
+            gop->base.finished_next = NULL;
+            tbx_stack_push(q->finished, gop);
+        }
+        gop = (gop_op_generic_t *)tbx_stack_pop(q->finished);
+    }
+
+    tbx_atomic_dec(q->n_finished);
+    return(gop);
+}
+
+//*************************************************************
+// _opque_nleft_dec - Decrements nleft without the lock if it's not the
+//    last task.  Returns 0 if successful or 1 if the lock is needed.
+//*************************************************************
+
+int _opque_nleft_dec(gop_que_data_t *q)
+{
+    apr_uint32_t n;
+
+    do {
+        n = tbx_atomic_get(q->nleft);
+        if (n <= 1) return(1);  //** Completion has to be done under the lock
+    } while (tbx_atomic_cas(q->nleft, n-1, n) != n);
+
+    return(0);
+}
+
 //*************************************************************
 // _opque_cb - Global callback for all opque's
+//    Successful tasks that aren't the last one and have nobody waiting
+//    on the que complete without taking the que lock.
 //*************************************************************
 
 void _opque_cb(void *v, int mode)
@@ -150,6 +214,8 @@ void _opque_cb(void *v, int mode)
 
     log_printf(15, "_opque_cb: START qid=%d gid=%d\n", gop_id(&(q->opque->op)), gop_id(gop));
 
+    tbx_atomic_inc(q->n_cb);  //** Keeps the que from being freed out from under us
+
     //** Get the status (gop is already locked)
     type = gop_get_type(gop);
     if (type == Q_TYPE_QUE) {
@@ -160,43 +226,49 @@ void _opque_cb(void *v, int mode)
         success = gop->base.status;
     }
 
-    lock_opque(q);
-
-    log_printf(15, "_opque_cb: qid=%d gid=%d success=%d gop_type(gop)=%d\n", gop_id(&(q->opque->op)), gop_id(gop), success.op_status, gop_get_type(gop));
+    //** It always goes on the finished list
+    _opque_finished_push(q, gop);
+    log_printf(15, "PUSH finished gid=%d qid=%d\n", gop_id(gop), gop_id(&(q->opque->op)));
 
+    //** See if we can take the fast path.  The push above is a full barrier so a waiter
+    //** that registered before we read n_waiters gets the broadcast and one that registers
+    //** after will find the task on the finished list.
+    if ((success.op_status != OP_STATE_FAILURE) && (tbx_atomic_get(q->opque->op.base.ctl->n_waiters) == 0)) {
+        if (_opque_nleft_dec(q) == 0) {
+            log_printf(15, "_opque_cb: FAST END qid=%d gid=%d\n", gop_id(&(q->opque->op)), gop_id(gop));
+            tbx_atomic_dec(q->n_cb);
+            return;
+        }
+    }
 
-    //** It always goes on the finished list
-    tbx_stack_move_to_bottom(q->finished);
-    tbx_stack_insert_below(q->finished, gop);
+    lock_opque(q);
 
-    log_printf(15, "PUSH finished gid=%d qid=%d\n", gop_id(gop), gop_id(&(q->opque->op)));
-    log_printf(15, "Printing finished stack for qid=%d\n", gop_id(&(q->opque->op)));
-    if (tbx_log_level() > 15) _opque_print_stack(q->finished);
+    log_printf(15, "_opque_cb: qid=%d gid=%d success=%d gop_type(gop)=%d\n", gop_id(&(q->opque->op)), gop_id(gop), success.op_status, gop_get_type(gop));
 
     if (success.op_status == OP_STATE_FAILURE) tbx_stack_push(q->failed, gop); //** Push it on the failed list if needed
 
-    q->nleft--;
-    log_printf(15, "_opque_cb: qid=%d gid=%d nleft=%d tbx_stack_count(q->failed)=%d tbx_stack_count(q->finished)=%d\n", gop_id(&(q->opque->op)), gop_id(gop), q->nleft, tbx_stack_count(q->failed), tbx_stack_count(q->finished));
+    n = tbx_atomic_dec(q->nleft);
+    log_printf(15, "_opque_cb: qid=%d gid=%d nleft=%d tbx_stack_count(q->failed)=%d n_finished=%d\n", gop_id(&(q->opque->op)), gop_id(gop), tbx_atomic_get(q->nleft), tbx_stack_count(q->failed), tbx_atomic_get(q->n_finished));
     tbx_log_flush();
 
-    if (q->nleft <= 0) {  //** we're finished
+    if (n == 0) {  //** we're finished
         if (tbx_stack_count(q->failed) == 0) {
             q->opque->op.base.status = gop_success_status;
             callback_execute(q->opque->op.base.cb, OP_STATE_SUCCESS);
 
             //** Lastly trigger the signal. for anybody listening
-            apr_thread_cond_broadcast(q->opque->op.base.ctl->cond);
+            gop_control_broadcast(q->opque->op.base.ctl);
         } else if (q->opque->op.base.retries == 0) {  //** How many times we're retried
             //** Trigger the callbacks
             q->opque->op.base.retries++;
-            q->nleft = 0;
+            tbx_atomic_set(q->nleft, 0);
             q->opque->op.base.failure_mode = 0;
             callback_execute(&(q->failure_cb), OP_STATE_FAILURE);  //** Attempt to fix things
 
             if (q->opque->op.base.failure_mode == 0) {  //** No retry
                 q->opque->op.base.status = gop_failure_status;
                 callback_execute(q->opque->op.base.cb, OP_STATE_FAILURE);  //**Execute the other CBs
-                apr_thread_cond_broadcast(q->opque->op.base.ctl->cond);  //** and fail for good
+                gop_control_broadcast(q->opque->op.base.ctl);  //** and fail for good
             }
 
             //** If retrying don't send the broadcast
@@ -204,17 +276,19 @@ void _opque_cb(void *v, int mode)
             tbx_log_flush();
         } else {
             //** Finished with errors but trigger the signal for anybody listening
-            apr_thread_cond_broadcast(q->opque->op.base.ctl->cond);
+            gop_control_broadcast(q->opque->op.base.ctl);
         }
     } else {
         //** Not finished but trigger the signal for anybody listening
-        apr_thread_cond_broadcast(q->opque->op.base.ctl->cond);
+        gop_control_broadcast(q->opque->op.base.ctl);
     }
 
     log_printf(15, "_opque_cb: END qid=%d gid=%d\n", gop_id(&(q->opque->op)), gop_id(gop));
     tbx_log_flush();
 
     unlock_opque(q);
+
+    tbx_atomic_dec(q->n_cb);
 }
 
 //*************************************************************
@@ -254,7 +328,7 @@ void init_opque(gop_opque_t *q)
     que->list = tbx_stack_new();
     que->finished = tbx_stack_new();
     que->failed = tbx_stack_new();
-    que->nleft = 0;
+    tbx_atomic_set(que->nleft, 0);
     que->nsubmitted = 0;
     gop->base.retries = 0;
     que->finished_submission = 0;
@@ -278,11 +352,11 @@ gop_opque_t *gop_opque_new()
 // free_finished_stack - Frees an opque
 //*************************************************************
 
-void free_finished_stack(tbx_stack_t *stack, int mode)
+void free_finished_stack(gop_que_data_t *q, int mode)
 {
     gop_op_generic_t *gop;
 
-    gop = (gop_op_generic_t *)tbx_stack_pop(stack);
+    gop = _opque_finished_pop(q);
     while (gop != NULL) {
         if (gop->type == Q_TYPE_QUE) {
             gop_opque_free(gop->q->opque, mode);
@@ -290,10 +364,10 @@ void free_finished_stack(tbx_stack_t *stack, int mode)
             if (gop->base.free != NULL) gop->base.free(gop, mode);
         }
 
-        gop = (gop_op_generic_t *)tbx_stack_pop(stack);
+        gop = _opque_finished_pop(q);
     }
 
-    tbx_stack_free(stack, 0);
+    tbx_stack_free(q->finished, 0);
 }
 
 //*************************************************************
@@ -331,13 +405,16 @@ void gop_opque_free(gop_opque_t *opq, int mode)
 {
     gop_que_data_t *q = &(opq->qd);
 
-    log_printf(15, "qid=%d nfin=%d nlist=%d nfailed=%d\n", gop_id(&(opq->op)), tbx_stack_count(q->finished), tbx_stack_count(q->list), tbx_stack_count(q->failed));
+    log_printf(15, "qid=%d nfin=%d nlist=%d nfailed=%d\n", gop_id(&(opq->op)), tbx_atomic_get(q->n_finished), tbx_stack_count(q->list), tbx_stack_count(q->failed));
+
+    //** Wait for any lock-free completions to get out.  They're already on the finished list
+    while (tbx_atomic_get(q->n_cb) > 0) apr_thread_yield();
 
     lock_opque(&(opq->qd));  //** Lock it to make sure Everything is finished and safe to free
 
     //** Free the stacks
     tbx_stack_free(q->failed, 0);
-    free_finished_stack(q->finished, mode);
+    free_finished_stack(q, mode);
     free_list_stack(q->list, mode);
 
     unlock_opque(&(opq->qd));  //** Has to be unlocked for gop_generic_free to work cause it also locks it
@@ -371,7 +448,7 @@ int internal_gop_opque_add(gop_opque_t *que, gop_op_generic_t *gop, int dolock)
 
     //**Add the op to the q
     q->nsubmitted++;
-    q->nleft++;
+    tbx_atomic_inc(q->nleft);
     if (q->opque->op.base.started_execution == 0) {
         tbx_stack_move_to_bottom(q->list);
         tbx_stack_insert_below(q->list, (void *)cb);
@@ -266,6 +266,8 @@ int parse_config(tbx_inip_file_t *keyfile, Config_t *cfg, int force_rebuild)
 
   cfg->dbenv_loc = "/tmp/ibp_dbenv";
   cfg->db_mem = 256;
+  cfg->db_group_commit = 1;
+  cfg->db_group_commit_window = 0;
   cfg->force_resource_rebuild = force_rebuild;
   cfg->truncate_expiration = 0;
   cfg->soft_fail = -1;
@@ -331,6 +333,8 @@ int parse_config(tbx_inip_file_t *keyfile, Config_t *cfg, int force_rebuild)
 
   cfg->dbenv_loc = tbx_inip_get_string(keyfile, "server", "db_env_loc", cfg->dbenv_loc);
   cfg->db_mem = tbx_inip_get_integer(keyfile, "server", "db_mem", cfg->db_mem);
+  cfg->db_group_commit = tbx_inip_get_integer(keyfile, "server", "db_group_commit", cfg->db_group_commit);
+  cfg->db_group_commit_window = tbx_inip_get_integer(keyfile, "server", "db_group_commit_window_us", cfg->db_group_commit_window);
 
   server->alog_name = tbx_inip_get_string(keyfile, "server", "activity_file", server->alog_name);
   server->alog_max_size = tbx_inip_get_integer(keyfile, "server", "activity_maxsize", server->alog_max_size) * 1024 * 1024;
@@ -362,6 +366,7 @@ int parse_config(tbx_inip_file_t *keyfile, Config_t *cfg, int force_rebuild)
   apr_pool_t *mount_pool;
   apr_pool_create(&mount_pool, NULL);
   cfg->dbenv = create_db_env(cfg->dbenv_loc, cfg->db_mem, cfg->force_resource_rebuild);
+  if (cfg->db_group_commit == 1) db_env_group_commit_enable(cfg->dbenv, cfg->db_group_commit_window);
   k= tbx_inip_group_count(keyfile);
   tbx_type_malloc_clear(pmarray, pMount_t, k-1);
   tbx_inip_group_t *igrp = tbx_inip_group_first(keyfile);
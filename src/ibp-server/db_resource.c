@@ -45,6 +45,9 @@
 #define DB_INDEX_EXPIRE 4
 #define DB_INDEX_SOFT   5
 
+#define DB_READ_RETRY  10     //** How many times a lookup is retried if picked as a deadlock victim
+#define DBR_CACHE_SIZE 16384  //** Default number of cap cache slots
+
 apr_thread_mutex_t *dbr_mutex = NULL;  //** Only used if testing a common lock
 
 #define db_txn(str, err)       \
@@ -214,6 +217,151 @@ int compare_expiration(DB *db, const DBT *k1, const DBT *k2)
 
 }
 
+//***************************************************************************
+// dbr_cache_slot - Maps a cap to its cache slot
+//***************************************************************************
+
+int dbr_cache_slot(dbr_cache_t *c, int cap_type, const char *cap)
+{
+  uint32_t h;
+  int i;
+
+  h = 2166136261U;  //** FNV-1a.  The caps are random so this is plenty
+  for (i=0; (i<CAP_SIZE) && (cap[i] != '\0'); i++) {
+     h = (h ^ (unsigned char)cap[i]) * 16777619U;
+  }
+  h = (h ^ cap_type) * 16777619U;
+
+  return(h % c->n_slots);
+}
+
+#define dbr_cache_stripe(c, slot) (&((c)->stripe[(slot) % DBR_CACHE_LOCKS]))
+
+//***************************************************************************
+// dbr_cache_create - Creates the cap cache with n_slots entries
+//***************************************************************************
+
+dbr_cache_t *dbr_cache_create(apr_pool_t *pool, int n_slots)
+{
+  dbr_cache_t *c;
+  int i;
+
+  if (n_slots <= 0) return(NULL);
+
+  tbx_type_malloc_clear(c, dbr_cache_t, 1);
+  c->n_slots = n_slots;
+  tbx_type_malloc_clear(c->slot, dbr_cache_entry_t, n_slots);
+  for (i=0; i<n_slots; i++) c->slot[i].cap_type = -1;
+  for (i=0; i<DBR_CACHE_LOCKS; i++) {
+     apr_thread_mutex_create(&(c->stripe[i].lock), APR_THREAD_MUTEX_DEFAULT, pool);
+  }
+
+  return(c);
+}
+
+//***************************************************************************
+// dbr_cache_destroy - Destroys the cap cache.  The locks go with the pool.
+//***************************************************************************
+
+void dbr_cache_destroy(dbr_cache_t *c)
+{
+  if (c == NULL) return;
+
+  free(c->slot);
+  free(c);
+}
+
+//***************************************************************************
+// dbr_cache_get - Looks up the cap in the cache.  Returns 0 on a hit and
+//    stores the allocation in alloc.  On a miss the stripe generation is
+//    returned in gen for use with dbr_cache_insert().
+//***************************************************************************
+
+int dbr_cache_get(dbr_cache_t *c, int cap_type, Cap_t *cap, Allocation_t *alloc, uint64_t *gen)
+{
+  dbr_cache_stripe_t *s;
+  dbr_cache_entry_t *e;
+  int slot, err;
+
+  slot = dbr_cache_slot(c, cap_type, cap->v);
+  s = dbr_cache_stripe(c, slot);
+  e = &(c->slot[slot]);
+
+  err = 1;
+  apr_thread_mutex_lock(s->lock);
+  if ((e->cap_type == cap_type) && (strncmp(e->a.caps[cap_type].v, cap->v, CAP_SIZE) == 0)) {
+     *alloc = e->a;
+     err = 0;
+  } else {
+     *gen = s->gen;
+  }
+  apr_thread_mutex_unlock(s->lock);
+
+  if (err == 0) {
+     tbx_atomic_inc(c->hits);
+  } else {
+     tbx_atomic_inc(c->misses);
+  }
+
+  return(err);
+}
+
+//***************************************************************************
+// dbr_cache_insert - Adds an allocation fetched from the DB to the cache.
+//    If the stripe was updated since the lookup started the result may be
+//    stale and is dropped.
+//***************************************************************************
+
+void dbr_cache_insert(dbr_cache_t *c, int cap_type, Allocation_t *a, uint64_t gen)
+{
+  dbr_cache_stripe_t *s;
+  dbr_cache_entry_t *e;
+  int slot;
+
+  slot = dbr_cache_slot(c, cap_type, a->caps[cap_type].v);
+  s = dbr_cache_stripe(c, slot);
+  e = &(c->slot[slot]);
+
+  apr_thread_mutex_lock(s->lock);
+  if (s->gen == gen) {
+     e->cap_type = cap_type;
+     e->a = *a;
+  }
+  apr_thread_mutex_unlock(s->lock);
+}
+
+//***************************************************************************
+// dbr_cache_update - Refreshes or drops (a == NULL) the cached copies of an
+//    allocation.  old supplies the caps to look for.
+//    NOTE: Should be called after the DB has been changed
+//***************************************************************************
+
+void dbr_cache_update(dbr_cache_t *c, Allocation_t *old, Allocation_t *a)
+{
+  dbr_cache_stripe_t *s;
+  dbr_cache_entry_t *e;
+  int i, slot;
+
+  if (c == NULL) return;
+
+  for (i=0; i<3; i++) {
+     slot = dbr_cache_slot(c, i, old->caps[i].v);
+     s = dbr_cache_stripe(c, slot);
+     e = &(c->slot[slot]);
+
+     apr_thread_mutex_lock(s->lock);
+     s->gen++;
+     if ((e->cap_type == i) && (strncmp(e->a.caps[i].v, old->caps[i].v, CAP_SIZE) == 0)) {
+        if (a == NULL) {
+           e->cap_type = -1;
+        } else {
+           e->a = *a;
+        }
+     }
+     apr_thread_mutex_unlock(s->lock);
+  }
+}
+
 //***************************************************************************
 // print_db_resource - Prints the DB resource
 //***************************************************************************
@@ -223,8 +371,12 @@ int print_db_resource(char *buffer, int *used, int nbytes, DB_resource_t *dbr)
   int i;
   tbx_append_printf(buffer, used, nbytes, "[%s]\n", dbr->kgroup);
   i = tbx_append_printf(buffer, used, nbytes, "loc = %s\n", dbr->loc);
+  if (dbr->cache != NULL) {
+     tbx_append_printf(buffer, used, nbytes, "cap_cache_size = %d\n", dbr->cache->n_slots);
+     i = tbx_append_printf(buffer, used, nbytes, "# cap_cache hits=%u misses=%u\n", tbx_atomic_get(dbr->cache->hits), tbx_atomic_get(dbr->cache->misses));
+  }
 
-  return(i);   
+  return(i);
 }
 
 
@@ -323,6 +475,7 @@ int mkfs_db(DB_resource_t *dbres, char *loc, const char *kgroup, FILE *fd) {
    //** and make the mutex
    apr_pool_create(&(dbres->pool), NULL);
    apr_thread_mutex_create(&(dbres->mutex), APR_THREAD_MUTEX_DEFAULT,dbres->pool);
+   dbres->cache = NULL;
 
    used = 0;   
    print_db_resource(buffer, &used, sizeof(buffer), dbres);
@@ -356,6 +509,7 @@ int mount_db_generic(tbx_inip_file_t *kf, const char *kgroup, DB_env_t *env, DB_
       log_printf(10, "mount_db_generic:  Creating local DB environment. loc=%s max_size=" ST " wipe_clean=%d\n", dbres->loc, env->max_size, wipe_clean);
       lenv = create_db_env(dbres->loc, env->max_size, wipe_clean);
       lenv->local = 1;
+      if (env->gc_enable == 1) db_env_group_commit_enable(lenv, env->gc_window);
       dbres->env = lenv;
    }
 
@@ -464,9 +618,10 @@ int mount_db_generic(tbx_inip_file_t *kf, const char *kgroup, DB_env_t *env, DB_
       abort();
    }
 
-   //** and make the mutex
+   //** and make the mutex and cap cache
    apr_pool_create(&(dbres->pool), NULL);
    apr_thread_mutex_create(&(dbres->mutex), APR_THREAD_MUTEX_DEFAULT,dbres->pool);
+   dbres->cache = dbr_cache_create(dbres->pool, tbx_inip_get_integer(kf, kgroup, "cap_cache_size", DBR_CACHE_SIZE));
 
    return(0);
 }
@@ -525,6 +680,7 @@ int umount_db(DB_resource_t *dbres)
     }
   }
 
+  dbr_cache_destroy(dbres->cache);
   apr_thread_mutex_destroy(dbres->mutex);
   apr_pool_destroy(dbres->pool);
 
@@ -612,6 +768,7 @@ DB_env_t *create_db_env(const char *loc, int db_mem, int wipe_clean)
    assert_result(dbenv->set_cachesize(dbenv, gbytes, bytes, 1), 0);
 //   assert_result(dbenv->set_flags(dbenv, DB_TXN_NOSYNC | DB_TXN_NOWAIT, 1), 0);
    assert_result(dbenv->log_set_config(dbenv, DB_LOG_AUTO_REMOVE, 1), 0);
+   assert_result(dbenv->set_lk_detect(dbenv, DB_LOCK_MINWRITE), 0);  //** Lookups run without the resource lock so let them lose any deadlock
    if ((err=dbenv->open(dbenv, loc, flags, 0)) != 0) {
       printf("create_db_env: Warning!  No environment located in %s\n", loc);
       printf("create_db_env: Attempting to create a new environment.\n");
@@ -631,6 +788,98 @@ DB_env_t *create_db_env(const char *loc, int db_mem, int wipe_clean)
    return(env);
 }
 
+//***************************************************************************
+// db_env_flush_thread - Group commit thread.  Syncs the log once for each
+//    batch of commits waiting on it.  It also flushes at least once a second
+//    so commits that don't wait are still bounded.
+//***************************************************************************
+
+void *db_env_flush_thread(apr_thread_t *th, void *data)
+{
+  DB_env_t *env = (DB_env_t *)data;
+  uint64_t target;
+  int err;
+
+  apr_thread_mutex_lock(env->gc_lock);
+  while (env->gc_shutdown == 0) {
+     if (env->gc_requested == env->gc_flushed) apr_thread_cond_timedwait(env->gc_cond, env->gc_lock, apr_time_from_sec(1));
+
+     if ((env->gc_window > 0) && (env->gc_requested != env->gc_flushed)) {  //** Let more commits join the batch
+        apr_thread_mutex_unlock(env->gc_lock);
+        apr_sleep(env->gc_window);
+        apr_thread_mutex_lock(env->gc_lock);
+     }
+
+     target = env->gc_requested;
+     apr_thread_mutex_unlock(env->gc_lock);
+
+     err = env->dbenv->log_flush(env->dbenv, NULL);
+     if (err != 0) log_printf(0, "db_env_flush_thread: log_flush error: %s\n", db_strerror(err));
+
+     apr_thread_mutex_lock(env->gc_lock);
+     if (target != env->gc_flushed) {
+        log_printf(15, "db_env_flush_thread: batch=" LU " commits=" LU "\n", env->gc_batches, target - env->gc_flushed);
+        env->gc_batches++;
+        env->gc_flushed = target;
+        apr_thread_cond_broadcast(env->gc_done);
+     }
+  }
+  apr_thread_mutex_unlock(env->gc_lock);
+
+  return(NULL);
+}
+
+//***************************************************************************
+// db_env_group_commit_enable - Switches the environment to group commit.
+//    Transactions no longer sync on commit.  Instead callers use
+//    db_env_commit_wait() and a single log flush covers everyone waiting.
+//***************************************************************************
+
+int db_env_group_commit_enable(DB_env_t *env, apr_time_t window)
+{
+  int err;
+
+  env->gc_enable = 1;
+  env->gc_window = window;
+
+  if (env->dbenv == NULL) return(0);  //** Resources make their own environment and inherit the settings
+
+  if ((err = env->dbenv->set_flags(env->dbenv, DB_TXN_WRITE_NOSYNC, 1)) != 0) {
+     log_printf(0, "db_env_group_commit_enable: Can't disable commit syncs! err=%s\n", db_strerror(err));
+     env->gc_enable = 0;
+     return(err);
+  }
+
+  apr_pool_create(&(env->gc_pool), NULL);
+  apr_thread_mutex_create(&(env->gc_lock), APR_THREAD_MUTEX_DEFAULT, env->gc_pool);
+  apr_thread_cond_create(&(env->gc_cond), env->gc_pool);
+  apr_thread_cond_create(&(env->gc_done), env->gc_pool);
+  apr_thread_create(&(env->gc_thread), NULL, db_env_flush_thread, (void *)env, env->gc_pool);
+
+  log_printf(5, "db_env_group_commit_enable: window=" TT "\n", env->gc_window);
+  return(0);
+}
+
+//***************************************************************************
+// db_env_commit_wait - Blocks until the log has been synced past any
+//    transactions the caller already committed.
+//***************************************************************************
+
+void db_env_commit_wait(DB_env_t *env)
+{
+  uint64_t me;
+
+  if ((env == NULL) || (env->gc_thread == NULL)) return;  //** Commits are synchronous
+
+  apr_thread_mutex_lock(env->gc_lock);
+  me = ++(env->gc_requested);
+  apr_thread_cond_signal(env->gc_cond);
+  while (env->gc_flushed < me) {
+     apr_thread_cond_wait(env->gc_done, env->gc_lock);
+  }
+  apr_thread_mutex_unlock(env->gc_lock);
+}
+
 //***************************************************************************
 // close_db_env - Closes the DB environment
 //***************************************************************************
@@ -638,6 +887,16 @@ DB_env_t *create_db_env(const char *loc, int db_mem, int wipe_clean)
 int close_db_env(DB_env_t *env)
 {
   int err = 0;
+  apr_status_t val;
+
+  if (env->gc_thread != NULL) {  //** Shut down the flush thread
+     apr_thread_mutex_lock(env->gc_lock);
+     env->gc_shutdown = 1;
+     apr_thread_cond_signal(env->gc_cond);
+     apr_thread_mutex_unlock(env->gc_lock);
+     apr_thread_join(&val, env->gc_thread);
+     apr_pool_destroy(env->gc_pool);
+  }
 
   if (env->dbenv != NULL) {
     err = env->dbenv->close(env->dbenv, 0);
@@ -674,13 +933,11 @@ int get_num_allocations_db(DB_resource_t *db)
 //  u_int32_t flags = DB_FAST_STAT;
   u_int32_t flags = DB_READ_COMMITTED;
 
-  
-  dbr_lock(db);
-  err = db->pdb->stat(db->pdb, NULL, (void *)&dstat, flags);   
+
+  err = db->pdb->stat(db->pdb, NULL, (void *)&dstat, flags);
   if (err != 0) {
      log_printf(0, "get_allocations_db:  error=%d  (%s)\n", err, db_strerror(err));
   }
-  dbr_unlock(db);
 
   n = -1;
   if (err == 0) {
@@ -695,6 +952,25 @@ int get_num_allocations_db(DB_resource_t *db)
 
 //---------------------------------------------------------------------------
 
+//***************************************************************************
+// _dbr_get - Does a DB lookup outside of any transaction.  Lookups don't
+//     hold the resource lock so they can be picked as a deadlock victim
+//     by a concurrent update.  If so just retry.
+//***************************************************************************
+
+int _dbr_get(DB *db, DBT *key, DBT *data)
+{
+  int err, i;
+
+  for (i=0; i<DB_READ_RETRY; i++) {
+     err = db->get(db, NULL, key, data, 0);
+     if (err != DB_LOCK_DEADLOCK) break;
+     log_printf(5, "_dbr_get: Deadlock victim. retry=%d\n", i);
+  }
+
+  return(err);
+}
+
 //***************************************************************************
 // _get_alloc_with_id_db - Returns the alloc with the given ID from the DB
 //      internal version that does no locking
@@ -715,7 +991,7 @@ int _get_alloc_with_id_db(DB_resource_t *dbr, osd_id_t id, Allocation_t *alloc)
   data.ulen = sizeof(Allocation_t);
   data.flags = DB_DBT_USERMEM;
 
-  err = dbr->pdb->get(dbr->pdb, NULL, &key, &data, 0);
+  err = _dbr_get(dbr->pdb, &key, &data);
   if (err != 0) {
      log_printf(10, "_get_alloc_with_id_db:  Unknown ID=" LU " error=%d  (%s)\n", id, err, db_strerror(err));
   }
@@ -724,23 +1000,22 @@ int _get_alloc_with_id_db(DB_resource_t *dbr, osd_id_t id, Allocation_t *alloc)
 }
 
 //***************************************************************************
-// get_alloc_with_id_db - Returns the alloc with the given ID from the DB
+// get_alloc_with_id_db - Returns the alloc with the given ID from the DB.
+//    The DB handles are free threaded so no resource lock is needed.
 //***************************************************************************
 
 int get_alloc_with_id_db(DB_resource_t *dbr, osd_id_t id, Allocation_t *alloc)
 {
-  dbr_lock(dbr);
-  int err = _get_alloc_with_id_db(dbr, id, alloc);
-  dbr_unlock(dbr);
-  return(err);
+  return(_get_alloc_with_id_db(dbr, id, alloc));
 }
 
 //***************************************************************************
-// _put_alloc_db - Stores the allocation in the DB
+// _put_alloc_txn_db - Stores the allocation in the DB as part of the given
+//    transaction.  If txn is NULL the put is auto committed.
 //    Internal routine that performs no locking
 //***************************************************************************
 
-int _put_alloc_db(DB_resource_t *dbr, Allocation_t *a)
+int _put_alloc_txn_db(DB_resource_t *dbr, DB_TXN *txn, Allocation_t *a)
 {
   int err;
   DBT key, data;
@@ -758,12 +1033,12 @@ int _put_alloc_db(DB_resource_t *dbr, Allocation_t *a)
   data.data = a;
   data.size = sizeof(Allocation_t);
 
-//db_txn("_put_alloc_db", err);
-  if ((err = dbr->pdb->put(dbr->pdb, NULL, &key, &data, 0)) != 0) {
+  if ((err = dbr->pdb->put(dbr->pdb, txn, &key, &data, 0)) != 0) {
      log_printf(10, "put_alloc_db: Error storing primary key: %d id=" LU "\n", err, a->id);
      return(err);
   }
-//db_commit("_put_alloc_db", err)
+
+  dbr_cache_update(dbr->cache, a, a);
 
   apr_time_t t = ibp2apr_time(a->expiration);
   log_printf(10, "put_alloc_db: err=%d  id=" LU ", r=%s w=%s m=%s a.size=" LU " a.max_size=" LU " expire=" TT "\n", 
@@ -772,6 +1047,16 @@ int _put_alloc_db(DB_resource_t *dbr, Allocation_t *a)
   return(0);
 }
 
+//***************************************************************************
+// _put_alloc_db - Stores the allocation in the DB
+//    Internal routine that performs no locking
+//***************************************************************************
+
+int _put_alloc_db(DB_resource_t *dbr, Allocation_t *a)
+{
+  return(_put_alloc_txn_db(dbr, NULL, a));
+}
+
 //***************************************************************************
 // put_alloc_db - Stores the allocation in the DB
 //***************************************************************************
@@ -784,6 +1069,8 @@ int put_alloc_db(DB_resource_t *dbr, Allocation_t *a)
   err = _put_alloc_db(dbr, a);
   dbr_unlock(dbr);
 
+  if (err == 0) db_env_commit_wait(dbr->env);
+
 //Allocation_t a2;
 //err=get_alloc_with_cap_db(dbr, MANAGE_CAP, &(a->caps[MANAGE_CAP]), &a2);
   
@@ -816,6 +1103,8 @@ int modify_alloc_iter_db(DB_iterator_t *it, Allocation_t *a)
   err = it->cursor->put(it->cursor, NULL, &data, DB_CURRENT);
   if (err != 0) {
      log_printf(0, "modify_alloc_iter_db: %s\n", db_strerror(err));
+  } else {
+     dbr_cache_update(it->dbr->cache, a, a);
   }
 
   return(err);
@@ -827,23 +1116,38 @@ int modify_alloc_iter_db(DB_iterator_t *it, Allocation_t *a)
 
 int remove_alloc_iter_db(DB_iterator_t *it)
 {
-  int err;
+  int err, cerr;
+  DBT key, data;
+  Allocation_t a;
 
   debug_printf(10, "_remove_alloc_iter_db: Start\n");
 
+  cerr = 1;
+  if (it->dbr->cache != NULL) {  //** Need the caps to purge it from the cache
+     memset(&key, 0, sizeof(DBT));
+     memset(&data, 0, sizeof(DBT));
+     data.data = &a;
+     data.ulen = sizeof(Allocation_t);
+     data.flags = DB_DBT_USERMEM;
+     cerr = it->cursor->get(it->cursor, &key, &data, DB_CURRENT);
+  }
+
   err = it->cursor->c_del(it->cursor, 0);
   if (err != 0) {
      log_printf(0, "remove_alloc_iter_db: %s\n", db_strerror(err));
+  } else if (cerr == 0) {
+     dbr_cache_update(it->dbr->cache, &a, NULL);
   }
 
   return(err);
 }
 
 //***************************************************************************
-// _remove_alloc_db - Removes the given key from the DB
+// _remove_alloc_txn_db - Removes the given key from the DB as part of the
+//    given transaction.  If txn is NULL the delete is auto committed.
 //***************************************************************************
 
-int _remove_alloc_db(DB_resource_t *dbr, Allocation_t *alloc)
+int _remove_alloc_txn_db(DB_resource_t *dbr, DB_TXN *txn, Allocation_t *alloc)
 {
   DBT key;
   int err;
@@ -852,14 +1156,25 @@ int _remove_alloc_db(DB_resource_t *dbr, Allocation_t *alloc)
   key.data = &(alloc->id);
   key.size = sizeof(osd_id_t);
 
-  err = dbr->pdb->del(dbr->pdb, NULL, &key, 0);
+  err = dbr->pdb->del(dbr->pdb, txn, &key, 0);
   if (err != 0) {
      log_printf(0, "remove_alloc_db: %s\n", db_strerror(err));
   }
 
+  dbr_cache_update(dbr->cache, alloc, NULL);
+
   return(err);
 }
 
+//***************************************************************************
+// _remove_alloc_db - Removes the given key from the DB
+//***************************************************************************
+
+int _remove_alloc_db(DB_resource_t *dbr, Allocation_t *alloc)
+{
+  return(_remove_alloc_txn_db(dbr, NULL, alloc));
+}
+
 //***************************************************************************
 // remove_alloc_db - Removes the given key from the DB
 //***************************************************************************
@@ -872,6 +1187,8 @@ int remove_alloc_db(DB_resource_t *dbr, Allocation_t *a)
   err = _remove_alloc_db(dbr, a);
   dbr_unlock(dbr);
 
+  if (err == 0) db_env_commit_wait(dbr->env);
+
   return(err);
 }
 
@@ -884,6 +1201,99 @@ int modify_alloc_db(DB_resource_t *dbr, Allocation_t *a)
   return(put_alloc_db(dbr, a));
 }
 
+//***************************************************************************
+// remove_alloc_batch_db - Removes a batch of allocations from the DB using
+//    a single transaction.  If any remove fails the whole transaction is
+//    aborted.  Returns the number of failed removes.
+//***************************************************************************
+
+int remove_alloc_batch_db(DB_resource_t *dbr, Allocation_t **a, int n)
+{
+  int i, nfailed, err;
+  DB_TXN *txn = NULL;
+
+  if (n == 0) return(0);
+
+  nfailed = 0;
+  dbr_lock(dbr);
+  err = dbr->dbenv->txn_begin(dbr->dbenv, NULL, &txn, 0);
+  if (err != 0) {
+     log_printf(0, "remove_alloc_batch_db: Transaction begin failed with err %d\n", err);
+     txn = NULL;
+  }
+
+  for (i=0; i<n; i++) {
+     if (_remove_alloc_txn_db(dbr, txn, a[i]) != 0) {
+        nfailed++;
+        if (txn != NULL) break;   //** No point continuing since it all gets aborted
+     }
+  }
+
+  if (txn != NULL) {
+     if (nfailed > 0) {
+        log_printf(0, "remove_alloc_batch_db: Remove failed for id=" LU ". Aborting the transaction n=%d\n", a[i]->id, n);
+        if ((err = txn->abort(txn)) != 0) log_printf(0, "remove_alloc_batch_db: Transaction abort failed with err %d\n", err);
+        nfailed = n;
+     } else if ((err = txn->commit(txn, 0)) != 0) {
+        log_printf(0, "remove_alloc_batch_db: Transaction commit failed with err %d\n", err);
+        nfailed = n;
+     }
+  }
+  dbr_unlock(dbr);
+
+  if (nfailed < n) db_env_commit_wait(dbr->env);
+
+  return(nfailed);
+}
+
+//***************************************************************************
+// modify_alloc_batch_db - Stores a batch of modified allocations in the DB
+//    taking the DB lock only once and using a single transaction.  If any
+//    put fails the whole transaction is aborted.
+//    Returns the number of failed puts.
+//***************************************************************************
+
+int modify_alloc_batch_db(DB_resource_t *dbr, Allocation_t **a, int n)
+{
+  int i, nfailed, err;
+  DB_TXN *txn = NULL;
+
+  nfailed = 0;
+  dbr_lock(dbr);
+  err = dbr->dbenv->txn_begin(dbr->dbenv, NULL, &txn, 0);
+  if (err != 0) {
+     log_printf(0, "modify_alloc_batch_db: Transaction begin failed with err %d\n", err);
+     txn = NULL;
+  }
+
+  for (i=0; i<n; i++) {
+     if (_put_alloc_txn_db(dbr, txn, a[i]) != 0) {
+        nfailed++;
+        if (txn != NULL) break;   //** No point continuing since it all gets aborted
+     }
+  }
+
+  if (txn != NULL) {
+     if (nfailed > 0) {
+        log_printf(0, "modify_alloc_batch_db: Put failed for id=" LU ". Aborting the transaction n=%d\n", a[i]->id, n);
+        if ((err = txn->abort(txn)) != 0) log_printf(0, "modify_alloc_batch_db: Transaction abort failed with err %d\n", err);
+        err = 1;
+     } else if ((err = txn->commit(txn, 0)) != 0) {
+        log_printf(0, "modify_alloc_batch_db: Transaction commit failed with err %d\n", err);
+     }
+
+     if (err != 0) {
+        nfailed = n;
+        for (i=0; i<n; i++) dbr_cache_update(dbr->cache, a[i], NULL);  //** The cache was updated with the aborted values
+     }
+  }
+  dbr_unlock(dbr);
+
+  if (nfailed < n) db_env_commit_wait(dbr->env);
+
+  return(nfailed);
+}
+
 //***************************************************************************
 // _lookup_id_with_cap_db - Looks to see if the cap is stored
 //***************************************************************************
@@ -903,7 +1313,7 @@ int _lookup_id_with_cap_db(DB_resource_t *dbr, Cap_t *cap, int cap_type, osd_id_
   data.ulen = sizeof(Allocation_t);
   data.flags = DB_DBT_USERMEM;
 
-  int err = dbr->cap[cap_type]->get(dbr->cap[cap_type], NULL, &key, &data, 0);
+  int err = _dbr_get(dbr->cap[cap_type], &key, &data);
   if (err != 0) {
      log_printf(10, "lookup_id_with_cap_db: cap=%s err = %s\n", cap->v, db_strerror(err));
      if (err != DB_NOTFOUND) {
@@ -939,22 +1349,23 @@ int get_alloc_with_cap_db(DB_resource_t *dbr, int cap_type, Cap_t *cap, Allocati
   data.ulen = sizeof(Allocation_t);
   data.flags = DB_DBT_USERMEM;
 
-  dbr_lock(dbr); 
+  uint64_t gen = 0;
+  if (dbr->cache != NULL) {  //** Check the cache first
+     if (dbr_cache_get(dbr->cache, cap_type, cap, alloc, &gen) == 0) return(0);
+  }
 
-  log_printf(10, "get_alloc_with_cap_db:  After lock\n"); 
-  int err = dbr->cap[cap_type]->get(dbr->cap[cap_type], NULL, &key, &data, 0);
+  int err = _dbr_get(dbr->cap[cap_type], &key, &data);
   if (err != 0) {
      log_printf(0, "get_alloc_with_cap_db: cap=%s err = %s\n", cap->v, db_strerror(err));
-     dbr_unlock(dbr); 
      return(err);
   }
 
+  if (dbr->cache != NULL) dbr_cache_insert(dbr->cache, cap_type, alloc, gen);
+
 //apr_time_t t = ibp2apr_time(alloc->expiration);
 //debug_printf(10, "get_alloc_db: err=%d  id=" LU ", r=%s w=%s m=%s a.size=" LU " a.max_size=" LU " expireation=" TT "\n", 
 //      err, alloc->id, alloc->caps[READ_CAP].v, alloc->caps[WRITE_CAP].v, alloc->caps[MANAGE_CAP].v, alloc->size, alloc->max_size, t);
 
-  dbr_unlock(dbr); 
-
   return(err);
 }
 
@@ -997,6 +1408,8 @@ int create_alloc_db(DB_resource_t *dbr, Allocation_t *a)
 
    dbr_unlock(dbr); 
 
+   if (err == 0) db_env_commit_wait(dbr->env);
+
    return(err);
 }
 
@@ -22,9 +22,13 @@
 
 #include "visibility.h"
 #include <db.h>
+#include <stdint.h>
 #include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_proc.h>
 #include <apr_pools.h>
 #include "allocation.h"
+#include <tbx/atomic_counter.h>
 #include <tbx/iniparse.h>
 #include "ibp_time.h"
 
@@ -40,9 +44,40 @@ typedef struct {
   DB_ENV *dbenv;
   size_t max_size;
   int local;
+  int gc_enable;               //** Group commit.  Commits skip the sync and wait on a shared log flush
+  apr_time_t gc_window;        //** How long the flush thread waits for more commits to join a batch
+  uint64_t gc_requested;       //** Commits waiting on a log flush
+  uint64_t gc_flushed;         //** Last commit covered by a log flush
+  uint64_t gc_batches;         //** Number of log flushes performed
+  int gc_shutdown;
+  apr_thread_t *gc_thread;
+  apr_thread_mutex_t *gc_lock;
+  apr_thread_cond_t *gc_cond;  //** Wakes the flush thread
+  apr_thread_cond_t *gc_done;  //** Wakes the committers once their flush completes
+  apr_pool_t *gc_pool;
 } DB_env_t;
 
 
+#define DBR_CACHE_LOCKS 64    //** Number of lock stripes for the cap cache
+
+typedef struct {    //** Cap cache slot.  The key is a.caps[cap_type]
+  int cap_type;        //** -1 if the slot is empty
+  Allocation_t a;
+} dbr_cache_entry_t;
+
+typedef struct {    //** Cap cache lock stripe
+  apr_thread_mutex_t *lock;
+  uint64_t gen;        //** Bumped on every update so stale lookups aren't inserted
+} dbr_cache_stripe_t;
+
+typedef struct {    //** Bounded, direct mapped cap->allocation cache in front of the DB
+  int n_slots;
+  dbr_cache_entry_t *slot;
+  dbr_cache_stripe_t stripe[DBR_CACHE_LOCKS];
+  tbx_atomic_unit32_t hits;
+  tbx_atomic_unit32_t misses;
+} dbr_cache_t;
+
 typedef struct {  //Resource DB interface
     char *kgroup;          //Ini file group
     char *loc;             //Directory with all the DB's in it
@@ -52,8 +87,9 @@ typedef struct {  //Resource DB interface
     DB *soft;              //Expiration is used as the key but only soft allocs are stored in it  
     DB_env_t *env;
     DB_ENV *dbenv;         //Common DB enviroment to use
-    apr_thread_mutex_t *mutex;  // Lock used for creates
+    apr_thread_mutex_t *mutex;  // Serializes mutations and iterators.  Lookups don't use it
     apr_pool_t *pool;      //** Memory pool
+    dbr_cache_t *cache;    //** Cap lookup cache.  NULL if disabled
 } DB_resource_t;
 
 typedef struct {    //Container for cursor
@@ -73,6 +109,8 @@ int mount_db_generic(tbx_inip_file_t *kf, const char *kgroup, DB_env_t *dbenv, D
 int umount_db(DB_resource_t *dbres);
 IBPS_API DB_env_t *create_db_env(const char *loc, int db_mem, int run_recover);
 IBPS_API int close_db_env(DB_env_t *env);
+IBPS_API int db_env_group_commit_enable(DB_env_t *env, apr_time_t window);
+void db_env_commit_wait(DB_env_t *env);
 int print_db(DB_resource_t *db, FILE *fd);
 int get_num_allocations_db(DB_resource_t *db);
 int get_alloc_with_id_db(DB_resource_t *dbr, osd_id_t id, Allocation_t *alloc);
@@ -82,9 +120,11 @@ int _put_alloc_db(DB_resource_t *dbr, Allocation_t *a);
 int put_alloc_db(DB_resource_t *dbr, Allocation_t *alloc);
 int remove_id_only_db(DB_resource_t *dbr, osd_id_t id);
 int remove_alloc_db(DB_resource_t *dbr, Allocation_t *alloc);
+int remove_alloc_batch_db(DB_resource_t *dbr, Allocation_t **a, int n);
 int remove_alloc_iter_db(DB_iterator_t *it);
 int modify_alloc_iter_db(DB_iterator_t *it, Allocation_t *a);
 int modify_alloc_db(DB_resource_t *dbr, Allocation_t *a);
+int modify_alloc_batch_db(DB_resource_t *dbr, Allocation_t **a, int n);
 int create_alloc_db(DB_resource_t *dbr, Allocation_t *alloc);
 
 //DB_iterator_t *db_iterator_begin(DB *db);
@@ -1358,8 +1358,210 @@ int handle_manage(ibp_task_t *task)
   cmd->state = CMD_STATE_FINISHED;
   log_printf(10, "handle_manage: Sucessfully processed manage command\n");
 
-  unlock_osd_id(a->id); 
+  unlock_osd_id(a->id);
+
+  return(0);
+}
+
+typedef struct {
+  Resource_t *r;           //** Resource the cap lives on or NULL if an error occurred
+  Cap_t cap;               //** Manage cap
+  char crid[128];          //** Character version of the RID
+  Allocation_t a;
+  int status;              //** Status returned to the client
+} bulk_manage_ele_t;
+
+#define BULK_MANAGE_CHUNK 16  //** Max allocations locked at once by a bulk manage
+
+//*****************************************************************
+// _bulk_manage_resource - Changes the duration on all the caps in the
+//    bulk command living on the same resource as cap "start".  The
+//    allocations are processed in small chunks.  Each chunk is locked only
+//    while it's re-read, updated, and stored in the DB as a single batch so
+//    other commands on the depot aren't stalled by a large bulk request.
+//*****************************************************************
+
+void _bulk_manage_resource(ibp_task_t *task, bulk_manage_ele_t *e, int start, Allocation_t **alist, osd_id_t *ids)
+{
+  Cmd_state_t *cmd = &(task->cmd);
+  Cmd_bulk_manage_t *bulk = &(cmd->cargs.bulk_manage);
+  Resource_t *r = e[start].r;
+  Allocation_t *a;
+  ibp_time_t new_expiration;
+  int slot[BULK_MANAGE_CHUNK];
+  int i, j, k, n, ndone, nupdated, err;
+
+  new_expiration = ibp_time_now() + bulk->duration;
+  n = 0;
+  nupdated = 0;
+  i = start;
+  while (i < bulk->n) {
+     //** Form the next chunk of allocations on this resource
+     k = 0;
+     for (; (i<bulk->n) && (k<BULK_MANAGE_CHUNK); i++) {
+        if (e[i].r != r) continue;
+        slot[k] = i;
+        ids[k] = e[i].a.id;
+        k++;
+     }
+     if (k == 0) break;
+     n += k;
+
+     lock_osd_id_set(ids, k);  //** Lock them so we don't get race updates
+
+     ndone = 0;
+     for (j=0; j<k; j++) {
+        a = &(e[slot[j]].a);
+
+        //** Re-read the data with the lock enabled
+        if (get_allocation_resource(r, a->id, a) != 0) {
+           log_printf(10, "handle_bulk_manage: Error reading id after lock  id: " LU " rid=%s\n", a->id, r->name);
+           e[slot[j]].status = IBP_E_CAP_NOT_FOUND;
+           continue;
+        }
+
+        //** Same policy as the IBP_CHNG in handle_manage
+        e[slot[j]].status = IBP_OK;
+        if (new_expiration > (ibp_time_now()+r->max_duration)) {
+           e[slot[j]].status = IBP_E_WOULD_EXCEED_POLICY;
+           log_printf(10, "handle_bulk_manage: Duration >max_duration  id: " LU " rid=%s\n", a->id, r->name);
+        }
+        a->expiration = new_expiration;
+
+        alog_append_manage_change(task->myid, r->rl_index, a->id, a->max_size, a->reliability, a->expiration);
+        update_manage_history(r, a->id, a->is_alias, &(task->ipadd), IBP_MANAGE, IBP_CHNG, a->reliability, a->expiration, a->max_size, a->id);
+
+        alist[ndone] = a;
+        ndone++;
+     }
+
+     err = (ndone > 0) ? modify_expiration_batch_resource(r, alist, ndone) : 0;
+     if (err != 0) log_printf(0, "handle_bulk_manage: Error storing batch! rid=%s n=%d nfailed=%d\n", r->name, ndone, err);
+
+     unlock_osd_id_set(ids, k);
+
+     //** Flag them as processed.  If the batch failed we don't know which ones so flag them all
+     for (j=0; j<k; j++) {
+        e[slot[j]].r = NULL;
+        if ((err != 0) && (e[slot[j]].status != IBP_E_CAP_NOT_FOUND)) e[slot[j]].status = IBP_E_WOULD_EXCEED_POLICY;
+     }
+     if (err == 0) nupdated += ndone;
+  }
+
+  log_printf(10, "handle_bulk_manage: rid=%s n=%d updated=%d\n", r->name, n, nupdated);
+}
+
+//*****************************************************************
+// handle_bulk_manage - Processes the bulk manage command.  The caps are
+//    read from the stream and the duration is changed on each one.  The
+//    DB updates are batched by resource.
+//
+//  Returns
+//    status s_1 s_2 ... s_n \n
+//
+//  where s_i is the IBP status of the i'th cap
+//*****************************************************************
+
+int handle_bulk_manage(ibp_task_t *task)
+{
+  Cmd_state_t *cmd = &(task->cmd);
+  Cmd_bulk_manage_t *bulk = &(cmd->cargs.bulk_manage);
+  bulk_manage_ele_t *e;
+  Allocation_t **alist;
+  osd_id_t *ids;
+  tbx_ns_timeout_t dt;
+  char line[1024];
+  char *bstate, *buf;
+  int i, nbytes, bufsize, used, finished, nbad;
+
+  debug_printf(1, "handle_bulk_manage: Starting to process command n=%d ns=%d\n", bulk->n, tbx_ns_getid(task->ns));
+
+  tbx_type_malloc_clear(e, bulk_manage_ele_t, bulk->n);
+  tbx_type_malloc(alist, Allocation_t *, bulk->n);
+  tbx_type_malloc(ids, osd_id_t, bulk->n);
+
+  //** Read all the caps and look up the allocations
+  convert_epoch_time2net(&dt, task->cmd_timeout);
+  nbad = 0;
+  for (i=0; i<bulk->n; i++) {
+     nbytes = server_ns_readline(task->ns, line, sizeof(line), dt);
+     if (nbytes < 0) {
+        log_printf(10, "handle_bulk_manage: Error reading cap %d of %d ns=%d\n", i, bulk->n, tbx_ns_getid(task->ns));
+        free(e); free(alist); free(ids);
+        return(-1);
+     }
+
+     e[i].crid[sizeof(e[i].crid)-1] = '\0';
+     strncpy(e[i].crid, tbx_stk_string_token(line, " #", &bstate, &finished), sizeof(e[i].crid)-1);
+     e[i].cap.v[sizeof(e[i].cap.v)-1] = '\0';
+     strncpy(e[i].cap.v, tbx_stk_string_token(NULL, " ", &bstate, &finished), sizeof(e[i].cap.v)-1);
+
+     e[i].r = resource_lookup(global_config->rl, e[i].crid);
+     if (e[i].r == NULL) {
+        log_printf(10, "handle_bulk_manage:  Invalid RID :%s\n", e[i].crid);
+        e[i].status = IBP_E_INVALID_RID;
+     } else if ((resource_get_mode(e[i].r) & RES_MODE_MANAGE) == 0) {
+        log_printf(10, "handle_bulk_manage: Manage access is disabled cap: %s RID=%s\n", e[i].cap.v, e[i].r->name);
+        e[i].status = IBP_E_FILE_ACCESS;
+     } else if (get_allocation_by_cap_resource(e[i].r, MANAGE_CAP, &(e[i].cap), &(e[i].a)) != 0) {
+        log_printf(10, "handle_bulk_manage: Invalid cap: %s rid=%s\n", e[i].cap.v, e[i].r->name);
+        e[i].status = IBP_E_CAP_NOT_FOUND;
+     } else if (e[i].a.is_alias == 1) {  //** Just like IBP_MANAGE only a probe is allowed on an alias
+        log_printf(10, "handle_bulk_manage: Alias cap not supported: %s rid=%s\n", e[i].cap.v, e[i].r->name);
+        e[i].status = IBP_E_INVALID_CMD;
+     } else {
+        continue;  //** Good cap
+     }
+
+     e[i].r = NULL;
+     nbad++;
+     alog_append_manage_bad(task->myid, IBP_BULK_MANAGE, bulk->subcmd);
+  }
+
+  //** Now process each resource as a batch
+  for (i=0; i<bulk->n; i++) {
+     if (e[i].r != NULL) _bulk_manage_resource(task, e, i, alist, ids);
+  }
+
+  //** Send the results back
+  bufsize = 32 + 8*bulk->n;
+  tbx_type_malloc(buf, char, bufsize);
+  used = snprintf(buf, bufsize, "%d", IBP_OK);
+  for (i=0; i<bulk->n; i++) {
+     used += snprintf(buf + used, bufsize - used, " %d", e[i].status);
+  }
+  used += snprintf(buf + used, bufsize - used, " \n");
+
+  server_ns_write_block(task->ns, task->cmd_timeout, buf, used);
+  alog_append_cmd_result(task->myid, IBP_OK);
+
+  free(buf);
+  free(e);
+  free(alist);
+  free(ids);
+
+  cmd->state = CMD_STATE_FINISHED;
+  log_printf(10, "handle_bulk_manage: Processed n=%d bad_caps=%d\n", bulk->n, nbad);
+
+  return(0);
+}
+
+//*****************************************************************
+// handle_binary_mode - Enables binary command framing for the rest
+//     of the connection.  Text commands are still accepted.
+//
+// Returns
+//    status \n
+//*****************************************************************
+
+int handle_binary_mode(ibp_task_t *task)
+{
+  log_printf(5, "handle_binary_mode: Enabling binary framing ns=%d\n", tbx_ns_getid(task->ns));
+
+  send_cmd_result(task, IBP_OK);
+  tbx_ns_proto_flags_set(task->ns, tbx_ns_proto_flags_get(task->ns) | IBP_PROTO_BINARY);
 
+  task->cmd.state = CMD_STATE_FINISHED;
   return(0);
 }
 
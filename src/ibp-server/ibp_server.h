@@ -120,6 +120,8 @@ typedef struct {      //Main config structure
    Server_t server;     // Server config
    char *dbenv_loc;     // Location of DB enviroment
    int  db_mem;      // DB envirment memory usage in MB
+   int  db_group_commit;  // Batch commit syncs into shared log flushes
+   int  db_group_commit_window;  // Time in us to let commits join a batch
    DB_env_t  *dbenv;     // Container for DB environment
    int force_resource_rebuild; // Force rebuilding of all resources
    int truncate_expiration;    // Force existing allocs duration to be the RID max.  Only used in rebuild!
@@ -205,6 +207,9 @@ IBPS_API int read_merge_allocate(ibp_task_t *task, char **bstate);
 IBPS_API int read_alias_allocate(ibp_task_t *task, char **bstate);
 IBPS_API int read_status(ibp_task_t *task, char **bstate);
 IBPS_API int read_manage(ibp_task_t *task, char **bstate);
+IBPS_API int read_bulk_manage(ibp_task_t *task, char **bstate);
+IBPS_API int read_binary_mode(ibp_task_t *task, char **bstate);
+IBPS_API int read_binary_rw(ibp_task_t *task, unsigned char *buf, int nbytes);
 IBPS_API int read_write(ibp_task_t *task, char **bstate);
 IBPS_API int read_read(ibp_task_t *task, char **bstate);
 IBPS_API int read_internal_get_alloc(ibp_task_t *task, char **bstate);
@@ -227,6 +232,8 @@ IBPS_API int handle_alias_allocate(ibp_task_t *task);
 IBPS_API int handle_rename(ibp_task_t *task);
 IBPS_API int handle_status(ibp_task_t *task);
 IBPS_API int handle_manage(ibp_task_t *task);
+IBPS_API int handle_bulk_manage(ibp_task_t *task);
+IBPS_API int handle_binary_mode(ibp_task_t *task);
 IBPS_API int handle_write(ibp_task_t *task);
 IBPS_API int handle_read(ibp_task_t *task);
 IBPS_API int handle_copy(ibp_task_t *task);
@@ -129,6 +129,14 @@ typedef struct {
   Allocation_t a;          //** Allocation for command
 } Cmd_manage_t;
 
+#define BULK_MANAGE_MAX 4096     //** Max number of caps in a single IBP_BULK_MANAGE command
+
+typedef struct {
+  int   subcmd;            //** Subcommand.  Only IBP_CHNG is supported
+  int   n;                 //** Number of caps following the command
+  long int duration;       //** New duration in sec for all the allocations
+} Cmd_bulk_manage_t;
+
 typedef struct {
   int      sending;        //** Write state
   rid_t rid;               //** RID for querying
@@ -216,6 +224,7 @@ typedef union {            //** Union of command args
     Cmd_allocate_t allocate;
     Cmd_status_t   status;
     Cmd_manage_t   manage;
+    Cmd_bulk_manage_t bulk_manage;
     Cmd_merge_t    merge;
     Cmd_write_t    write;
     Cmd_read_t     read;
@@ -58,6 +58,8 @@ void install_commands(tbx_inip_file_t *kf) {
   add_command(IBP_GET_CHKSUM, "ibp_get_chksum", kf, NULL, NULL, NULL, NULL, read_validate_get_chksum, handle_get_chksum);
   add_command(IBP_VEC_WRITE_CHKSUM, "ibp_write", kf, NULL, NULL, NULL, NULL, read_write, handle_write);
   add_command(IBP_VEC_READ_CHKSUM, "ibp_load", kf, NULL, NULL, NULL, NULL, read_read, handle_read);
+  add_command(IBP_BULK_MANAGE, "ibp_manage", kf, NULL, NULL, NULL, NULL, read_bulk_manage, handle_bulk_manage);
+  add_command(IBP_BINARY_MODE, "ibp_binary_mode", kf, NULL, NULL, NULL, NULL, read_binary_mode, handle_binary_mode);
 
   //*** Extra commands go below ****
   add_command(INTERNAL_GET_CORRUPT, "internal_get_corrupt", kf, NULL, NULL, NULL, NULL, read_internal_get_corrupt, handle_internal_get_corrupt);
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <apr_thread_mutex.h>
 #include <apr_pools.h>
 #include "osd_abstract.h"
@@ -97,6 +98,41 @@ void unlock_osd_id_pair(osd_id_t id1, osd_id_t id2)
    }
 }
 
+//******************************************************************
+//  lock_osd_id_set - Locks a set of IDs.  The slots are acquired in
+//     the same descending order as lock_osd_id_pair so they can't deadlock.
+//******************************************************************
+
+void lock_osd_id_set(osd_id_t *id, int n)
+{
+   char used[LOCK_MAX];
+   int i;
+
+   memset(used, 0, sizeof(used));
+   for (i=0; i<n; i++) used[id_slot(id[i])] = 1;
+
+   for (i=LOCK_MAX-1; i>=0; i--) {
+      if (used[i]) apr_thread_mutex_lock(_lock_table[i]);
+   }
+}
+
+//******************************************************************
+//  unlock_osd_id_set - Unlocks a set of IDs
+//******************************************************************
+
+void unlock_osd_id_set(osd_id_t *id, int n)
+{
+   char used[LOCK_MAX];
+   int i;
+
+   memset(used, 0, sizeof(used));
+   for (i=0; i<n; i++) used[id_slot(id[i])] = 1;
+
+   for (i=0; i<LOCK_MAX; i++) {
+      if (used[i]) apr_thread_mutex_unlock(_lock_table[i]);
+   }
+}
+
 //******************************************************************
 //  lock_alloc_init - Initializes the allocation locking routines
 //******************************************************************
@@ -24,6 +24,8 @@ IBPS_API void lock_osd_id(osd_id_t id);
 IBPS_API void unlock_osd_id(osd_id_t id);
 IBPS_API void lock_osd_id_pair(osd_id_t id1, osd_id_t id2);
 IBPS_API void unlock_osd_id_pair(osd_id_t id1, osd_id_t id2);
+IBPS_API void lock_osd_id_set(osd_id_t *id, int n);
+IBPS_API void unlock_osd_id_set(osd_id_t *id, int n);
 IBPS_API void lock_alloc_init();
 IBPS_API void lock_alloc_destroy();
 
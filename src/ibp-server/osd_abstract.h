@@ -87,6 +87,7 @@ typedef struct {
 #define osd_destroy_corrupt_iterator(iter) (iter)->d->destroy_corrupt_iterator(iter)
 #define osd_corrupt_iterator_next(iter, id) (iter)->d->corrupt_iterator_next(iter, id)
 #define osd_reserve(d, id, len) (d)->reserve(d, id, len)
+#define osd_blank(d, id, offset, len) (d)->blank(d, id, offset, len)
 #define osd_remove(d, rmode, id) (d)->remove(d, rmode, id)
 #define osd_delete_remove(d, id) (d)->delete_remove(d, id)
 #define osd_expire_remove(d, id) (d)->expire_remove(d, id)
@@ -124,6 +125,7 @@ struct osd_s {
     void (*destroy_corrupt_iterator)(osd_iter_t *iter);   // Corrupt iterator destruction
     int (*corrupt_iterator_next)(osd_iter_t *iter, osd_id_t *id);    // Corrupt iterator next
     int (*reserve)(osd_t *d, osd_id_t id, osd_off_t len);  // Reserve space for the file
+    int (*blank)(osd_t *d, osd_id_t id, osd_off_t offset, osd_off_t len);  // Zero a range without writing it.  Non-zero means the caller has to write the zeros
     int (*remove)(osd_t *d, int rmode, osd_id_t id);  //** Wrapper for delete/expire/physical_remove
     int (*delete_remove)(osd_t *d, osd_id_t id);  // Move an object from valid->deleted bin
     int (*expire_remove)(osd_t *d, osd_id_t id);  // Move an object from valid->expired bin
@@ -17,10 +17,12 @@
 //*******************************************
 
 #define _XOPEN_SOURCE 600
+#include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <apr_time.h>
 #include <math.h>
@@ -802,23 +804,98 @@ osd_off_t fsfd_lock(osd_fs_t *fs, osd_fs_fd_t *fsfd, int mode, osd_off_t start_b
 }
 
 //**************************************************
-//  reserve - Preallocates space for allocation
+// _fs_fallocate - Calls fallocate() if the platform has it.
+//    Returns 0 on success, 1 if the FS or kernel doesn't support
+//    the mode, and -1 on any other error.
+//**************************************************
+
+int _fs_fallocate(int fd, int mode, osd_off_t offset, osd_off_t len)
+{
+#ifdef FALLOC_FL_KEEP_SIZE
+  if (fallocate(fd, mode, offset, len) == 0) return(0);
+  if ((errno == EOPNOTSUPP) || (errno == ENOSYS)) return(1);
+  log_printf(1, "_fs_fallocate: mode=%d offset=" I64T " len=" I64T " errno=%d\n", mode, offset, len, errno);
+  return(-1);
+#else
+  return(1);
+#endif
+}
+
+//**************************************************
+//  reserve - Preallocates space for allocation.
+//     If the FS can't reserve extents the file is just
+//     extended so its size is the same either way.
 //**************************************************
 
 int fs_reserve(osd_t *d, osd_id_t id, osd_off_t len) {
+  osd_fs_t *fs = (osd_fs_t *)(d->private);
+  osd_off_t n;
+  struct stat sbuf;
+  int fd, err;
 
-log_printf(10, "osd_fs: reserve(" LU ", " ST ")\n", id, len);
+log_printf(10, "osd_fs: reserve(" LU ", " I64T ")\n", id, len);
 
   osd_fs_fd_t *fsfd = (osd_fs_fd_t *)fs_open(d, id, OSD_READ_MODE);
   if (fsfd == NULL) return(0);
 
-  posix_fallocate(fileno(fsfd->fd), 0, len);
+  n = fs_offset_l2p(fs, fsfd, len);  //** Reserve the physical size including any chksums
+  fflush(fsfd->fd);
+  fd = fileno(fsfd->fd);
+
+  err = _fs_fallocate(fd, 0, 0, n);
+  if (err == 1) {   //** Not supported so don't emulate it with writes.  Just extend the file
+     if ((fstat(fd, &sbuf) == 0) && (sbuf.st_size < n)) err = ftruncate(fd, n);
+  }
+  if (err != 0) log_printf(1, "osd_fs: reserve(" LU ", " I64T ") failed err=%d errno=%d\n", id, len, err, errno);
 
   fs_close(d, (osd_fd_t *)fsfd);
 
   return(0);
 }
 
+//**************************************************
+//  blank - Zeros the range using the FS instead of writing
+//     zeros.  Returns non-zero if the caller needs to write
+//     them, which is always the case with chksums since the
+//     block chksums have to be updated.
+//**************************************************
+
+int fs_blank(osd_t *d, osd_id_t id, osd_off_t offset, osd_off_t len) {
+  osd_fs_fd_t *fsfd;
+  osd_off_t eof, n;
+  struct stat sbuf;
+  int fd, err;
+
+log_printf(10, "osd_fs: blank(" LU ", " I64T ", " I64T ")\n", id, offset, len);
+
+  fsfd = (osd_fs_fd_t *)fs_open(d, id, OSD_WRITE_MODE);
+  if (fsfd == NULL) return(-1);
+
+  err = 1;
+#if defined(FALLOC_FL_ZERO_RANGE) && defined(FALLOC_FL_PUNCH_HOLE)
+  if (fsfd->obj->fd_chksum.is_valid == 0) {  //** No chksum so logical == physical offsets
+     fflush(fsfd->fd);
+     fd = fileno(fsfd->fd);
+
+     err = _fs_fallocate(fd, FALLOC_FL_ZERO_RANGE, offset, len);
+     if ((err == 1) && (fstat(fd, &sbuf) == 0)) {  //** No zero range so punch out the existing data and then reserve the whole range
+        eof = sbuf.st_size;
+        err = 0;
+        if (offset < eof) {
+           n = ((offset + len) > eof) ? eof - offset : len;
+           err = _fs_fallocate(fd, FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE, offset, n);
+        }
+        if (err == 0) err = _fs_fallocate(fd, 0, offset, len);  //** Otherwise the caller writes the zeros
+     }
+  }
+#endif
+
+  fs_close(d, (osd_fd_t *)fsfd);
+
+  log_printf(10, "osd_fs: blank(" LU ", " I64T ", " I64T ") err=%d\n", id, offset, len, err);
+  return(err);
+}
+
 
 //**************************************************
 // id_exists - Checks to see if the ID exists
@@ -3093,6 +3170,7 @@ osd_t *osd_mount_fs(const char *device, int n_cache, apr_time_t expire_time)
    d->native_open = fs_native_open;
    d->native_close = fs_native_close;
    d->reserve = fs_reserve;
+   d->blank = fs_blank;
    d->remove = fs_remove;
    d->chksum_info = fs_chksum_info;
    d->get_chksum = fs_get_chksum;
@@ -32,6 +32,7 @@
 #include "ibp_time.h"
 #include <tbx/network.h>
 #include <tbx/chksum.h>
+#include <tbx/varint.h>
 
 //*****************************************************************
 // get_command_timeout - Gets the command timeout from the NS
@@ -651,6 +652,229 @@ int read_manage(ibp_task_t *task, char **bstate)
    return(-100);  //** NEver get here
 }
 
+//*****************************************************************
+//  read_bulk_manage - Reads an ibp_bulk_manage command.  Only the
+//     header is parsed here.  The caps are read by the handler.
+//
+// 1.6
+//    version IBP_BULK_MANAGE IBP_CHNG duration n_caps timeout \n
+//    key_1 typekey_1 \n
+//    ...
+//    key_n typekey_n \n
+//
+//*****************************************************************
+
+int read_bulk_manage(ibp_task_t *task, char **bstate)
+{
+   int d, finished;
+   long int ld;
+   Cmd_state_t *cmd = &(task->cmd);
+   Cmd_bulk_manage_t *bulk = &(cmd->cargs.bulk_manage);
+
+   finished = 0;
+
+   debug_printf(1, "read_bulk_manage:  Starting to process buffer\n");
+
+   //*** Get the subcommand ***
+   d = -1; sscanf(tbx_stk_string_token(NULL, " ", bstate, &finished), "%d", &d);
+   if (d != IBP_CHNG) {
+      log_printf(1, "read_bulk_manage: Unsupported sub-command %d\n", d);
+      send_cmd_result(task, IBP_E_BAD_FORMAT);
+      return(-1);
+   }
+   bulk->subcmd = d;
+
+   //**Read the new duration
+   ld = 0; sscanf(tbx_stk_string_token(NULL, " ", bstate, &finished), "%ld", &ld);
+   if (ld <= 0) {
+      log_printf(1, "read_bulk_manage: Bad duration: %ld\n", ld);
+      send_cmd_result(task, IBP_E_INVALID_PARAMETER);
+      return(-1);
+   }
+   bulk->duration = ld;
+
+   //** and the number of caps
+   d = 0; sscanf(tbx_stk_string_token(NULL, " ", bstate, &finished), "%d", &d);
+   if ((d <= 0) || (d > BULK_MANAGE_MAX)) {
+      log_printf(1, "read_bulk_manage: Bad cap count: %d max=%d\n", d, BULK_MANAGE_MAX);
+      send_cmd_result(task, IBP_E_INVALID_PARAMETER);
+      return(-1);
+   }
+   bulk->n = d;
+
+   get_command_timeout(task, bstate);
+
+   debug_printf(1, "read_bulk_manage: n=%d duration=%ld\n", bulk->n, bulk->duration);
+   return(0);
+}
+
+//*****************************************************************
+//  read_binary_mode - Reads an IBP_BINARY_MODE command.  Used to
+//     switch the connection over to binary framing for R/W commands
+//
+//    version IBP_BINARY_MODE timeout \n
+//
+//*****************************************************************
+
+int read_binary_mode(ibp_task_t *task, char **bstate)
+{
+   debug_printf(1, "read_binary_mode:  Starting to process buffer\n");
+
+   get_command_timeout(task, bstate);
+
+   return(0);
+}
+
+//*****************************************************************
+//  read_binary_rw - Parses a binary framed IBP_LOAD, IBP_WRITE,
+//     IBP_VEC_READ, or IBP_VEC_WRITE command.  The frame header has
+//     already been stripped and the version/command consumed by
+//     the caller.
+//
+//    version(1) command(1) timeout(4) key_len(2) RID#key
+//       n_ele offset_1 len_1 ... offset_N len_N
+//
+//    Fixed width fields are big endian and the IO vec list is zigzag varints
+//*****************************************************************
+
+int read_binary_rw(ibp_task_t *task, unsigned char *buf, int nbytes)
+{
+   Cmd_state_t *cmd = &(task->cmd);
+   Cmd_read_t *r;
+   Cmd_write_t *w;
+   ibp_iovec_t *iovec;
+   Cap_t *cap;
+   rid_t *rid;
+   char *crid, *key;
+   char rkey[1024];
+   int64_t n, off, len;
+   uint32_t t;
+   int i, k, pos, klen;
+
+   debug_printf(1, "read_binary_rw:  Starting to process buffer\n");
+
+   task->enable_chksum = 0;
+
+   switch (cmd->command) {
+      case IBP_LOAD:
+      case IBP_VEC_READ:
+         r = &(cmd->cargs.read);
+         memset(r, 0, sizeof(Cmd_read_t));
+         r->write_mode = 1;
+         r->transfer_dir = IBP_PUSH;
+         r->ctype = IBP_TCP;
+         rid = &(r->rid); crid = r->crid; cap = &(r->cap); iovec = &(r->iovec);
+         break;
+      case IBP_WRITE:
+      case IBP_VEC_WRITE:
+         w = &(cmd->cargs.write);
+         w->sending = 0;
+         rid = &(w->rid); crid = w->crid; cap = &(w->cap); iovec = &(w->iovec);
+         break;
+      default:
+         log_printf(1, "read_binary_rw: Command not supported in binary mode! cmd=%d\n", cmd->command);
+         send_cmd_result(task, IBP_E_BAD_FORMAT);
+         return(-1);
+   }
+
+   //** Fixed width fields
+   if (nbytes < 8) {
+      log_printf(1, "read_binary_rw: Short frame! nbytes=%d\n", nbytes);
+      send_cmd_result(task, IBP_E_BAD_FORMAT);
+      return(-1);
+   }
+   t = ((uint32_t)buf[2] << 24) | ((uint32_t)buf[3] << 16) | ((uint32_t)buf[4] << 8) | buf[5];
+   klen = (buf[6] << 8) | buf[7];
+   pos = 8;
+   if ((klen < 1) || (klen >= (int)sizeof(rkey)) || ((pos + klen) > nbytes)) {
+      log_printf(1, "read_binary_rw: Bad key length! klen=%d nbytes=%d\n", klen, nbytes);
+      send_cmd_result(task, IBP_E_BAD_FORMAT);
+      return(-1);
+   }
+   memcpy(rkey, &(buf[pos]), klen);
+   rkey[klen] = '\0';
+   pos += klen;
+
+   //** Split the key into the RID and cap.  The format is RID#key
+   key = strchr(rkey, '#');
+   if (key == NULL) {
+      log_printf(1, "read_binary_rw: Missing RID: %s\n", rkey);
+      send_cmd_result(task, IBP_E_INVALID_RID);
+      return(-1);
+   }
+   *key = '\0';
+   key++;
+   if (ibp_str2rid(rkey, rid) != 0) {
+      log_printf(1, "read_binary_rw: Bad RID: %s\n", rkey);
+      send_cmd_result(task, IBP_E_INVALID_RID);
+      return(-1);
+   }
+   ibp_rid2str(*rid, crid);
+   cap->v[sizeof(cap->v)-1] = '\0';
+   strncpy(cap->v, key, sizeof(cap->v)-1);
+   debug_printf(10, "read_binary_rw: RID=%s cap=%s\n", crid, cap->v);
+
+   //** Now the IO vec list
+   n = 0;
+   k = tbx_zigzag_decode(&(buf[pos]), nbytes - pos, &n);
+   if (k < 0) {
+      send_cmd_result(task, IBP_E_BAD_FORMAT);
+      return(-1);
+   }
+   pos += k;
+   if (n < 1) {
+      log_printf(10, "read_binary_rw:  Invalid IOVEC count (" I64T ")!\n", n);
+      send_cmd_result(task, IBP_E_FILE_SEEK_ERROR);
+      return(-1);
+   } else if ((n > IOVEC_MAX) || ((n > 1) && ((cmd->command == IBP_LOAD) || (cmd->command == IBP_WRITE)))) {
+      log_printf(10, "read_binary_rw:  IOVEC count too big (" I64T ")!\n", n);
+      send_cmd_result(task, IBP_E_INVALID_PARAMETER);
+      return(-1);
+   }
+
+   iovec->n = n;
+   iovec->total_len = 0;
+   iovec->transfer_total = 0;
+   for (i=0; i<iovec->n; i++) {
+      k = tbx_zigzag_decode(&(buf[pos]), nbytes - pos, &off);
+      if (k < 0) break;
+      pos += k;
+      k = tbx_zigzag_decode(&(buf[pos]), nbytes - pos, &len);
+      if (k < 0) break;
+      pos += k;
+
+      if (off < 0) {
+         log_printf(10, "read_binary_rw:  Invalid vec offset[%d] (" I64T ")!\n", i, off);
+         send_cmd_result(task, IBP_E_FILE_SEEK_ERROR);
+         return(-1);
+      } else if (len < 1) {
+         log_printf(10, "read_binary_rw:  Invalid vec length[%d] (" I64T ")!\n", i, len);
+         send_cmd_result(task, IBP_E_INV_PAR_SIZE);
+         return(-1);
+      }
+
+      iovec->vec[i].off = off;
+      iovec->vec[i].len = len;
+      iovec->total_len = iovec->total_len + len;
+      iovec->vec[i].cumulative_len = iovec->total_len;
+   }
+
+   if (i != iovec->n) {
+      log_printf(1, "read_binary_rw: Truncated IO vec list! n=%d got=%d\n", iovec->n, i);
+      send_cmd_result(task, IBP_E_BAD_FORMAT);
+      return(-1);
+   }
+
+   //** and finally the timeout
+   task->cmd_timeout = apr_time_now() + apr_time_make(t, 0);
+   if (t == 0) {
+      log_printf(1, "read_binary_rw: Bad timeout value changing to 2\n");
+      task->cmd_timeout = apr_time_now() + apr_time_make(2, 0);
+   }
+
+   debug_printf(1, "read_binary_rw: Successfully parsed cmd=%d n=%d off[0]=" I64T " len[0]=" I64T "\n", cmd->command, iovec->n, iovec->vec[0].off, iovec->vec[0].len);
+   return(0);
+}
 
 //*****************************************************************
 //  read_rename - Reads an ibp_rename command
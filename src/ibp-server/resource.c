@@ -50,6 +50,27 @@ char *_blanks[_RESOURCE_BUF_SIZE];
 
 const char *_res_types[] = {DEVICE_UNKNOWN, DEVICE_DIR};
 
+typedef struct {  //** Physical object to remove when reclaiming space
+  osd_id_t id;
+  int rmode;
+  char *trash_id;        //** If not NULL this is a trash object
+  ibp_off_t nbytes;
+} reclaim_entry_t;
+
+typedef struct {  //** List of objects to remove in bulk
+  reclaim_entry_t *e;
+  int n;
+  int max;
+} reclaim_list_t;
+
+typedef struct {  //** Shared state for the removal threads
+  Resource_t *r;
+  reclaim_list_t *rl;
+  tbx_atomic_unit32_t next;
+} reclaim_work_t;
+
+#define RECLAIM_WAKE_INTERVAL apr_time_from_sec(1)
+
 typedef struct {  //** Internal resource iterator
   int mode;
   DB_iterator_t *dbi;
@@ -60,6 +81,10 @@ typedef struct {  //** Internal resource iterator
 
 void *resource_cleanup_thread(apr_thread_t *th, void *data);
 int _remove_allocation_for_make_free(Resource_t *r, int rmode, Allocation_t *alloc, DB_iterator_t *it);
+void reclaim_add(reclaim_list_t *rl, osd_id_t id, int rmode, char *trash_id, ibp_off_t nbytes);
+void reclaim_list_free(reclaim_list_t *rl);
+void reclaim_remove(Resource_t *r, reclaim_list_t *rl);
+void reclaim_watermark(Resource_t *r);
 
 
 //***************************************************************************
@@ -805,6 +830,10 @@ int parse_resource(Resource_t *res, tbx_inip_file_t *keyfile, char *group)
    ibp_str2rid(res->name, &(res->rid));
 
    res->preallocate = tbx_inip_get_integer(keyfile, group, "preallocate", 0);
+   res->reclaim_threads = tbx_inip_get_integer(keyfile, group, "reclaim_threads", 4);
+   res->reclaim_low = tbx_inip_get_integer(keyfile, group, "reclaim_low_water", 0) * 1024*1024;
+   res->reclaim_high = tbx_inip_get_integer(keyfile, group, "reclaim_high_water", 0) * 1024*1024;
+   if (res->reclaim_high < res->reclaim_low) res->reclaim_high = res->reclaim_low;
    res->update_alloc = tbx_inip_get_integer(keyfile, group, "update_alloc", 1);
    res->enable_write_history = tbx_inip_get_integer(keyfile, group, "enable_write_history", 1);
    res->enable_read_history = tbx_inip_get_integer(keyfile, group, "enable_read_history", 1);
@@ -1107,6 +1136,9 @@ int print_resource(char *buffer, int *used, int nbytes, Resource_t *res)
    n = res->max_size[ALLOC_HARD]/1024/1024; tbx_append_printf(buffer, used, nbytes, "hard_size = " I64T "\n", n);
    n = res->minfree/1024/1024; tbx_append_printf(buffer, used, nbytes, "minfree_size = " I64T "\n", n);
    tbx_append_printf(buffer, used, nbytes, "preallocate = %d\n", res->preallocate);
+   tbx_append_printf(buffer, used, nbytes, "reclaim_threads = %d\n", res->reclaim_threads);
+   n = res->reclaim_low/1024/1024; tbx_append_printf(buffer, used, nbytes, "reclaim_low_water = " I64T "\n", n);
+   n = res->reclaim_high/1024/1024; tbx_append_printf(buffer, used, nbytes, "reclaim_high_water = " I64T "\n", n);
 
    tbx_append_printf(buffer, used, nbytes, "enable_chksum = %d\n", res->enable_chksum);
    tbx_append_printf(buffer, used, nbytes, "chksum_type = %s\n", tbx_chksum_name(&(res->chksum)));
@@ -1275,6 +1307,55 @@ int remove_allocation_resource(Resource_t *r, int rmode, Allocation_t *alloc)
   return(_remove_allocation(r, rmode, alloc, 1));
 }
 
+//***************************************************************************
+// remove_allocation_batch_resource - Removes a batch of allocations.  The
+//       DB records are retired in a single transaction and the objects are
+//       removed in parallel.
+//***************************************************************************
+
+int remove_allocation_batch_resource(Resource_t *r, int rmode, Allocation_t *alloc, int n)
+{
+   Allocation_t **a;
+   reclaim_list_t rl;
+   int i, nfailed;
+
+   if (n == 0) return(0);
+
+   tbx_atomic_inc(r->counter);
+
+   tbx_type_malloc(a, Allocation_t *, n);
+   for (i=0; i<n; i++) a[i] = &(alloc[i]);
+
+   //** EVen if this fails we want to try and remove the physical allocations
+   if ((nfailed = remove_alloc_batch_db(&(r->db), a, n)) != 0) {
+      log_printf(1, "remove_allocation_batch_resource: rid=%s Error with remove_alloc_batch_db! nfailed=%d n=%d\n", r->name, nfailed, n);
+   }
+   free(a);
+
+   memset(&rl, 0, sizeof(rl));
+   apr_thread_mutex_lock(r->mutex);
+   for (i=0; i<n; i++) {
+      _trash_adjust(r, rmode, alloc[i].id);
+
+      if ((r->enable_alias_history == 1) || (alloc[i].is_alias == 0)) {
+         reclaim_add(&rl, alloc[i].id, rmode, NULL, alloc[i].max_size);
+      }
+
+      r->n_allocs--;
+      if (alloc[i].is_alias == 0) {
+         r->used_space[alloc[i].reliability] -= alloc[i].max_size;   //** Update the amount of space used
+      } else {
+         r->n_alias--;
+      }
+   }
+   apr_thread_mutex_unlock(r->mutex);
+
+   reclaim_remove(r, &rl);
+   reclaim_list_free(&rl);
+
+   return(nfailed);
+}
+
 //***************************************************************************
 // merge_allocation_resource - Merges the space for the child allocation, a,
 //    into the master(ma).  THe child allocations data is NOT merged and is lost.
@@ -1347,6 +1428,117 @@ int _remove_allocation_for_make_free(Resource_t *r, int rmode, Allocation_t *all
 }
 
 
+//***************************************************************************
+// reclaim_add - Adds an object to the removal list
+//***************************************************************************
+
+void reclaim_add(reclaim_list_t *rl, osd_id_t id, int rmode, char *trash_id, ibp_off_t nbytes)
+{
+  reclaim_entry_t *e;
+
+  if (rl->n >= rl->max) {
+     rl->max = (rl->max == 0) ? 128 : 2*rl->max;
+     tbx_type_realloc(rl->e, reclaim_entry_t, rl->max);
+  }
+
+  e = &(rl->e[rl->n]);
+  e->id = id;
+  e->rmode = rmode;
+  e->trash_id = (trash_id == NULL) ? NULL : strdup(trash_id);
+  e->nbytes = nbytes;
+  rl->n++;
+}
+
+//***************************************************************************
+// reclaim_list_free - Releases the list contents
+//***************************************************************************
+
+void reclaim_list_free(reclaim_list_t *rl)
+{
+  int i;
+
+  for (i=0; i<rl->n; i++) {
+     if (rl->e[i].trash_id != NULL) free(rl->e[i].trash_id);
+  }
+  if (rl->e != NULL) free(rl->e);
+  memset(rl, 0, sizeof(reclaim_list_t));
+}
+
+//***************************************************************************
+// _reclaim_remove_one - Removes a single object from the list
+//***************************************************************************
+
+void _reclaim_remove_one(Resource_t *r, reclaim_entry_t *e)
+{
+  int err;
+
+  if (e->trash_id != NULL) {
+     err = osd_trash_physical_remove(r->dev, e->rmode, e->trash_id);
+  } else {
+     err = osd_remove(r->dev, e->rmode, e->id);
+  }
+
+  if (err != 0) {
+     log_printf(1, "_reclaim_remove_one: Error removing id=" LU " trash_id=%s err=%d\n", e->id, e->trash_id, err);
+  }
+}
+
+//***************************************************************************
+// reclaim_remove_thread - Removal worker.  Pulls entries until the list is done
+//***************************************************************************
+
+void *reclaim_remove_thread(apr_thread_t *th, void *data)
+{
+  reclaim_work_t *w = (reclaim_work_t *)data;
+  int i;
+
+  while ((i = tbx_atomic_inc(w->next)) < w->rl->n) {
+     _reclaim_remove_one(w->r, &(w->rl->e[i]));
+  }
+
+  return(NULL);
+}
+
+//***************************************************************************
+// reclaim_remove - Removes all the objects in the list using up to
+//    r->reclaim_threads threads and waits for them to finish
+//***************************************************************************
+
+void reclaim_remove(Resource_t *r, reclaim_list_t *rl)
+{
+  reclaim_work_t w;
+  apr_pool_t *pool;
+  apr_thread_t **thr;
+  apr_status_t val;
+  int i, nthreads;
+
+  if (rl->n == 0) return;
+
+  nthreads = (r->reclaim_threads < rl->n) ? r->reclaim_threads : rl->n;
+
+  log_printf(5, "reclaim_remove: rid=%s n=%d nthreads=%d\n", r->name, rl->n, nthreads);
+
+  if (nthreads <= 1) {
+     for (i=0; i<rl->n; i++) _reclaim_remove_one(r, &(rl->e[i]));
+     return;
+  }
+
+  w.r = r;
+  w.rl = rl;
+  tbx_atomic_set(w.next, 0);
+
+  apr_pool_create(&pool, NULL);
+  tbx_type_malloc(thr, apr_thread_t *, nthreads);
+  for (i=0; i<nthreads; i++) {
+     apr_thread_create(&(thr[i]), NULL, reclaim_remove_thread, (void *)&w, pool);
+  }
+  for (i=0; i<nthreads; i++) {
+     apr_thread_join(&val, thr[i]);
+  }
+  free(thr);
+  apr_pool_destroy(pool);
+}
+
 //***************************************************************************
 //  blank_space - Fills an allocation with 0's
 //***************************************************************************
@@ -1360,6 +1552,12 @@ int blank_space(Resource_t *r, osd_id_t id, ibp_off_t off, ibp_off_t size)
   ibp_off_t remainder = size - bcount * _RESOURCE_BUF_SIZE;
 
   log_printf(10, "blank_space: id=" LU " off=" I64T " size=" I64T " bcount = " I64T " rem = " I64T "\n", id, off,size,bcount,remainder);
+
+  //** See if the device can do it without writing the zeros
+  if (r->dev->blank != NULL) {
+     if (osd_blank(r->dev, id, off, size) == 0) return(0);
+  }
+
   offset = off;      // Now store the data in chunks
   fd = osd_open(r->dev, id , OSD_WRITE_MODE);
   if (fd == NULL) {
@@ -1378,12 +1576,44 @@ int blank_space(Resource_t *r, osd_id_t id, ibp_off_t off, ibp_off_t size)
   return(0);
 }
 
+//***************************************************************************
+// _reclaim_allocation_iter - Retires the allocation's DB record via the
+//     iterator and updates the accounting.  The physical object is added
+//     to the removal list for bulk deletion once the iterator is closed.
+//     NOTE: No locking is performed
+//***************************************************************************
+
+int _reclaim_allocation_iter(Resource_t *r, Allocation_t *alloc, DB_iterator_t *it, reclaim_list_t *rl)
+{
+   int err;
+
+   log_printf(10, "_reclaim_allocation_iter:  Removing " LU " with space " LU "\n", alloc->id, alloc->max_size);
+
+   //** EVen if this fails we want to try and remove the physical allocation
+   if ((err = remove_alloc_iter_db(it)) != 0) {
+      debug_printf(1, "_reclaim_allocation_iter:  Error with remove_alloc_db!  Error=%d\n", err);
+   }
+
+   if ((r->enable_alias_history) || (alloc->is_alias == 0)) {
+      reclaim_add(rl, alloc->id, OSD_PHYSICAL_ID, NULL, alloc->max_size);
+   }
+
+   if (alloc->is_alias == 0) {
+      r->used_space[alloc->reliability] -= alloc->max_size;   //** Upodate the amount of space used
+   }
+   r->n_allocs--;
+   if (alloc->is_alias == 1) r->n_alias--;
+
+   return(0);
+}
+
 //***************************************************************************
 // make_free_space_iterator - Frees space up using the given iterator and
-//    time stamp
+//    time stamp.  The victims are retired from the DB in expire order as
+//    part of the iterator's transaction and their objects are added to rl.
 //***************************************************************************
 
-int make_free_space_iterator(Resource_t *r, DB_iterator_t *dbi, ibp_off_t *nbytesleft, ibp_time_t timestamp)
+int make_free_space_iterator(Resource_t *r, DB_iterator_t *dbi, ibp_off_t *nbytesleft, ibp_time_t timestamp, reclaim_list_t *rl)
 {
   int err;
   Allocation_t a;
@@ -1404,7 +1634,7 @@ int make_free_space_iterator(Resource_t *r, DB_iterator_t *dbi, ibp_off_t *nbyte
              nleft -= a.max_size;            //** Free to delete it
           }
 
-          err = _remove_allocation_for_make_free(r, OSD_PHYSICAL_ID, &a, dbi);
+          err = _reclaim_allocation_iter(r, &a, dbi, rl);
        } else {
           finished = 1;                //** Nothing else has expired:(
        }
@@ -1429,7 +1659,7 @@ int make_free_space_iterator(Resource_t *r, DB_iterator_t *dbi, ibp_off_t *nbyte
 //    NOTE: No locking is performed
 //***************************************************************************
 
-int _trash_free_space(Resource_t *r, int tmode, ibp_off_t *nleft)
+int _trash_free_space(Resource_t *r, int tmode, ibp_off_t *nleft, reclaim_list_t *rl)
 {
   osd_iter_t *iter;
   osd_id_t id;
@@ -1443,7 +1673,7 @@ int _trash_free_space(Resource_t *r, int tmode, ibp_off_t *nleft)
   iter = osd_new_trash_iterator(r->dev, rmode);
   while ((osd_trash_iterator_next(iter, &id, &move_time, trash_id) == 0) && (bleft > 0)) {
      bleft = bleft - osd_trash_size(r->dev, rmode, trash_id);
-     osd_trash_physical_remove(r->dev, rmode, trash_id);
+     reclaim_add(rl, id, rmode, trash_id, 0);
   }
   osd_destroy_iterator(iter);
 
@@ -1452,6 +1682,108 @@ int _trash_free_space(Resource_t *r, int tmode, ibp_off_t *nleft)
   return(0);
 }
 
+//***************************************************************************
+// _reclaim_space - Retires trash, expired, and optionally soft allocations
+//      until nleft bytes have been reclaimed.  The DB records and accounting
+//      are updated here and the physical objects are added to rl for bulk
+//      removal.  Returns 0 if enough space was found.
+//      NOTE: The resource lock should be held by the calling thread
+//***************************************************************************
+
+int _reclaim_space(Resource_t *r, ibp_off_t *nbytesleft, int do_soft, reclaim_list_t *rl)
+{
+  DB_iterator_t *dbi;
+  ibp_off_t nleft;
+  int err;
+
+  nleft = *nbytesleft;
+
+  //*** Start by freeing all the expired allocations ***
+  ibp_time_t now = ibp_time_now();  //Get the current time so I know when to stop
+
+  //** 1st free space from the trash bins
+  err = _trash_free_space(r, RES_DELETE_INDEX, &nleft, rl);
+  if (nleft > 0)  err = _trash_free_space(r, RES_EXPIRE_INDEX, &nleft, rl);
+
+  if (nleft > 0) {
+     dbr_lock(&(r->db));
+     dbi = expire_iterator(&(r->db));
+     err = make_free_space_iterator(r, dbi, &nleft, now, rl);
+     db_iterator_end(dbi);
+     dbr_unlock(&(r->db));
+  }
+
+  //*** Now free up any soft allocations if needed ***
+  if ((nleft > 0) && (err == 0) && (do_soft == 1)) {
+    now = 0;  //** We can delete everything here if needed
+    dbr_lock(&(r->db));
+    dbi = soft_iterator(&(r->db));
+    err = make_free_space_iterator(r, dbi, &nleft, now, rl);
+    db_iterator_end(dbi);
+    dbr_unlock(&(r->db));
+  }
+
+  *nbytesleft = nleft;
+
+  return(((nleft > 0) || (err != 0)) ? 1 : 0);
+}
+
+//***************************************************************************
+// reclaim_wakeup - Kicks the cleanup thread into a reclaim pass if the
+//      free space has dropped below the low watermark.  Rate limited so a
+//      full device doesn't keep it spinning.
+//***************************************************************************
+
+void reclaim_wakeup(Resource_t *r, ibp_off_t free_bytes)
+{
+  apr_time_t now;
+
+  if ((r->reclaim_low <= 0) || (free_bytes >= r->reclaim_low)) return;
+
+  now = apr_time_now();
+  apr_thread_mutex_lock(r->cleanup_lock);
+  if ((now - r->reclaim_wake) > RECLAIM_WAKE_INTERVAL) {
+     r->reclaim_wake = now;
+     r->reclaim_pending = 1;
+     apr_thread_cond_signal(r->cleanup_cond);
+  }
+  apr_thread_mutex_unlock(r->cleanup_lock);
+}
+
+//***************************************************************************
+// reclaim_watermark - Reclaims trash and expired allocations in the
+//      background until the free space is back above the high watermark.
+//      This keeps make_space() from having to do it on the allocation path.
+//***************************************************************************
+
+void reclaim_watermark(Resource_t *r)
+{
+  struct statfs stat;
+  ibp_off_t free_bytes, nleft;
+  reclaim_list_t rl;
+
+  if (r->reclaim_low <= 0) return;
+
+  osd_statfs(r->dev, &stat);
+  free_bytes = (ibp_off_t)stat.f_bavail*(ibp_off_t)stat.f_bsize;
+  if (free_bytes >= r->reclaim_low) return;
+
+  nleft = r->reclaim_high - free_bytes;
+  log_printf(5, "reclaim_watermark: rid=%s free=" I64T " low=" I64T " high=" I64T " nleft=" I64T "\n", r->name, free_bytes, r->reclaim_low, r->reclaim_high, nleft);
+
+  memset(&rl, 0, sizeof(rl));
+  apr_thread_mutex_lock(r->mutex);
+  _reclaim_space(r, &nleft, 0, &rl);
+  apr_thread_mutex_unlock(r->mutex);
+
+  log_printf(5, "reclaim_watermark: rid=%s n=%d unable to reclaim=" I64T "\n", r->name, rl.n, nleft);
+
+  reclaim_remove(r, &rl);   //** No need to hold the lock while removing the files
+  reclaim_list_free(&rl);
+
+  tbx_atomic_inc(r->counter);
+}
+
 //***************************************************************************
 // make_space - Creates enough free space on the device for a subsequent
 //      allocation
@@ -1462,13 +1794,14 @@ int make_space(Resource_t *r, ibp_off_t size, int atype)
   struct statfs stat;
   ibp_off_t free_bytes, trash_bytes;
   ibp_off_t nleft, type_over, aggregate_over, minfree_over, over, num;
-  DB_iterator_t *dbi;
+  reclaim_list_t rl;
   int err;
 
   //** Get baseline values
   trash_bytes = r->trash_size[RES_DELETE_INDEX] + r->trash_size[RES_EXPIRE_INDEX];
   osd_statfs(r->dev, &stat);
   free_bytes = (ibp_off_t)stat.f_bavail*(ibp_off_t)stat.f_bsize;
+  reclaim_wakeup(r, free_bytes - size);
 //  nbytes = free_bytes + trash_bytes;
   nleft = 0;
   type_over = 0;
@@ -1513,37 +1846,12 @@ int make_space(Resource_t *r, ibp_off_t size, int atype)
 
   if (nleft == 0) return(0);  //** Plenty of space so return
 
-  //*** Start by freeing all the expired allocations ***
-  ibp_time_t now = ibp_time_now();  //Get the current time so I know when to stop
-
-  //** 1st free space from the trash bins
-  err = _trash_free_space(r, RES_DELETE_INDEX, &nleft);
-  if (nleft > 0)  err = _trash_free_space(r, RES_EXPIRE_INDEX, &nleft);
-
-  dbr_lock(&(r->db));
-  dbi = expire_iterator(&(r->db));
-
-  err = make_free_space_iterator(r, dbi, &nleft, now);
-
-  db_iterator_end(dbi);
-  dbr_unlock(&(r->db));
-
-  //*** Now free up any soft allocations if needed ***
-  if ((nleft > 0) && (err == 0)) {
-    now = 0;  //** We can delete everything here if needed
-    dbr_lock(&(r->db));
-    dbi = soft_iterator(&(r->db));
-    err = make_free_space_iterator(r, dbi, &nleft, now);
-    db_iterator_end(dbi);
-    dbr_unlock(&(r->db));
-
-  }
+  memset(&rl, 0, sizeof(rl));
+  err = _reclaim_space(r, &nleft, 1, &rl);
+  reclaim_remove(r, &rl);
+  reclaim_list_free(&rl);
 
-  if ((nleft > 0) || (err != 0)) {
-     return(1);   //*** Didn't have envough space **
-  } else {
-     return(0);
-  }
+  return(err);   //** 1 means we didn't have enough space
 }
 
 //***************************************************************************
@@ -1947,8 +2255,8 @@ int modify_allocation_resource(Resource_t *r, osd_id_t id, Allocation_t *a)
         if (err != 0) {
            return(err);  // ** FAiled on make_space
         } else if ((r->preallocate > 0) && (size > 0)) { //** Actually fill the extra space they requested
-           if ((r->preallocate & RES_RESERVE_FALLOCATE) > 0) osd_reserve(r->dev, a->id, size);
-           if ((r->preallocate & RES_RESERVE_BLANK) > 0) blank_space(r, a->id, old_a.max_size, size);
+           if ((r->preallocate & RES_RESERVE_FALLOCATE) > 0) osd_reserve(r->dev, a->id, ALLOC_HEADER + a->max_size);
+           if ((r->preallocate & RES_RESERVE_BLANK) > 0) blank_space(r, a->id, ALLOC_HEADER + old_a.max_size, size);
 
            apr_thread_mutex_lock(r->mutex);
            r->pending -= size;
@@ -1961,6 +2269,31 @@ int modify_allocation_resource(Resource_t *r, osd_id_t id, Allocation_t *a)
   return(modify_alloc_db(&(r->db), a));
 }
 
+//***************************************************************************
+// modify_expiration_batch_resource - Stores a batch of allocations whose
+//    expiration changed.  The size and reliability must be unchanged so no
+//    space accounting is needed.  Returns the number of failed updates.
+//***************************************************************************
+
+int modify_expiration_batch_resource(Resource_t *r, Allocation_t **a, int n)
+{
+  int i;
+
+  for (i=0; i<n; i++) {
+     tbx_atomic_inc(r->counter);
+
+     if (r->update_alloc == 1) {
+        if (a[i]->is_alias == 0) {
+           write_allocation_header(r, a[i], 0);
+        } else if (r->enable_alias_history) {
+           write_allocation_header(r, a[i], 0);
+        }
+     }
+  }
+
+  return(modify_alloc_batch_db(&(r->db), a, n));
+}
+
 //---------------------------------------------------------------------------
 
 //***************************************************************************
@@ -2399,10 +2732,11 @@ time_t trash_cleanup(Resource_t *r, int tmode, ibp_time_t wipe_time, int enforce
   osd_iter_t *iter;
   osd_id_t id;
   ibp_time_t oldest_time, move_time;
-  ibp_off_t nbytes, free_bytes;
+  ibp_off_t nbytes, free_bytes, fsize;
   int nwipe, loop;
   char trash_id[1024];
   struct statfs stat;
+  reclaim_list_t rl;
 
   int rmode = (tmode == RES_DELETE_INDEX) ? OSD_DELETE_ID : OSD_EXPIRE_ID;
 
@@ -2420,6 +2754,7 @@ time_t trash_cleanup(Resource_t *r, int tmode, ibp_time_t wipe_time, int enforce
   osd_statfs(r->dev, &stat);
   free_bytes = (ibp_off_t)stat.f_bavail*(ibp_off_t)stat.f_bsize;
 
+  memset(&rl, 0, sizeof(rl));
   iter = osd_new_trash_iterator(r->dev, rmode);
   if (iter == NULL) goto fail;
   while (osd_trash_iterator_next(iter, &id, &move_time, trash_id) == 0) {
@@ -2428,9 +2763,10 @@ time_t trash_cleanup(Resource_t *r, int tmode, ibp_time_t wipe_time, int enforce
      //** Free the data if too old (<wipe_time) or not enough free space for min reserve
      if ((move_time <= wipe_time) || ((free_bytes < r->minfree) && (enforce_minfree == 1))) {
         nwipe++;
-        nbytes = nbytes + osd_trash_size(r->dev, rmode, trash_id);
-        free_bytes = free_bytes + osd_trash_size(r->dev, rmode, trash_id);
-        osd_trash_physical_remove(r->dev, rmode, trash_id);
+        fsize = osd_trash_size(r->dev, rmode, trash_id);
+        nbytes = nbytes + fsize;
+        free_bytes = free_bytes + fsize;
+        reclaim_add(&rl, id, rmode, trash_id, fsize);  //** Removed in bulk after the scan
      } else if (move_time < oldest_time) {
         oldest_time = move_time;
      }
@@ -2440,6 +2776,9 @@ time_t trash_cleanup(Resource_t *r, int tmode, ibp_time_t wipe_time, int enforce
   }
   osd_destroy_iterator(iter);
 
+  reclaim_remove(r, &rl);
+  reclaim_list_free(&rl);
+
 fail:
   //** Update the counts **
   apr_thread_mutex_lock(r->mutex);
@@ -2459,7 +2798,7 @@ fail:
 void resource_cleanup(Resource_t *r, ibp_time_t start_grace_time)
 {
   int max_alloc = 100;
-  int i, n, err, start_index;
+  int i, n, err, start_index, nexpired;
   Allocation_t a[max_alloc], b;
   ibp_time_t grace_over = start_grace_time + r->preexpire_grace_period;
   walk_expire_iterator_t *wei;
@@ -2507,14 +2846,16 @@ fail:
 
     log_printf(1, "resource_background_cleanup: rid=%s n=%d\n", r->name, n);
 
-    //** Do the actual removal
+    //** Make sure they are still expired and do the actual removal in bulk
+    nexpired = 0;
     for (i=0; i<n; i++) {
        log_printf(1, "resource_background_cleanup:i=%d.  rid=%s checking/removing:" LU "\n",i, r->name, a[i].id);
        err = get_alloc_with_id_db(&(r->db), a[i].id, &b);
        if (err == 0) {
-          if (b.expiration < ibp_time_now()) _remove_allocation(r, OSD_EXPIRE_ID, &b, 1);
+          if (b.expiration < ibp_time_now()) a[nexpired++] = b;
        }
     }
+    remove_allocation_batch_resource(r, OSD_EXPIRE_ID, a, nexpired);
   }
 
   log_printf(1, "resource_background_cleanup: End of routine.  rid=%s time= " TT "\n",r->name, apr_time_now());
@@ -2531,6 +2872,7 @@ void *resource_cleanup_thread(apr_thread_t *th, void *data)
   Resource_t *r = (Resource_t *)data;
   ibp_time_t delete_oldest, expire_oldest, wipe_start, start_time;
   apr_interval_time_t t;
+  apr_time_t wake_time;
   int count;
 
   log_printf(5, "resource_cleanup_thread: Start.  rid=%s time= " TT "\n",r->name, apr_time_now());
@@ -2570,12 +2912,25 @@ void *resource_cleanup_thread(apr_thread_t *th, void *data)
 
      log_printf(10, "resource_cleanup_thread: rid=%s expire_oldest=" TT " delete_oldest=" TT "\n", r->name, ibp2apr_time(expire_oldest), ibp2apr_time(delete_oldest));
      resource_cleanup(r, start_time);
+     reclaim_watermark(r);
 
      t = 1000000 * r->cleanup_interval;    //Cleanup interval in us
+     wake_time = apr_time_now() + t;
      apr_thread_mutex_lock(r->cleanup_lock);
-     if (r->cleanup_shutdown == 0) {
+     while (r->cleanup_shutdown == 0) {
         log_printf(5, "resource_cleanup_thread: Sleeping rid=%s time= " TT " shutdown=%d\n",r->name, apr_time_now(), r->cleanup_shutdown);
-        apr_thread_cond_timedwait(r->cleanup_cond, r->cleanup_lock, t);
+        if (r->reclaim_pending == 0) {
+           apr_thread_cond_timedwait(r->cleanup_cond, r->cleanup_lock, t);
+           if (r->reclaim_pending == 0) break;  //** Normal wakeup
+        }
+
+        //** Kicked by make_space() so just do a reclaim pass and go back to sleep
+        r->reclaim_pending = 0;
+        apr_thread_mutex_unlock(r->cleanup_lock);
+        reclaim_watermark(r);
+        apr_thread_mutex_lock(r->cleanup_lock);
+        t = wake_time - apr_time_now();
+        if (t <= 0) break;
      }
      log_printf(5, "resource_cleanup_thread: waking up rid=%s time= " TT " shutdown=%d\n",r->name, apr_time_now(), r->cleanup_shutdown);
      tbx_log_flush();
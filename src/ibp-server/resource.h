@@ -103,6 +103,11 @@ typedef struct {       //Resource structure
    ibp_off_t trash_size[2];   //Amount of space in trash
    ibp_off_t n_trash[2];      //Number of allocations in trash
    int    preallocate;      //PReallocate all new allocations
+   int    reclaim_threads;  //Number of threads used to remove files when reclaiming space
+   ibp_off_t reclaim_low;   //Reclaim in the background when free space drops below this
+   ibp_off_t reclaim_high;  //  and keep going until it's back above this
+   int    reclaim_pending;  //Set when the cleanup thread should run a reclaim pass
+   apr_time_t reclaim_wake; //Last time the cleanup thread was woken to reclaim
    DB_resource_t db;        //DB for maintaining the resource's caps
    osd_t *dev;              //Actual Device information
    int      rl_index;       //** Index in global resource array
@@ -150,6 +155,7 @@ IBPS_API int get_allocation_state(Resource_t *r, osd_fd_t *fd);
 IBPS_API osd_fd_t *open_allocation(Resource_t *r, osd_id_t id, int mode);
 IBPS_API int close_allocation(Resource_t *r, osd_fd_t *fd);
 IBPS_API int remove_allocation_resource(Resource_t *r, int rmode, Allocation_t *alloc);
+int remove_allocation_batch_resource(Resource_t *r, int rmode, Allocation_t *alloc, int n);
 IBPS_API void free_expired_allocations(Resource_t *r);
 IBPS_API uint64_t resource_allocable(Resource_t *r, int free_space);
 IBPS_API int create_allocation_resource(Resource_t *r, Allocation_t *a, ibp_off_t size, int type,
@@ -166,6 +172,7 @@ IBPS_API int merge_allocation_resource(Resource_t *r, Allocation_t *ma, Allocati
 IBPS_API int get_allocation_by_cap_resource(Resource_t *r, int cap_type, Cap_t *cap, Allocation_t *a);
 IBPS_API int get_allocation_resource(Resource_t *r, osd_id_t id, Allocation_t *a);
 IBPS_API int modify_allocation_resource(Resource_t *r, osd_id_t id, Allocation_t *a);
+IBPS_API int modify_expiration_batch_resource(Resource_t *r, Allocation_t **a, int n);
 IBPS_API int get_manage_allocation_resource(Resource_t *r, Cap_t *mcap, Allocation_t *a);
 IBPS_API int write_allocation_header(Resource_t *r, Allocation_t *a, int do_blank);
 IBPS_API int read_allocation_header(Resource_t *r, osd_id_t id, Allocation_t *a);
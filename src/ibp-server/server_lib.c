@@ -285,6 +285,8 @@ int print_config(char *buffer, int *used, int nbytes, Config_t *cfg)
   tbx_append_printf(buffer, used, nbytes, "splice_enable = %d\n", server->splice_enable);
   tbx_append_printf(buffer, used, nbytes, "db_env_loc = %s\n", cfg->dbenv_loc);
   tbx_append_printf(buffer, used, nbytes, "db_mem = %d\n", cfg->db_mem);
+  tbx_append_printf(buffer, used, nbytes, "db_group_commit = %d\n", cfg->db_group_commit);
+  tbx_append_printf(buffer, used, nbytes, "db_group_commit_window_us = %d\n", cfg->db_group_commit_window);
   tbx_append_printf(buffer, used, nbytes, "log_file = %s\n", server->logfile);
   tbx_append_printf(buffer, used, nbytes, "log_level = %d\n", server->log_level);
   tbx_append_printf(buffer, used, nbytes, "return_cap_id = %d\n", server->return_cap_id);
@@ -328,6 +330,33 @@ int print_config(char *buffer, int *used, int nbytes, Config_t *cfg)
   return(i);
 }
 
+//*****************************************************************
+// read_binary_frame - Reads the rest of a binary command frame after
+//     the magic byte.  Returns the payload size or -1 on error.
+//*****************************************************************
+
+int read_binary_frame(tbx_ns_t *ns, char *buffer, int bsize)
+{
+   unsigned char *ubuf = (unsigned char *)buffer;
+   apr_time_t end_time;
+   uint32_t n;
+
+   end_time = apr_time_now() + apr_time_make(5, 0);
+
+   //** Get the payload length
+   if (server_ns_read_block(ns, end_time, buffer, IBP_BINARY_HEADER_SIZE-1) != NS_OK) return(-1);
+   n = ((uint32_t)ubuf[0] << 24) | ((uint32_t)ubuf[1] << 16) | ((uint32_t)ubuf[2] << 8) | ubuf[3];
+   if ((n < 2) || (n > (uint32_t)bsize)) {
+      log_printf(1, "read_binary_frame: ns=%d Bad frame size=%u\n", tbx_ns_getid(ns), n);
+      return(-1);
+   }
+
+   //** and the payload
+   if (server_ns_read_block(ns, end_time, buffer, n) != NS_OK) return(-1);
+
+   return(n);
+}
+
 //*****************************************************************
 // read_command - Reads a command from the stream
 //*****************************************************************
@@ -341,7 +370,7 @@ int read_command(ibp_task_t *task)
    char buffer[bufsize];
    char *bstate;
    int  nbytes, status, offset, count, close_request;
-   int err, fin;
+   int err, fin, binary;
    apr_time_t endtime;
    command_t *mycmd;
 
@@ -363,15 +392,38 @@ int read_command(ibp_task_t *task)
    count = sizeof(buffer);
    endtime = apr_time_now() + global_config->server.min_idle; //** Wait for the min_idle time
    close_request = 0;
-   do {
-     nbytes = server_ns_readline_raw(ns, &(buffer[offset]), count - offset, dt, &status);
-     offset = offset + nbytes;
-     if ((request_task_close() == 1) && (offset <= 0)) close_request = 1;
+   binary = 0;
+   status = 0;
+   if (tbx_ns_proto_flags_get(ns) & IBP_PROTO_BINARY) {  //** Peek at the 1st byte to see if it's a binary frame
+      do {
+        nbytes = server_ns_read(ns, buffer, 1, dt);
+        if ((request_task_close() == 1) && (nbytes == 0)) close_request = 1;
+      } while ((nbytes == 0) && (apr_time_now() <= endtime) && (close_request == 0));
+
+      if (nbytes < 0) {
+         status = -1;
+      } else if (nbytes == 1) {
+         if ((unsigned char)buffer[0] == IBP_BINARY_MAGIC) {
+            binary = 1;
+            offset = read_binary_frame(ns, buffer, count);
+            status = (offset > 0) ? 1 : -1;
+         } else {
+            offset = 1;  //** Normal text command so keep the byte and read the rest of the line
+         }
+      }
+   }
+
+   if ((binary == 0) && (status == 0) && (close_request == 0)) {
+      do {
+        nbytes = server_ns_readline_raw(ns, &(buffer[offset]), count - offset, dt, &status);
+        offset = offset + nbytes;
+        if ((request_task_close() == 1) && (offset <= 0)) close_request = 1;
 log_printf(15, "read_command: ns=%d nbytes=%d offset=%d status=%d sizeof(buffer)=" LU " close_req=%d\n", tbx_ns_getid(ns), nbytes, offset, status, sizeof(buffer), close_request);
-   } while ((offset < (count-1)) && (status == 0) && (apr_time_now() <= endtime) && (close_request == 0));
+      } while ((offset < (count-1)) && (status == 0) && (apr_time_now() <= endtime) && (close_request == 0));
+   }
    nbytes = offset;
 
-   log_printf(10, "read_command: ns=%d tid=" LU " Command: %s\n", tbx_ns_getid(task->ns), task->tid, buffer);
+   if (binary == 0) log_printf(10, "read_command: ns=%d tid=" LU " Command: %s\n", tbx_ns_getid(task->ns), task->tid, buffer);
    log_printf(10, "read_command: ns=%d total_bytes=%d status=%d\n", tbx_ns_getid(ns), nbytes, status);
    tbx_log_flush();
 
@@ -398,9 +450,14 @@ log_printf(15, "read_command: ns=%d nbytes=%d offset=%d status=%d sizeof(buffer)
    apr_thread_mutex_unlock(task_count_lock);
 
    cmd->version = -1;  cmd->command = -1;
-   sscanf(tbx_stk_string_token(buffer, " ", &bstate, &fin), "%d", &(cmd->version));
-   log_printf(10, "read_command: version=%d\n", cmd->version); tbx_log_flush();
-   sscanf(tbx_stk_string_token(NULL, " ", &bstate, &fin), "%d", &(cmd->command));
+   if (binary == 1) {
+      cmd->version = (unsigned char)buffer[0];
+      cmd->command = (unsigned char)buffer[1];
+   } else {
+      sscanf(tbx_stk_string_token(buffer, " ", &bstate, &fin), "%d", &(cmd->version));
+      log_printf(10, "read_command: version=%d\n", cmd->version); tbx_log_flush();
+      sscanf(tbx_stk_string_token(NULL, " ", &bstate, &fin), "%d", &(cmd->command));
+   }
 
    log_printf(10, "read_command: ns=%d version = %d tid=" LU "* Command = %d\n", tbx_ns_getid(task->ns), cmd->version, task->tid, cmd->command);
 tbx_log_flush();
@@ -420,7 +477,11 @@ tbx_log_flush();
       err = -1;
    } else {
       mycmd = &(global_config->command[cmd->command]);
-      if (mycmd->read != NULL) err = mycmd->read(task, &bstate);
+      if (binary == 1) {
+         err = read_binary_rw(task, (unsigned char *)buffer, nbytes);
+      } else if (mycmd->read != NULL) {
+         err = mycmd->read(task, &bstate);
+      }
 
       if (task->command_acl[cmd->command] == 0) {  //** Not allowed so err out
          log_printf(10, "read_command:  Can't execute command due to ACL restriction! ns=%d cmd=%d\n", tbx_ns_getid(task->ns), cmd->command);
@@ -42,6 +42,7 @@
 #include <tbx/network.h>
 #include <tbx/pigeon_coop.h>
 #include <tbx/stack.h>
+#include <tbx/transfer_buffer.h>
 #include <tbx/type_malloc.h>
 
 #include "misc.h"
@@ -447,6 +448,45 @@ void _ibp_destroy_connect_context(void *connect_context)
 }
 
 
+//**********************************************************
+// _ibp_binary_negotiate - Asks the depot to accept binary command
+//     frames on the connection.  Returns 0 if accepted.  Depots that
+//     don't know the command reply with an error and hang up.
+//**********************************************************
+
+int _ibp_binary_negotiate(tbx_ns_t *ns, tbx_ns_timeout_t timeout)
+{
+    char buffer[128];
+    tbx_tbuf_t tbuf;
+    apr_time_t end_time;
+    int len, n, pos, status, to;
+
+    to = apr_time_sec(timeout);
+    if (to < 1) to = 1;
+    end_time = apr_time_now() + apr_time_make(to, 0);
+
+    len = snprintf(buffer, sizeof(buffer), "%d %d %d\n", IBPv040, IBP_BINARY_MODE, to);
+    tbx_tbuf_single(&tbuf, len, buffer);
+    if (tbx_ns_write_block(ns, end_time, &tbuf, 0, len) != 0) return(1);
+
+    tbx_tbuf_single(&tbuf, sizeof(buffer), buffer);
+    pos = 0;
+    status = 0;
+    do {
+        n = tbx_ns_readline_raw(ns, &tbuf, pos, sizeof(buffer) - pos, global_dt, &status);
+        pos += n;
+    } while ((status == 0) && (pos < (int)sizeof(buffer)-1) && (apr_time_now() < end_time));
+
+    if (status != 1) return(1);
+
+    n = atoi(buffer);
+    log_printf(5, "ns=%d status=%d\n", tbx_ns_getid(ns), n);
+    if (n != IBP_OK) return(1);
+
+    tbx_ns_proto_flags_set(ns, tbx_ns_proto_flags_get(ns) | IBP_PROTO_BINARY);
+    return(0);
+}
+
 //**********************************************************
 // _ibp_connect - Makes an IBP connection to a remote host
 //     If connect_context == NULL then a standard socket based
@@ -483,6 +523,16 @@ int _ibp_connect(tbx_ns_t *ns, void *connect_context, char *host, int port, tbx_
         i=-i;
     }
     n = tbx_ns_connect(ns, host, port, timeout);
+
+    //** See if the depot speaks binary.  If not reconnect and stick with text
+    if ((n == 0) && (cc != NULL) && (cc->binary == 1)) {
+        if (_ibp_binary_negotiate(ns, timeout) != 0) {
+            log_printf(5, "Binary framing rejected. Reconnecting in text mode. host=%s\n", host);
+            tbx_ns_close(ns);
+            tbx_ns_sock_config(ns, cc->tcpsize);
+            n = tbx_ns_connect(ns, host, port, timeout);
+        }
+    }
     if (i<0) host[-i] = '#';
 
     return(n);
@@ -626,6 +676,17 @@ int  ibp_context_connection_mode_get(ibp_context_t *ic)
 {
     return(ic->connection_mode);
 }
+void ibp_context_binary_protocol_set(ibp_context_t *ic, int enable)
+{
+    int i;
+
+    ic->binary_protocol = enable;
+    for (i=0; i<=IBP_MAX_NUM_CMDS; i++) ic->cc[i].binary = enable;
+}
+int  ibp_context_binary_protocol_get(ibp_context_t *ic)
+{
+    return(ic->binary_protocol);
+}
 
 //**********************************************************
 // set_ibp_config - Sets the ibp config options
@@ -702,6 +763,8 @@ void ibp_cc_load(tbx_inip_file_t *kf, ibp_context_t *cfg)
     //** Set everything to the default **
     cc.type = NS_TYPE_SOCK;
     cc.tcpsize = 0;
+    cc.binary = cfg->binary_protocol;
+    cc.data = NULL;
     cc_load(kf, "default", &cc);
     for (i=0; i<=IBP_MAX_NUM_CMDS; i++) cfg->cc[i] = cc;
 
@@ -712,6 +775,7 @@ void ibp_cc_load(tbx_inip_file_t *kf, ibp_context_t *cfg)
     cc_load(kf, "ibp_send", &(cfg->cc[IBP_SEND]));
     cc_load(kf, "ibp_load", &(cfg->cc[IBP_LOAD]));
     cc_load(kf, "ibp_manage", &(cfg->cc[IBP_MANAGE]));
+    cfg->cc[IBP_BULK_MANAGE] = cfg->cc[IBP_MANAGE];
     cc_load(kf, "ibp_write", &(cfg->cc[IBP_WRITE]));
     cc_load(kf, "ibp_proxy_allocate", &(cfg->cc[IBP_PROXY_ALLOCATE]));
     cc_load(kf, "ibp_proxy_manage", &(cfg->cc[IBP_PROXY_MANAGE]));
@@ -752,6 +816,7 @@ int ibp_config_load(ibp_context_t *ic, tbx_inip_file_t *keyfile, char *section)
     ic->connection_mode = tbx_inip_get_integer(keyfile, section, "connection_mode", ic->connection_mode);
     ic->transfer_rate = tbx_inip_get_double(keyfile, section, "transfer_rate", ic->transfer_rate);
     ic->rr_size = tbx_inip_get_integer(keyfile, section, "rr_size", ic->rr_size);
+    ic->binary_protocol = tbx_inip_get_integer(keyfile, section, "binary_protocol", ic->binary_protocol);
 
     ibp_cc_load(keyfile, ic);
 
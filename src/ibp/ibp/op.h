@@ -33,6 +33,7 @@ extern "C" {
 // Typedefs
 typedef struct ibp_context_t ibp_context_t;
 typedef struct ibp_op_alloc_t ibp_op_alloc_t;
+typedef struct ibp_op_bulk_manage_t ibp_op_bulk_manage_t;
 typedef struct ibp_op_copy_t ibp_op_copy_t;
 typedef struct ibp_op_depot_inq_t ibp_op_depot_inq_t;
 typedef struct ibp_op_depot_modify_t ibp_op_depot_modify_t;
@@ -58,6 +59,7 @@ IBP_API gop_op_generic_t *ibp_proxy_modify_alloc_gop(ibp_context_t *ic, ibp_cap_
 IBP_API gop_op_generic_t *ibp_proxy_remove_gop(ibp_context_t *ic, ibp_cap_t *cap, ibp_cap_t *mcap, int timeout);
 IBP_API gop_op_generic_t *ibp_proxy_probe_gop(ibp_context_t *ic, ibp_cap_t *cap, ibp_proxy_capstatus_t *probe, int timeout);
 IBP_API gop_op_generic_t *ibp_alloc_gop(ibp_context_t *ic, ibp_capset_t *caps, ibp_off_t size, ibp_depot_t *depot, ibp_attributes_t *attr, int disk_cs_type, ibp_off_t disk_blocksize, int timeout);
+IBP_API gop_op_generic_t *ibp_bulk_modify_duration_gop(ibp_context_t *ic, int n, ibp_cap_t **caps, int duration, int *status, int timeout);
 IBP_API gop_op_generic_t *ibp_append_gop(ibp_context_t *ic, ibp_cap_t *cap, tbx_tbuf_t *buffer, ibp_off_t boff, ibp_off_t len, int timeout);
 IBP_API int ibp_cc_type(ibp_connect_context_t *cc);
 IBP_API int ibp_chksum_set(ibp_context_t *ic, tbx_ns_chksum_t *ncs);
@@ -118,6 +120,8 @@ IBP_API void ibp_context_transfer_rate_set(ibp_context_t *ic, double rate);
 IBP_API double ibp_context_transfer_rate_get(ibp_context_t *ic);
 IBP_API void ibp_context_connection_mode_set(ibp_context_t *ic, int mode);
 IBP_API int  ibp_context_connection_mode_get(ibp_context_t *ic);
+IBP_API void ibp_context_binary_protocol_set(ibp_context_t *ic, int enable);
+IBP_API int  ibp_context_binary_protocol_get(ibp_context_t *ic);
 
 // Preprocessor constants
 #define MAX_KEY_SIZE 256
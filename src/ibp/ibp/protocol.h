@@ -73,8 +73,15 @@
 #define   IBP_VEC_WRITE_CHKSUM  34
 #define   IBP_VEC_READ          35
 #define   IBP_VEC_READ_CHKSUM   36
+#define   IBP_BULK_MANAGE       37
+#define   IBP_BINARY_MODE       38
 
-#define   IBP_MAX_NUM_CMDS      36
+#define   IBP_MAX_NUM_CMDS      38
+
+//** Binary command framing.  Enabled per connection via IBP_BINARY_MODE
+#define   IBP_PROTO_BINARY       1     //** tbx_ns proto flag set once the depot accepts binary frames
+#define   IBP_BINARY_MAGIC       0xB1  //** 1st byte of a binary frame.  Never the start of a text command
+#define   IBP_BINARY_HEADER_SIZE 5     //** Magic byte + 32-bit big endian payload length
 
 #define   IBP_TCP          1
 #define  IBP_PHOEBUS      2
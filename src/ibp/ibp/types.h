@@ -148,6 +148,7 @@ struct ibp_timer_t {
 struct ibp_connect_context_t {
     int type;           //** Type of connection as defined in network.h
     int tcpsize;        //** All types have this parameter
+    int binary;         //** If 1 try and negotiate binary command framing on connect
     void *data;         //** Generic container for context data
 };
 
@@ -71,6 +71,8 @@ gop_op_status_t proxy_probe_recv(gop_op_generic_t *gop, tbx_ns_t *ns);
 gop_op_status_t allocate_command(gop_op_generic_t *gop, tbx_ns_t *ns);
 gop_op_status_t allocate_recv(gop_op_generic_t *gop, tbx_ns_t *ns);
 gop_op_status_t append_command(gop_op_generic_t *gop, tbx_ns_t *ns);
+gop_op_status_t bulk_manage_command(gop_op_generic_t *gop, tbx_ns_t *ns);
+gop_op_status_t bulk_manage_recv(gop_op_generic_t *gop, tbx_ns_t *ns);
 gop_op_status_t copy_recv(gop_op_generic_t *gop, tbx_ns_t *ns);
 gop_op_status_t copyappend_command(gop_op_generic_t *gop, tbx_ns_t *ns);
 gop_op_status_t depot_inq_command(gop_op_generic_t *gop, tbx_ns_t *ns);
@@ -787,6 +789,44 @@ gop_op_generic_t *ibp_modify_alloc_gop(ibp_context_t *ic, ibp_cap_t *cap, ibp_of
     return(ibp_get_gop(op));
 }
 
+//*************************************************************
+// ibp_bulk_modify_duration_gop - Changes the duration on a batch of
+//     allocations with a single command.  All the manage caps must
+//     live on the same depot.  The per cap IBP status is returned in
+//     status[] and the op only succeeds if every cap succeeded.
+//*************************************************************
+
+gop_op_generic_t *ibp_bulk_modify_duration_gop(ibp_context_t *ic, int n, ibp_cap_t **caps, int duration, int *status, int timeout)
+{
+    ibp_op_t *op = new_ibp_op(ic);
+    char hoststr[MAX_HOST_SIZE];
+    int i, port;
+    char host[MAX_HOST_SIZE];
+    char key[MAX_KEY_SIZE], typekey[MAX_KEY_SIZE];
+    ibp_op_bulk_manage_t *cmd;
+
+    init_ibp_base_op(op, "bulk_modify_duration", timeout, op->ic->other_new_command, NULL, 1, IBP_BULK_MANAGE, IBP_CHNG);
+
+    cmd = &(op->ops.bulk_manage_op);
+
+    parse_cap(op->ic, caps[0], host, &port, key, typekey);
+    set_hostport(hoststr, sizeof(hoststr), host, port, &(op->ic->cc[IBP_BULK_MANAGE]));
+    op->dop.cmd.hostport = strdup(hoststr);
+
+    cmd->n = n;
+    cmd->caps = caps;
+    cmd->duration = duration;
+    cmd->status = status;
+    for (i=0; i<n; i++) status[i] = IBP_E_GENERIC;
+
+    gop_op_generic_t *gop = ibp_get_gop(op);
+    gop->op->cmd.send_command = bulk_manage_command;
+    gop->op->cmd.send_phase = NULL;
+    gop->op->cmd.recv_phase = bulk_manage_recv;
+
+    return(ibp_get_gop(op));
+}
+
 gop_op_generic_t *ibp_proxy_modify_alloc_gop(ibp_context_t *ic, ibp_cap_t *cap, ibp_cap_t *mcap, ibp_off_t offset, ibp_off_t size, int duration, int timeout)
 {
     ibp_op_t *op = new_ibp_op(ic);
@@ -78,6 +78,7 @@ struct ibp_context_t {
     int connection_mode;  //** Connection mode
     int rr_size;          //** Round robin connection count. Only used ir cmode = RR
     double transfer_rate; //** Transfer rate in bytes/sec used for calculating timeouts.  Set to 0 to disable function
+    int binary_protocol;  //** If 1 use binary framing for R/W commands on depots that support it
     tbx_atomic_unit32_t rr_count; //** RR counter
     ibp_connect_context_t cc[IBP_MAX_NUM_CMDS+1];  //** Default connection contexts for EACH command
     tbx_ns_chksum_t ncs;
@@ -239,6 +240,13 @@ struct ibp_op_modify_alloc_t {  //** modify Allocation operation
     int        duration;
     int        reliability;
 };
+struct ibp_op_bulk_manage_t {  //** IBP_BULK_MANAGE operation
+    int        n;          //** Number of caps
+    ibp_cap_t **caps;      //** Manage caps.  All must live on the same depot
+    int        duration;
+    int       *status;     //** Per cap IBP status
+};
+
 struct ibp_op_copy_t {  //** depot depot copy operations
     char      *path;       //** Phoebus path or NULL for default
     ibp_cap_t *srccap;
@@ -298,6 +306,7 @@ struct ibp_op_t { //** Individual IO operation
         ibp_op_depot_modify_t depot_modify_op;
         ibp_op_depot_inq_t depot_inq_op;
         ibp_op_modify_alloc_t mod_alloc_op;
+        ibp_op_bulk_manage_t bulk_manage_op;
         ibp_op_rid_inq_t   rid_op;
         ibp_op_version_t   ver_op;
     } ops;
@@ -34,8 +34,11 @@
 #include <tbx/stack.h>
 #include <tbx/string_token.h>
 #include <tbx/transfer_buffer.h>
+#include <tbx/type_malloc.h>
+#include <tbx/varint.h>
 #include <time.h>
 
+#include "misc.h"
 #include "op.h"
 #include "types.h"
 
@@ -105,6 +108,92 @@ gop_op_status_t send_command(gop_op_generic_t *gop, tbx_ns_t *ns, char *command)
     return(status);
 }
 
+//*************************************************************
+// binary_rw_command - Sends a R/W command using binary framing.
+//    Only used on connections that negotiated IBP_BINARY_MODE.
+//
+//    magic(1) payload_len(4) version(1) command(1) timeout(4) key_len(2) key
+//        n_ele offset_1 len_1 ... offset_N len_N
+//
+//    Fixed width fields are big endian and the IO vec list is zigzag varints.
+//*************************************************************
+
+static void _binary_put32(unsigned char *buf, uint32_t n)
+{
+    buf[0] = n >> 24;
+    buf[1] = n >> 16;
+    buf[2] = n >> 8;
+    buf[3] = n;
+}
+
+gop_op_status_t binary_rw_command(gop_op_generic_t *gop, tbx_ns_t *ns, int command)
+{
+    ibp_op_t *op = ibp_get_iop(gop);
+    unsigned char stackbuffer[1024];
+    unsigned char *buffer = stackbuffer;
+    int i, j, n, used, klen, bufsize;
+    ibp_op_rw_t *cmd;
+    ibp_rw_buf_t *rwbuf;
+    tbx_tbuf_t buf;
+    gop_op_status_t err;
+
+    cmd = &(op->ops.rw_op);
+
+    n = ((command == IBP_LOAD) || (command == IBP_WRITE)) ? 1 : cmd->n_tbx_iovec_total;
+    klen = strlen(cmd->key);
+    bufsize = IBP_BINARY_HEADER_SIZE + 8 + klen + 10 + 20*n;
+    if (bufsize > (int)sizeof(stackbuffer)) tbx_type_malloc(buffer, unsigned char, bufsize);
+
+    //** Fixed width portion
+    used = IBP_BINARY_HEADER_SIZE;
+    buffer[used++] = IBPv040;
+    buffer[used++] = command;
+    _binary_put32(&(buffer[used]), apr_time_sec(gop->op->cmd.timeout));
+    used += 4;
+    buffer[used++] = klen >> 8;
+    buffer[used++] = klen;
+    memcpy(&(buffer[used]), cmd->key, klen);
+    used += klen;
+
+    //** Now the IO vec list
+    used += tbx_zigzag_encode(n, &(buffer[used]));
+    if (n == 1) {
+        used += tbx_zigzag_encode(cmd->buf_single.iovec[0].offset, &(buffer[used]));
+        used += tbx_zigzag_encode(cmd->buf_single.size, &(buffer[used]));
+    } else {
+        for (j=0; j<cmd->n_ops; j++) {
+            rwbuf = cmd->rwbuf[j];
+            for (i=0; i<rwbuf->n_iovec; i++) {
+                used += tbx_zigzag_encode(rwbuf->iovec[i].offset, &(buffer[used]));
+                used += tbx_zigzag_encode(rwbuf->iovec[i].len, &(buffer[used]));
+            }
+        }
+    }
+
+    //** Fill in the header now that we know the size
+    buffer[0] = IBP_BINARY_MAGIC;
+    _binary_put32(&(buffer[1]), used - IBP_BINARY_HEADER_SIZE);
+
+    tbx_ns_chksum_write_set(ns, op->ncs);
+    tbx_ns_chksum_write_disable(ns);
+
+    log_printf(5, "ns=%d gid=%d command=%d n=%d frame_size=%d\n", tbx_ns_getid(ns), gop_id(gop), command, n, used);
+
+    tbx_tbuf_single(&buf, used, (char *)buffer);
+    err = gop_write_block(ns, gop, &buf, 0, used);
+    if (err.op_status != OP_STATE_SUCCESS) {
+        log_printf(10, "Error=%d! ns=%d command=%d\n", err.op_status, tbx_ns_getid(ns), command);
+        err = ibp_retry_status;
+    }
+
+    if (buffer != stackbuffer) free(buffer);
+
+    return(err);
+}
+
+//** Binary framing is only used for the plain R/W commands.  Chksum'ed commands stay in text
+#define use_binary(op, ns) ((tbx_ns_chksum_is_valid(&((op)->ncs)) == 0) && (tbx_ns_proto_flags_get(ns) & IBP_PROTO_BINARY))
+
 gop_op_status_t gop_readline_with_timeout(tbx_ns_t *ns, char *buffer, int size, gop_op_generic_t *gop)
 {
     int nbytes, n, nleft, pos;
@@ -169,6 +258,8 @@ gop_op_status_t vec_read_command(gop_op_generic_t *gop, tbx_ns_t *ns)
 
     cmd = &(op->ops.rw_op);
 
+    if (use_binary(op, ns)) return(binary_rw_command(gop, ns, IBP_VEC_READ));
+
     used = 0;
 
     //** Store the base command
@@ -222,6 +313,8 @@ gop_op_status_t read_command(gop_op_generic_t *gop, tbx_ns_t *ns)
 
     cmd = &(op->ops.rw_op);
 
+    if (use_binary(op, ns)) return(binary_rw_command(gop, ns, IBP_LOAD));
+
     if (tbx_ns_chksum_is_valid(&(op->ncs)) == 0) {
         snprintf(buffer, sizeof(buffer), "%d %d %s %s " I64T " " I64T " %d\n",
                  IBPv040, IBP_LOAD, cmd->key, cmd->typekey, cmd->buf_single.iovec[0].offset, cmd->buf_single.size, (int)apr_time_sec(gop->op->cmd.timeout));
@@ -367,6 +460,8 @@ gop_op_status_t vec_write_command(gop_op_generic_t *gop, tbx_ns_t *ns)
 
     cmd = &(op->ops.rw_op);
 
+    if (use_binary(op, ns)) return(binary_rw_command(gop, ns, IBP_VEC_WRITE));
+
     used = 0;
 
     //** Store base command
@@ -424,6 +519,8 @@ gop_op_status_t write_command(gop_op_generic_t *gop, tbx_ns_t *ns)
 
     cmd = &(op->ops.rw_op);
 
+    if (use_binary(op, ns)) return(binary_rw_command(gop, ns, IBP_WRITE));
+
     if (tbx_ns_chksum_is_valid(&(op->ncs)) == 0) {
         snprintf(buffer, sizeof(buffer), "%d %d %s %s " I64T " " I64T " %d\n",
                  IBPv040, IBP_WRITE, cmd->key, cmd->typekey, cmd->buf_single.iovec[0].offset, cmd->buf_single.size, (int)apr_time_sec(gop->op->cmd.timeout));
@@ -1016,6 +1113,87 @@ gop_op_status_t modify_alloc_command(gop_op_generic_t *gop, tbx_ns_t *ns)
     return(err);
 }
 
+gop_op_status_t bulk_manage_command(gop_op_generic_t *gop, tbx_ns_t *ns)
+{
+    ibp_op_t *op = ibp_get_iop(gop);
+    ibp_op_bulk_manage_t *cmd = &(op->ops.bulk_manage_op);
+    int bufsize = 20 + cmd->n * 2 * MAX_KEY_SIZE;
+    char *buffer;
+    char host[MAX_HOST_SIZE];
+    char key[MAX_KEY_SIZE], typekey[MAX_KEY_SIZE];
+    gop_op_status_t err;
+    int i, port, used;
+
+    tbx_type_malloc(buffer, char, bufsize);
+
+    used = 0;
+    tbx_append_printf(buffer, &used, bufsize, "%d %d %d %d %d %d\n",
+             IBPv040, IBP_BULK_MANAGE, IBP_CHNG, cmd->duration, cmd->n, (int)apr_time_sec(gop->op->cmd.timeout));
+
+    //** Add the caps one per line
+    for (i=0; i<cmd->n; i++) {
+        parse_cap(op->ic, cmd->caps[i], host, &port, key, typekey);
+        tbx_append_printf(buffer, &used, bufsize, "%s %s\n", key, typekey);
+    }
+
+    tbx_ns_chksum_write_clear(ns);
+
+    err = send_command(gop, ns, buffer);
+    if (err.op_status != OP_STATE_SUCCESS) {
+        log_printf(10, "bulk_manage_command: Error with send_command()! ns=%d\n", tbx_ns_getid(ns));
+    }
+
+    free(buffer);
+
+    return(err);
+}
+
+gop_op_status_t bulk_manage_recv(gop_op_generic_t *gop, tbx_ns_t *ns)
+{
+    ibp_op_t *op = ibp_get_iop(gop);
+    ibp_op_bulk_manage_t *cmd = &(op->ops.bulk_manage_op);
+    int bufsize = 32 + 8*cmd->n;
+    int i, status, fin, nfailed;
+    char *buffer, *bstate;
+    gop_op_status_t err;
+
+    tbx_ns_chksum_read_clear(ns);
+
+    tbx_type_malloc(buffer, char, bufsize);
+    err = gop_readline_with_timeout(ns, buffer, bufsize, gop);
+    if (err.op_status != OP_STATE_SUCCESS) {
+        free(buffer);
+        return(err);
+    }
+
+    log_printf(15, "bulk_manage_recv: ns=%d n=%d\n", tbx_ns_getid(ns), cmd->n);
+
+    status = atoi(tbx_stk_string_token(buffer, " ", &bstate, &fin));
+    if (status != IBP_OK) {
+        process_error(gop, &err, status, -1, &bstate);
+        free(buffer);
+        return(err);
+    }
+
+    //** Get the individual cap status
+    nfailed = 0;
+    for (i=0; i<cmd->n; i++) {
+        cmd->status[i] = atoi(tbx_stk_string_token(NULL, " ", &bstate, &fin));
+        if (cmd->status[i] != IBP_OK) nfailed++;
+    }
+
+    free(buffer);
+
+    if (nfailed == 0) {
+        err = ibp_success_status;
+    } else {
+        err.op_status = OP_STATE_FAILURE;
+        err.error_code = nfailed;
+    }
+
+    return(err);
+}
+
 gop_op_status_t proxy_modify_alloc_command(gop_op_generic_t *gop, tbx_ns_t *ns)
 {
     ibp_op_t *op = ibp_get_iop(gop);
@@ -75,6 +75,70 @@ void du_format_entry(tbx_log_fd_t *ifd, du_entry_t *de, int sumonly)
     return;
 }
 
+//*************************************************************************
+// du_aggregate - Has the object service tally each directory's size and
+//   file count.  Returns 0 on success.  Otherwise nothing is updated and
+//   the caller should walk the namespace instead.
+//*************************************************************************
+
+int du_aggregate(du_entry_t **dir, int n, char *key, int obj_types, int recurse_depth)
+{
+    lio_os_regex_table_t *rp;
+    lio_os_aggregate_t *agg;
+    lio_os_agg_level_t total;
+    gop_op_generic_t *gop;
+    gop_op_status_t status;
+    int64_t *bytes, *count;
+    int i, err;
+
+    if (n == 0) return(0);
+    if (recurse_depth <= 0) return(0);  //** Nothing below the top level to tally
+
+    tbx_type_malloc_clear(bytes, int64_t, n);
+    tbx_type_malloc_clear(count, int64_t, n);
+
+    err = 0;
+    for (i=0; i<n; i++) {
+        rp = lio_os_path_children2regex(dir[i]->fname);  //** Don't want any glob chars in the name expanded
+        if (rp == NULL) {
+            err = 1;
+            goto finished;
+        }
+        agg = lio_os_aggregate_create(0);
+        gop = lio_aggregate_gop(tuple.lc, tuple.creds, rp, NULL, obj_types, recurse_depth-1, key, agg);
+        if (gop == NULL) {
+            err = 1;
+        } else {
+            status = gop_sync_exec_status(gop);
+            if (status.op_status != OP_STATE_SUCCESS) {
+                err = 1;
+            } else {
+                lio_os_aggregate_total(agg, &total);
+                bytes[i] = total.sum;
+                count[i] = total.n_objects;
+            }
+        }
+        lio_os_aggregate_destroy(agg);
+        lio_os_regex_table_destroy(rp);
+
+        if (err != 0) {
+            log_printf(1, "Aggregation failed for %s.  Falling back to walking the namespace\n", dir[i]->fname);
+            goto finished;
+        }
+    }
+
+    for (i=0; i<n; i++) {
+        dir[i]->bytes += bytes[i];
+        dir[i]->count += count[i];
+    }
+
+finished:
+    free(bytes);
+    free(count);
+
+    return(err);
+}
+
 //*************************************************************************
 //*************************************************************************
 
@@ -96,6 +160,8 @@ int main(int argc, char **argv)
     tbx_stdinarray_iter_t *it_args;
     int recurse_depth = 10000;
     int return_code = 0;
+    int use_agg, n_dirs, max_dirs, agg_types;
+    du_entry_t **dirs;
     du_entry_t du_total;
 
     // Set sum_table to NULL since Alan left it undefined. See if it goes
@@ -104,7 +170,7 @@ int main(int argc, char **argv)
 
     if (argc < 2) {
         printf("\n");
-        printf("lio_du LIO_COMMON_OPTIONS [-rd recurse_depth] [-ns] [-h|-hi] [-s] [-ln] LIO_PATH_OPTIONS\n");
+        printf("lio_du LIO_COMMON_OPTIONS [-rd recurse_depth] [-ns] [-h|-hi] [-s] [-ln] [-walk] LIO_PATH_OPTIONS\n");
         lio_print_options(stdout);
         lio_print_path_options(stdout);
         printf("\n");
@@ -114,6 +180,7 @@ int main(int argc, char **argv)
         printf("    -hi                - Print using base 1024\n");
         printf("    -s                 - Print directory summaries only\n");
         printf("    -ln                - Follow links.  Otherwise they are ignored\n");
+        printf("    -walk              - Summaries walk the namespace from the client instead of having the object service tally them\n");
         return(1);
     }
 
@@ -128,6 +195,7 @@ int main(int argc, char **argv)
     base = 1;
     ignoreln = 1;
     sumonly = 0;
+    use_agg = 1;
     obj_types = OS_OBJECT_ANY_FLAG;
     i=1;
     do {
@@ -153,6 +221,9 @@ int main(int argc, char **argv)
             i++;
             ignoreln = 0;
             obj_types |= OS_OBJECT_FOLLOW_SYMLINK_FLAG;
+        } else if (strcmp(argv[i], "-walk") == 0) {  //** Don't use server side aggregation
+            i++;
+            use_agg = 0;
         }
 
     } while ((start_option < i) && (i<argc));
@@ -182,6 +253,11 @@ int main(int argc, char **argv)
 
     table = tbx_list_create(0, &tbx_list_string_compare, NULL, tbx_list_no_key_free, tbx_list_no_data_free);
 
+    //** Directories from the current path that need tallying
+    max_dirs = 1024;
+    tbx_type_malloc(dirs, du_entry_t *, max_dirs);
+    agg_types = OS_OBJECT_FILE_FLAG | (obj_types & OS_OBJECT_FOLLOW_SYMLINK_FLAG);
+
     total_files = total_bytes = 0;
     it_args = tbx_stdinarray_iter_create(argc-start_index, (const char **)(argv+start_index));
     while (1) {
@@ -206,6 +282,7 @@ int main(int argc, char **argv)
         //** Make the toplevel list
         if (sumonly == 1) {
             log_printf(15, "MAIN SUMONLY=1\n");
+            n_dirs = 0;
             v_size = -1024;
             val = NULL;
             it = lio_create_object_iter_alist(tuple.lc, tuple.creds, rp_single, ro_single, obj_types, 0, &key, (void **)&val, &v_size, 1);
@@ -229,6 +306,15 @@ int main(int argc, char **argv)
                 if (val != NULL) sscanf(val, I64T, &(de->bytes));
                 tbx_list_insert(sum_table, de->fname, de);
 
+                if (ftype & OS_OBJECT_DIR_FLAG) {
+                    if (n_dirs == max_dirs) {
+                        max_dirs = 2*max_dirs;
+                        tbx_type_realloc(dirs, du_entry_t *, max_dirs);
+                    }
+                    dirs[n_dirs] = de;
+                    n_dirs++;
+                }
+
 next_top:
                 v_size = -1024;
                 free(val);
@@ -238,6 +324,9 @@ next_top:
             lio_destroy_object_iter(tuple.lc, it);
 
             log_printf(15, "sum_table=%d\n", tbx_list_key_count(sum_table));
+
+            //** Have the object service do the tallying if it can.  Otherwise fall back to walking everything
+            if ((use_agg == 1) && (du_aggregate(dirs, n_dirs, key, agg_types, recurse_depth) == 0)) goto path_done;
         }
 
         log_printf(15, "MAIN LOOP\n");
@@ -292,6 +381,7 @@ next:
 
         lio_destroy_object_iter(tuple.lc, it);
 
+path_done:
         lio_path_release(&tuple);
         if (rp_single != NULL) {
             lio_os_regex_table_destroy(rp_single);
@@ -332,6 +422,7 @@ next:
     if (sumonly == 1) tbx_list_destroy(sum_table);
 
 finished:
+    free(dirs);
     tbx_list_destroy(table);
     tbx_stdinarray_iter_destroy(it_args);
     lio_shutdown();
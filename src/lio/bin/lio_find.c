@@ -35,6 +35,7 @@ int main(int argc, char **argv)
     char *fname, *path;
     lio_path_tuple_t tuple;
     lio_os_regex_table_t *rp_single, *ro_single;
+    lio_os_predicate_t *pred = NULL;
     tbx_stdinarray_iter_t *it_args;
     os_object_iter_t *it = NULL;
 
@@ -44,12 +45,16 @@ int main(int argc, char **argv)
 
     if (argc < 2) {
         printf("\n");
-        printf("lio_find LIO_COMMON_OPTIONS [-rd recurse_depth] [-t object_types] [-nopre] LIO_PATH_OPTIONS\n");
+        printf("lio_find LIO_COMMON_OPTIONS [-rd recurse_depth] [-t object_types] [-p predicate] [-nopre] LIO_PATH_OPTIONS\n");
         lio_print_options(stdout);
         lio_print_path_options(stdout);
         printf("\n");
         printf("    -rd recurse_depth  - Max recursion depth on directories. Defaults to %d\n", recurse_depth);
         printf("    -t  object_types   - Types of objects to list bitwise OR of 1=Files, 2=Directories, 4=symlink, 8=hardlink.  Default is %d.\n", obj_types);
+        printf("    -p  predicate      - Only list objects whose attributes match the predicate.  It's evaluated by the object service.\n");
+        printf("                         Comparisons are key OP value with OP one of == != < <= > >=.  A bare key tests for existence.\n");
+        printf("                         Integer values are compared numerically.  Combine with &&, || and ! along with parentheses.\n");
+        printf("                         For example: -p 'system.exnode.size > 1000000 && !user.keep'\n");
         printf("    -nopre             - Don't print the scan common prefix\n");
         return(1);
     }
@@ -78,6 +83,14 @@ int main(int argc, char **argv)
         } else if (strcmp(argv[i], "-nopre") == 0) {  //** Strip off the path prefix
             i++;
             nopre = 1;
+        } else if (strcmp(argv[i], "-p") == 0) {  //** Attribute predicate
+            i++;
+            pred = lio_os_predicate_parse(argv[i]);
+            if (pred == NULL) {
+                fprintf(stderr, "Invalid predicate: %s\n", argv[i]);
+                return(EINVAL);
+            }
+            i++;
         }
 
     } while ((start_option < i) && (i<argc));
@@ -113,7 +126,11 @@ int main(int argc, char **argv)
             rg_mode = 0;  //** Use the initial rp
         }
 
-        it = lio_create_object_iter(tuple.lc, tuple.creds, rp_single, ro_single, obj_types, NULL, recurse_depth, NULL, 0);
+        if (pred != NULL) {
+            it = lio_create_object_iter_predicate(tuple.lc, tuple.creds, rp_single, ro_single, obj_types, recurse_depth, pred, NULL, NULL, NULL, 0);
+        } else {
+            it = lio_create_object_iter(tuple.lc, tuple.creds, rp_single, ro_single, obj_types, NULL, recurse_depth, NULL, 0);
+        }
         if (it == NULL) {
             log_printf(0, "ERROR: Failed with object_iter creation\n");
             goto finished;
@@ -145,6 +162,7 @@ int main(int argc, char **argv)
     }
 
 finished:
+    if (pred != NULL) lio_os_predicate_destroy(pred);
     tbx_stdinarray_iter_destroy(it_args);
     lio_shutdown();
     if (it == NULL) return_code = EIO;
@@ -120,6 +120,8 @@ int error_only_check = 0;
 apr_thread_mutex_t *rid_lock = NULL;
 apr_hash_t *rid_changes = NULL;
 apr_pool_t *rid_mpool = NULL;
+lio_rid_throttle_t *throttle = NULL;
+int max_rows = 0;
 
 apr_thread_mutex_t *lock = NULL;
 tbx_list_t *seg_index;
@@ -854,6 +856,8 @@ gop_op_status_t inspect_task(void *arg, int id)
     args.query = query;
     args.qs = gop_opque_new();
     args.qf = gop_opque_new();
+    args.throttle = throttle;
+    args.max_rows = max_rows;
     gop = segment_inspect(seg, lio_gc->da, lfd, whattodo, bufsize, &args, lio_gc->timeout);
     if (gop == NULL) {
         printf("File not found.\n");
@@ -1073,6 +1077,8 @@ int main(int argc, char **argv)
     int submitted, good, bad, do_print, print_pools, assume_skip, base, rtol_mode;
     int pool_finished, pool_todo, check_iter, todo_mode;
     int recurse_depth = 10000;
+    int src_max, dest_max;
+    ex_off_t src_bw, dest_bw;
     inspect_t *w;
     char *set_key, *set_success, *set_fail, *select_key, *select_value;
     int set_success_size, set_fail_size, select_mode, select_index;
@@ -1080,6 +1086,8 @@ int main(int argc, char **argv)
     void *piter;
 
     bufsize = 20*1024*1024;
+    src_max = dest_max = 0;
+    src_bw = dest_bw = 0;
     base = 1;
     dump_iter = 100;
     check_iter = 100;
@@ -1090,7 +1098,7 @@ int main(int argc, char **argv)
 
     if (argc < 2) {
         printf("\n");
-        printf("lio_inspect LIO_COMMON_OPTIONS [-rd recurse_depth] [-b bufsize] [-es] [-eh] [-ew] [-rerr] [-werr] [-h | -hi][-f] [-s] [-r]\n");
+        printf("lio_inspect LIO_COMMON_OPTIONS [-rd recurse_depth] [-b bufsize] [-mr n] [-src_max n] [-dest_max n] [-src_bw bw] [-dest_bw bw] [-es] [-eh] [-ew] [-rerr] [-werr] [-h | -hi][-f] [-s] [-r]\n");
         printf("            [-pc pool.cfg] [-pp iter] [-rebalance [auto|key]] [-q extra_query] [-bl key value] [-p] -o inspect_opt [LIO_PATH_OPTIONS | -]\n");
         lio_print_options(stdout);
         lio_print_path_options(stdout);
@@ -1099,6 +1107,12 @@ int main(int argc, char **argv)
         printf("                         The log naming convention used will be ${log_prefix}.N where N corresponds\n");
         printf("                         to the index provided in the Success/Failure line printed to the global information log.\n");
         printf("    -b bufsize         - Buffer size to use for *each* inspect. Units supported (Default=%s)\n", tbx_stk_pretty_print_int_with_scale(bufsize, ppbuf));
+        printf("    -mr n              - Number of rows to migrate in parallel for each file. (Default=%d)\n", INSPECT_MIGRATE_ROWS);
+        printf("    -src_max n         - Max number of concurrent copies reading from a single RID. Default is no limit.\n");
+        printf("    -dest_max n        - Max number of concurrent copies writing to a single RID. Default is no limit.\n");
+        printf("    -src_bw bw         - Max copy bandwidth in bytes/s read from a single RID. Units supported. Default is no limit.\n");
+        printf("    -dest_bw bw        - Max copy bandwidth in bytes/s written to a single RID. Units supported. Default is no limit.\n");
+        printf("                         These limits apply to depot-to-depot copies during migration and placement repair.\n");
         printf("    -s                 - Report soft errors, like a missing RID in the config file but the allocation is good.\n");
         printf("                         The default is to ignore these type of errors.\n");
         printf("    -r                 - Use reconstruction for all repairs. Even for data placement issues.\n");
@@ -1183,6 +1197,26 @@ int main(int argc, char **argv)
             i++;
             bufsize = tbx_stk_string_get_integer(argv[i]);
             i++;
+        } else if (strcmp(argv[i], "-mr") == 0) {  //** Rows to migrate in parallel
+            i++;
+            max_rows = atoi(argv[i]);
+            i++;
+        } else if (strcmp(argv[i], "-src_max") == 0) {  //** Max copies per source RID
+            i++;
+            src_max = atoi(argv[i]);
+            i++;
+        } else if (strcmp(argv[i], "-dest_max") == 0) {  //** Max copies per destination RID
+            i++;
+            dest_max = atoi(argv[i]);
+            i++;
+        } else if (strcmp(argv[i], "-src_bw") == 0) {  //** Source RID bandwidth
+            i++;
+            src_bw = tbx_stk_string_get_integer(argv[i]);
+            i++;
+        } else if (strcmp(argv[i], "-dest_bw") == 0) {  //** Destination RID bandwidth
+            i++;
+            dest_bw = tbx_stk_string_get_integer(argv[i]);
+            i++;
         } else if (strcmp(argv[i], "-f") == 0) { //** Force repair
             i++;
             force_repair = INSPECT_FORCE_REPAIR;
@@ -1361,6 +1395,11 @@ int main(int argc, char **argv)
     } while ((start_option < i) && (i<argc));
     start_option = i;
 
+    //** Set up the per RID copy limits if needed
+    if ((src_max > 0) || (dest_max > 0) || (src_bw > 0) || (dest_bw > 0)) {
+        throttle = lio_rid_throttle_create(src_max, dest_max, src_bw, dest_bw);
+    }
+
     //** Finish forming the query.  We need to add all the AND operations
     if (q_count == 0) {
         rs_query_destroy(lio_gc->rs, query);
@@ -1621,6 +1660,7 @@ int main(int argc, char **argv)
     tbx_stdinarray_iter_destroy(piter);
     if (rid_lock != NULL) apr_thread_mutex_destroy(rid_lock);
     if (rid_mpool != NULL) apr_pool_destroy(rid_mpool);
+    if (throttle != NULL) lio_rid_throttle_destroy(throttle);
 finished:
     lio_shutdown();
 
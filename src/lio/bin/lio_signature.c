@@ -17,8 +17,12 @@
 #define _log_module_index 206
 
 #include <gop/gop.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <tbx/log.h>
+#include <tbx/string_token.h>
 
 #include <lio/ex3.h>
 #include <lio/lio.h>
@@ -33,7 +37,11 @@ int main(int argc, char **argv)
 {
     int bufsize = 10*1024;
     char buffer[bufsize];
-    int err, ftype, start_index, used;
+    int err, ftype, start_index, start_option, used, i;
+    int do_adler, n_parallel;
+    ex_off_t chunk_size;
+    uint32_t adler;
+    lio_fd_t *fd;
     char *ex_data;
     lio_exnode_t *ex;
     lio_exnode_exchange_t *exp;
@@ -43,16 +51,44 @@ int main(int argc, char **argv)
 
     if (argc < 2) {
         printf("\n");
-        printf("lio_signature LIO_COMMON_OPTIONS file\n");
+        printf("lio_signature LIO_COMMON_OPTIONS [-a [-p n_parallel] [-b chunk_size]] file\n");
         lio_print_options(stdout);
+        printf("    -a            - Also calculate the file's adler32 by reading it in parallel chunks\n");
+        printf("    -p n_parallel - Number of chunks to checksum at once.  Default is the number of cores\n");
+        printf("    -b chunk_size - Chunk size (units accepted).  Default is 16Mi.  Always rounded up to whole stripes and capped at 1Gi\n");
         printf("    file          - File to examine\n");
         return(1);
     }
 
     lio_init(&argc, &argv);
 
-    //** This is the 1st dir to remove
-    start_index = 1;
+    do_adler = 0;
+    n_parallel = 0;
+    chunk_size = 0;
+
+    //*** Parse the args
+    i=1;
+    if (argc > 1) {
+        do {
+            start_option = i;
+
+            if (strcmp(argv[i], "-a") == 0) { //** Calculate the adler32
+                i++;
+                do_adler = 1;
+            } else if (strcmp(argv[i], "-p") == 0) { //** Chunks in flight
+                i++;
+                n_parallel = atoi(argv[i]);
+                i++;
+            } else if (strcmp(argv[i], "-b") == 0) { //** Chunk size
+                i++;
+                chunk_size = tbx_stk_string_get_integer(argv[i]);
+                i++;
+            }
+
+        } while ((start_option - i < 0) && (i<argc));
+    }
+
+    start_index = i;
     if (argv[start_index] == NULL) {
         info_printf(lio_ifd, 0, "Missing Source!\n");
         return(2);
@@ -102,6 +138,22 @@ int main(int argc, char **argv)
 
     info_printf(lio_ifd, 0, "%s", buffer);
 
+    if (do_adler) {
+        fd = NULL;
+        err = gop_sync_exec(lio_open_gop(tuple.lc, tuple.creds, tuple.path, lio_fopen_flags("r"), NULL, &fd, 60));
+        if (err != OP_STATE_SUCCESS) {
+            info_printf(lio_ifd, 0, "Failed opening file! path=%s\n", tuple.path);
+        } else {
+            err = gop_sync_exec(lio_checksum_gop(fd, 0, -1, chunk_size, n_parallel, &adler));
+            if (err == OP_STATE_SUCCESS) {
+                info_printf(lio_ifd, 0, "adler32: %08x\n", adler);
+            } else {
+                info_printf(lio_ifd, 0, "Failed calculating the adler32! path=%s\n", tuple.path);
+            }
+            gop_sync_exec(lio_close_gop(fd));
+        }
+    }
+
     lio_exnode_destroy(ex);
     lio_exnode_exchange_destroy(exp);
 
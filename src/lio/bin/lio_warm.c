@@ -20,6 +20,8 @@
 #include <apr.h>
 #include <apr_hash.h>
 #include <apr_pools.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
 #include <gop/gop.h>
 #include <gop/opque.h>
 #include <gop/tp.h>
@@ -54,20 +56,40 @@ typedef struct {
     ex_off_t dtime;
 } warm_hash_entry_t;
 
+typedef struct warm_file_s warm_file_t;
+
 typedef struct {
    char *cap;
    ex_off_t nbytes;
+   warm_hash_entry_t *wrid;
+   warm_file_t *wf;
 } warm_cap_info_t;
 
-typedef struct {
+struct warm_file_s {     //** Per file state.  Lives until the last cap completes
     warm_cap_info_t *cap;
     char *fname;
-    char *exnode;
     lio_creds_t *creds;
+    ex_id_t inode;
+    int write_err;
+    int n;
+    int n_left;          //** Number of caps still pending
+    int nfailed;
+};
+
+typedef struct {         //** Batch of caps on the same RID sent as a single depot command
+    char *rid_key;
     ibp_context_t *ic;
-    apr_hash_t *hash;
-    apr_pool_t *mpool;
     int n;
+    warm_cap_info_t **cap;
+    ibp_cap_t **caps;
+    int *status;
+} warm_batch_t;
+
+typedef struct {
+    char *fname;
+    char *exnode;
+    lio_creds_t *creds;
+    ibp_context_t *ic;
     ex_id_t inode;
     int write_err;
 } warm_t;
@@ -79,7 +101,17 @@ leveldb_t *db_rid = NULL;
 leveldb_t *db_inode = NULL;
 int verbose = 0;
 
+apr_pool_t *warm_pool = NULL;
+apr_thread_mutex_t *warm_lock = NULL;
+apr_thread_cond_t *warm_cond = NULL;
+apr_hash_t *warm_rids = NULL;      //** RID stats
+apr_hash_t *warm_batches = NULL;   //** Partially filled batches by RID
+int warm_inflight = 0;             //** Batches currently being processed
+ex_off_t warm_good = 0;            //** File counts
+ex_off_t warm_bad = 0;
+
 static int dt = 86400;
+static int bulk_size = 1024;
 
 //*************************************************************************
 // parse_tag_file - Parse the file contianing the RID's for tagging
@@ -128,60 +160,247 @@ void parse_tag_file(char *fname)
 }
 
 //*************************************************************************
-//  gen_warm_task
+// warm_file_finalize - Records the file results once all its caps are done
 //*************************************************************************
 
-gop_op_status_t gen_warm_task(void *arg, int id)
+void warm_file_finalize(warm_file_t *wf)
 {
-    warm_t *w = (warm_t *)arg;
+    char *etext;
+    int i, state;
+
+    state = (wf->write_err == 0) ? 0 : WFE_WRITE_ERR;
+    if (wf->nfailed == 0) {
+        state |= WFE_SUCCESS;
+        if (verbose == 1) info_printf(lio_ifd, 0, "Succeeded with file %s with %d allocations\n", wf->fname, wf->n);
+    } else {
+        state |= WFE_FAIL;
+        info_printf(lio_ifd, 0, "Failed with file %s on %d out of %d allocations\n", wf->fname, wf->nfailed, wf->n);
+    }
+    warm_put_inode(db_inode, wf->inode, state, wf->nfailed, wf->fname);
+
+    etext = NULL;
+    i = 0;
+    lio_setattr(lio_gc, wf->creds, wf->fname, NULL, "os.timestamp.system.warm", (void *)etext, i);
+
+    apr_thread_mutex_lock(warm_lock);
+    if (wf->nfailed == 0) {
+        warm_good++;
+    } else {
+        warm_bad++;
+    }
+    apr_thread_mutex_unlock(warm_lock);
+
+    free(wf->fname);
+    for (i=0; i<wf->n; i++) free(wf->cap[i].cap);
+    free(wf->cap);
+    free(wf);
+}
+
+//*************************************************************************
+// warm_batch_task - Renews all the caps in the batch with a single bulk
+//    command.  If the depot doesn't understand it we fall back to
+//    renewing each cap individually.
+//*************************************************************************
+
+gop_op_status_t warm_batch_task(void *arg, int id)
+{
+    warm_batch_t *b = (warm_batch_t *)arg;
+    warm_cap_info_t *c;
+    warm_file_t *wf;
+    gop_op_generic_t *gop;
     gop_op_status_t status;
+    gop_opque_t *q;
+    ex_off_t dtime;
+    int i, done;
+
+    gop = ibp_bulk_modify_duration_gop(b->ic, b->n, b->caps, dt, b->status, lio_gc->timeout);
+    status = gop_sync_exec_status(gop);
+    dtime = gop_time_exec(gop);
+    gop_free(gop, OP_DESTROY);
+
+    if ((status.op_status != OP_STATE_SUCCESS) && (status.error_code <= 0)) {  //** The whole command failed so do it the old way
+        log_printf(5, "Bulk renew failed for rid_key=%s n=%d error=%d.  Renewing individually\n", b->rid_key, b->n, status.error_code);
+        q = gop_opque_new();
+        for (i=0; i<b->n; i++) {
+            gop = ibp_modify_alloc_gop(b->ic, b->caps[i], -1, dt, -1, lio_gc->timeout);
+            gop_set_myid(gop, i);
+            gop_opque_add(q, gop);
+        }
+        opque_start_execution(q);
+        dtime = 0;
+        while ((gop = opque_waitany(q)) != NULL) {
+            i = gop_get_myid(gop);
+            b->status[i] = (gop_completed_successfully(gop) == OP_STATE_SUCCESS) ? IBP_OK : IBP_E_GENERIC;
+            dtime += gop_time_exec(gop);
+            gop_free(gop, OP_DESTROY);
+        }
+        gop_opque_free(q, OP_DESTROY);
+    }
+    dtime = dtime / b->n;
+
+    for (i=0; i<b->n; i++) {
+        c = b->cap[i];
+        wf = c->wf;
+        if (b->status[i] != IBP_OK) info_printf(lio_ifd, 1, "ERROR: %s  cap=%s\n", wf->fname, c->cap);
+        warm_put_rid(db_rid, c->wrid->rid_key, wf->inode, c->nbytes, 0);
+
+        apr_thread_mutex_lock(warm_lock);
+        c->wrid->dtime += dtime;
+        if (b->status[i] == IBP_OK) {
+            c->wrid->good++;
+        } else {
+            c->wrid->bad++;
+            wf->nfailed++;
+        }
+        wf->n_left--;
+        done = (wf->n_left == 0) ? 1 : 0;
+        apr_thread_mutex_unlock(warm_lock);
+
+        if (done) warm_file_finalize(wf);
+    }
+
+    free(b->cap);
+    free(b->caps);
+    free(b->status);
+    free(b);
+
+    apr_thread_mutex_lock(warm_lock);
+    warm_inflight--;
+    apr_thread_cond_broadcast(warm_cond);
+    apr_thread_mutex_unlock(warm_lock);
+
+    return(gop_success_status);
+}
+
+//*************************************************************************
+// _warm_batch_submit - Launches the batch.  Blocks if too many are in flight.
+//   NOTE: The warm_lock should be held by the calling thread
+//*************************************************************************
+
+void _warm_batch_submit(warm_batch_t *b)
+{
     gop_op_generic_t *gop;
+
+    apr_hash_set(warm_batches, b->rid_key, APR_HASH_KEY_STRING, NULL);
+
+    while (warm_inflight >= lio_parallel_task_count) {
+        apr_thread_cond_wait(warm_cond, warm_lock);
+    }
+    warm_inflight++;
+
+    gop = gop_tp_op_new(lio_gc->tpc_unlimited, NULL, warm_batch_task, (void *)b, NULL, 1);
+    gop_set_auto_destroy(gop, 1);
+    gop_start_execution(gop);
+}
+
+//*************************************************************************
+// warm_batch_add - Adds the cap to the RID's pending batch sending it if full
+//*************************************************************************
+
+void warm_batch_add(ibp_context_t *ic, warm_cap_info_t *c)
+{
+    warm_batch_t *b;
+
+    apr_thread_mutex_lock(warm_lock);
+    b = apr_hash_get(warm_batches, c->wrid->rid_key, APR_HASH_KEY_STRING);
+    if (b == NULL) {
+        tbx_type_malloc_clear(b, warm_batch_t, 1);
+        b->rid_key = c->wrid->rid_key;
+        b->ic = ic;
+        tbx_type_malloc(b->cap, warm_cap_info_t *, bulk_size);
+        tbx_type_malloc(b->caps, ibp_cap_t *, bulk_size);
+        tbx_type_malloc(b->status, int, bulk_size);
+        apr_hash_set(warm_batches, b->rid_key, APR_HASH_KEY_STRING, b);
+    }
+
+    b->cap[b->n] = c;
+    b->caps[b->n] = c->cap;
+    b->n++;
+
+    if (b->n >= bulk_size) _warm_batch_submit(b);
+    apr_thread_mutex_unlock(warm_lock);
+}
+
+//*************************************************************************
+// warm_batch_flush - Sends any partial batches and waits for them all to complete
+//*************************************************************************
+
+void warm_batch_flush()
+{
+    apr_hash_index_t *hi;
+    warm_batch_t *b;
+
+    apr_thread_mutex_lock(warm_lock);
+    while ((hi = apr_hash_first(NULL, warm_batches)) != NULL) {
+        apr_hash_this(hi, NULL, NULL, (void **)&b);
+        _warm_batch_submit(b);
+    }
+
+    while (warm_inflight > 0) {
+        apr_thread_cond_wait(warm_cond, warm_lock);
+    }
+    apr_thread_mutex_unlock(warm_lock);
+}
+
+//*************************************************************************
+//  gen_warm_task - Parses the exnode and queues the caps for renewal
+//*************************************************************************
+
+gop_op_status_t gen_warm_task(void *arg, int id)
+{
+    warm_t *w = (warm_t *)arg;
+    warm_file_t *wf;
+    warm_cap_info_t *c;
     tbx_inip_file_t *fd;
-    int i, nfailed, state;
+    int done;
     warm_hash_entry_t *wrid = NULL;
     char *etext;
-    gop_opque_t *q;
 
     log_printf(15, "warming fname=%s, dt=%d\n", w->fname, dt);
     fd = tbx_inip_string_read(w->exnode);
     tbx_inip_group_t *g;
 
-    q = gop_opque_new();
-    opque_start_execution(q);
+    tbx_type_malloc_clear(wf, warm_file_t, 1);
+    wf->fname = w->fname;
+    wf->creds = w->creds;
+    wf->inode = w->inode;
+    wf->write_err = w->write_err;
+    wf->n_left = 1;  //** Hold a reference so the file can't complete while we're still adding caps
 
-    tbx_type_malloc(w->cap, warm_cap_info_t, tbx_inip_group_count(fd));
+    tbx_type_malloc_clear(wf->cap, warm_cap_info_t, tbx_inip_group_count(fd));
     g = tbx_inip_group_first(fd);
-    w->n = 0;
     while (g) {
         if (strncmp(tbx_inip_group_get(g), "block-", 6) == 0) { //** Got a data block
             //** Get the RID key
             etext = tbx_inip_get_string(fd, tbx_inip_group_get(g), "rid_key", NULL);
             if (etext != NULL) {
-                wrid = apr_hash_get(w->hash, etext, APR_HASH_KEY_STRING);
+                apr_thread_mutex_lock(warm_lock);
+                wrid = apr_hash_get(warm_rids, etext, APR_HASH_KEY_STRING);
                 if (wrid == NULL) { //** 1st time so need to make an entry
                     tbx_type_malloc_clear(wrid, warm_hash_entry_t, 1);
                     wrid->rid_key = etext;
-                    apr_hash_set(w->hash, wrid->rid_key, APR_HASH_KEY_STRING, wrid);
+                    apr_hash_set(warm_rids, wrid->rid_key, APR_HASH_KEY_STRING, wrid);
                 } else {
                     free(etext);
                 }
+                apr_thread_mutex_unlock(warm_lock);
             }
 
             //** Get the data size and update the counts
-            w->cap[w->n].nbytes += tbx_inip_get_integer(fd, tbx_inip_group_get(g), "max_size", 0);
-            wrid->nbytes += w->cap[w->n].nbytes;
+            c = &(wf->cap[wf->n]);
+            c->wf = wf;
+            c->wrid = wrid;
+            c->nbytes = tbx_inip_get_integer(fd, tbx_inip_group_get(g), "max_size", 0);
+            apr_thread_mutex_lock(warm_lock);
+            wrid->nbytes += c->nbytes;
+            wf->n_left++;
+            apr_thread_mutex_unlock(warm_lock);
 
             //** Get the manage cap
             etext = tbx_inip_get_string(fd, tbx_inip_group_get(g), "manage_cap", "");
-            w->cap[w->n].cap = tbx_stk_unescape_text('\\', etext);
+            c->cap = tbx_stk_unescape_text('\\', etext);
             free(etext);
-
-            //** Add the task
-            gop = ibp_modify_alloc_gop(w->ic, w->cap[w->n].cap, -1, dt, -1, lio_gc->timeout);
-            gop_set_myid(gop, w->n);
-            gop_set_private(gop, wrid);
-            gop_opque_add(q, gop);
-            w->n++;
+            wf->n++;
 
             //** Check if it was tagged
             if (tagged_rids != NULL) {
@@ -189,55 +408,24 @@ gop_op_status_t gen_warm_task(void *arg, int id)
                     info_printf(lio_ifd, 0, "RID_TAG: %s  rid_key=%s\n", w->fname, wrid->rid_key);
                 }
             }
+
+            //** Queue it for renewal
+            warm_batch_add(w->ic, c);
         }
         g = tbx_inip_group_next(g);
     }
 
     tbx_inip_destroy(fd);
-
-    nfailed = 0;
-    while ((gop = opque_waitany(q)) != NULL) {
-        status = gop_get_status(gop);
-        wrid = gop_get_private(gop);
-        i = gop_get_myid(gop);
-
-        wrid->dtime += gop_time_exec(gop);
-        if (status.op_status == OP_STATE_SUCCESS) {
-            wrid->good++;
-         } else {
-            nfailed++;
-            wrid->bad++;
-            info_printf(lio_ifd, 1, "ERROR: %s  cap=%s\n", w->fname, w->cap[i].cap);
-        }
-        warm_put_rid(db_rid, wrid->rid_key, w->inode, w->cap[i].nbytes, 0);
-
-        gop_free(gop, OP_DESTROY);
-    }
-
-    state = (w->write_err == 0) ? 0 : WFE_WRITE_ERR;
-    if (nfailed == 0) {
-        status = gop_success_status;
-        state |= WFE_SUCCESS;
-        if (verbose == 1) info_printf(lio_ifd, 0, "Succeeded with file %s with %d allocations\n", w->fname, w->n);
-    } else {
-        status = gop_failure_status;
-        state |= WFE_FAIL;
-        info_printf(lio_ifd, 0, "Failed with file %s on %d out of %d allocations\n", w->fname, nfailed, w->n);
-    }
-    warm_put_inode(db_inode, w->inode, state, nfailed, w->fname);
-
-    etext = NULL;
-    i = 0;
-    lio_setattr(lio_gc, w->creds, w->fname, NULL, "os.timestamp.system.warm", (void *)etext, i);
-
-    gop_opque_free(q, OP_DESTROY);
-
     free(w->exnode);
-    free(w->fname);
-    for (i=0; i<w->n; i++) free(w->cap[i].cap);
-    free(w->cap);
 
-    return(status);
+    //** Release our reference
+    apr_thread_mutex_lock(warm_lock);
+    wf->n_left--;
+    done = (wf->n_left == 0) ? 1 : 0;
+    apr_thread_mutex_unlock(warm_lock);
+    if (done) warm_file_finalize(wf);
+
+    return(gop_success_status);
 }
 
 
@@ -250,7 +438,6 @@ int main(int argc, char **argv)
     char *fname, *path;
     gop_opque_t *q;
     gop_op_generic_t *gop;
-    gop_op_status_t status;
     char *keys[] = { "system.exnode", "system.write_errors", "system.inode" };
     char *vals[3];
     char *db_base = "/lio/log/warm";
@@ -279,13 +466,14 @@ int main(int argc, char **argv)
 
     if (argc < 2) {
         printf("\n");
-        printf("lio_warm LIO_COMMON_OPTIONS [-db DB_output_dir] [-t tag.cfg] [-rd recurse_depth] [-dt time] [-sb] [-sf] [ -v] LIO_PATH_OPTIONS\n");
+        printf("lio_warm LIO_COMMON_OPTIONS [-db DB_output_dir] [-t tag.cfg] [-rd recurse_depth] [-dt time] [-bs n] [-sb] [-sf] [ -v] LIO_PATH_OPTIONS\n");
         lio_print_options(stdout);
         lio_print_path_options(stdout);
         printf("    -db DB_output_dir   - Output Directory for the DBes. Default is %s\n", db_base);
         printf("    -t tag.cfg         - INI file with RID to tag by printing any files usign the RIDs\n");
         printf("    -rd recurse_depth  - Max recursion depth on directories. Defaults to %d\n", recurse_depth);
         printf("    -dt time           - Duration time in sec.  Default is %d sec\n", dt);
+        printf("    -bs n              - Max number of allocations renewed in a single depot command.  Default is %d\n", bulk_size);
         printf("    -sb                - Print the summary but only list the bad RIDs\n");
         printf("    -sf                - Print the the full summary\n");
         printf("    -v                 - Print all Success/Fail messages instead of just errors\n");
@@ -313,6 +501,11 @@ int main(int argc, char **argv)
             i++;
             dt = atoi(argv[i]);
             i++;
+        } else if (strcmp(argv[i], "-bs") == 0) { //** Bulk renewal size
+            i++;
+            bulk_size = atoi(argv[i]);
+            if (bulk_size < 1) bulk_size = 1;
+            i++;
         } else if (strcmp(argv[i], "-rd") == 0) { //** Recurse depth
             i++;
             recurse_depth = atoi(argv[i]);
@@ -353,12 +546,13 @@ int main(int argc, char **argv)
     opque_start_execution(q);
 
     tbx_type_malloc_clear(w, warm_t, lio_parallel_task_count);
-    for (j=0; j<lio_parallel_task_count; j++) {
-        apr_pool_create(&(w[j].mpool), NULL);
-        w[j].hash = apr_hash_make(w[j].mpool);
-    }
+    apr_pool_create(&warm_pool, NULL);
+    apr_thread_mutex_create(&warm_lock, APR_THREAD_MUTEX_DEFAULT, warm_pool);
+    apr_thread_cond_create(&warm_cond, warm_pool);
+    warm_rids = apr_hash_make(warm_pool);
+    warm_batches = apr_hash_make(warm_pool);
 
-    submitted = good = bad = werr = missing_err = 0;
+    submitted = werr = missing_err = 0;
     return_code = 0;
     while ((path = tbx_stdinarray_iter_next(piter)) != NULL) {
         if (rg_mode == 0) {
@@ -429,12 +623,6 @@ int main(int argc, char **argv)
 
             if (submitted >= lio_parallel_task_count) {
                 gop = opque_waitany(q);
-                status = gop_get_status(gop);
-                if (status.op_status == OP_STATE_SUCCESS) {
-                    good++;
-                } else {
-                    bad++;
-                }
                 slot = gop_get_myid(gop);
                 gop_free(gop, OP_DESTROY);
             } else {
@@ -445,15 +633,11 @@ int main(int argc, char **argv)
         lio_destroy_object_iter(lio_gc, it);
 
         while ((gop = opque_waitany(q)) != NULL) {
-            status = gop_get_status(gop);
-            if (status.op_status == OP_STATE_SUCCESS) {
-                good++;
-            } else {
-                bad++;
-            }
             gop_free(gop, OP_DESTROY);
         }
 
+        warm_batch_flush();  //** Send any partial batches and wait for all the files to complete
+
         lio_path_release(&tuple);
         if (rp_single != NULL) {
             lio_os_regex_table_destroy(rp_single);
@@ -467,6 +651,8 @@ int main(int argc, char **argv)
 
     gop_opque_free(q, OP_DESTROY);
 
+    good = warm_good;
+    bad = warm_bad;
     info_printf(lio_ifd, 0, "--------------------------------------------------------------------\n");
     info_printf(lio_ifd, 0, "Submitted: " XOT "   Success: " XOT "   Fail: " XOT "    Write Errors: " XOT "   Missing Exnodes: " XOT "\n", submitted, good, bad, werr, missing_err);
     if (submitted != (good+bad)) {
@@ -481,28 +667,11 @@ int main(int argc, char **argv)
 
     if (submitted == 0) goto cleanup;
 
-    //** Merge the data from all the tables
+    //** Sort the RID stats
     master = tbx_list_create(0, &tbx_list_string_compare, tbx_list_string_dup, tbx_list_simple_free, tbx_list_no_data_free);
-    for (i=0; i<lio_parallel_task_count; i++) {
-        hi = apr_hash_first(NULL, w[i].hash);
-        while (hi != NULL) {
-            apr_hash_this(hi, (const void **)&rkey, &klen, (void **)&wrid);
-            mrid = tbx_list_search(master, wrid->rid_key);
-            if (mrid == NULL) {
-                tbx_list_insert(master, wrid->rid_key, wrid);
-            } else {
-                mrid->good += wrid->good;
-                mrid->bad += wrid->bad;
-                mrid->nbytes += wrid->nbytes;
-                mrid->dtime += wrid->dtime;
-
-                apr_hash_set(w[i].hash, wrid->rid_key, APR_HASH_KEY_STRING, NULL);
-                free(wrid->rid_key);
-                free(wrid);
-            }
-
-            hi = apr_hash_next(hi);
-        }
+    for (hi = apr_hash_first(NULL, warm_rids); hi != NULL; hi = apr_hash_next(hi)) {
+        apr_hash_this(hi, (const void **)&rkey, &klen, (void **)&wrid);
+        tbx_list_insert(master, wrid->rid_key, wrid);
     }
 
     //** Get the RID config which is used in the summary
@@ -579,9 +748,9 @@ int main(int argc, char **argv)
     }
     tbx_stack_free(stack, 0);
 cleanup:
-    for (j=0; j<lio_parallel_task_count; j++) {
-        apr_pool_destroy(w[j].mpool);
-    }
+    apr_thread_mutex_destroy(warm_lock);
+    apr_thread_cond_destroy(warm_cond);
+    apr_pool_destroy(warm_pool);
 
     free(w);
 
@@ -17,22 +17,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <tbx/adler32.h>
 #include <tbx/assert_result.h>
 #include <tbx/string_token.h>
 #include <tbx/type_malloc.h>
-#include <zlib.h>
 
 //*************************************************************************
 // adler32_fd- Calculates the adler32 for the given FD
 //*************************************************************************
 
-uLong adler32_fd(FILE *fd, unsigned char *buffer, int bufsize)
+uint32_t adler32_fd(FILE *fd, unsigned char *buffer, int bufsize)
 {
     int nbytes;
-    uLong adler = adler32(0L, Z_NULL, 0);
+    uint32_t adler = 1;
 
     while ((nbytes = fread(buffer, 1, bufsize, fd)) > 0) {
-        adler = adler32(adler, buffer, nbytes);
+        adler = tbx_adler32(adler, buffer, nbytes);
     }
 
     return(adler);
@@ -22,6 +22,7 @@
 #include <tbx/list.h>
 #include <tbx/pigeon_coop.h>
 
+#include "cache/arena.h"
 #include "ex3.h"
 
 #ifdef __cplusplus
@@ -66,15 +67,32 @@ struct lio_cache_counters_t {
     ex_off_t write_bytes;
 };
 
+struct lio_cache_prefetch_counters_t {
+    ex_off_t issued_count;    //** Prefetch ops launched
+    ex_off_t issued_bytes;    //** Bytes requested by prefetch ops
+    ex_off_t hit_bytes;       //** Prefetched bytes later read by the user
+    ex_off_t wait_count;      //** Prefetches a reader caught up with before they completed
+    ex_off_t throttled_count; //** Prefetches dropped or truncated by the global budget
+    ex_off_t stride_count;    //** Strided prefetches issued
+    ex_off_t backward_count;  //** Backward scan prefetches issued
+};
+
 struct lio_cache_stats_get_t {
     lio_cache_counters_t user;
     lio_cache_counters_t system;
+    lio_cache_prefetch_counters_t prefetch;
     ex_off_t dirty_bytes;
     ex_off_t hit_bytes;
     ex_off_t miss_bytes;
     ex_off_t unused_bytes;
     apr_time_t hit_time;
     apr_time_t miss_time;
+    apr_time_t write_stall_time;   //** Time writers spent throttled or waiting for space
+    ex_off_t write_stall_count;
+    ex_off_t writeback_extents;    //** Extents flushed by the write-back thread
+    ex_off_t arena_slab_bytes;     //** Bytes mapped for page slabs
+    ex_off_t arena_used_bytes;     //** Slab bytes currently handed out as pages
+    ex_off_t arena_huge_slabs;     //** Slabs backed by huge pages
 };
 
 struct lio_cache_cond_t {
@@ -163,6 +181,7 @@ struct lio_cache_fn_t {
     void (*cache_miss_tag)(lio_cache_t *c, lio_segment_t *seg, int rw_mode, ex_off_t lo, ex_off_t hi, ex_off_t missing_offset, void **miss);
     int (*s_page_access)(lio_cache_t *c, lio_cache_page_t *p, int rw_mode, ex_off_t request_len);
     int (*s_pages_release)(lio_cache_t *c, lio_cache_page_t **p, int n_pages);
+    void (*write_throttle)(lio_cache_t *c, lio_segment_t *seg, ex_off_t nbytes);
     lio_cache_t *(*get_handle)(lio_cache_t *);
     int (*destroy)(lio_cache_t *c);
 };
@@ -173,6 +192,7 @@ struct lio_cache_t {
     apr_thread_mutex_t *lock;
     tbx_list_t *segments;
     tbx_pc_t *cond_coop;
+    cache_arena_t *arena;
     data_attr_t *da;
     ex_off_t default_page_size;
     lio_cache_stats_get_t stats;
@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <tbx/apr_wrapper.h>
 #include <tbx/atomic_counter.h>
+#include <tbx/fmttypes.h>
 #include <tbx/iniparse.h>
 #include <tbx/list.h>
 #include <tbx/log.h>
@@ -56,11 +57,27 @@ typedef struct {
     lio_segment_t *seg;
     ex_off_t lo;
     ex_off_t hi;
+    ex_off_t stride;    //** Distance between blocks for a strided prefetch
+    ex_off_t nbytes;    //** Total bytes charged against the prefetch budget
+    ex_off_t eof_row;   //** Last page in the segment.  Blocks are clipped to it
+    int n_blocks;       //** Number of [lo,hi] blocks to fetch
+    int stride_slot;    //** Stride table slot or -1 for a sequential stream
     int start_prefetch;
     int start_trigger;
     gop_op_generic_t *gop;
 } amp_prefetch_op_t;
 
+typedef struct {
+    lio_segment_t *seg;
+    ex_off_t dirty;
+} amp_wb_seg_t;
+
+typedef struct {
+    lio_segment_t *seg;
+    ex_off_t lo;
+    ex_off_t hi;
+} amp_wb_extent_t;
+
 int _amp_logging = 15;  //** Kludge to flip the low level loggin statements on/off
 int _amp_slog = 15;
 
@@ -159,12 +176,22 @@ lio_amp_page_stream_t *_amp_stream_get(lio_cache_t *c, lio_segment_t *seg, ex_of
     lio_amp_page_stream_t *ps, *ps2;
     tbx_list_iter_t it;
     ex_off_t *poff, dn, pos;
+    int i;
 
     if (nbytes > 0) {
         ps = tbx_list_search(as->streams, &offset);
 
         log_printf(_amp_logging, "seg=" XIDT " offset=" XOT " nbytes=" XOT "\n", segment_id(seg), offset, nbytes);
         if ((ps == NULL) && (nbytes > 0)) { //** Got a miss and they want a new one
+            //** Find a victim.  Streams that have been used since the last sweep get a
+            //** second chance so interleaved readers don't knock each other out.
+            for (i=0; i<as->max_streams; i++) {
+                ps = &(as->stream_table[as->index]);
+                if (ps->referenced == 0) break;
+                ps->referenced = 0;
+                as->index = (as->index + 1) % as->max_streams;
+            }
+
             //** Unlink the old one and remove it
             ps = &(as->stream_table[as->index]);
             if (pse != NULL) *pse = ps;
@@ -177,12 +204,14 @@ lio_amp_page_stream_t *_amp_stream_get(lio_cache_t *c, lio_segment_t *seg, ex_of
             ps->nbytes = nbytes;
             ps->prefetch_size = 0;
             ps->trigger_distance = 0;
+            ps->referenced = 0;
 
             log_printf(_amp_logging, "seg=" XIDT " offset=" XOT " moving to MRU ps=%p ps->last_offset=" XOT "\n", segment_id(seg), offset, ps, ps->last_offset);
 
             //** Add the entry back into the stream table
             tbx_list_insert(as->streams, &(ps->last_offset), ps);
         } else if (ps != NULL) {   //** Move it to the MRU slot
+            ps->referenced = 1;
             log_printf(_amp_logging, "seg=" XIDT " offset=" XOT " moving to MRU ps=%p ps->last_offset=" XOT " prefetch=%d trigger=%d\n", segment_id(seg), offset, ps, ps->last_offset, ps->prefetch_size, ps->trigger_distance);
         }
     } else {
@@ -194,6 +223,7 @@ lio_amp_page_stream_t *_amp_stream_get(lio_cache_t *c, lio_segment_t *seg, ex_of
         }
         ps2 = ps;
         if (ps != NULL) {
+            ps->referenced = 1;
             log_printf(_amp_logging, "seg=" XIDT " offset=" XOT " moving to MRU ps=%p ps->last_offset=" XOT " prefetch=%d trigger=%d\n", segment_id(seg), offset, ps, ps->last_offset, ps->prefetch_size, ps->trigger_distance);
         }
         if (pse != NULL) {
@@ -217,86 +247,224 @@ lio_amp_page_stream_t *_amp_stream_get(lio_cache_t *c, lio_segment_t *seg, ex_of
 }
 
 //*************************************************************************
-// amp_dirty_thread - Thread to handle flushing due to dirty ratio
+// amp_wb_seg_compare - Sorts the write-back segments with the most dirty 1st
 //*************************************************************************
 
-void *amp_dirty_thread(apr_thread_t *th, void *data)
+int amp_wb_seg_compare(const void *a, const void *b)
+{
+    const amp_wb_seg_t *s1 = (const amp_wb_seg_t *)a;
+    const amp_wb_seg_t *s2 = (const amp_wb_seg_t *)b;
+
+    if (s1->dirty > s2->dirty) return(-1);
+    if (s1->dirty < s2->dirty) return(1);
+    return(0);
+}
+
+//*************************************************************************
+// _amp_writeback_plan - Builds the list of dirty extents to flush.  Segments
+//    are visited most dirty first and each segment's dirty pages are coalesced
+//    into sorted contiguous extents.  If full=0 only enough extents to get
+//    back under the low water mark are returned.  The segments used are flagged
+//    as in use and returned in seg_list.
+//   NOTE: Cache lock should be held by calling thread
+//*************************************************************************
+
+amp_wb_extent_t *_amp_writeback_plan(lio_cache_t *c, int full, amp_wb_seg_t **seg_list, int *n_segs, int *n_extents)
 {
-    lio_cache_t *c = (lio_cache_t *)data;
     lio_cache_amp_t *cp = (lio_cache_amp_t *)c->fn.priv;
-    double df;
-    int n, i;
-    ex_id_t *id;
+    lio_cache_lio_segment_t *s;
     lio_segment_t *seg;
+    lio_cache_page_t *p;
+    amp_wb_seg_t *sl;
+    amp_wb_extent_t *ext;
+    tbx_list_iter_t it;
+    ex_id_t *id;
+    ex_off_t *poff, goal, planned, lo, hi, max_ext;
+    int i, n, ns, ne;
+
+    n = tbx_list_key_count(c->segments);
+    tbx_type_malloc(sl, amp_wb_seg_t, n+1);
+
+    //** Get the dirty segments
+    ns = 0;
+    max_ext = 0;
+    it = tbx_list_iter_search(c->segments, NULL, 0);
+    tbx_list_next(&it, (tbx_list_key_t **)&id, (tbx_list_data_t **)&seg);
+    while ((id != NULL) && (ns < n)) {
+        s = (lio_cache_lio_segment_t *)seg->priv;
+        if (s->stats.dirty_bytes > 0) {
+            sl[ns].seg = seg;
+            sl[ns].dirty = s->stats.dirty_bytes;
+            max_ext += s->stats.dirty_bytes / s->page_size + 1;
+            ns++;
+        }
+        tbx_list_next(&it, (tbx_list_key_t **)&id, (tbx_list_data_t **)&seg);
+    }
+    qsort(sl, ns, sizeof(amp_wb_seg_t), amp_wb_seg_compare);
+
+    goal = (full == 1) ? c->stats.dirty_bytes : c->stats.dirty_bytes - cp->dirty_bytes_trigger/2;
+
+    //** Now coalesce the dirty pages into extents
+    tbx_type_malloc(ext, amp_wb_extent_t, max_ext+1);
+    ne = 0;
+    planned = 0;
+    for (i=0; (i<ns) && (planned < goal); i++) {
+        seg = sl[i].seg;
+        s = (lio_cache_lio_segment_t *)seg->priv;
+        s->cache_check_in_progress++;  //** Flag it as being checked
+
+        lo = hi = -1;
+        it = tbx_list_iter_search(s->pages, NULL, 0);
+        tbx_list_next(&it, (tbx_list_key_t **)&poff, (tbx_list_data_t **)&p);
+        while ((p != NULL) && (ne < max_ext)) {
+            if (((p->bit_fields & C_ISDIRTY) > 0) && (p->offset >= 0)) {
+                if ((lo >= 0) && (p->offset == hi + s->page_size) && ((p->offset + s->page_size - lo) <= cp->writeback_extent_bytes)) {
+                    hi = p->offset;  //** Extend the current extent
+                } else {
+                    if (lo >= 0) {
+                        ext[ne].seg = seg; ext[ne].lo = lo; ext[ne].hi = hi + s->page_size - 1;
+                        planned += ext[ne].hi - lo + 1;
+                        ne++;
+                    }
+                    lo = hi = p->offset;
+                }
+            } else if (lo >= 0) {  //** Hit a clean page so close out the extent
+                ext[ne].seg = seg; ext[ne].lo = lo; ext[ne].hi = hi + s->page_size - 1;
+                planned += ext[ne].hi - lo + 1;
+                ne++;
+                lo = hi = -1;
+            }
+            tbx_list_next(&it, (tbx_list_key_t **)&poff, (tbx_list_data_t **)&p);
+        }
+
+        if ((lo >= 0) && (ne < max_ext)) {
+            ext[ne].seg = seg; ext[ne].lo = lo; ext[ne].hi = hi + s->page_size - 1;
+            planned += ext[ne].hi - lo + 1;
+            ne++;
+        }
+    }
+
+    log_printf(15, "full=%d dirty=" XOT " goal=" XOT " planned=" XOT " n_segs=%d/%d n_extents=%d\n", full, c->stats.dirty_bytes, goal, planned, i, ns, ne);
+
+    *seg_list = sl;
+    *n_segs = i;
+    *n_extents = ne;
+    return(ext);
+}
+
+//*************************************************************************
+// _amp_writeback_run - Flushes the extents keeping at most writeback_inflight_bytes
+//    outstanding.  Writers throttled in amp_write_throttle are woken as each
+//    extent completes.  Returns the number of extents successfully flushed.
+//*************************************************************************
+
+int _amp_writeback_run(lio_cache_t *c, amp_wb_extent_t *ext, int n)
+{
+    lio_cache_amp_t *cp = (lio_cache_amp_t *)c->fn.priv;
     gop_opque_t *q;
     gop_op_generic_t *gop;
+    ex_off_t inflight, len;
+    int i, j, nflushed;
+
+    q = gop_opque_new();
+    opque_start_execution(q);
+
+    inflight = 0;
+    nflushed = 0;
+    i = 0;
+    while ((i < n) || (inflight > 0)) {
+        //** Keep the pipe full
+        while (i < n) {
+            len = ext[i].hi - ext[i].lo + 1;
+            if ((inflight > 0) && ((inflight + len) > cp->writeback_inflight_bytes)) break;
+            gop = cache_flush_range_gop(ext[i].seg, c->da, ext[i].lo, ext[i].hi, c->timeout);
+            gop_set_myid(gop, i);
+            gop_opque_add(q, gop);
+            inflight += len;
+            i++;
+        }
+
+        gop = opque_waitany(q);
+        if (gop == NULL) break;
+        j = gop_get_myid(gop);
+        inflight -= ext[j].hi - ext[j].lo + 1;
+        if (gop_completed_successfully(gop) == OP_STATE_SUCCESS) {
+            nflushed++;
+        } else {
+            log_printf(1, "ERROR flushing seg=" XIDT " lo=" XOT " hi=" XOT "\n", segment_id(ext[j].seg), ext[j].lo, ext[j].hi);
+        }
+        gop_free(gop, OP_DESTROY);
+
+        //** Let any throttled writers know progress was made
+        cache_lock(c);
+        apr_thread_cond_broadcast(cp->writeback_cond);
+        cache_unlock(c);
+    }
+
+    gop_opque_free(q, OP_DESTROY);
+
+    return(nflushed);
+}
+
+//*************************************************************************
+// amp_dirty_thread - Write-back thread.  While the dirty bytes are over the
+//    trigger it continuously flushes coalesced extents, most dirty segment 1st,
+//    with a bounded amount in flight.  Otherwise it sleeps and flushes
+//    everything every dirty_max_wait.
+//*************************************************************************
+
+void *amp_dirty_thread(apr_thread_t *th, void *data)
+{
+    lio_cache_t *c = (lio_cache_t *)data;
+    lio_cache_amp_t *cp = (lio_cache_amp_t *)c->fn.priv;
+    double df;
+    int n_segs, n_extents, i, full, nflushed;
     lio_cache_lio_segment_t *s;
-    tbx_sl_iter_t it;
-    lio_segment_t **flush_list;
+    amp_wb_seg_t *seg_list;
+    amp_wb_extent_t *ext;
+    apr_time_t last_full;
 
     cache_lock(c);
 
     log_printf(15, "Dirty thread launched\n");
+    last_full = apr_time_now();
+    nflushed = 0;
     while (c->shutdown_request == 0) {
-        apr_thread_cond_timedwait(cp->dirty_trigger, c->lock, cp->dirty_max_wait);
+        if ((nflushed == 0) || (c->stats.dirty_bytes <= cp->dirty_bytes_trigger)) {  //** Nothing pressing or no progress so sleep
+            cp->flush_in_progress = 0;
+            apr_thread_cond_timedwait(cp->dirty_trigger, c->lock, cp->dirty_max_wait);
+        }
+
+        full = (((apr_time_now() - last_full) >= cp->dirty_max_wait) || (c->shutdown_request == 1)) ? 1 : 0;
+        if (full == 1) last_full = apr_time_now();
 
         df = cp->max_bytes;
         df = c->stats.dirty_bytes / df;
 
-        log_printf(15, "Dirty thread running.  dirty fraction=%lf dirty bytes=" XOT " inprogress=%d  cached segments=%d\n", df, c->stats.dirty_bytes, cp->flush_in_progress, tbx_list_key_count(c->segments));
+        log_printf(15, "Dirty thread running.  dirty fraction=%lf dirty bytes=" XOT " inprogress=%d  cached segments=%d full=%d\n", df, c->stats.dirty_bytes, cp->flush_in_progress, tbx_list_key_count(c->segments), full);
 
         cp->flush_in_progress = 1;
-        q = gop_opque_new();
-
-        n = tbx_list_key_count(c->segments);
-        tbx_type_malloc(flush_list, lio_segment_t *, n);
-
-        it = tbx_list_iter_search(c->segments, NULL, 0);
-        tbx_list_next(&it, (tbx_list_key_t **)&id, (tbx_list_data_t **)&seg);
-        i = 0;
-        while (id != NULL) {
-            log_printf(15, "Flushing seg=" XIDT " i=%d\n", *id, i);
-            tbx_log_flush();
-            flush_list[i] = seg;
-            s = (lio_cache_lio_segment_t *)seg->priv;
-            s->cache_check_in_progress++;  //** Flag it as being checked
-            gop = cache_flush_range_gop(seg, s->c->da, 0, -1, s->c->timeout);
-            gop_set_myid(gop, i);
-            gop_opque_add(q, gop);
-            i++;
-
-            tbx_list_next(&it, (tbx_list_key_t **)&id, (tbx_list_data_t **)&seg);
-        }
+        ext = _amp_writeback_plan(c, full, &seg_list, &n_segs, &n_extents);
         cache_unlock(c);
 
-        //** Flag the tasks as they complete
-        opque_start_execution(q);
-        while ((gop = opque_waitany(q)) != NULL) {
-            i = gop_get_myid(gop);
-            s = (lio_cache_lio_segment_t *)flush_list[i]->priv;
+        nflushed = (n_extents > 0) ? _amp_writeback_run(c, ext, n_extents) : 0;
 
-            log_printf(15, "Flush completed seg=" XIDT " i=%d\n", segment_id(flush_list[i]), i);
-            tbx_log_flush();
-            cache_lock(c);
+        cache_lock(c);
+        for (i=0; i<n_segs; i++) {
+            s = (lio_cache_lio_segment_t *)seg_list[i].seg->priv;
             s->cache_check_in_progress--;  //** Flag it as being finished
-            cache_unlock(c);
-
-            gop_free(gop, OP_DESTROY);
         }
-        gop_opque_free(q, OP_DESTROY);
+        free(seg_list);
+        free(ext);
 
-
-        cache_lock(c);
-
-        cp->flush_in_progress = 0;
-        free(flush_list);
+        c->stats.writeback_extents += nflushed;
 
         df = cp->max_bytes;
         df = c->stats.dirty_bytes / df;
-        log_printf(15, "Dirty thread sleeping.  dirty fraction=%lf dirty bytes=" XOT " inprogress=%d\n", df, c->stats.dirty_bytes, cp->flush_in_progress);
-//     apr_thread_cond_timedwait(cp->dirty_trigger, c->lock, cp->dirty_max_wait);
+        log_printf(15, "Dirty thread pass done.  dirty fraction=%lf dirty bytes=" XOT " extents=%d flushed=%d\n", df, c->stats.dirty_bytes, n_extents, nflushed);
     }
 
+    cp->flush_in_progress = 0;
     log_printf(15, "Dirty thread Exiting\n");
 
     cache_unlock(c);
@@ -305,6 +473,42 @@ void *amp_dirty_thread(apr_thread_t *th, void *data)
 
 }
 
+//*************************************************************************
+// amp_write_throttle - Applies backpressure to writers.  Once the dirty bytes
+//    pass the trigger the writer is delayed in proportion to how far it is
+//    towards the hard limit, up to write_throttle_max_wait.  The wait ends early
+//    if the write-back thread makes progress.
+//*************************************************************************
+
+void amp_write_throttle(lio_cache_t *c, lio_segment_t *seg, ex_off_t nbytes)
+{
+    lio_cache_amp_t *cp = (lio_cache_amp_t *)c->fn.priv;
+    apr_time_t start, dt;
+    double frac;
+
+    cache_lock(c);
+    if ((c->stats.dirty_bytes > cp->dirty_bytes_trigger) && (c->shutdown_request == 0)) {
+        if (cp->flush_in_progress == 0) {
+            cp->flush_in_progress = 1;
+            apr_thread_cond_signal(cp->dirty_trigger);
+        }
+
+        frac = c->stats.dirty_bytes - cp->dirty_bytes_trigger;
+        frac = (cp->dirty_hard_bytes > cp->dirty_bytes_trigger) ? frac / (cp->dirty_hard_bytes - cp->dirty_bytes_trigger) : 1.0;
+        if (frac > 1.0) frac = 1.0;
+        dt = frac * cp->write_throttle_max_wait;
+
+        if (dt > 0) {
+            log_printf(15, "seg=" XIDT " nbytes=" XOT " dirty=" XOT " throttling dt=" TT "\n", segment_id(seg), nbytes, c->stats.dirty_bytes, dt);
+            start = apr_time_now();
+            apr_thread_cond_timedwait(cp->writeback_cond, c->lock, dt);
+            c->stats.write_stall_time += apr_time_now() - start;
+            c->stats.write_stall_count++;
+        }
+    }
+    cache_unlock(c);
+}
+
 //*************************************************************************
 // amp_adjust_dirty - Adjusts the dirty ratio and if needed trigger a flush
 //   NOTE:  cache lock should be help by calling thread!
@@ -338,7 +542,7 @@ lio_cache_page_t *_amp_new_page(lio_cache_t *c, lio_segment_t *seg)
     p = &(lp->page);
     p->curr_data = &(p->data[0]);
     p->current_index = 0;
-    tbx_type_malloc_clear(p->curr_data->ptr, char, s->page_size);
+    p->curr_data->ptr = cache_arena_page_get(c->arena, s->page_size, 1);
 
     cp->bytes_used += s->page_size;
 
@@ -347,6 +551,7 @@ lio_cache_page_t *_amp_new_page(lio_cache_t *c, lio_segment_t *seg)
     p->offset = tbx_atomic_dec(amp_dummy);
     p->bit_fields = C_EMPTY;  //** This way it's not accidentally deleted
     lp->stream_offset = -1;
+    lp->stride_slot = -1;
 
     //** Store my position
     tbx_stack_push(cp->stack, p);
@@ -398,6 +603,25 @@ void _amp_process_waiters(lio_cache_t *c)
 
 }
 
+//*******************************************************************************
+// _amp_prefetch_tag - Tags the trigger page for the next prefetch
+//   NOTE: Cache lock should be held by calling thread
+//*******************************************************************************
+
+void _amp_prefetch_tag(amp_prefetch_op_t *ap, lio_cache_page_t *p, ex_off_t hi)
+{
+    lio_page_amp_t *lp = (lio_page_amp_t *)p->priv;
+
+    if (ap->stride_slot < 0) {
+        lp->bit_fields |= CAMP_TAG;
+        lp->stream_offset = hi;
+    } else {
+        lp->bit_fields |= CAMP_STAG;
+        lp->stride_slot = ap->stride_slot;
+    }
+    log_printf(_amp_logging, "seg=" XIDT " SET_TAG offset=" XOT " last=" XOT " stride_slot=%d\n", segment_id(ap->seg), p->offset, hi, ap->stride_slot);
+}
+
 //*******************************************************************************
 // amp_pretech_fn - Does the actual prefetching
 //*******************************************************************************
@@ -408,93 +632,111 @@ gop_op_status_t amp_prefetch_fn(void *arg, int id)
     lio_segment_t *seg = ap->seg;
     lio_cache_lio_segment_t *s = (lio_cache_lio_segment_t *)seg->priv;
     lio_cache_amp_t *cp = (lio_cache_amp_t *)s->c->fn.priv;
+    lio_amp_stream_table_t *as;
     lio_page_handle_t page[CACHE_MAX_PAGES_RETURNED];
     lio_cache_page_t *p;
     lio_page_amp_t *lp;
     lio_amp_page_stream_t *ps;
-    ex_off_t offset, *poff, trigger_offset, nbytes;
+    lio_amp_stride_t *sp;
+    ex_off_t offset, *poff, trigger_offset, nbytes, lo, hi;
     tbx_sl_iter_t it;
-    int n_pages, i, nloaded, pending_read;
+    int n_pages, i, b, nloaded, pending_read;
 
     nbytes = ap->hi + s->page_size - ap->lo;
-    trigger_offset = ap->hi - ap->start_trigger*s->page_size;
 
-    log_printf(_amp_logging, "seg=" XIDT " initial lo=" XOT " hi=" XOT " trigger=" XOT " start_trigger=%d start_prefetch=%d\n", segment_id(ap->seg), ap->lo, ap->hi, trigger_offset, ap->start_trigger, ap->start_prefetch);
+    log_printf(_amp_logging, "seg=" XIDT " initial lo=" XOT " hi=" XOT " stride=" XOT " n_blocks=%d start_trigger=%d start_prefetch=%d\n", segment_id(ap->seg), ap->lo, ap->hi, ap->stride, ap->n_blocks, ap->start_trigger, ap->start_prefetch);
 
     pending_read = 0;
     nloaded = 0;
-    offset = ap->lo;
-    while (offset <= ap->hi) {
-        n_pages = CACHE_MAX_PAGES_RETURNED;
-        cache_advise(ap->seg, NULL, CACHE_READ, offset, ap->hi, page, &n_pages, 1);
-        log_printf(_amp_logging, "seg=" XIDT " lo=" XOT " hi=" XOT " n_pages=%d\n", segment_id(ap->seg), offset, ap->hi, n_pages);
-        if (n_pages == 0) { //** Hit an existing page
-            cache_lock(s->c);
-            it = tbx_sl_iter_search(s->pages, &offset, 0);
-            tbx_sl_next(&it, (tbx_sl_key_t **)&poff, (tbx_sl_data_t **)&p);
-            log_printf(15, "seg=" XIDT " before while offset=" XOT " p=%p\n", segment_id(ap->seg), offset, p);
-            while (p != NULL) {
-                log_printf(_amp_logging, "seg=" XIDT " p->offset=" XOT " offset=" XOT "\n", segment_id(ap->seg), p->offset, offset);
-                if (p->offset != offset) {  //** got a hole
-                    p = NULL;
-                } else {
-                    if (offset == ap->hi) { //** Kick out we hit the end
-                        offset += s->page_size;
+    for (b=0; b<ap->n_blocks; b++) {
+        lo = ap->lo + b*ap->stride;
+        hi = ap->hi + b*ap->stride;
+        if (hi > ap->eof_row) hi = ap->eof_row;  //** The last stride block can run past EOF
+        if (lo > hi) continue;
+        if (ap->stride_slot < 0) {
+            trigger_offset = hi - ap->start_trigger*s->page_size;
+        } else {  //** For strides the trigger is the 1st page of the start_trigger block
+            trigger_offset = (b == ap->start_trigger) ? lo : -1;
+        }
+
+        offset = lo;
+        while (offset <= hi) {
+            n_pages = CACHE_MAX_PAGES_RETURNED;
+            cache_advise(ap->seg, NULL, CACHE_READ, offset, hi, page, &n_pages, 1);
+            log_printf(_amp_logging, "seg=" XIDT " lo=" XOT " hi=" XOT " n_pages=%d\n", segment_id(ap->seg), offset, hi, n_pages);
+            if (n_pages == 0) { //** Hit an existing page
+                cache_lock(s->c);
+                it = tbx_sl_iter_search(s->pages, &offset, 0);
+                tbx_sl_next(&it, (tbx_sl_key_t **)&poff, (tbx_sl_data_t **)&p);
+                log_printf(15, "seg=" XIDT " before while offset=" XOT " p=%p\n", segment_id(ap->seg), offset, p);
+                while (p != NULL) {
+                    log_printf(_amp_logging, "seg=" XIDT " p->offset=" XOT " offset=" XOT "\n", segment_id(ap->seg), p->offset, offset);
+                    if (p->offset != offset) {  //** got a hole
                         p = NULL;
                     } else {
-                        if (offset == trigger_offset) {  //** Set the trigger page
-                            lp = (lio_page_amp_t *)p->priv;
-                            lp->bit_fields |= CAMP_TAG;
-                            lp->stream_offset = ap->hi;
-                            log_printf(_amp_logging, "seg=" XIDT " SET_TAG offset=" XOT "\n", segment_id(ap->seg), offset);
-                        }
-
-                        //** Attempt to get the next page
-                        tbx_sl_next(&it, (tbx_sl_key_t **)&poff, (tbx_sl_data_t **)&p);
-                        offset += s->page_size;
-                        if (p != NULL) {
-                            if (p->offset != offset) p = NULL;  //** Hit a hole so kick out
+                        if (offset == hi) { //** Kick out we hit the end
+                            if ((offset == trigger_offset) && (ap->stride_slot >= 0)) _amp_prefetch_tag(ap, p, hi);
+                            offset += s->page_size;
+                            p = NULL;
+                        } else {
+                            if (offset == trigger_offset) _amp_prefetch_tag(ap, p, hi);  //** Set the trigger page
+
+                            //** Attempt to get the next page
+                            tbx_sl_next(&it, (tbx_sl_key_t **)&poff, (tbx_sl_data_t **)&p);
+                            offset += s->page_size;
+                            if (p != NULL) {
+                                if (p->offset != offset) p = NULL;  //** Hit a hole so kick out
+                            }
                         }
                     }
                 }
-            }
-            cache_unlock(s->c);
-        } else {  //** Process the pages just loaded
-            cache_lock(s->c);
-            nloaded += n_pages;
-            for (i=0; i<n_pages; i++) {
-                if (page[i].p->access_pending[CACHE_READ] > 1) pending_read++;
-
-                if (page[i].p->offset == trigger_offset) {
+                cache_unlock(s->c);
+            } else {  //** Process the pages just loaded
+                cache_lock(s->c);
+                nloaded += n_pages;
+                for (i=0; i<n_pages; i++) {
+                    if (page[i].p->access_pending[CACHE_READ] > 1) pending_read++;
+
                     lp = (lio_page_amp_t *)page[i].p->priv;
-                    lp->bit_fields |= CAMP_TAG;
-                    lp->stream_offset = ap->hi;
-                    log_printf(_amp_logging, "seg=" XIDT " SET_TAG offset=" XOT " last=" XOT "\n", segment_id(ap->seg), offset, lp->stream_offset);
+                    if ((lp->bit_fields & CAMP_ACCESSED) == 0) {
+                        lp->bit_fields |= CAMP_PREFETCH;
+                        lp->stride_slot = ap->stride_slot;
+                    }
+
+                    if (page[i].p->offset == trigger_offset) _amp_prefetch_tag(ap, page[i].p, hi);
                 }
-            }
-            offset = page[n_pages-1].p->offset;
-            offset += s->page_size;
+                offset = page[n_pages-1].p->offset;
+                offset += s->page_size;
 
-            cache_unlock(s->c);
-            log_printf(_amp_logging, "seg=" XIDT " lo=" XOT " hi=" XOT " RELEASE n_pages=%d pending_read=%d\n", segment_id(ap->seg), offset, ap->hi, n_pages, pending_read);
+                cache_unlock(s->c);
+                log_printf(_amp_logging, "seg=" XIDT " lo=" XOT " hi=" XOT " RELEASE n_pages=%d pending_read=%d\n", segment_id(ap->seg), offset, hi, n_pages, pending_read);
 
-            cache_release_pages(n_pages, page, CACHE_READ);
+                cache_release_pages(n_pages, page, CACHE_READ);
+            }
         }
     }
 
     //** Update the stream info
     cache_lock(s->c);
-    ps = _amp_stream_get(s->c, seg, ap->hi, nbytes, NULL);
-    if (ps != NULL) {
-        ps->prefetch_size = (ap->start_prefetch >  (ps->trigger_distance+1)) ? ap->start_prefetch : ps->trigger_distance + 1;
-        ps->trigger_distance = ap->start_trigger;
-        if (pending_read > 0) {
-            ps->trigger_distance += (ap->hi + s->page_size - ap->lo) / s->page_size;
-            log_printf(_amp_logging, "seg=" XIDT " LAST read waiting=%d for offset=" XOT " increasing trigger_distance=%d prefetch_pages=%d\n", segment_id(ap->seg), pending_read, ap->hi, ps->trigger_distance, ps->prefetch_size);
+    if (pending_read > 0) s->c->stats.prefetch.wait_count++;
+    if (ap->stride_slot < 0) {
+        ps = _amp_stream_get(s->c, seg, ap->hi, nbytes, NULL);
+        if (ps != NULL) {
+            ps->prefetch_size = (ap->start_prefetch >  (ps->trigger_distance+1)) ? ap->start_prefetch : ps->trigger_distance + 1;
+            ps->trigger_distance = ap->start_trigger;
+            if (pending_read > 0) {
+                ps->trigger_distance += (ap->hi + s->page_size - ap->lo) / s->page_size;
+                log_printf(_amp_logging, "seg=" XIDT " LAST read waiting=%d for offset=" XOT " increasing trigger_distance=%d prefetch_pages=%d\n", segment_id(ap->seg), pending_read, ap->hi, ps->trigger_distance, ps->prefetch_size);
+            }
         }
+    } else if (pending_read > 0) {  //** The reader caught up with us so look further ahead next time
+        as = (lio_amp_stream_table_t *)s->cache_priv;
+        sp = &(as->stride_table[ap->stride_slot]);
+        if (sp->depth < cp->max_stride_depth) sp->depth++;
+        log_printf(_amp_logging, "seg=" XIDT " STRIDE read waiting=%d slot=%d increasing depth=%d\n", segment_id(ap->seg), pending_read, ap->stride_slot, sp->depth);
     }
 
-    cp->prefetch_in_process -= nbytes;  //** Adjust the prefetch bytes
+    cp->prefetch_in_process -= ap->nbytes;  //** Adjust the prefetch bytes
     cache_unlock(s->c);
 
 
@@ -515,6 +757,51 @@ gop_op_status_t amp_prefetch_fn(void *arg, int id)
     return(gop_success_status);
 }
 
+//*******************************************************************************
+// _amp_prefetch_launch - Charges the prefetch against the budget and starts the task
+//   NOTE : ASsumes the cache is locked!
+//*******************************************************************************
+
+void _amp_prefetch_launch(lio_segment_t *seg, ex_off_t lo_row, ex_off_t hi_row, ex_off_t stride, int n_blocks, int stride_slot, int start_prefetch, int start_trigger)
+{
+    lio_cache_lio_segment_t *s = (lio_cache_lio_segment_t *)seg->priv;
+    lio_cache_amp_t *cp = (lio_cache_amp_t *)s->c->fn.priv;
+    amp_prefetch_op_t *ca;
+    gop_op_generic_t *gop;
+    ex_off_t nbytes;
+
+    //** Let's make sure the segment isn't marked for removal
+    if (tbx_list_search(s->c->segments, &(segment_id(seg))) == NULL) return;
+
+    nbytes = n_blocks * (hi_row + s->page_size - lo_row);
+
+    log_printf(_amp_slog, "seg=" XIDT " budget=" XOT " prefetch_in_process=" XOT " nbytes=" XOT " stride=" XOT " n_blocks=%d\n", segment_id(seg), cp->prefetch_budget, cp->prefetch_in_process, nbytes, stride, n_blocks);
+
+    cp->prefetch_in_process += nbytes;  //** Adjust the prefetch size
+    s->c->stats.prefetch.issued_count++;
+    s->c->stats.prefetch.issued_bytes += nbytes;
+
+    s->cache_check_in_progress++;  //** Flag it as in use.  This is released on completion in amp_prefetch_fn
+
+    tbx_type_malloc(ca, amp_prefetch_op_t, 1);
+    ca->seg = seg;
+    ca->lo = lo_row;
+    ca->hi = hi_row;
+    ca->stride = stride;
+    ca->nbytes = nbytes;
+    ca->eof_row = ((s->total_size-1) / s->page_size) * s->page_size;
+    ca->n_blocks = n_blocks;
+    ca->stride_slot = stride_slot;
+    ca->start_prefetch = start_prefetch;
+    ca->start_trigger = start_trigger;
+    gop = gop_tp_op_new(s->tpc_unlimited, NULL, amp_prefetch_fn, (void *)ca, free, 1);
+    ca->gop = gop;
+
+    gop_set_auto_destroy(gop, 1);
+
+    gop_start_execution(gop);
+}
+
 //*******************************************************************************
 // _amp_prefetch - Prefetch the given range
 //   NOTE : ASsumes the cache is locked!
@@ -525,8 +812,6 @@ void _amp_prefetch(lio_segment_t *seg, ex_off_t lo, ex_off_t hi, int start_prefe
     lio_cache_lio_segment_t *s = (lio_cache_lio_segment_t *)seg->priv;
     lio_cache_amp_t *cp = (lio_cache_amp_t *)s->c->fn.priv;
     ex_off_t lo_row, hi_row, nbytes, dn;
-    amp_prefetch_op_t *ca;
-    gop_op_generic_t *gop;
     int tid;
 
     tid = tbx_atomic_thread_id;
@@ -548,18 +833,18 @@ void _amp_prefetch(lio_segment_t *seg, ex_off_t lo, ex_off_t hi, int start_prefe
         log_printf(15, "OOPS read beyond EOF  truncating hi=child\n");
     }
 
-    if (s->c->max_fetch_size <= cp->prefetch_in_process) return;  //** To much prefetching
-
-    //** To much fetching going on so truncate the fetch
-    dn = s->c->max_fetch_size - cp->prefetch_in_process;
-    if (cp->prefetch_in_process > 0) {    //** This forces only 1 prefetch to occur at a time
-        log_printf(1, "to much prefetching.\n");
+    if (cp->prefetch_budget <= cp->prefetch_in_process) {  //** To much prefetching
+        log_printf(_amp_slog, "to much prefetching. budget=" XOT " in_process=" XOT "\n", cp->prefetch_budget, cp->prefetch_in_process);
+        s->c->stats.prefetch.throttled_count++;
         return;
     }
 
+    //** To much fetching going on so truncate the fetch
+    dn = cp->prefetch_budget - cp->prefetch_in_process;
     nbytes = hi - lo + 1;
     if (dn < nbytes) {
         hi = lo + dn - 1;
+        s->c->stats.prefetch.throttled_count++;
     }
 
 
@@ -568,29 +853,135 @@ void _amp_prefetch(lio_segment_t *seg, ex_off_t lo, ex_off_t hi, int start_prefe
     lo_row = lo_row * s->page_size;
     hi_row = hi / s->page_size;
     hi_row = hi_row * s->page_size;
-    nbytes = hi_row + s->page_size - lo_row;
 
-    log_printf(_amp_slog, "seg=" XIDT " max_fetch=" XOT " prefetch_in_process=" XOT " nbytes=" XOT "\n", segment_id(seg), s->c->max_fetch_size, cp->prefetch_in_process, nbytes);
+    _amp_prefetch_launch(seg, lo_row, hi_row, 0, 1, -1, start_prefetch, start_trigger);
+}
 
-    cp->prefetch_in_process += nbytes;  //** Adjust the prefetch size
+//*******************************************************************************
+// _amp_stride_prefetch - Prefetches the next blocks of a confirmed stride
+//   NOTE : ASsumes the cache is locked!
+//*******************************************************************************
 
-    //** Let's make sure the segment isn't marked for removal
-    if (tbx_list_search(s->c->segments, &(segment_id(seg))) == NULL) return;
+void _amp_stride_prefetch(lio_segment_t *seg, int slot)
+{
+    lio_cache_lio_segment_t *s = (lio_cache_lio_segment_t *)seg->priv;
+    lio_cache_amp_t *cp = (lio_cache_amp_t *)s->c->fn.priv;
+    lio_amp_stream_table_t *as = (lio_amp_stream_table_t *)s->cache_priv;
+    lio_amp_stride_t *sp = &(as->stride_table[slot]);
+    ex_off_t lo, hi, lo_row, hi_row, bsize, dn;
+    int n;
 
-    s->cache_check_in_progress++;  //** Flag it as in use.  This is released on completion in amp_prefetch_fn
+    lo = sp->last_lo + sp->stride;
+    hi = lo + sp->nbytes - 1;
+    lo_row = (lo / s->page_size) * s->page_size;
+    hi_row = (hi / s->page_size) * s->page_size;
+    bsize = hi_row + s->page_size - lo_row;
+
+    //** Figure out how many blocks fit in the file and the budget.  A block
+    //** that starts before EOF but runs past it is clipped to the last page
+    //** when it's fetched just like _amp_prefetch does.
+    dn = cp->prefetch_budget - cp->prefetch_in_process;
+    for (n=0; n<sp->depth; n++) {
+        lo = lo_row + n*sp->stride;
+        if ((lo < 0) || (lo >= s->total_size)) break;
+        if ((n+1)*bsize > dn) {
+            s->c->stats.prefetch.throttled_count++;
+            break;
+        }
+    }
 
-    tbx_type_malloc(ca, amp_prefetch_op_t, 1);
-    ca->seg = seg;
-    ca->lo = lo_row;
-    ca->hi = hi_row;
-    ca->start_prefetch = start_prefetch;
-    ca->start_trigger = start_trigger;
-    gop = gop_tp_op_new(s->tpc_unlimited, NULL, amp_prefetch_fn, (void *)ca, free, 1);
-    ca->gop = gop;
+    log_printf(_amp_slog, "seg=" XIDT " slot=%d last_lo=" XOT " stride=" XOT " nbytes=" XOT " depth=%d n=%d\n", segment_id(seg), slot, sp->last_lo, sp->stride, sp->nbytes, sp->depth, n);
+    if (n == 0) return;
 
-    gop_set_auto_destroy(gop, 1);
+    sp->last_lo += n*sp->stride;
+    if (sp->stride < 0) {
+        s->c->stats.prefetch.backward_count++;
+    } else {
+        s->c->stats.prefetch.stride_count++;
+    }
 
-    gop_start_execution(gop);
+    _amp_prefetch_launch(seg, lo_row, hi_row, sp->stride, n, slot, n, n/2);
+}
+
+//*******************************************************************************
+// _amp_stride_check - Looks for a strided or backwards access pattern in the
+//    missed reads.  Each miss is either matched against a predicted block, paired
+//    with the nearest single miss of the same size, or recorded as a single miss.
+//   NOTE : ASsumes the cache is locked!
+//*******************************************************************************
+
+void _amp_stride_check(lio_cache_t *c, lio_segment_t *seg, ex_off_t lo, ex_off_t nbytes)
+{
+    lio_cache_amp_t *cp = (lio_cache_amp_t *)c->fn.priv;
+    lio_cache_lio_segment_t *s = (lio_cache_lio_segment_t *)seg->priv;
+    lio_amp_stream_table_t *as = (lio_amp_stream_table_t *)s->cache_priv;
+    lio_amp_stride_t *sp;
+    ex_off_t dn, best_dn;
+    int i, best, slot;
+
+    if (as->max_strides <= 0) return;
+
+    //** See if it's the next block of a known stride
+    best = -1;
+    best_dn = cp->max_stride_bytes + 1;
+    for (i=0; i<as->max_strides; i++) {
+        sp = &(as->stride_table[i]);
+        if ((sp->confidence == 0) || (sp->nbytes != nbytes)) continue;
+        if ((sp->stride != 0) && (lo == (sp->last_lo + sp->stride))) {
+            sp->confidence++;
+            sp->referenced = 1;
+            sp->last_lo = lo;
+            log_printf(_amp_slog, "seg=" XIDT " STRIDE confirmed slot=%d lo=" XOT " stride=" XOT " confidence=%d depth=%d\n", segment_id(seg), i, lo, sp->stride, sp->confidence, sp->depth);
+            if (sp->confidence >= 2) _amp_stride_prefetch(seg, i);
+            return;
+        }
+
+        if (sp->stride == 0) {  //** Single miss so see if it's the closest
+            dn = lo - sp->last_lo;
+            if (dn == nbytes) continue;  //** Forward contiguous is handled by the streams
+            if (dn < 0) dn = -dn;
+            if ((dn > 0) && (dn < best_dn)) {
+                best_dn = dn;
+                best = i;
+            }
+        }
+    }
+
+    //** Get a slot for the new entry giving recently used strides a second chance
+    for (i=0; i<as->max_strides; i++) {
+        sp = &(as->stride_table[as->stride_index]);
+        if (sp->referenced == 0) break;
+        sp->referenced = 0;
+        as->stride_index = (as->stride_index + 1) % as->max_strides;
+    }
+    slot = as->stride_index;
+    as->stride_index = (as->stride_index + 1) % as->max_strides;
+    if (slot == best) {  //** Don't overwrite the miss we're pairing with
+        slot = as->stride_index;
+        as->stride_index = (as->stride_index + 1) % as->max_strides;
+    }
+
+    sp = &(as->stride_table[slot]);
+    sp->last_lo = lo;
+    sp->nbytes = nbytes;
+    sp->stride = (best >= 0) ? lo - as->stride_table[best].last_lo : 0;
+    sp->confidence = 1;
+    sp->depth = 2;
+    sp->referenced = 0;
+
+    log_printf(_amp_slog, "seg=" XIDT " STRIDE new slot=%d lo=" XOT " nbytes=" XOT " stride=" XOT "\n", segment_id(seg), slot, lo, nbytes, sp->stride);
+
+    if (best >= 0) {  //** Also record it as a single miss for pairing with later streams
+        slot = as->stride_index;
+        as->stride_index = (as->stride_index + 1) % as->max_strides;
+        sp = &(as->stride_table[slot]);
+        sp->last_lo = lo;
+        sp->nbytes = nbytes;
+        sp->stride = 0;
+        sp->confidence = 1;
+        sp->depth = 2;
+        sp->referenced = 0;
+    }
 }
 
 //*************************************************************************
@@ -627,8 +1018,8 @@ int _amp_pages_release(lio_cache_t *c, lio_cache_page_t **page, int n_pages)
             if (p->offset > -1) {
                 tbx_list_remove(s->pages, &(p->offset), p);  //** Have to do this here cause p->offset is the key var
             }
-            if (p->data[0].ptr) free(p->data[0].ptr);
-            if (p->data[1].ptr) free(p->data[1].ptr);
+            cache_arena_page_put(c->arena, s->page_size, p->data[0].ptr);
+            cache_arena_page_put(c->arena, s->page_size, p->data[1].ptr);
             free(lp);
         }
     }
@@ -679,8 +1070,8 @@ void _amp_pages_destroy(lio_cache_t *c, lio_cache_page_t **page, int n_pages, in
                 tbx_list_remove(s->pages, &(p->offset), p);  //** Have to do this here cause p->offset is the key var
             }
 
-            if (p->data[0].ptr) free(p->data[0].ptr);
-            if (p->data[1].ptr) free(p->data[1].ptr);
+            cache_arena_page_put(c->arena, s->page_size, p->data[0].ptr);
+            cache_arena_page_put(c->arena, s->page_size, p->data[1].ptr);
             free(lp);
         } else {  //** Someone is listening so trigger them and also clear the bits so it will be released
             p->bit_fields = C_TORELEASE;
@@ -703,6 +1094,7 @@ int _amp_page_access(lio_cache_t *c, lio_cache_page_t *p, int rw_mode, ex_off_t
     lio_cache_amp_t *cp = (lio_cache_amp_t *)c->fn.priv;
     lio_cache_lio_segment_t *s = (lio_cache_lio_segment_t *)p->seg->priv;
     lio_page_amp_t *lp = (lio_page_amp_t *)p->priv;
+    lio_amp_stream_table_t *as;
     lio_amp_page_stream_t *ps, *pse;
     ex_off_t lo, hi, psize, last_offset;
     int prefetch_pages, trigger_distance, tag;
@@ -729,6 +1121,19 @@ int _amp_page_access(lio_cache_t *c, lio_cache_page_t *p, int rw_mode, ex_off_t
         //** IF made it to here we are doing a READ access update or a small write
         psize = s->page_size;
         ps = NULL;
+
+        if ((lp->bit_fields & CAMP_PREFETCH) > 0) {  //** 1st use of a prefetched page
+            lp->bit_fields ^= CAMP_PREFETCH;
+            c->stats.prefetch.hit_bytes += psize;
+        }
+
+        if ((lp->bit_fields & CAMP_STAG) > 0) {  //** Keep a strided reader ahead of the demand reads
+            lp->bit_fields ^= CAMP_STAG;
+            as = (lio_amp_stream_table_t *)s->cache_priv;
+            if ((lp->stride_slot >= 0) && (lp->stride_slot < as->max_strides)) {
+                if (as->stride_table[lp->stride_slot].confidence >= 2) _amp_stride_prefetch(p->seg, lp->stride_slot);
+            }
+        }
         //** Check if we need to do a prefetch
         tag = lp->bit_fields & CAMP_TAG;
         if (tag > 0) {
@@ -803,8 +1208,8 @@ int _amp_free_mem(lio_cache_t *c, lio_segment_t *pseg, ex_off_t bytes_to_free)
                     log_printf(_amp_logging, "amp_free_mem: freeing page seg=" XIDT " p->offset=" XOT " bits=%d\n", segment_id(p->seg), p->offset, p->bit_fields);
                     tbx_list_remove(s->pages, &(p->offset), p);  //** Have to do this here cause p->offset is the key var
                     tbx_stack_delete_current(cp->stack, 1, 0);
-                    if (p->data[0].ptr) free(p->data[0].ptr);
-                    if (p->data[1].ptr) free(p->data[1].ptr);
+                    cache_arena_page_put(c->arena, s->page_size, p->data[0].ptr);
+                    cache_arena_page_put(c->arena, s->page_size, p->data[1].ptr);
                     free(lp);
                 } else {         //** Got to flush the page first
                     err = 1;
@@ -841,6 +1246,8 @@ ex_off_t _amp_attempt_free_mem(lio_cache_t *c, lio_segment_t *page_seg, ex_off_t
     gop_op_generic_t *gop;
     gop_opque_t *q;
     lio_amp_page_stream_t *ps;
+    lio_amp_stream_table_t *as;
+    lio_amp_stride_t *sp;
     ex_off_t total_bytes, freed_bytes, pending_bytes;
     ex_id_t *segid;
     tbx_list_iter_t sit;
@@ -883,8 +1290,8 @@ ex_off_t _amp_attempt_free_mem(lio_cache_t *c, lio_segment_t *page_seg, ex_off_t
                         log_printf(_amp_logging, "freeing page seg=" XIDT " p->offset=" XOT " bits=%d\n", segment_id(p->seg), p->offset, p->bit_fields);
                         tbx_list_remove(s->pages, &(p->offset), p);  //** Have to do this here cause p->offset is the key var
                         tbx_stack_delete_current(cp->stack, 1, 0);
-                        if (p->data[0].ptr) free(p->data[0].ptr);
-                        if (p->data[1].ptr) free(p->data[1].ptr);
+                        cache_arena_page_put(c->arena, s->page_size, p->data[0].ptr);
+                        cache_arena_page_put(c->arena, s->page_size, p->data[1].ptr);
                         free(lp);
                         n = 1;
                     }
@@ -930,11 +1337,20 @@ ex_off_t _amp_attempt_free_mem(lio_cache_t *c, lio_segment_t *page_seg, ex_off_t
                 tbx_stack_move_to_ptr(cp->stack, curr_ele);
 
                 //** Tweak the stream info
-                _amp_stream_get(c, p->seg, p->offset, -1, &ps);  //** Don't care about the initial element in the chaing.  Just the last
-                if (ps != NULL) {
-                    if (ps->prefetch_size > 0) ps->prefetch_size--;
-                    if (ps->trigger_distance > 0) ps->trigger_distance--;
-                    if ((ps->prefetch_size-1) < ps->trigger_distance) ps->trigger_distance = ps->prefetch_size - 1;
+                if (lp->stride_slot >= 0) {  //** Strided prefetch that wasn't used so back off the depth
+                    as = (lio_amp_stream_table_t *)s->cache_priv;
+                    if (lp->stride_slot < as->max_strides) {
+                        sp = &(as->stride_table[lp->stride_slot]);
+                        if (sp->depth > 1) sp->depth--;
+                    }
+                    lp->stride_slot = -1;
+                } else {
+                    _amp_stream_get(c, p->seg, p->offset, -1, &ps);  //** Don't care about the initial element in the chaing.  Just the last
+                    if (ps != NULL) {
+                        if (ps->prefetch_size > 0) ps->prefetch_size--;
+                        if (ps->trigger_distance > 0) ps->trigger_distance--;
+                        if ((ps->prefetch_size-1) < ps->trigger_distance) ps->trigger_distance = ps->prefetch_size - 1;
+                    }
                 }
             }
         } else {
@@ -1064,9 +1480,11 @@ void _amp_wait_for_page(lio_cache_t *c, lio_segment_t *seg, int ontop)
     tbx_pch_t pch;
     lio_cache_cond_t *cc;
     ex_off_t bytes_free, bytes_needed, n;
+    apr_time_t start;
     int check_waiters_first;
 
     check_waiters_first = (ontop == 0) ? 1 : 0;
+    start = apr_time_now();
     pch = tbx_pch_reserve(c->cond_coop);
     cc = (lio_cache_cond_t *)tbx_pch_data(&pch);
     pw.cond = cc->cond;
@@ -1097,6 +1515,9 @@ void _amp_wait_for_page(lio_cache_t *c, lio_segment_t *seg, int ontop)
 
     tbx_pch_release(c->cond_coop, &pch);
 
+    c->stats.write_stall_time += apr_time_now() - start;
+    c->stats.write_stall_count++;
+
     return;
 }
 
@@ -1172,6 +1593,7 @@ void amp_update(lio_cache_t *c, lio_segment_t *seg, int rw_mode, ex_off_t lo, ex
     offset = lo - s->page_size;
     pps = _amp_stream_get(c, seg, offset, -1, NULL);
     prevp = (pps == NULL) ? 0 : pps->prefetch_size;
+    if (pps == NULL) _amp_stride_check(c, seg, lo, nbytes);  //** Not sequential so look for a stride
     log_printf(_amp_slog, "seg=" XIDT " hi=" XOT " pps=%p prevp=%d npages=%d lo=" XOT " hi=" XOT "\n", segment_id(seg), hi, pps, prevp, npages, lo, hi);
     ps = _amp_stream_get(c, seg, hi, nbytes, NULL);
     ps->prefetch_size = prevp + npages;
@@ -1248,6 +1670,10 @@ void amp_adding_segment(lio_cache_t *c, lio_segment_t *seg)
 
     tbx_type_malloc(stable, lio_amp_stream_table_t, 1);
     tbx_type_malloc_clear(stable->stream_table, lio_amp_page_stream_t, cp->max_streams);
+    stable->max_strides = cp->max_strides;
+    if ((stable->max_strides > 0) && (stable->max_strides < 4)) stable->max_strides = 4;
+    stable->stride_index = 0;
+    tbx_type_malloc_clear(stable->stride_table, lio_amp_stride_t, stable->max_strides + 1);
 
     stable->streams = tbx_list_create(0, &skiplist_compare_ex_off, NULL, NULL, NULL);
     stable->max_streams = cp->max_streams;
@@ -1277,6 +1703,7 @@ void amp_removing_segment(lio_cache_t *c, lio_segment_t *seg)
 
     tbx_list_destroy(stable->streams);
     free(stable->stream_table);
+    free(stable->stride_table);
 
     free(stable);
 
@@ -1371,14 +1798,23 @@ lio_cache_t *amp_cache_create(void *arg, data_attr_t *da, int timeout)
     c->dirty_fraction = 0.1;
     c->async_prefetch_threshold = 256*1024*1024;
     c->min_prefetch_size = 1024*1024;
+    c->max_strides = 32;
+    c->max_stride_depth = 16;
+    c->max_stride_bytes = 64*1024*1024;
     cache->n_ppages = 0;
     cache->max_fetch_fraction = 0.1;
     cache->max_fetch_size = cache->max_fetch_fraction * c->max_bytes;
+    c->prefetch_budget = cache->max_fetch_size;
     cache->write_temp_overflow_used = 0;
     cache->write_temp_overflow_fraction = 0.01;
     cache->write_temp_overflow_size = cache->write_temp_overflow_fraction * c->max_bytes;
 
     c->dirty_bytes_trigger = c->dirty_fraction * c->max_bytes;
+    c->dirty_hard_fraction = 0.5;
+    c->dirty_hard_bytes = c->dirty_hard_fraction * c->max_bytes;
+    c->writeback_inflight_bytes = c->dirty_bytes_trigger;
+    c->writeback_extent_bytes = 16*1024*1024;
+    c->write_throttle_max_wait = apr_time_from_msec(100);
     c->dirty_max_wait = apr_time_make(1, 0);
     c->flush_in_progress = 0;
     c->limbo_pages = 0;
@@ -1390,6 +1826,7 @@ lio_cache_t *amp_cache_create(void *arg, data_attr_t *da, int timeout)
     cache->fn.destroy_pages = _amp_pages_destroy;
     cache->fn.cache_update = amp_update;
     cache->fn.cache_miss_tag = _amp_miss_tag;
+    cache->fn.write_throttle = amp_write_throttle;
     cache->fn.s_page_access = _amp_page_access;
     cache->fn.s_pages_release = _amp_pages_release;
     cache->fn.destroy = amp_cache_destroy;
@@ -1398,6 +1835,7 @@ lio_cache_t *amp_cache_create(void *arg, data_attr_t *da, int timeout)
     cache->fn.get_handle = cache_base_handle;
 
     apr_thread_cond_create(&(c->dirty_trigger), cache->mpool);
+    apr_thread_cond_create(&(c->writeback_cond), cache->mpool);
     tbx_thread_create_assert(&(c->dirty_thread), NULL, amp_dirty_thread, (void *)cache, cache->mpool);
 
     return(cache);
@@ -1427,6 +1865,13 @@ lio_cache_t *amp_cache_load(void *arg, tbx_inip_file_t *fd, char *grp, data_attr
     cp->max_streams = tbx_inip_get_integer(fd, grp, "max_streams", cp->max_streams);
     cp->dirty_fraction = tbx_inip_get_double(fd, grp, "dirty_fraction", cp->dirty_fraction);
     cp->dirty_bytes_trigger = cp->dirty_fraction * cp->max_bytes;
+    cp->dirty_hard_fraction = tbx_inip_get_double(fd, grp, "dirty_hard_fraction", cp->dirty_hard_fraction);
+    if (cp->dirty_hard_fraction < cp->dirty_fraction) cp->dirty_hard_fraction = cp->dirty_fraction;
+    cp->dirty_hard_bytes = cp->dirty_hard_fraction * cp->max_bytes;
+    cp->writeback_inflight_bytes = tbx_inip_get_integer(fd, grp, "writeback_inflight_bytes", cp->dirty_bytes_trigger);
+    cp->writeback_extent_bytes = tbx_inip_get_integer(fd, grp, "writeback_extent_bytes", cp->writeback_extent_bytes);
+    dt = tbx_inip_get_integer(fd, grp, "write_throttle_max_wait_ms", apr_time_as_msec(cp->write_throttle_max_wait));
+    cp->write_throttle_max_wait = apr_time_from_msec(dt);
     c->default_page_size = tbx_inip_get_integer(fd, grp, "default_page_size", c->default_page_size);
     cp->async_prefetch_threshold = tbx_inip_get_integer(fd, grp, "async_prefetch_threshold", cp->async_prefetch_threshold);
     cp->min_prefetch_size = tbx_inip_get_integer(fd, grp, "min_prefetch_bytes", cp->min_prefetch_size);
@@ -1434,9 +1879,16 @@ lio_cache_t *amp_cache_load(void *arg, tbx_inip_file_t *fd, char *grp, data_attr
     cp->dirty_max_wait = apr_time_make(dt, 0);
     c->max_fetch_fraction = tbx_inip_get_double(fd, grp, "max_fetch_fraction", c->max_fetch_fraction);
     c->max_fetch_size = c->max_fetch_fraction * cp->max_bytes;
+    cp->prefetch_budget = tbx_inip_get_integer(fd, grp, "prefetch_budget", c->max_fetch_size);
+    cp->max_strides = tbx_inip_get_integer(fd, grp, "max_strides", cp->max_strides);
+    cp->max_stride_depth = tbx_inip_get_integer(fd, grp, "max_stride_depth", cp->max_stride_depth);
+    cp->max_stride_bytes = tbx_inip_get_integer(fd, grp, "max_stride_bytes", cp->max_stride_bytes);
     c->write_temp_overflow_fraction = tbx_inip_get_double(fd, grp, "write_temp_overflow_fraction", c->write_temp_overflow_fraction);
     c->write_temp_overflow_size = c->write_temp_overflow_fraction * cp->max_bytes;
     c->n_ppages = tbx_inip_get_integer(fd, grp, "ppages", c->n_ppages);
+    c->arena->slab_size = tbx_inip_get_integer(fd, grp, "slab_bytes", c->arena->slab_size);
+    if (tbx_inip_get_integer(fd, grp, "slab_hugepages", 0) == 1) c->arena->flags |= CACHE_ARENA_HUGEPAGE;
+    if (tbx_inip_get_integer(fd, grp, "slab_mlock", 0) == 1) c->arena->flags |= CACHE_ARENA_MLOCK;
 
     cache_unlock(c);
 
@@ -37,11 +37,14 @@ lio_cache_t *amp_cache_load(void *arg, tbx_inip_file_t *ifd, char *section, data
 #define CAMP_ACCESSED 1  //** Page has been accessed
 #define CAMP_TAG      2  //** Tag page for pretech
 #define CAMP_OLD      4  //** Page has been recycled without a hit
+#define CAMP_PREFETCH 8  //** Page was loaded by a prefetch and not yet read
+#define CAMP_STAG    16  //** Tag page for a strided prefetch
 
 struct lio_page_amp_t {
     lio_cache_page_t page;  //** Actual page
     tbx_stack_ele_t *ele;   //** LRU position
     ex_off_t stream_offset;
+    int stride_slot;        //** Stride table slot that prefetched the page or -1
     int bit_fields;
 };
 
@@ -50,6 +53,16 @@ struct lio_amp_page_stream_t {
     ex_off_t nbytes;
     int prefetch_size;
     int trigger_distance;
+    int referenced;         //** Second chance bit used when recycling streams
+};
+
+struct lio_amp_stride_t {
+    ex_off_t last_lo;       //** Start of the last block missed or prefetched
+    ex_off_t nbytes;        //** Block size
+    ex_off_t stride;        //** Distance between blocks.  Negative for backward scans
+    int confidence;         //** 0=unused, 1=single miss or unconfirmed pair, >=2 confirmed
+    int depth;              //** Number of blocks to prefetch ahead
+    int referenced;
 };
 
 struct lio_amp_stream_table_t {
@@ -58,6 +71,9 @@ struct lio_amp_stream_table_t {
     tbx_list_t *streams;
     int index;
     int start_apt_pages;
+    lio_amp_stride_t *stride_table;
+    int max_strides;
+    int stride_index;
 };
 
 struct lio_cache_amp_t {
@@ -67,16 +83,26 @@ struct lio_cache_amp_t {
     tbx_pc_t *free_pending_tables;
     tbx_pc_t *free_page_tables;
     apr_thread_cond_t *dirty_trigger;
+    apr_thread_cond_t *writeback_cond;  //** Signaled as write-back extents complete
     apr_thread_t *dirty_thread;
     apr_time_t dirty_max_wait;
+    apr_time_t write_throttle_max_wait;  //** Max delay applied to a writer at the hard limit
     ex_off_t max_bytes;
     ex_off_t bytes_used;
     ex_off_t dirty_bytes_trigger;
+    ex_off_t dirty_hard_bytes;          //** Dirty level where writers get the full throttle delay
+    ex_off_t writeback_inflight_bytes;  //** Max bytes of write-back in flight
+    ex_off_t writeback_extent_bytes;    //** Max size of a coalesced write-back extent
     ex_off_t prefetch_in_process;
     ex_off_t async_prefetch_threshold;
     ex_off_t min_prefetch_size;
+    ex_off_t prefetch_budget;    //** Max bytes of prefetch in flight across all segments
+    ex_off_t max_stride_bytes;   //** Max distance between blocks to be considered a stride
     double   dirty_fraction;
+    double   dirty_hard_fraction;
     int      max_streams;
+    int      max_strides;
+    int      max_stride_depth;
     int      flush_in_progress;
     int      limbo_pages;
 };
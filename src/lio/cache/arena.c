@@ -0,0 +1,216 @@
+/*
+   Copyright 2016 Vanderbilt University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+//***********************************************************************
+// Slab allocator for cache page buffers.  Pages are carved out of large
+// mmap'ed slabs, one pool per page size, and recycled through a free list.
+// Slabs are only returned to the OS when the arena is destroyed so the
+// cache's memory footprint stays flat as pages churn.
+//***********************************************************************
+
+#define _log_module_index 143
+
+#include <apr_pools.h>
+#include <apr_thread_mutex.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <tbx/log.h>
+#include <tbx/type_malloc.h>
+
+#include "cache/arena.h"
+#include "ex3.h"
+
+//*************************************************************************
+// _arena_slab_new - Maps a new slab for the pool
+//   NOTE: Arena lock should be held by calling thread
+//*************************************************************************
+
+cache_arena_slab_t *_arena_slab_new(cache_arena_t *a, cache_arena_pool_t *pool)
+{
+    cache_arena_slab_t *slab;
+    ex_off_t size;
+    void *base;
+    int is_huge;
+
+    //** Make sure we get at least 1 page and are a multiple of the page size
+    size = (a->slab_size > pool->page_size) ? a->slab_size : pool->page_size;
+    size = (size / pool->page_size) * pool->page_size;
+
+    is_huge = 0;
+    base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if ((a->flags & CACHE_ARENA_HUGEPAGE) && ((size % CACHE_ARENA_SLAB_SIZE) == 0)) {
+        base = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if (base != MAP_FAILED) is_huge = 1;
+    }
+#endif
+    if (base == MAP_FAILED) {
+        base = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {  //** Can't map it so fall back to the heap
+            log_printf(0, "ERROR: Unable to map slab! Using the heap. page_size=" XOT " size=" XOT "\n", pool->page_size, size);
+            tbx_type_malloc(base, char, size);
+            is_huge = -1;
+        }
+#ifdef MADV_HUGEPAGE
+        else if (a->flags & CACHE_ARENA_HUGEPAGE) madvise(base, size, MADV_HUGEPAGE);  //** Fall back to transparent huge pages
+#endif
+    }
+
+    if ((a->flags & CACHE_ARENA_MLOCK) && (is_huge >= 0)) {
+        if (mlock(base, size) != 0) {
+            log_printf(1, "WARNING: Unable to mlock slab.  page_size=" XOT " size=" XOT "\n", pool->page_size, size);
+        }
+    }
+
+    tbx_type_malloc(slab, cache_arena_slab_t, 1);
+    slab->base = base;
+    slab->size = size;
+    slab->is_huge = is_huge;  //** -1 means it came from the heap
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+
+    pool->carve = base;
+    pool->carve_end = slab->base + size;
+
+    a->slab_bytes += size;
+    a->n_slabs++;
+    if (is_huge == 1) a->huge_slabs++;
+
+    log_printf(5, "page_size=" XOT " slab_size=" XOT " is_huge=%d n_slabs=" XOT " slab_bytes=" XOT "\n", pool->page_size, size, is_huge, a->n_slabs, a->slab_bytes);
+
+    return(slab);
+}
+
+//*************************************************************************
+// _arena_pool_get - Returns the pool for the page size creating it if needed
+//   NOTE: Arena lock should be held by calling thread
+//*************************************************************************
+
+cache_arena_pool_t *_arena_pool_get(cache_arena_t *a, ex_off_t page_size)
+{
+    cache_arena_pool_t *pool;
+
+    for (pool = a->pools; pool != NULL; pool = pool->next) {
+        if (pool->page_size == page_size) return(pool);
+    }
+
+    tbx_type_malloc_clear(pool, cache_arena_pool_t, 1);
+    pool->page_size = page_size;
+    pool->next = a->pools;
+    a->pools = pool;
+
+    return(pool);
+}
+
+//*************************************************************************
+// cache_arena_page_get - Returns a page buffer of the given size
+//*************************************************************************
+
+char *cache_arena_page_get(cache_arena_t *a, ex_off_t page_size, int clear)
+{
+    cache_arena_pool_t *pool;
+    char *ptr;
+
+    apr_thread_mutex_lock(a->lock);
+    pool = _arena_pool_get(a, page_size);
+
+    if (pool->free_list != NULL) {  //** Recycle a free page
+        ptr = pool->free_list;
+        pool->free_list = *(void **)ptr;
+        pool->n_free--;
+    } else {   //** Carve a new one
+        if ((pool->carve == NULL) || ((pool->carve + page_size) > pool->carve_end)) _arena_slab_new(a, pool);
+        ptr = pool->carve;
+        pool->carve += page_size;
+    }
+
+    a->used_bytes += page_size;
+    apr_thread_mutex_unlock(a->lock);
+
+    if (clear) memset(ptr, 0, page_size);
+
+    return(ptr);
+}
+
+//*************************************************************************
+// cache_arena_page_put - Returns the page to the free list
+//*************************************************************************
+
+void cache_arena_page_put(cache_arena_t *a, ex_off_t page_size, char *ptr)
+{
+    cache_arena_pool_t *pool;
+
+    if (ptr == NULL) return;
+
+    apr_thread_mutex_lock(a->lock);
+    pool = _arena_pool_get(a, page_size);
+
+    *(void **)ptr = pool->free_list;
+    pool->free_list = ptr;
+    pool->n_free++;
+    a->used_bytes -= page_size;
+
+    apr_thread_mutex_unlock(a->lock);
+}
+
+//*************************************************************************
+// cache_arena_create - Creates a page arena
+//*************************************************************************
+
+cache_arena_t *cache_arena_create(apr_pool_t *mpool, ex_off_t slab_size, int flags)
+{
+    cache_arena_t *a;
+
+    tbx_type_malloc_clear(a, cache_arena_t, 1);
+    apr_thread_mutex_create(&(a->lock), APR_THREAD_MUTEX_DEFAULT, mpool);
+    a->slab_size = (slab_size > 0) ? slab_size : CACHE_ARENA_SLAB_SIZE;
+    a->flags = flags;
+
+    return(a);
+}
+
+//*************************************************************************
+// cache_arena_destroy - Unmaps all the slabs and destroys the arena
+//*************************************************************************
+
+void cache_arena_destroy(cache_arena_t *a)
+{
+    cache_arena_pool_t *pool, *pnext;
+    cache_arena_slab_t *slab, *snext;
+
+    if (a->used_bytes != 0) {
+        log_printf(1, "WARNING: Destroying arena with pages still in use! used_bytes=" XOT "\n", a->used_bytes);
+    }
+
+    for (pool = a->pools; pool != NULL; pool = pnext) {
+        pnext = pool->next;
+        for (slab = pool->slabs; slab != NULL; slab = snext) {
+            snext = slab->next;
+            if (slab->is_huge < 0) {
+                free(slab->base);
+            } else {
+                if (a->flags & CACHE_ARENA_MLOCK) munlock(slab->base, slab->size);
+                munmap(slab->base, slab->size);
+            }
+            free(slab);
+        }
+        free(pool);
+    }
+
+    apr_thread_mutex_destroy(a->lock);
+    free(a);
+}
@@ -0,0 +1,77 @@
+/*
+   Copyright 2016 Vanderbilt University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+//***********************************************************************
+// Slab allocator for cache page buffers
+//***********************************************************************
+
+#ifndef __CACHE_ARENA_H_
+#define __CACHE_ARENA_H_
+
+#include <apr_thread_mutex.h>
+#include <lio/ex3_fwd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CACHE_ARENA_HUGEPAGE  1   //** Try and back the slabs with 2MB huge pages
+#define CACHE_ARENA_MLOCK     2   //** Lock the slabs in memory
+
+#define CACHE_ARENA_SLAB_SIZE (2*1024*1024)
+
+typedef struct cache_arena_t cache_arena_t;
+typedef struct cache_arena_pool_t cache_arena_pool_t;
+typedef struct cache_arena_slab_t cache_arena_slab_t;
+
+struct cache_arena_slab_t {
+    char *base;                 //** Start of the mapping
+    ex_off_t size;              //** Size of the mapping
+    int is_huge;                //** 1=huge pages, 0=normal mapping, -1=heap fallback
+    cache_arena_slab_t *next;
+};
+
+struct cache_arena_pool_t {
+    ex_off_t page_size;
+    void *free_list;            //** Free pages linked through their 1st word
+    cache_arena_slab_t *slabs;
+    char *carve;                //** Next uncarved page in the current slab
+    char *carve_end;
+    ex_off_t n_free;
+    cache_arena_pool_t *next;
+};
+
+struct cache_arena_t {
+    apr_thread_mutex_t *lock;
+    cache_arena_pool_t *pools;  //** One per page size
+    ex_off_t slab_size;         //** Preferred slab size
+    ex_off_t slab_bytes;        //** Total bytes mapped
+    ex_off_t used_bytes;        //** Bytes handed out as pages
+    ex_off_t huge_slabs;        //** Number of slabs backed by huge pages
+    ex_off_t n_slabs;
+    int flags;
+};
+
+cache_arena_t *cache_arena_create(apr_pool_t *mpool, ex_off_t slab_size, int flags);
+void cache_arena_destroy(cache_arena_t *a);
+char *cache_arena_page_get(cache_arena_t *a, ex_off_t page_size, int clear);
+void cache_arena_page_put(cache_arena_t *a, ex_off_t page_size, char *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
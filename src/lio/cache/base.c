@@ -51,6 +51,7 @@ void cache_base_destroy(lio_cache_t *c)
 {
     tbx_list_destroy(c->segments);
     tbx_pc_destroy(c->cond_coop);
+    cache_arena_destroy(c->arena);
     apr_thread_mutex_destroy(c->lock);
     apr_pool_destroy(c->mpool);
 }
@@ -65,6 +66,7 @@ void cache_base_create(lio_cache_t *c, data_attr_t *da, int timeout)
     apr_thread_mutex_create(&(c->lock), APR_THREAD_MUTEX_DEFAULT, c->mpool);
     c->segments = tbx_list_create(0, &skiplist_compare_ex_id, NULL, NULL, NULL);
     c->cond_coop = tbx_pc_new("cache_cond_coop", 50, sizeof(lio_cache_cond_t), c->mpool, cache_cond_new, cache_cond_free);
+    c->arena = cache_arena_create(c->mpool, CACHE_ARENA_SLAB_SIZE, 0);
     c->da = da;
     c->timeout = timeout;
     c->default_page_size = 16*1024;
@@ -34,6 +34,7 @@ typedef struct lio_cache_counters_t lio_cache_counters_t;
 typedef struct lio_cache_fn_t lio_cache_fn_t;
 typedef struct lio_cache_page_t lio_cache_page_t;
 typedef struct lio_cache_partial_page_t lio_cache_partial_page_t;
+typedef struct lio_cache_prefetch_counters_t lio_cache_prefetch_counters_t;
 typedef struct lio_cache_range_t lio_cache_range_t;
 typedef struct lio_cache_lio_segment_t lio_cache_lio_segment_t;
 typedef struct lio_cache_t lio_cache_t;
@@ -45,6 +46,7 @@ typedef struct lio_page_table_t lio_page_table_t;
 typedef struct lio_amp_page_stream_t lio_amp_page_stream_t;
 typedef struct lio_amp_page_wait_t lio_amp_page_wait_t;
 typedef struct lio_amp_stream_table_t lio_amp_stream_table_t;
+typedef struct lio_amp_stride_t lio_amp_stride_t;
 typedef struct lio_cache_amp_t lio_cache_amp_t;
 typedef struct lio_page_amp_t lio_page_amp_t;
 
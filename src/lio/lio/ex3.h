@@ -29,6 +29,7 @@ limitations under the License.
 #include <lio/ds.h>
 #include <lio/ex3_fwd.h>
 #include <lio/visibility.h>
+#include <lio/rid_throttle.h>
 #include <lio/rs.h>
 #include <lio/service_manager.h>
 #include <tbx/iniparse.h>
@@ -103,6 +104,8 @@ enum lio_ex3_inspect_command_t {
 #define INSPECT_FIX_READ_ERROR       (1 << 11)   //** Treat read errors as bad blocks for repair
 #define INSPECT_FIX_WRITE_ERROR      (1 << 12)   //** Treat write errors as bad blocks for repair
 
+#define INSPECT_MIGRATE_ROWS 8    //** Default number of rows migrated in parallel
+
 #define XIDT "%" PRIu64    //uint64_t
 #define XOT  "%" PRId64    //int64_t
 #define PXOT     PRId64    // Drop the % for formatting ..int64_t
@@ -130,6 +133,8 @@ struct lio_inspect_args_t {
     gop_opque_t *qf;         //** Cleanup Que for failure
     apr_hash_t *rid_changes;  //** List of RID space changes
     apr_thread_mutex_t *rid_lock;     //** Lock for manipulating the rid_changes table
+    lio_rid_throttle_t *throttle;     //** Optional per-RID copy limits
+    int max_rows;                     //** Max rows migrated in parallel.  0 uses the default
     int n_dev_rows;
     int dev_row_replaced[128];
 };
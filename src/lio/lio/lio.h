@@ -22,6 +22,7 @@ limitations under the License.
 #define ACCRE_LIO_LIO_ABSTRACT_H_INCLUDED
 
 #include <gop/mq.h>
+#include <stdint.h>
 #include <lio/visibility.h>
 #include <lio/authn.h>
 #include <lio/blacklist.h>
@@ -49,6 +50,7 @@ struct stat;
 
 // Functions
 LIO_API gop_op_generic_t *lio_abort_regex_object_set_multiple_attrs_gop(lio_config_t *lc, gop_op_generic_t *gop);
+LIO_API gop_op_generic_t *lio_aggregate_gop(lio_config_t *lc, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types, int recurse_depth, char *key, lio_os_aggregate_t *agg);
 LIO_API gop_op_generic_t *lio_symlink_object_gop(lio_config_t *lc, lio_creds_t *creds, char *src_path, char *dest_path, char *id);
 LIO_API gop_op_generic_t *lio_read_gop(lio_fd_t *fd, char *buf, ex_off_t size, ex_off_t off, lio_segment_rw_hints_t *rw_hints);
 LIO_API gop_op_generic_t *lio_readv_gop(lio_fd_t *fd, tbx_iovec_t *iov, int n_iov, ex_off_t size, ex_off_t off, lio_segment_rw_hints_t *rw_hints);
@@ -70,6 +72,8 @@ LIO_API int lio_stat(lio_config_t *lc, lio_creds_t *creds, char *fname, struct s
 LIO_API ex_off_t lio_seek(lio_fd_t *fd, ex_off_t offset, int whence);
 LIO_API ex_off_t lio_tell(lio_fd_t *fd);
 LIO_API ex_off_t lio_size(lio_fd_t *fd);
+LIO_API ex_off_t lio_stripe_size(lio_fd_t *fd);
+LIO_API gop_op_generic_t *lio_checksum_gop(lio_fd_t *fd, ex_off_t offset, ex_off_t len, ex_off_t chunk_size, int n_parallel, uint32_t *adler32);
 LIO_API gop_op_generic_t *lio_truncate_gop(lio_fd_t *fd, ex_off_t new_size);
 
 LIO_API gop_op_generic_t *lio_cp_lio2lio_gop(lio_fd_t *sfd, lio_fd_t *dfd, ex_off_t bufsize, char *buffer, int hints, lio_segment_rw_hints_t *rw_hints);
@@ -88,6 +92,7 @@ LIO_API gop_op_generic_t *lio_cp_local2lio_gop(FILE *sfd, lio_fd_t *dfd, ex_off_
 LIO_API lio_fsck_iter_t *lio_create_fsck_iter(lio_config_t *lc, lio_creds_t *creds, char *path, int owner_mode, char *owner, int exnode_mode);
 LIO_API os_object_iter_t *lio_create_object_iter(lio_config_t *lc, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *obj_regex, int object_types, lio_os_regex_table_t *attr, int recurse_dpeth, os_attr_iter_t **it, int v_max);
 LIO_API os_object_iter_t *lio_create_object_iter_alist(lio_config_t *lc, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *obj_regex, int object_types, int recurse_depth, char **key, void **val, int *v_size, int n_keys);
+LIO_API os_object_iter_t *lio_create_object_iter_predicate(lio_config_t *lc, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *obj_regex, int object_types, int recurse_depth, lio_os_predicate_t *pred, char **key, void **val, int *v_size, int n_keys);
 LIO_API gop_op_generic_t *lio_create_gop(lio_config_t *lc, lio_creds_t *creds, char *path, int type, char *ex, char *id);
 LIO_API void lio_destroy_fsck_iter(lio_config_t *lc, lio_fsck_iter_t *oit);
 LIO_API void lio_destroy_object_iter(lio_config_t *lc, os_object_iter_t *it);
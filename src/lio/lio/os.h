@@ -34,6 +34,9 @@ extern "C" {
 
 // Typedefs
 typedef struct lio_object_service_fn_t lio_object_service_fn_t;
+typedef struct lio_os_agg_level_t lio_os_agg_level_t;
+typedef struct lio_os_aggregate_t lio_os_aggregate_t;
+typedef struct lio_os_predicate_t lio_os_predicate_t;
 typedef struct lio_os_attr_list_t lio_os_attr_list_t;
 typedef struct lio_os_authz_t lio_os_authz_t;
 typedef struct lio_os_regex_entry_t lio_os_regex_entry_t;
@@ -105,6 +108,9 @@ typedef os_attr_iter_t *(*lio_os_create_attr_iter_fn_t)(lio_object_service_fn_t
 typedef int (*lio_os_next_attr_fn_t)(os_attr_iter_t *it, char **key, void **val, int *v_size);
 typedef int (*lio_os_add_virtual_attr_fn_t)(lio_os_virtual_attr_t *va, char *key, int type);
 typedef void (*lio_os_destroy_attr_iter_fn_t)(os_attr_iter_t *it);
+typedef gop_op_generic_t *(*lio_os_aggregate_fn_t)(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types, int recurse_depth, char *key, lio_os_aggregate_t *agg);
+typedef gop_op_generic_t *(*lio_os_abort_aggregate_fn_t)(lio_object_service_fn_t *os, gop_op_generic_t *gop);
+typedef os_object_iter_t *(*lio_os_create_object_iter_predicate_fn_t)(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *obj_regex, int object_types, int recurse_depth, lio_os_predicate_t *pred, char **key, void **val, int *v_size, int n_keys);
 
 //* FIXME: leaky
 typedef struct lio_osfile_priv_t lio_osfile_priv_t;
@@ -116,15 +122,24 @@ typedef struct lio_osrs_priv_t lio_osrs_priv_t;
 LIO_API char *lio_os_glob2regex(char *glob);
 LIO_API int lio_os_local_filetype(char *path);
 LIO_API lio_os_regex_table_t *lio_os_path_glob2regex(char *path);
+LIO_API lio_os_regex_table_t *lio_os_path_children2regex(char *path);
 LIO_API void lio_os_path_split(const char *path, char **dir, char **file);
 LIO_API lio_os_regex_table_t *lio_os_regex2table(char *regex);
 LIO_API int lio_os_regex_is_fixed(lio_os_regex_table_t *regex);
 LIO_API void lio_os_regex_table_destroy(lio_os_regex_table_t *table);
+LIO_API lio_os_aggregate_t *lio_os_aggregate_create(int max_depth);
+LIO_API void lio_os_aggregate_destroy(lio_os_aggregate_t *agg);
+LIO_API void lio_os_aggregate_add(lio_os_aggregate_t *agg, int depth, int ftype, int has_value, int64_t value);
+LIO_API void lio_os_aggregate_total(lio_os_aggregate_t *agg, lio_os_agg_level_t *total);
+LIO_API lio_os_predicate_t *lio_os_predicate_parse(const char *expr);
+LIO_API void lio_os_predicate_destroy(lio_os_predicate_t *pred);
 
 // ** These are generic testing routines for the OS
 LIO_API int os_create_remove_tests(char *prefix);
 LIO_API int os_attribute_tests(char *prefix);
 LIO_API int os_locking_tests(char *prefix);
+LIO_API int os_aggregate_tests(char *prefix);
+LIO_API int os_metadata_benchmark(char *prefix, int n_objects);
 
 // Preprocessor constants
 #define OS_PATH_MAX  32768    //** Max path length
@@ -143,6 +158,8 @@ LIO_API int os_locking_tests(char *prefix);
 
 #define OS_MODE_READ_IMMEDIATE  0
 
+#define OS_AGG_HIST_BINS  64  //** log2 buckets used for the aggregate attribute histogram
+
 // Preprocessor macros
 #define os_close_object(os, fd) (os)->close_object(os, fd)
 #define os_create_fsck_iter(os, c, path, mode) (os)->create_fsck_iter(os, c, path, mode)
@@ -194,6 +211,23 @@ struct lio_object_service_fn_t {
     lio_os_next_attr_fn_t next_attr;
     lio_os_add_virtual_attr_fn_t add_virtual_attr;
     lio_os_destroy_attr_iter_fn_t destroy_attr_iter;
+    lio_os_aggregate_fn_t aggregate;               //** Optional. NULL if the service can't aggregate
+    lio_os_abort_aggregate_fn_t abort_aggregate;
+    lio_os_create_object_iter_predicate_fn_t create_object_iter_predicate;  //** Optional. alist iterator filtered by a predicate
+};
+
+struct lio_os_agg_level_t {
+    int64_t n_objects;     //** Objects found at this depth
+    int64_t n_dirs;        //** How many of them are directories
+    int64_t n_values;      //** Objects that had the attribute
+    int64_t sum;           //** Sum of the attribute values
+    int64_t hist[OS_AGG_HIST_BINS];  //** hist[0] is for values <= 0 otherwise hist[i] is [2^(i-1), 2^i)
+};
+
+struct lio_os_aggregate_t {
+    int max_depth;         //** Objects deeper than this are folded into the last level
+    int n_levels;          //** Number of levels with data
+    lio_os_agg_level_t *level;
 };
 
 struct lio_os_regex_entry_t {
@@ -0,0 +1,45 @@
+/*
+Copyright 2016 Vanderbilt University
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/** \file
+* Autogenerated public API
+*/
+
+#ifndef ACCRE_LIO_RID_THROTTLE_H_INCLUDED
+#define ACCRE_LIO_RID_THROTTLE_H_INCLUDED
+
+#include <lio/ex3_fwd.h>
+#include <lio/visibility.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Typedefs
+typedef struct lio_rid_throttle_entry_t lio_rid_throttle_entry_t;
+typedef struct lio_rid_throttle_t lio_rid_throttle_t;
+
+// Functions
+LIO_API void lio_rid_throttle_acquire(lio_rid_throttle_t *rt, char *src_rid, char *dest_rid, ex_off_t nbytes);
+LIO_API lio_rid_throttle_t *lio_rid_throttle_create(int src_max, int dest_max, ex_off_t src_bw, ex_off_t dest_bw);
+LIO_API void lio_rid_throttle_destroy(lio_rid_throttle_t *rt);
+LIO_API void lio_rid_throttle_release(lio_rid_throttle_t *rt, char *src_rid, char *dest_rid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ^ ACCRE_LIO_RID_THROTTLE_H_INCLUDED ^ */
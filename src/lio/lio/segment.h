@@ -47,6 +47,7 @@ typedef ex_off_t (*lio_segment_size_fn_t)(lio_segment_t *seg);
 typedef int (*lio_segment_serialize_fn_t)(lio_segment_t *seg, lio_exnode_exchange_t *exp);
 typedef int (*lio_segment_deserialize_fn_t)(lio_segment_t *seg, ex_id_t id, lio_exnode_exchange_t *exp);
 typedef void (*lio_segment_destroy_fn_t)(lio_segment_t *seg);
+typedef void (*lio_slog_merge_checkpoint_fn_t)(void *arg, lio_segment_t *seg, ex_off_t checkpoint);
 // FIXME: leaky
 typedef struct lio_seglog_priv_t lio_seglog_priv_t;
 typedef struct lio_slog_range_t lio_slog_range_t;
@@ -59,6 +60,7 @@ LIO_API int lio_cache_stats_get_print(lio_cache_stats_get_t *cs, char *buffer, i
 LIO_API lio_cache_stats_get_t segment_lio_cache_stats_get(lio_segment_t *seg);
 LIO_API gop_op_generic_t *lio_segment_linear_make_gop(lio_segment_t *seg, data_attr_t *da, rs_query_t *rsq, int n_rid, ex_off_t block_size, ex_off_t total_size, int timeout);
 LIO_API gop_op_generic_t *lio_slog_merge_with_base_gop(lio_segment_t *seg, data_attr_t *da, ex_off_t bufsize, char *buffer, int truncate_old_log, int timeout);  //** Merges the current log with the base
+LIO_API gop_op_generic_t *lio_slog_merge_with_base_cp_gop(lio_segment_t *seg, data_attr_t *da, ex_off_t bufsize, char *buffer, int truncate_old_log, lio_slog_merge_checkpoint_fn_t cp_fn, void *cp_arg, int timeout);  //** Same as above but calls cp_fn as progress is checkpointed
 
 // Preprocessor constants
 // FIXME: leaky
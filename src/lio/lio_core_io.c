@@ -29,6 +29,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <tbx/adler32.h>
 #include <tbx/assert_result.h>
 #include <tbx/atomic_counter.h>
 #include <tbx/list.h>
@@ -36,7 +38,6 @@
 #include <tbx/stack.h>
 #include <tbx/transfer_buffer.h>
 #include <tbx/type_malloc.h>
-#include <zlib.h>
 
 #include "authn.h"
 #include "blacklist.h"
@@ -46,6 +47,9 @@
 #include "ex3/types.h"
 #include "lio.h"
 #include "os.h"
+#include "segment/cache.h"
+#include "segment/jerasure.h"
+#include "segment/lun.h"
 
 //***********************************************************************
 // Core LIO I/O functionality
@@ -60,7 +64,7 @@ static char *_lio_fh_keys[] = { "system.inode", "system.exnode" };
 typedef struct {
     ex_off_t offset;
     ex_off_t len;
-    uLong adler32;
+    uint32_t adler32;
 } lfs_adler32_t;
 
 //***********************************************************************
@@ -231,6 +235,49 @@ int lio_update_exnode_attrs(lio_config_t *lc, lio_creds_t *creds, lio_exnode_t *
     return(ret);
 }
 
+//*****************************************************************
+// _lio_tbuf_adler32 - Calculates the adler32 of a range of the tbuf
+//    directly from its iovecs.  Holes are treated as zeros.
+//*****************************************************************
+
+uint32_t _lio_tbuf_adler32(tbx_tbuf_t *buffer, ex_off_t boff, ex_off_t len)
+{
+    static const unsigned char zero[4096];
+    tbx_tbuf_var_t tbv;
+    uint32_t cksum;
+    ex_off_t pos, nleft, n, k, z, m;
+    int i;
+
+    cksum = 1;
+    pos = boff;
+    nleft = len;
+    tbx_tbuf_var_init(&tbv);
+    while (nleft > 0) {
+        tbv.nbytes = nleft;
+        if (tbx_tbuf_next(buffer, pos, &tbv) != TBUFFER_OK) break;
+        if (tbv.nbytes == 0) break;
+
+        n = tbv.nbytes;
+        for (i=0; (i < tbv.n_iov) && (n > 0); i++) {
+            k = (tbv.buffer[i].iov_len > (size_t)n) ? n : (ex_off_t)tbv.buffer[i].iov_len;
+            if (tbv.buffer[i].iov_base != NULL) {
+                cksum = tbx_adler32(cksum, (unsigned char *)tbv.buffer[i].iov_base, k);
+            } else {
+                for (z=0; z<k; z += m) {
+                    m = ((k-z) > (ex_off_t)sizeof(zero)) ? (ex_off_t)sizeof(zero) : k-z;
+                    cksum = tbx_adler32(cksum, zero, m);
+                }
+            }
+            n -= k;
+        }
+
+        pos += tbv.nbytes;
+        nleft -= tbv.nbytes;
+    }
+
+    return(cksum);
+}
+
 //*****************************************************************
 // lio_store_and_release_adler32 - Takes all the adler32 structures
 //    and coalesces them into a single adler32 and stores it in the
@@ -242,7 +289,7 @@ void lio_store_and_release_adler32(lio_config_t *lc, lio_creds_t *creds, tbx_lis
 {
     tbx_list_iter_t it;
     ex_off_t next, missing, overlap, dn, nbytes, pend;
-    uLong cksum;
+    uint32_t cksum;
     unsigned int aval;
     lfs_adler32_t *a32;
     tbx_stack_t *stack;
@@ -250,7 +297,7 @@ void lio_store_and_release_adler32(lio_config_t *lc, lio_creds_t *creds, tbx_lis
     char value[256];
     stack = tbx_stack_new();
     it = tbx_list_iter_search(write_table, 0, 0);
-    cksum = adler32(0L, Z_NULL, 0);
+    cksum = 1;  //** Adler32 of an empty buffer
     missing = next = overlap = nbytes = 0;
     while (tbx_list_next(&it, (tbx_list_key_t **)&aoff, (tbx_list_data_t **)&a32) == 0) {
         aval = a32->adler32;
@@ -270,7 +317,7 @@ void lio_store_and_release_adler32(lio_config_t *lc, lio_creds_t *creds, tbx_lis
         }
 
         nbytes += a32->len;
-        cksum = adler32_combine(cksum, a32->adler32, a32->len);
+        cksum = tbx_adler32_combine(cksum, a32->adler32, a32->len);
 
         next = a32->offset + a32->len;
     }
@@ -1018,35 +1065,19 @@ gop_op_status_t lio_write_ex_fn(void *arg, int id)
     tbx_log_flush();
 
     if (fd->fh->write_table != NULL) {
-        tbx_tbuf_t tb;
         lfs_adler32_t *a32;
-        unsigned char *buf = NULL;
-        ex_off_t blen = 0;
         ex_off_t bpos = op->boff;
         for (i=0; i < op->n_iov; i++) {
             tbx_type_malloc(a32, lfs_adler32_t, 1);
             a32->offset = iov[i].offset;
             a32->len = iov[i].len;
-            a32->adler32 = adler32(0L, Z_NULL, 0);
-
-            //** This is sloppy should use tbuffer_next to do this but this is all going ot be thrown away once we track
-            //** down the gridftp plugin issue
-            if (blen < a32->len) {
-                if (buf != NULL) free(buf);
-                blen = a32->len;
-                tbx_type_malloc(buf, unsigned char, blen);
-            }
-            tbx_tbuf_single(&tb, a32->len, (char *)buf);
-            tbx_tbuf_copy(buffer, bpos, &tb, 0, a32->len, 1);
-            a32->adler32 = adler32(a32->adler32, buf, a32->len);
+            a32->adler32 = _lio_tbuf_adler32(buffer, bpos, a32->len);
             segment_lock(fd->fh->seg);
             tbx_list_insert(fd->fh->write_table, &(a32->offset), a32);
             segment_unlock(fd->fh->seg);
 
             bpos += a32->len;
         }
-
-        if (buf != NULL) free(buf);
     }
 
     if (err != OP_STATE_SUCCESS) {
@@ -1190,6 +1221,7 @@ int lio_write(lio_fd_t *fd, char *buf, ex_off_t size, off_t off, lio_segment_rw_
 //***********************************************************************
 
 #define LIO_COPY_BUFSIZE (20*1024*1024)
+#define LIO_COPY_DIRECT_INFLIGHT 16   //** Max depot-to-depot copies in flight for a re-striping copy
 
 typedef struct {
     FILE *sffd, *dffd;
@@ -1293,6 +1325,115 @@ gop_op_generic_t *lio_cp_lio2local_gop(lio_fd_t *sfd, FILE *dfd, ex_off_t bufsiz
 }
 
 
+//***********************************************************************
+// _lio_cp_child - Returns the child segment for the layers that just wrap
+//    another segment or NULL otherwise
+//***********************************************************************
+
+lio_segment_t *_lio_cp_child(lio_segment_t *seg)
+{
+    if (strcmp(seg->header.type, SEGMENT_TYPE_CACHE) == 0) {
+        return(((lio_cache_lio_segment_t *)seg->priv)->child_seg);
+    } else if (strcmp(seg->header.type, SEGMENT_TYPE_JERASURE) == 0) {
+        return(segjerase_child_get(seg));
+    }
+
+    return(NULL);
+}
+
+//***********************************************************************
+// _lio_cp_layer_match - Returns 1 if the segments' own layers match
+//    ignoring the children.  The signature of a wrapping layer is its own
+//    part followed by the child's signature so that's stripped off.
+//***********************************************************************
+
+int _lio_cp_layer_match(lio_segment_t *sseg, lio_segment_t *schild, lio_segment_t *dseg, lio_segment_t *dchild)
+{
+    const int sigsize = 10*1024;
+    char sig1[sigsize], sig2[sigsize], csig[sigsize];
+    int n1, n2, used;
+
+    used = 0;
+    segment_signature(sseg, sig1, &used, sigsize);
+    used = 0;
+    segment_signature(schild, csig, &used, sigsize);
+    n1 = strlen(sig1) - strlen(csig);
+
+    used = 0;
+    segment_signature(dseg, sig2, &used, sigsize);
+    used = 0;
+    segment_signature(dchild, csig, &used, sigsize);
+    n2 = strlen(sig2) - strlen(csig);
+
+    if ((n1 < 0) || (n1 != n2)) return(0);
+    return((strncmp(sig1, sig2, n1) == 0) ? 1 : 0);
+}
+
+//***********************************************************************
+// lio_cp_direct_plan - Figures out if the source can be copied to the
+//    destination with depot-to-depot copies even though the signatures
+//    differ.  Caches are peeled off either side.  Other wrapping layers,
+//    like erasure coding, must be identical on both sides since their
+//    parity is then a straight byte copy.  What's left must be a pair of
+//    LUNs which can have any striping.  Returns 0 and the LUNs on success.
+//***********************************************************************
+
+int lio_cp_direct_plan(lio_segment_t *sseg, lio_segment_t *dseg, lio_segment_t **slun, lio_segment_t **dlun)
+{
+    lio_segment_t *schild, *dchild;
+
+    while ((sseg != NULL) && (dseg != NULL)) {
+        if ((strcmp(sseg->header.type, SEGMENT_TYPE_LUN) == 0) && (strcmp(dseg->header.type, SEGMENT_TYPE_LUN) == 0)) {
+            *slun = sseg;
+            *dlun = dseg;
+            return(0);
+        }
+
+        if (strcmp(sseg->header.type, SEGMENT_TYPE_CACHE) == 0) {
+            sseg = _lio_cp_child(sseg);
+        } else if (strcmp(dseg->header.type, SEGMENT_TYPE_CACHE) == 0) {
+            dseg = _lio_cp_child(dseg);
+        } else {
+            schild = _lio_cp_child(sseg);
+            dchild = _lio_cp_child(dseg);
+            if ((schild == NULL) || (dchild == NULL)) return(1);
+            if (strcmp(sseg->header.type, dseg->header.type) != 0) return(1);
+            if (_lio_cp_layer_match(sseg, schild, dseg, dchild) == 0) return(1);
+            sseg = schild;
+            dseg = dchild;
+        }
+    }
+
+    return(1);
+}
+
+//***********************************************************************
+// lio_cp_direct - Re-striping copy using depot-to-depot copies.  The
+//    destination is sized to match the source first so the wrapping layers
+//    update their state and then the LUN blocks are copied directly.
+//***********************************************************************
+
+gop_op_status_t lio_cp_direct(lio_file_handle_t *sfh, lio_file_handle_t *dfh)
+{
+    lio_segment_t *slun, *dlun;
+    gop_op_status_t status;
+    ex_off_t len;
+
+    if (lio_cp_direct_plan(sfh->seg, dfh->seg, &slun, &dlun) != 0) return(gop_failure_status);
+
+    len = segment_size(sfh->seg);
+    status = gop_sync_exec_status(lio_segment_truncate(dfh->seg, dfh->lc->da, len, dfh->lc->timeout));
+    if (status.op_status != OP_STATE_SUCCESS) return(status);
+
+    status = gop_sync_exec_status(seglun_direct_copy_gop(dfh->lc->da, slun, dlun, segment_size(slun), LIO_COPY_DIRECT_INFLIGHT, dfh->lc->timeout));
+    if (status.op_status == OP_STATE_SUCCESS) {
+        lio_cache_pages_drop(dfh->seg, 0, len);  //** Nothing should be cached but make sure stale pages aren't used
+    }
+
+    log_printf(1, "sfh=" XIDT " dfh=" XIDT " len=" XOT " status=%d\n", segment_id(sfh->seg), segment_id(dfh->seg), len, status.op_status);
+    return(status);
+}
+
 //***********************************************************************
 // lio_cp_lio2lio - Copies a LIO file to another LIO file
 //***********************************************************************
@@ -1319,9 +1460,11 @@ gop_op_status_t lio_cp_lio2lio_fn(void *arg, int id)
     status = gop_failure_status;
     if ((strcmp(sig1, sig2) == 0) && ((op->hints & LIO_COPY_INDIRECT) == 0)) {
         status = gop_sync_exec_status(segment_clone(sfh->seg, dfh->lc->da, &(dfh->seg), CLONE_STRUCT_AND_DATA, NULL, dfh->lc->timeout));
+    } else if ((op->hints & LIO_COPY_INDIRECT) == 0) {  //** Different layouts so see if we can still do it depot->depot
+        status = lio_cp_direct(sfh, dfh);
     }
 
-    //** If the signatures don't match or the clone failed do a slow indirect copy passing through the client
+    //** If we can't go depot->depot or the copy failed do a slow indirect copy passing through the client
     if (status.op_status == OP_STATE_FAILURE) {
         buffer = op->buffer;
         bufsize = (op->bufsize <= 0) ? LIO_COPY_BUFSIZE-1 : op->bufsize-1;
@@ -1681,6 +1824,158 @@ ex_off_t lio_size(lio_fd_t *fd)
     return(segment_size(fd->fh->seg));
 }
 
+//***********************************************************************
+// lio_stripe_size - Returns the stripe size of the file's data segment
+//     looking through any cache layer.  Returns 1 if it has no striping.
+//***********************************************************************
+
+ex_off_t lio_stripe_size(lio_fd_t *fd)
+{
+    lio_segment_t *seg = fd->fh->seg;
+    ex_off_t n;
+
+    if ((seg->header.type != NULL) && (strcmp(seg->header.type, SEGMENT_TYPE_CACHE) == 0)) {
+        seg = ((lio_cache_lio_segment_t *)seg->priv)->child_seg;
+    }
+
+    n = segment_block_size(seg);
+    return((n > 0) ? n : 1);
+}
+
+//***********************************************************************
+// lio_checksum_gop - Calculates the adler32 of a range of an open file.
+//    The range is split into chunks which are read and summed in parallel
+//    and then merged in offset order with tbx_adler32_combine().
+//***********************************************************************
+
+#define LIO_CHECKSUM_CHUNK_MAX (1024*1024*1024)  //** lio_read() returns an int so keep chunks well under 2GiB
+
+typedef struct {
+    lio_fd_t *fd;
+    ex_off_t offset;
+    ex_off_t len;
+    uint32_t adler32;
+} lio_checksum_chunk_t;
+
+typedef struct {
+    lio_fd_t *fd;
+    ex_off_t offset;
+    ex_off_t len;
+    ex_off_t chunk_size;
+    int n_parallel;
+    uint32_t *adler32;
+} lio_checksum_op_t;
+
+gop_op_status_t lio_checksum_chunk_fn(void *arg, int id)
+{
+    lio_checksum_chunk_t *c = (lio_checksum_chunk_t *)arg;
+    gop_op_status_t status;
+    unsigned char *buf;
+    ex_off_t nbytes;
+
+    tbx_type_malloc(buf, unsigned char, c->len);
+    nbytes = lio_read(c->fd, (char *)buf, c->len, c->offset, NULL);
+    if (nbytes != c->len) {
+        log_printf(1, "ERROR reading chunk! fname=%s off=" XOT " len=" XOT " got=" XOT "\n", c->fd->path, c->offset, c->len, nbytes);
+        _op_set_status(status, OP_STATE_FAILURE, -EIO);
+    } else {
+        c->adler32 = tbx_adler32(1, buf, c->len);
+        status = gop_success_status;
+    }
+
+    free(buf);
+    return(status);
+}
+
+gop_op_status_t lio_checksum_fn(void *arg, int id)
+{
+    lio_checksum_op_t *op = (lio_checksum_op_t *)arg;
+    lio_checksum_chunk_t *chunk;
+    gop_opque_t *q;
+    gop_op_generic_t *gop;
+    gop_op_status_t status;
+    ex_off_t n_chunks, next, i, pos;
+    uint32_t cksum;
+    int err;
+
+    n_chunks = (op->len + op->chunk_size - 1) / op->chunk_size;
+    tbx_type_malloc_clear(chunk, lio_checksum_chunk_t, n_chunks);
+    pos = op->offset;
+    for (i=0; i<n_chunks; i++) {
+        chunk[i].fd = op->fd;
+        chunk[i].offset = pos;
+        chunk[i].len = ((op->offset + op->len - pos) > op->chunk_size) ? op->chunk_size : op->offset + op->len - pos;
+        pos += chunk[i].len;
+    }
+
+    //** Keep n_parallel chunks in flight.  Each one is read and summed in its own thread
+    q = gop_opque_new();
+    err = 0;
+    for (next=0; (next<n_chunks) && (next<op->n_parallel); next++) {
+        gop_opque_add(q, gop_tp_op_new(op->fd->lc->tpc_unlimited, NULL, lio_checksum_chunk_fn, (void *)&(chunk[next]), NULL, 1));
+    }
+    while ((gop = opque_waitany(q)) != NULL) {
+        if (gop_completed_successfully(gop) != OP_STATE_SUCCESS) err++;
+        gop_free(gop, OP_DESTROY);
+        if ((err == 0) && (next < n_chunks)) {
+            gop_opque_add(q, gop_tp_op_new(op->fd->lc->tpc_unlimited, NULL, lio_checksum_chunk_fn, (void *)&(chunk[next]), NULL, 1));
+            next++;
+        }
+    }
+    gop_opque_free(q, OP_DESTROY);
+
+    if (err == 0) {
+        cksum = 1;
+        for (i=0; i<n_chunks; i++) cksum = tbx_adler32_combine(cksum, chunk[i].adler32, chunk[i].len);
+        *op->adler32 = cksum;
+        status = gop_success_status;
+    } else {
+        _op_set_status(status, OP_STATE_FAILURE, -EIO);
+    }
+
+    free(chunk);
+    return(status);
+}
+
+//***********************************************************************
+
+gop_op_generic_t *lio_checksum_gop(lio_fd_t *fd, ex_off_t offset, ex_off_t len, ex_off_t chunk_size, int n_parallel, uint32_t *adler32)
+{
+    lio_checksum_op_t *op;
+    ex_off_t stripe, size;
+
+    size = segment_size(fd->fh->seg);
+    if ((len < 0) || (offset + len > size)) len = size - offset;
+    if (len <= 0) {
+        *adler32 = 1;
+        return(gop_dummy(gop_success_status));
+    }
+
+    //** Default to whole stripes of at least 16MB and 1 chunk per core
+    stripe = lio_stripe_size(fd);
+    if (chunk_size <= 0) chunk_size = 16*1024*1024;
+    if (chunk_size > LIO_CHECKSUM_CHUNK_MAX) chunk_size = LIO_CHECKSUM_CHUNK_MAX;
+    chunk_size = ((chunk_size + stripe - 1) / stripe) * stripe;
+    if (chunk_size > LIO_CHECKSUM_CHUNK_MAX) {  //** Rounding pushed it over so drop a stripe unless the stripe itself is too big
+        chunk_size = (LIO_CHECKSUM_CHUNK_MAX / stripe) * stripe;
+        if (chunk_size == 0) chunk_size = LIO_CHECKSUM_CHUNK_MAX;
+    }
+    if (n_parallel <= 0) {
+        n_parallel = sysconf(_SC_NPROCESSORS_ONLN);
+        if (n_parallel <= 0) n_parallel = 1;
+    }
+
+    tbx_type_malloc_clear(op, lio_checksum_op_t, 1);
+    op->fd = fd;
+    op->offset = offset;
+    op->len = len;
+    op->chunk_size = chunk_size;
+    op->n_parallel = n_parallel;
+    op->adler32 = adler32;
+
+    return(gop_tp_op_new(fd->lc->tpc_unlimited, NULL, lio_checksum_fn, (void *)op, free, 1));
+}
+
 //***********************************************************************
 // lio_truncate - Truncates an open LIO file
 //***********************************************************************
@@ -570,6 +570,18 @@ gop_op_generic_t *lio_regex_object_set_multiple_attrs_gop(lio_config_t *lc, lio_
     return(os_regex_object_set_multiple_attrs(lc->os, creds, id, path, object_regex, object_types, recurse_depth, key, val, v_size, n));
 }
 
+//*************************************************************************
+// lio_aggregate_gop - Tallies the matching objects and the key attribute
+//   per depth on the object service.  Returns NULL if the object service
+//   can't aggregate and the caller should walk the objects itself.
+//*************************************************************************
+
+gop_op_generic_t *lio_aggregate_gop(lio_config_t *lc, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types, int recurse_depth, char *key, lio_os_aggregate_t *agg)
+{
+    if (lc->os->aggregate == NULL) return(NULL);
+    return(os_aggregate(lc->os, creds, path, object_regex, object_types, recurse_depth, key, agg));
+}
+
 //*************************************************************************
 // lio_abort_regex_object_set_multiple_attrs_gop - Aborts an ongoing set attr call
 //*************************************************************************
@@ -845,6 +857,22 @@ os_object_iter_t *lio_create_object_iter_alist(lio_config_t *lc, lio_creds_t *cr
 }
 
 
+//*************************************************************************
+// lio_create_object_iter_predicate - Creates a fixed attribute list iterator
+//    that only returns objects matching the predicate.  The predicate is
+//    evaluated by the object service.
+//*************************************************************************
+
+os_object_iter_t *lio_create_object_iter_predicate(lio_config_t *lc, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *obj_regex, int object_types, int recurse_depth, lio_os_predicate_t *pred, char **key, void **val, int *v_size, int n_keys)
+{
+    if (lc->os->create_object_iter_predicate == NULL) {
+        log_printf(0, "ERROR: Object service doesn't support predicates!\n");
+        return(NULL);
+    }
+    return(os_create_object_iter_predicate(lc->os, creds, path, obj_regex, object_types, recurse_depth, pred, key, val, v_size, n_keys));
+}
+
+
 //*************************************************************************
 // lio_next_object - Returns the next iterator object
 //*************************************************************************
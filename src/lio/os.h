@@ -92,11 +92,45 @@ struct lio_os_attr_list_t {
 #define os_next_attr(os, it, key, val, vsize) (os)->next_attr(it, key, val, vsize)
 #define os_destroy_attr_iter(os, it) (os)->destroy_attr_iter(it)
 #define os_destroy(os) (os)->destroy_service(os)
+#define os_aggregate(os, c, path, obj_regex, otypes, depth, key, agg) (os)->aggregate(os, c, path, obj_regex, otypes, depth, key, agg)
+#define os_abort_aggregate(os, gop) (os)->abort_aggregate(os, gop)
+#define os_create_object_iter_predicate(os, c, path, obj_regex, otypes, depth, pred, key, val, v_size, n_keys) (os)->create_object_iter_predicate(os, c, path, obj_regex, otypes, depth, pred, key, val, v_size, n_keys)
 
 lio_os_regex_table_t *os_regex_table_create(int n);
 int os_regex_table_pack(lio_os_regex_table_t *regex, unsigned char *buffer, int bufsize);
 lio_os_regex_table_t *os_regex_table_unpack(unsigned char *buffer, int bufsize, int *used);
 
+//** Predicate opcodes.  The program is stored in postfix order
+#define OS_PRED_EXISTS 0
+#define OS_PRED_EQ     1
+#define OS_PRED_NE     2
+#define OS_PRED_LT     3
+#define OS_PRED_LE     4
+#define OS_PRED_GT     5
+#define OS_PRED_GE     6
+#define OS_PRED_AND    7
+#define OS_PRED_OR     8
+#define OS_PRED_NOT    9
+
+typedef struct {
+    int op;
+    int key;         //** Key slot for comparisons
+    int is_num;      //** Compare as integers
+    int64_t num;
+    char *value;
+} lio_os_pred_node_t;
+
+struct lio_os_predicate_t {
+    int n_keys;
+    char **key;      //** Unique attributes the predicate needs
+    int n_nodes;
+    lio_os_pred_node_t *node;
+};
+
+int os_predicate_pack(lio_os_predicate_t *p, unsigned char *buffer, int bufsize);
+lio_os_predicate_t *os_predicate_unpack(unsigned char *buffer, int bufsize, int *used);
+int os_predicate_eval(lio_os_predicate_t *p, void **val, int *v_size);
+
 struct lio_os_authz_t {
     void *priv;
     int (*object_create)(lio_os_authz_t *osa, lio_creds_t *c, char *path);
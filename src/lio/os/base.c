@@ -238,6 +238,48 @@ lio_os_regex_table_t *lio_os_path_glob2regex(char *path)
     return(table);
 }
 
+//***********************************************************************
+// lio_os_path_children2regex - Creates a regex table matching everything
+//    directly under the path.  Unlike lio_os_path_glob2regex() the path is
+//    used as is so names containing glob characters are safe.
+//***********************************************************************
+
+lio_os_regex_table_t *lio_os_path_children2regex(char *path)
+{
+    lio_os_regex_table_t *table;
+    lio_os_regex_entry_t *re;
+    char *ptr;
+    int i, n, err;
+
+    //** Drop the leading and trailing '/' the same as the glob tokenizer does
+    while (path[0] == '/') path++;
+    n = strlen(path);
+    while ((n > 0) && (path[n-1] == '/')) n--;
+
+    table = os_regex_table_create(2);
+    i = 0;
+    if (n > 0) {  //** The fixed part
+        re = &(table->regex_entry[0]);
+        re->expression = strndup(path, n);
+        ptr = strrchr(re->expression, '/');
+        re->fixed_prefix = (ptr == NULL) ? 0 : ptr - re->expression;
+        re->fixed = 1;
+        i++;
+    }
+
+    table->n = i+1;
+    re = &(table->regex_entry[i]);
+    re->expression = strdup("^.*$");
+    err = regcomp(&(re->compiled), re->expression, REG_NOSUB|REG_EXTENDED);
+    if (err != 0) {
+        log_printf(0, "Error with fragment %s err=%d\n", re->expression, err);
+        lio_os_regex_table_destroy(table);
+        return(NULL);
+    }
+
+    return(table);
+}
+
 //***********************************************************************
 // os_regex_table_create - Creates a regex table
 //***********************************************************************
@@ -528,3 +570,80 @@ int lio_os_local_filetype(char *path)
 
     return(os_local_filetype_stat(path, &s, &s));
 }
+
+//***********************************************************************
+// lio_os_aggregate_create - Creates an empty aggregate.  Objects deeper
+//   than max_depth are tallied in the last level.
+//***********************************************************************
+
+lio_os_aggregate_t *lio_os_aggregate_create(int max_depth)
+{
+    lio_os_aggregate_t *agg;
+
+    if (max_depth < 0) max_depth = 0;
+
+    tbx_type_malloc_clear(agg, lio_os_aggregate_t, 1);
+    agg->max_depth = max_depth;
+    tbx_type_malloc_clear(agg->level, lio_os_agg_level_t, max_depth+1);
+
+    return(agg);
+}
+
+//***********************************************************************
+// lio_os_aggregate_destroy - Destroys the aggregate
+//***********************************************************************
+
+void lio_os_aggregate_destroy(lio_os_aggregate_t *agg)
+{
+    free(agg->level);
+    free(agg);
+}
+
+//***********************************************************************
+// lio_os_aggregate_add - Adds an object to the aggregate
+//***********************************************************************
+
+void lio_os_aggregate_add(lio_os_aggregate_t *agg, int depth, int ftype, int has_value, int64_t value)
+{
+    lio_os_agg_level_t *l;
+    int bin;
+
+    if (depth < 0) depth = 0;
+    if (depth > agg->max_depth) depth = agg->max_depth;
+    if (depth >= agg->n_levels) agg->n_levels = depth + 1;
+
+    l = &(agg->level[depth]);
+    l->n_objects++;
+    if (ftype & OS_OBJECT_DIR_FLAG) l->n_dirs++;
+    if (has_value == 0) return;
+
+    l->n_values++;
+    l->sum += value;
+
+    bin = 0;
+    if (value > 0) {
+        while ((value > 0) && (bin < OS_AGG_HIST_BINS-1)) {
+            value >>= 1;
+            bin++;
+        }
+    }
+    l->hist[bin]++;
+}
+
+//***********************************************************************
+// lio_os_aggregate_total - Sums all the levels into total
+//***********************************************************************
+
+void lio_os_aggregate_total(lio_os_aggregate_t *agg, lio_os_agg_level_t *total)
+{
+    int i, j;
+
+    memset(total, 0, sizeof(lio_os_agg_level_t));
+    for (i=0; i<agg->n_levels; i++) {
+        total->n_objects += agg->level[i].n_objects;
+        total->n_dirs += agg->level[i].n_dirs;
+        total->n_values += agg->level[i].n_values;
+        total->sum += agg->level[i].sum;
+        for (j=0; j<OS_AGG_HIST_BINS; j++) total->hist[j] += agg->level[i].hist[j];
+    }
+}
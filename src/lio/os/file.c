@@ -43,7 +43,6 @@
 #include <tbx/append_printf.h>
 #include <tbx/assert_result.h>
 #include <tbx/atomic_counter.h>
-#include <tbx/chksum.h>
 #include <tbx/fmttypes.h>
 #include <tbx/list.h>
 #include <tbx/log.h>
@@ -149,6 +148,11 @@ typedef struct {
     void **val;
     int *v_size;
     int *v_size_user;
+    lio_os_predicate_t *pred;   //** Only objects matching this are returned
+    int *pred_slot;             //** Attr list slot for each predicate key
+    void **val_caller;          //** With a predicate val/v_size are internal and these are the callers
+    int *v_size_caller;
+    int n_caller;
     int n_list;
     int v_fixed;
     int recurse_depth;
@@ -170,6 +174,18 @@ typedef struct {
     int recurse_depth;
 } osfile_remove_regex_op_t;
 
+typedef struct {
+    lio_object_service_fn_t *os;
+    lio_creds_t *creds;
+    lio_os_regex_table_t *rpath;
+    lio_os_regex_table_t *object_regex;
+    char *key;
+    lio_os_aggregate_t *agg;
+    tbx_atomic_unit32_t abort;
+    int obj_types;
+    int recurse_depth;
+} osfile_aggregate_op_t;
+
 typedef struct {
     lio_object_service_fn_t *os;
     lio_creds_t *creds;
@@ -260,6 +276,8 @@ gop_op_status_t osfile_close_object_fn(void *arg, int id);
 gop_op_generic_t *osfile_close_object(lio_object_service_fn_t *os, os_fd_t *fd);
 os_object_iter_t *osfile_create_object_iter(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types,
         lio_os_regex_table_t *attr,  int recurse_depth, os_attr_iter_t **it_attr, int v_max);
+os_object_iter_t *osfile_create_object_iter_alist(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types,
+        int recurse_depth, char **key, void **val, int *v_size, int n_keys);
 int osfile_next_object(os_object_iter_t *oit, char **fname, int *prefix_len);
 void osfile_destroy_object_iter(os_object_iter_t *it);
 gop_op_status_t osf_set_multiple_attr_fn(void *arg, int id);
@@ -762,9 +780,9 @@ void osf_multi_lock(lio_object_service_fn_t *os, lio_creds_t *creds, osfile_fd_t
         small_slot = -1;
         small_index = max_index;
         for (j=0; j<n; j++) {
-            if (small_index > lock_slot[i]) {
-                small_index = lock_slot[i];
-                small_slot = i;
+            if (small_index > lock_slot[j]) {
+                small_index = lock_slot[j];
+                small_slot = j;
             }
         }
 
@@ -1287,6 +1305,46 @@ int va_null_get_link_attr(lio_os_virtual_attr_t *va, lio_object_service_fn_t *os
     return(0);
 }
 
+//***********************************************************************
+//  osf_lock_hash - Fast non-cryptographic hash used for striping the
+//     internal locks.  Consumes the path 8 bytes at a time with a 64-bit
+//     multiply/rotate mix and finishes with a full avalanche so similar
+//     paths land in different slots.
+//***********************************************************************
+
+uint64_t osf_lock_hash(const char *path, int len)
+{
+    const uint64_t p1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t p2 = 0xC2B2AE3D27D4EB4FULL;
+    uint64_t h, k;
+    int i;
+
+    h = p2 ^ ((uint64_t)len * p1);
+
+    for (i=0; i+8 <= len; i+=8) {
+        memcpy(&k, path + i, 8);
+        k *= p2;
+        k = (k << 31) | (k >> 33);
+        k *= p1;
+        h ^= k;
+        h = ((h << 27) | (h >> 37)) * p1 + 0x85EBCA77C2B2AE63ULL;
+    }
+
+    //** Handle the tail
+    k = 0;
+    memcpy(&k, path + i, len - i);
+    h ^= k * p1;
+
+    //** Final avalanche
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+
+    return(h);
+}
+
 //***********************************************************************
 //  osf_retrieve_lock - Returns the internal lock for the object
 //***********************************************************************
@@ -1294,22 +1352,10 @@ int va_null_get_link_attr(lio_os_virtual_attr_t *va, lio_object_service_fn_t *os
 apr_thread_mutex_t *osf_retrieve_lock(lio_object_service_fn_t *os, char *path, int *table_slot)
 {
     lio_osfile_priv_t *osf = (lio_osfile_priv_t *)os->priv;
-    tbx_chksum_t cs;
-    char  digest[OSF_LOCK_CHKSUM_SIZE];
-    unsigned int *n;
-    int nbytes, slot;
-    tbx_tbuf_t tbuf;
-
-    nbytes = strlen(path);
-    tbx_tbuf_single(&tbuf, nbytes, path);
-    tbx_chksum_set(&cs, OSF_LOCK_CHKSUM);
-    tbx_chksum_add(&cs, nbytes, &tbuf, 0);
-    tbx_chksum_get(&cs, CHKSUM_DIGEST_BIN, digest);
-
-    n = (unsigned int *)(&digest[OSF_LOCK_CHKSUM_SIZE-sizeof(unsigned int)]);
-    slot = (*n) % osf->internal_lock_size;
-    log_printf(15, "n=%u internal_lock_size=%d slot=%d path=!%s!\n", *n, osf->internal_lock_size, slot, path);
-    tbx_log_flush();
+    int slot;
+
+    slot = osf_lock_hash(path, strlen(path)) & osf->internal_lock_mask;
+    log_printf(15, "internal_lock_size=%d slot=%d path=!%s!\n", osf->internal_lock_size, slot, path);
     if (table_slot != NULL) *table_slot = slot;
 
     return(osf->internal_lock[slot]);
@@ -1923,6 +1969,117 @@ gop_op_generic_t *osfile_abort_remove_regex_object(lio_object_service_fn_t *os,
     return(gop_tp_op_new(osf->tpc, NULL, osfile_abort_remove_regex_object_fn, tpop->arg, NULL, 1));
 }
 
+//***********************************************************************
+// osfile_aggregate_fn - Walks the objects tallying them and the attribute
+//   by depth.  Depth 0 are the objects matching the path itself.  Symlinks
+//   are only tallied if following them was requested.
+//***********************************************************************
+
+gop_op_status_t osfile_aggregate_fn(void *arg, int id)
+{
+    osfile_aggregate_op_t *op = (osfile_aggregate_op_t *)arg;
+    os_object_iter_t *it;
+    int prefix_len, count, ftype, depth, v_size, n_keys;
+    char *fname, *val, *p;
+    int64_t value;
+    gop_op_status_t status;
+
+    status = gop_success_status;
+
+    n_keys = (op->key != NULL) ? 1 : 0;
+    val = NULL;
+    v_size = -1024;
+    it = osfile_create_object_iter_alist(op->os, op->creds, op->rpath, op->object_regex, op->obj_types, op->recurse_depth, &(op->key), (void **)&val, &v_size, n_keys);
+    if (it == NULL) return(gop_failure_status);
+
+    count = 0;
+    while ((ftype = osfile_next_object(it, &fname, &prefix_len)) > 0) {
+        if ((ftype & OS_OBJECT_SYMLINK_FLAG) && ((op->obj_types & OS_OBJECT_FOLLOW_SYMLINK_FLAG) == 0)) goto next;
+
+        //** Count the path components past the prefix to get the depth
+        p = fname + prefix_len;
+        if (*p == '/') p++;
+        depth = 0;
+        for (; *p != 0; p++) {
+            if (*p == '/') depth++;
+        }
+
+        value = 0;
+        if (val != NULL) sscanf(val, I64T, &value);
+        lio_os_aggregate_add(op->agg, depth, ftype, (val != NULL) ? 1 : 0, value);
+
+next:
+        free(fname);
+        if (val != NULL) {
+            free(val);
+            val = NULL;
+        }
+        v_size = -1024;
+
+        count++;  //** Check for an abort
+        if (count == 1000) {
+            count = 0;
+            if (tbx_atomic_get(op->abort) != 0) {
+                status.op_status = OP_STATE_FAILURE;
+                break;
+            }
+        }
+    }
+
+    osfile_destroy_object_iter(it);
+
+    log_printf(5, "n_levels=%d status=%d\n", op->agg->n_levels, status.op_status);
+    return(status);
+}
+
+//***********************************************************************
+// osfile_aggregate - Tallies the matching objects and the key attribute
+//   per directory depth without returning the objects
+//***********************************************************************
+
+gop_op_generic_t *osfile_aggregate(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int obj_types, int recurse_depth, char *key, lio_os_aggregate_t *agg)
+{
+    lio_osfile_priv_t *osf = (lio_osfile_priv_t *)os->priv;
+    osfile_aggregate_op_t *op;
+
+    tbx_type_malloc_clear(op, osfile_aggregate_op_t, 1);
+
+    op->os = os;
+    op->creds = creds;
+    op->rpath = path;
+    op->object_regex = object_regex;
+    op->obj_types = obj_types;
+    op->recurse_depth = recurse_depth;
+    op->key = key;
+    op->agg = agg;
+    return(gop_tp_op_new(osf->tpc, NULL, osfile_aggregate_fn, (void *)op, free, 1));
+}
+
+//***********************************************************************
+// osfile_abort_aggregate_fn - Flags the aggregate to stop
+//***********************************************************************
+
+gop_op_status_t osfile_abort_aggregate_fn(void *arg, int id)
+{
+    osfile_aggregate_op_t *op = (osfile_aggregate_op_t *)arg;
+
+    tbx_atomic_set(op->abort, 1);
+
+    return(gop_success_status);
+}
+
+//***********************************************************************
+//  osfile_abort_aggregate - Aborts an ongoing aggregate operation
+//***********************************************************************
+
+gop_op_generic_t *osfile_abort_aggregate(lio_object_service_fn_t *os, gop_op_generic_t *gop)
+{
+    lio_osfile_priv_t *osf = (lio_osfile_priv_t *)os->priv;
+    gop_thread_pool_op_t *tpop = gop_get_tp(gop);
+
+    return(gop_tp_op_new(osf->tpc, NULL, osfile_abort_aggregate_fn, tpop->arg, NULL, 1));
+}
+
 //***********************************************************************
 // osfile_regex_object_set_multiple_attrs - Recursivley sets the fixed attibutes
 //***********************************************************************
@@ -3419,6 +3576,46 @@ void osfile_destroy_attr_iter(os_attr_iter_t *oit)
     free(it);
 }
 
+//***********************************************************************
+// osf_predicate_filter - Evaluates the iterator's predicate for the
+//   current object and cleans up the attributes.  On a match the
+//   callers values are returned otherwise they are freed.
+//***********************************************************************
+
+int osf_predicate_filter(osf_object_iter_t *it)
+{
+    lio_os_predicate_t *pred = it->pred;
+    void *pval[pred->n_keys];
+    int psize[pred->n_keys];
+    int i, match;
+
+    for (i=0; i<pred->n_keys; i++) {
+        pval[i] = it->val[it->pred_slot[i]];
+        psize[i] = it->v_size[it->pred_slot[i]];
+    }
+    match = os_predicate_eval(pred, pval, psize);
+
+    //** The extra predicate only attributes are always ours to free
+    for (i=it->n_caller; i<it->n_list; i++) {
+        if (it->val[i] != NULL) {
+            free(it->val[i]);
+            it->val[i] = NULL;
+        }
+    }
+
+    for (i=0; i<it->n_caller; i++) {
+        if (match) {
+            it->val_caller[i] = it->val[i];
+            it->v_size_caller[i] = it->v_size[i];
+        } else if ((it->v_size_user[i] < 0) && (it->val[i] != NULL)) {
+            free(it->val[i]);
+            it->val[i] = NULL;
+        }
+    }
+
+    return(match);
+}
+
 //***********************************************************************
 // osfile_next_object - Returns the iterators next matching object
 //***********************************************************************
@@ -3429,8 +3626,9 @@ int osfile_next_object(os_object_iter_t *oit, char **fname, int *prefix_len)
     osfile_open_op_t op;
     osfile_attr_op_t aop;
     gop_op_status_t status;
-    int ftype;
+    int ftype, i;
 
+again:
     ftype = osf_next_object(it, fname, prefix_len);
     log_printf(15, " MATCH=%s\n", *fname);
 
@@ -3462,6 +3660,7 @@ int osfile_next_object(os_object_iter_t *oit, char **fname, int *prefix_len)
                 *(it->it_attr) = osfile_create_attr_iter(it->os, it->creds, it->fd, it->attr, it->v_max);
             }
         } else if (it->n_list > 0) {  //** Fixed list mode
+            for (i=0; i<it->n_caller; i++) it->val[i] = it->val_caller[i];  //** Only non-zero with a predicate
             op.os = it->os;
             op.creds = it->creds;
             op.path = strdup(*fname);
@@ -3492,6 +3691,14 @@ int osfile_next_object(os_object_iter_t *oit, char **fname, int *prefix_len)
 
         }
 
+        if (it->pred != NULL) {
+            if (osf_predicate_filter(it) == 0) {  //** No match so try the next one
+                free(*fname);
+                *fname = NULL;
+                goto again;
+            }
+        }
+
         return(ftype);
     }
 
@@ -3597,6 +3804,59 @@ os_object_iter_t *osfile_create_object_iter_alist(lio_object_service_fn_t *os, l
     return(it);
 }
 
+//***********************************************************************
+// osfile_create_object_iter_predicate - Creates a fixed attr list iterator
+//  that only returns objects matching the predicate.  Any attributes the
+//  predicate needs are fetched alongside the callers.
+//***********************************************************************
+
+os_object_iter_t *osfile_create_object_iter_predicate(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types,
+        int recurse_depth, lio_os_predicate_t *pred, char **key, void **val, int *v_size, int n_keys)
+{
+    osf_object_iter_t *it;
+    int i, j, n;
+
+    if (pred == NULL) return(osfile_create_object_iter_alist(os, creds, path, object_regex, object_types, recurse_depth, key, val, v_size, n_keys));
+
+    it = osfile_create_object_iter(os, creds, path, object_regex, object_types, NULL, recurse_depth, NULL, 0);
+    if (it == NULL) return(NULL);
+
+    //** Merge the predicate keys into the callers list
+    n = n_keys + pred->n_keys;
+    tbx_type_malloc(it->key, char *, n);
+    tbx_type_malloc_clear(it->val, void *, n);
+    tbx_type_malloc_clear(it->v_size, int, n);
+    tbx_type_malloc(it->v_size_user, int, n);
+    tbx_type_malloc(it->pred_slot, int, pred->n_keys);
+
+    for (i=0; i<n_keys; i++) {
+        it->key[i] = key[i];
+        it->v_size_user[i] = v_size[i];
+    }
+
+    n = n_keys;
+    for (j=0; j<pred->n_keys; j++) {
+        for (i=0; i<n_keys; i++) {
+            if (strcmp(key[i], pred->key[j]) == 0) break;
+        }
+        if (i == n_keys) {  //** Not one of the callers so add it
+            i = n;
+            it->key[i] = pred->key[j];
+            it->v_size_user[i] = -1024;
+            n++;
+        }
+        it->pred_slot[j] = i;
+    }
+
+    it->pred = pred;
+    it->n_list = n;
+    it->n_caller = n_keys;
+    it->val_caller = val;
+    it->v_size_caller = v_size;
+
+    return(it);
+}
+
 //***********************************************************************
 // osfile_destroy_object_iter - Destroy the object iterator
 //***********************************************************************
@@ -3632,6 +3892,12 @@ void osfile_destroy_object_iter(os_object_iter_t *oit)
     }
 
     if (it->v_size_user != NULL) free(it->v_size_user);
+    if (it->pred != NULL) {  //** These are only ours with a predicate
+        free(it->key);
+        free(it->val);
+        free(it->v_size);
+        free(it->pred_slot);
+    }
 
     if (it->object_types & OS_OBJECT_FOLLOW_SYMLINK_FLAG) { //** Following symlinks so cleanup
         for (hi = apr_hash_first(NULL, it->symlink_loop); hi != NULL; hi = apr_hash_next(hi)) {
@@ -4205,12 +4471,12 @@ lio_object_service_fn_t *object_service_file_create(lio_service_manager_t *ess,
         osf->osaz = (*osaz_create)(ess, NULL, NULL, os);
         authn_create = lio_lookup_service(ess, AUTHN_AVAILABLE, AUTHN_TYPE_FAKE);
         osf->authn = (*authn_create)(ess, NULL, NULL);
-        osf->internal_lock_size = 200;
+        osf->internal_lock_size = 1024;
         osf->max_copy = 1024*1024;
         osf->hardlink_dir_size = 256;
     } else {
         osf->base_path = tbx_inip_get_string(fd, section, "base_path", "./osfile");
-        osf->internal_lock_size = tbx_inip_get_integer(fd, section, "lock_table_size", 200);
+        osf->internal_lock_size = tbx_inip_get_integer(fd, section, "lock_table_size", 1024);
         osf->max_copy = tbx_inip_get_integer(fd, section, "max_copy", 1024*1024);
         osf->hardlink_dir_size = tbx_inip_get_integer(fd, section, "hardlink_dir_size", 256);
         asection = tbx_inip_get_string(fd, section, "authz", NULL);
@@ -4248,6 +4514,11 @@ lio_object_service_fn_t *object_service_file_create(lio_service_manager_t *ess,
     osf->hardlink_path = strdup(pname);
     osf->hardlink_path_len = strlen(osf->hardlink_path);
 
+    //** Round the lock table up to a power of 2 so the slot is just a mask
+    for (i=1; i<osf->internal_lock_size; i <<= 1) {}
+    osf->internal_lock_size = i;
+    osf->internal_lock_mask = i - 1;
+
     apr_pool_create(&osf->mpool, NULL);
     tbx_type_malloc_clear(osf->internal_lock, apr_thread_mutex_t *, osf->internal_lock_size);
     for (i=0; i<osf->internal_lock_size; i++) {
@@ -4350,6 +4621,7 @@ lio_object_service_fn_t *object_service_file_create(lio_service_manager_t *ess,
     os->hardlink_object = osfile_hardlink_object;
     os->create_object_iter = osfile_create_object_iter;
     os->create_object_iter_alist = osfile_create_object_iter_alist;
+    os->create_object_iter_predicate = osfile_create_object_iter_predicate;
     os->next_object = osfile_next_object;
     os->destroy_object_iter = osfile_destroy_object_iter;
     os->open_object = osfile_open_object;
@@ -4375,6 +4647,8 @@ lio_object_service_fn_t *object_service_file_create(lio_service_manager_t *ess,
     os->destroy_fsck_iter = osfile_destroy_fsck_iter;
     os->next_fsck = osfile_next_fsck;
     os->fsck_object = osfile_fsck_object;
+    os->aggregate = osfile_aggregate;
+    os->abort_aggregate = osfile_abort_aggregate;
 
     //** Check if everything is copacetic with the root dir
     if (lio_os_local_filetype(osf->base_path) <= 0) {
@@ -21,8 +21,6 @@
 #ifndef _OS_FILE_H_
 #define _OS_FILE_H_
 
-#include <openssl/md5.h>
-#include <tbx/chksum.h>
 #include <tbx/fmttypes.h>
 #include <tbx/iniparse.h>
 
@@ -54,14 +52,13 @@ int osf_store_val(void *src, int src_size, void **dest, int *v_size);
 #define FILE_ATTR_PREFIX_LEN 6
 
 #define DIR_PERMS S_IRWXU|S_IRGRP|S_IXGRP|S_IROTH|S_IXOTH
-#define OSF_LOCK_CHKSUM CHKSUM_MD5
-#define OSF_LOCK_CHKSUM_SIZE MD5_DIGEST_LENGTH
 
 struct lio_osfile_priv_t {
     int base_path_len;
     int file_path_len;
     int hardlink_path_len;
     int internal_lock_size;
+    int internal_lock_mask;
     int hardlink_dir_size;
     tbx_atomic_unit32_t hardlink_count;
     char *base_path;
@@ -0,0 +1,525 @@
+/*
+   Copyright 2016 Vanderbilt University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+//***********************************************************************
+// Attribute predicates evaluated by the object iterators.  Expressions
+// look like
+//
+//     system.exnode.size > 1000000 && (user.tag == "scratch" || !user.keep)
+//
+// A bare key tests for the attribute's existence.  If the constant is an
+// integer the attribute's leading integer is compared, otherwise it's a
+// string comparison.  Comparisons against a missing attribute are false.
+// The expression is compiled to postfix so it's cheap to ship to the
+// server and evaluate for every object.
+//***********************************************************************
+
+#define _log_module_index 101
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tbx/log.h>
+#include <tbx/type_malloc.h>
+#include <tbx/varint.h>
+
+#include "os.h"
+
+typedef struct {
+    const char *expr;
+    const char *pos;
+    lio_os_predicate_t *p;
+    int max_nodes;
+    int max_keys;
+    int err;
+} pred_parse_t;
+
+int _pred_parse_or(pred_parse_t *pp);
+
+//***********************************************************************
+// _pred_key_index - Returns the key's slot adding it if needed
+//***********************************************************************
+
+int _pred_key_index(pred_parse_t *pp, const char *key, int len)
+{
+    lio_os_predicate_t *p = pp->p;
+    int i;
+
+    for (i=0; i<p->n_keys; i++) {
+        if ((strncmp(p->key[i], key, len) == 0) && (p->key[i][len] == 0)) return(i);
+    }
+
+    if (p->n_keys == pp->max_keys) {
+        pp->max_keys = 2*pp->max_keys + 4;
+        tbx_type_realloc(p->key, char *, pp->max_keys);
+    }
+    p->key[p->n_keys] = strndup(key, len);
+    p->n_keys++;
+
+    return(p->n_keys-1);
+}
+
+//***********************************************************************
+// _pred_add_node - Appends a node to the postfix program
+//***********************************************************************
+
+lio_os_pred_node_t *_pred_add_node(pred_parse_t *pp, int op)
+{
+    lio_os_predicate_t *p = pp->p;
+    lio_os_pred_node_t *n;
+
+    if (p->n_nodes == pp->max_nodes) {
+        pp->max_nodes = 2*pp->max_nodes + 8;
+        tbx_type_realloc(p->node, lio_os_pred_node_t, pp->max_nodes);
+    }
+    n = &(p->node[p->n_nodes]);
+    memset(n, 0, sizeof(lio_os_pred_node_t));
+    n->op = op;
+    n->key = -1;
+    p->n_nodes++;
+
+    return(n);
+}
+
+//***********************************************************************
+// _pred_skip_ws - Skips over any whitespace
+//***********************************************************************
+
+void _pred_skip_ws(pred_parse_t *pp)
+{
+    while (isspace(*pp->pos)) pp->pos++;
+}
+
+//***********************************************************************
+// _pred_word_char - Returns 1 if the char can be part of a bare word
+//***********************************************************************
+
+int _pred_word_char(char c)
+{
+    if ((c == 0) || isspace(c)) return(0);
+    return((strchr("()!<>=&|\"", c) == NULL) ? 1 : 0);
+}
+
+//***********************************************************************
+// _pred_parse_value - Parses a quoted or bare constant
+//***********************************************************************
+
+int _pred_parse_value(pred_parse_t *pp, lio_os_pred_node_t *n)
+{
+    const char *start;
+    char *end;
+    int len;
+
+    _pred_skip_ws(pp);
+    if (*pp->pos == '"') {  //** Quoted string so it's never numeric
+        start = pp->pos + 1;
+        for (pp->pos = start; (*pp->pos != '"') && (*pp->pos != 0); pp->pos++) {}
+        if (*pp->pos != '"') return(1);
+        len = pp->pos - start;
+        pp->pos++;
+        n->value = strndup(start, len);
+        return(0);
+    }
+
+    start = pp->pos;
+    while (_pred_word_char(*pp->pos)) pp->pos++;
+    len = pp->pos - start;
+    if (len == 0) return(1);
+    n->value = strndup(start, len);
+
+    errno = 0;
+    n->num = strtoll(n->value, &end, 0);
+    if ((errno == 0) && (*end == 0)) n->is_num = 1;
+
+    return(0);
+}
+
+//***********************************************************************
+// _pred_parse_cmp - Parses a comparison or existence test
+//***********************************************************************
+
+int _pred_parse_cmp(pred_parse_t *pp)
+{
+    lio_os_pred_node_t *n;
+    const char *start;
+    int key, op, len;
+
+    _pred_skip_ws(pp);
+    start = pp->pos;
+    while (_pred_word_char(*pp->pos)) pp->pos++;
+    len = pp->pos - start;
+    if (len == 0) return(1);
+    key = _pred_key_index(pp, start, len);
+
+    _pred_skip_ws(pp);
+    if (strncmp(pp->pos, "==", 2) == 0) {
+        op = OS_PRED_EQ; pp->pos += 2;
+    } else if (strncmp(pp->pos, "!=", 2) == 0) {
+        op = OS_PRED_NE; pp->pos += 2;
+    } else if (strncmp(pp->pos, "<=", 2) == 0) {
+        op = OS_PRED_LE; pp->pos += 2;
+    } else if (strncmp(pp->pos, ">=", 2) == 0) {
+        op = OS_PRED_GE; pp->pos += 2;
+    } else if (*pp->pos == '<') {
+        op = OS_PRED_LT; pp->pos++;
+    } else if (*pp->pos == '>') {
+        op = OS_PRED_GT; pp->pos++;
+    } else if ((*pp->pos == '=') && (pp->pos[1] != '=')) {
+        op = OS_PRED_EQ; pp->pos++;
+    } else {
+        op = OS_PRED_EXISTS;
+    }
+
+    n = _pred_add_node(pp, op);
+    n->key = key;
+    if (op == OS_PRED_EXISTS) return(0);
+
+    return(_pred_parse_value(pp, n));
+}
+
+//***********************************************************************
+// _pred_parse_unary - Handles negation and sub expressions
+//***********************************************************************
+
+int _pred_parse_unary(pred_parse_t *pp)
+{
+    _pred_skip_ws(pp);
+
+    if ((*pp->pos == '!') && (pp->pos[1] != '=')) {
+        pp->pos++;
+        if (_pred_parse_unary(pp) != 0) return(1);
+        _pred_add_node(pp, OS_PRED_NOT);
+        return(0);
+    } else if (*pp->pos == '(') {
+        pp->pos++;
+        if (_pred_parse_or(pp) != 0) return(1);
+        _pred_skip_ws(pp);
+        if (*pp->pos != ')') return(1);
+        pp->pos++;
+        return(0);
+    }
+
+    return(_pred_parse_cmp(pp));
+}
+
+//***********************************************************************
+// _pred_parse_and - Parses a chain of &&'s
+//***********************************************************************
+
+int _pred_parse_and(pred_parse_t *pp)
+{
+    if (_pred_parse_unary(pp) != 0) return(1);
+
+    _pred_skip_ws(pp);
+    while (strncmp(pp->pos, "&&", 2) == 0) {
+        pp->pos += 2;
+        if (_pred_parse_unary(pp) != 0) return(1);
+        _pred_add_node(pp, OS_PRED_AND);
+        _pred_skip_ws(pp);
+    }
+
+    return(0);
+}
+
+//***********************************************************************
+// _pred_parse_or - Parses a chain of ||'s
+//***********************************************************************
+
+int _pred_parse_or(pred_parse_t *pp)
+{
+    if (_pred_parse_and(pp) != 0) return(1);
+
+    _pred_skip_ws(pp);
+    while (strncmp(pp->pos, "||", 2) == 0) {
+        pp->pos += 2;
+        if (_pred_parse_and(pp) != 0) return(1);
+        _pred_add_node(pp, OS_PRED_OR);
+        _pred_skip_ws(pp);
+    }
+
+    return(0);
+}
+
+//***********************************************************************
+// lio_os_predicate_parse - Compiles the expression.  Returns NULL on a
+//   syntax error.
+//***********************************************************************
+
+lio_os_predicate_t *lio_os_predicate_parse(const char *expr)
+{
+    pred_parse_t pp;
+    int err;
+
+    memset(&pp, 0, sizeof(pp));
+    pp.expr = expr;
+    pp.pos = expr;
+    tbx_type_malloc_clear(pp.p, lio_os_predicate_t, 1);
+
+    err = _pred_parse_or(&pp);
+    _pred_skip_ws(&pp);
+    if ((err != 0) || (*pp.pos != 0) || (pp.p->n_nodes == 0)) {
+        log_printf(0, "ERROR: Bad predicate at offset %d: %s\n", (int)(pp.pos - expr), expr);
+        lio_os_predicate_destroy(pp.p);
+        return(NULL);
+    }
+
+    return(pp.p);
+}
+
+//***********************************************************************
+// lio_os_predicate_destroy - Destroys the predicate
+//***********************************************************************
+
+void lio_os_predicate_destroy(lio_os_predicate_t *p)
+{
+    int i;
+
+    for (i=0; i<p->n_keys; i++) free(p->key[i]);
+    for (i=0; i<p->n_nodes; i++) {
+        if (p->node[i].value != NULL) free(p->node[i].value);
+    }
+    if (p->key != NULL) free(p->key);
+    if (p->node != NULL) free(p->node);
+    free(p);
+}
+
+//***********************************************************************
+// os_predicate_pack - Packs the predicate into the buffer and returns
+//   the number of chars used or a negative value representing the needed space
+//***********************************************************************
+
+int os_predicate_pack(lio_os_predicate_t *p, unsigned char *buffer, int bufsize)
+{
+    lio_os_pred_node_t *n;
+    unsigned char tbuf[32];
+    int i, bpos, len;
+
+    //** Just figure out the size first
+    bpos = tbx_zigzag_encode(p->n_keys, tbuf);
+    for (i=0; i<p->n_keys; i++) {
+        len = strlen(p->key[i]);
+        bpos += tbx_zigzag_encode(len, tbuf) + len;
+    }
+    bpos += tbx_zigzag_encode(p->n_nodes, tbuf);
+    for (i=0; i<p->n_nodes; i++) {
+        n = &(p->node[i]);
+        len = (n->value) ? strlen(n->value) : 0;
+        bpos += tbx_zigzag_encode(n->op, tbuf) + tbx_zigzag_encode(n->key, tbuf) + tbx_zigzag_encode(n->is_num, tbuf);
+        bpos += tbx_zigzag_encode(len, tbuf) + len;
+    }
+    if (bpos > bufsize) return(-bpos);
+
+    //** Now actually pack it.  The numeric flag is sent explicitly since a quoted
+    //** constant that looks like a number still has to compare as a string.
+    bpos = tbx_zigzag_encode(p->n_keys, buffer);
+    for (i=0; i<p->n_keys; i++) {
+        len = strlen(p->key[i]);
+        bpos += tbx_zigzag_encode(len, &(buffer[bpos]));
+        memcpy(&(buffer[bpos]), p->key[i], len);
+        bpos += len;
+    }
+    bpos += tbx_zigzag_encode(p->n_nodes, &(buffer[bpos]));
+    for (i=0; i<p->n_nodes; i++) {
+        n = &(p->node[i]);
+        len = (n->value) ? strlen(n->value) : 0;
+        bpos += tbx_zigzag_encode(n->op, &(buffer[bpos]));
+        bpos += tbx_zigzag_encode(n->key, &(buffer[bpos]));
+        bpos += tbx_zigzag_encode(n->is_num, &(buffer[bpos]));
+        bpos += tbx_zigzag_encode(len, &(buffer[bpos]));
+        if (len > 0) memcpy(&(buffer[bpos]), n->value, len);
+        bpos += len;
+    }
+
+    return(bpos);
+}
+
+//***********************************************************************
+// os_predicate_unpack - UnPacks a predicate from the buffer and returns
+//   it along with the number of characters used.  NULL is returned on error.
+//***********************************************************************
+
+lio_os_predicate_t *os_predicate_unpack(unsigned char *buffer, int bufsize, int *used)
+{
+    lio_os_predicate_t *p;
+    lio_os_pred_node_t *node;
+    int64_t n_keys, n_nodes, len, op, key, is_num;
+    char *end;
+    int i, n, bpos, depth;
+
+    *used = 0;
+    bpos = 0;
+
+    n = tbx_zigzag_decode(buffer, bufsize, &n_keys);
+    if ((n < 0) || (n_keys < 0) || (n_keys > bufsize)) return(NULL);
+    bpos += n;
+
+    tbx_type_malloc_clear(p, lio_os_predicate_t, 1);
+    tbx_type_malloc_clear(p->key, char *, n_keys+1);
+    for (i=0; i<n_keys; i++) {
+        n = tbx_zigzag_decode(&(buffer[bpos]), bufsize-bpos, &len);
+        if ((n < 0) || (len < 0)) goto fail;
+        bpos += n;
+        if ((bpos + len) > bufsize) goto fail;
+        p->key[i] = strndup((char *)&(buffer[bpos]), len);
+        p->n_keys++;
+        bpos += len;
+    }
+
+    n = tbx_zigzag_decode(&(buffer[bpos]), bufsize-bpos, &n_nodes);
+    if ((n < 0) || (n_nodes <= 0) || (n_nodes > bufsize)) goto fail;
+    bpos += n;
+
+    tbx_type_malloc_clear(p->node, lio_os_pred_node_t, n_nodes);
+    depth = 0;
+    for (i=0; i<n_nodes; i++) {
+        node = &(p->node[i]);
+        p->n_nodes++;
+        n = tbx_zigzag_decode(&(buffer[bpos]), bufsize-bpos, &op);
+        if (n < 0) goto fail;
+        bpos += n;
+        n = tbx_zigzag_decode(&(buffer[bpos]), bufsize-bpos, &key);
+        if (n < 0) goto fail;
+        bpos += n;
+        n = tbx_zigzag_decode(&(buffer[bpos]), bufsize-bpos, &is_num);
+        if ((n < 0) || (is_num < 0) || (is_num > 1)) goto fail;
+        bpos += n;
+        n = tbx_zigzag_decode(&(buffer[bpos]), bufsize-bpos, &len);
+        if ((n < 0) || (len < 0)) goto fail;
+        bpos += n;
+        if ((bpos + len) > bufsize) goto fail;
+
+        node->op = op;
+        node->key = key;
+        if (len > 0) {
+            node->value = strndup((char *)&(buffer[bpos]), len);
+            if (is_num) {
+                errno = 0;
+                node->num = strtoll(node->value, &end, 0);
+                if ((errno != 0) || (*end != 0)) goto fail;
+                node->is_num = 1;
+            }
+        }
+        bpos += len;
+        if ((is_num) && (node->is_num == 0)) goto fail;
+
+        //** Sanity check the program so eval can't go off the rails
+        if ((op >= OS_PRED_EXISTS) && (op <= OS_PRED_GE)) {
+            if ((key < 0) || (key >= n_keys)) goto fail;
+            if ((op != OS_PRED_EXISTS) && (node->value == NULL)) goto fail;
+            depth++;
+        } else if ((op == OS_PRED_AND) || (op == OS_PRED_OR)) {
+            if (depth < 2) goto fail;
+            depth--;
+        } else if (op == OS_PRED_NOT) {
+            if (depth < 1) goto fail;
+        } else {
+            goto fail;
+        }
+    }
+    if (depth != 1) goto fail;
+
+    *used = bpos;
+    return(p);
+
+fail:
+    log_printf(0, "ERROR: Corrupt predicate! bpos=%d bufsize=%d\n", bpos, bufsize);
+    lio_os_predicate_destroy(p);
+    return(NULL);
+}
+
+//***********************************************************************
+// _pred_compare - Does a single comparison
+//***********************************************************************
+
+int _pred_compare(lio_os_pred_node_t *n, char *val, int v_size)
+{
+    char buf[1024];
+    char *end;
+    int64_t ival;
+    int cmp, len;
+
+    if (n->op == OS_PRED_EXISTS) return((v_size > 0) ? 1 : 0);
+    if ((v_size <= 0) || (val == NULL)) return(0);
+
+    //** Make sure we have a NULL terminated copy
+    len = (v_size < (int)sizeof(buf)) ? v_size : (int)sizeof(buf)-1;
+    memcpy(buf, val, len);
+    buf[len] = 0;
+
+    if (n->is_num) {
+        errno = 0;
+        ival = strtoll(buf, &end, 0);
+        if ((errno != 0) || (end == buf)) return(0);
+        cmp = (ival < n->num) ? -1 : ((ival > n->num) ? 1 : 0);
+    } else {
+        cmp = strcmp(buf, n->value);
+    }
+
+    switch (n->op) {
+    case OS_PRED_EQ:
+        return(cmp == 0);
+    case OS_PRED_NE:
+        return(cmp != 0);
+    case OS_PRED_LT:
+        return(cmp < 0);
+    case OS_PRED_LE:
+        return(cmp <= 0);
+    case OS_PRED_GT:
+        return(cmp > 0);
+    case OS_PRED_GE:
+        return(cmp >= 0);
+    }
+
+    return(0);
+}
+
+//***********************************************************************
+// os_predicate_eval - Evaluates the predicate.  val/v_size are indexed
+//   by the predicate's key slots.  Returns 1 if the object matches.
+//***********************************************************************
+
+int os_predicate_eval(lio_os_predicate_t *p, void **val, int *v_size)
+{
+    lio_os_pred_node_t *n;
+    int stack[p->n_nodes];
+    int i, sp;
+
+    sp = 0;
+    for (i=0; i<p->n_nodes; i++) {
+        n = &(p->node[i]);
+        switch (n->op) {
+        case OS_PRED_AND:
+            sp--;
+            stack[sp-1] = stack[sp-1] && stack[sp];
+            break;
+        case OS_PRED_OR:
+            sp--;
+            stack[sp-1] = stack[sp-1] || stack[sp];
+            break;
+        case OS_PRED_NOT:
+            stack[sp-1] = !stack[sp-1];
+            break;
+        default:
+            stack[sp] = _pred_compare(n, val[n->key], v_size[n->key]);
+            sp++;
+        }
+    }
+
+    return(stack[0]);
+}
@@ -78,6 +78,8 @@ lio_object_service_fn_t *object_service_remote_client_create(lio_service_manager
 #define OSR_OBJECT_ITER_ALIST_SIZE  20
 #define OSR_OBJECT_ITER_AREGEX_KEY  "os_object_iter_aregex"
 #define OSR_OBJECT_ITER_AREGEX_SIZE  21
+#define OSR_OBJECT_ITER_PRED_KEY    "os_object_iter_pred"
+#define OSR_OBJECT_ITER_PRED_SIZE   19
 #define OSR_ATTR_ITER_KEY           "os_attr_iter"
 #define OSR_ATTR_ITER_SIZE          12
 #define OSR_FSCK_ITER_KEY           "os_fsck_iter"
@@ -86,6 +88,10 @@ lio_object_service_fn_t *object_service_remote_client_create(lio_service_manager
 #define OSR_FSCK_OBJECT_SIZE        14
 #define OSR_SPIN_HB_KEY             "os_spin_hb"
 #define OSR_SPIN_HB_SIZE            10
+#define OSR_AGGREGATE_KEY           "os_aggregate"
+#define OSR_AGGREGATE_SIZE          12
+#define OSR_ABORT_AGGREGATE_KEY     "os_abort_aggregate"
+#define OSR_ABORT_AGGREGATE_SIZE    18
 
 //** Types of ongoing objects stored
 #define OSR_ONGOING_FD_TYPE    0
@@ -116,6 +122,7 @@ struct lio_osrs_priv_t {
     lio_creds_t *dummy_creds;       //** Dummy creds. Should be replaced when proper AuthN/AuthZ is added
     char *fname_active;         //** Filename for logging ACTIVE operations.
     char *fname_activity;       //** Filename for logging create/remove/move operations.
+    char *pack_preferred;       //** Stream pack types in order of preference
 };
 
 struct lio_osrc_priv_t {
@@ -132,6 +132,18 @@ typedef struct {
     uint64_t my_id;
 } osrc_remove_regex_t;
 
+typedef struct {
+    lio_object_service_fn_t *os;
+    lio_creds_t *creds;
+    lio_os_regex_table_t *path;
+    lio_os_regex_table_t *object_regex;
+    char *key;
+    lio_os_aggregate_t *agg;
+    int obj_types;
+    int recurse_depth;
+    uint64_t my_id;
+} osrc_aggregate_t;
+
 typedef struct {
     lio_object_service_fn_t *os;
     lio_creds_t *creds;
@@ -409,6 +421,210 @@ gop_op_generic_t *osrc_abort_remove_regex_object(lio_object_service_fn_t *os, go
     return(g);
 }
 
+//***********************************************************************
+// osrc_response_aggregate - Handles the aggregate response
+//***********************************************************************
+
+gop_op_status_t osrc_response_aggregate(void *task_arg, int tid)
+{
+    gop_mq_task_t *task = (gop_mq_task_t *)task_arg;
+    osrc_aggregate_t *op = (osrc_aggregate_t *)task->arg;
+    lio_osrc_priv_t *osrc = (lio_osrc_priv_t *)op->os->priv;
+    lio_os_agg_level_t level;
+    gop_mq_stream_t *mqs;
+    gop_op_status_t status;
+    int err, i, j, n_levels, nbins;
+
+    log_printf(5, "START\n");
+
+    //** Parse the response
+    gop_mq_remove_header(task->response, 1);
+
+    mqs = gop_mq_stream_read_create(osrc->mqc, osrc->ongoing, osrc->host_id, osrc->host_id_len, gop_mq_msg_first(task->response), osrc->remote_host, osrc->stream_timeout);
+
+    //** Parse the status
+    status.op_status = gop_mq_stream_read_varint(mqs, &err);
+    status.error_code = gop_mq_stream_read_varint(mqs, &err);
+    if (err != 0) status = gop_failure_status;
+    if (status.op_status != OP_STATE_SUCCESS) goto fail;
+
+    //** Now get the tallies.  The server may have used a different max depth so fold them if needed.
+    n_levels = gop_mq_stream_read_varint(mqs, &err);
+    for (i=0; (i<n_levels) && (err == 0); i++) {
+        memset(&level, 0, sizeof(level));
+        level.n_objects = gop_mq_stream_read_varint(mqs, &err);
+        level.n_dirs = gop_mq_stream_read_varint(mqs, &err);
+        level.n_values = gop_mq_stream_read_varint(mqs, &err);
+        level.sum = gop_mq_stream_read_varint(mqs, &err);
+        nbins = gop_mq_stream_read_varint(mqs, &err);
+        if ((nbins < 0) || (nbins > OS_AGG_HIST_BINS)) {
+            err = 1;
+            break;
+        }
+        for (j=0; j<nbins; j++) level.hist[j] = gop_mq_stream_read_varint(mqs, &err);
+
+        j = (i > op->agg->max_depth) ? op->agg->max_depth : i;
+        if (j >= op->agg->n_levels) op->agg->n_levels = j + 1;
+        op->agg->level[j].n_objects += level.n_objects;
+        op->agg->level[j].n_dirs += level.n_dirs;
+        op->agg->level[j].n_values += level.n_values;
+        op->agg->level[j].sum += level.sum;
+        for (nbins=0; nbins<OS_AGG_HIST_BINS; nbins++) op->agg->level[j].hist[nbins] += level.hist[nbins];
+    }
+
+    if (err != 0) status = gop_failure_status;
+
+fail:
+    gop_mq_stream_destroy(mqs);
+
+    log_printf(5, "END status=%d %d\n", status.op_status, status.error_code);
+
+    return(status);
+}
+
+//***********************************************************************
+// osrc_aggregate_func - Sends the aggregate request and waits for the
+//   tallies sending spin heartbeats while the server walks the objects
+//***********************************************************************
+
+gop_op_status_t osrc_aggregate_func(void *arg, int id)
+{
+    osrc_aggregate_t *op = (osrc_aggregate_t *)arg;
+    lio_osrc_priv_t *osrc = (lio_osrc_priv_t *)op->os->priv;
+    int bpos, bufsize, again, n, klen;
+    unsigned char *buffer;
+    mq_msg_t *msg, *spin;
+    gop_op_generic_t *gop, *g;
+    gop_op_status_t status;
+
+    log_printf(5, "START\n");
+
+    //** Form the message
+    msg = gop_mq_make_exec_core_msg(osrc->remote_host, 1);
+    gop_mq_msg_append_mem(msg, OSR_AGGREGATE_KEY, OSR_AGGREGATE_SIZE, MQF_MSG_KEEP_DATA);
+    gop_mq_msg_append_mem(msg, osrc->host_id, osrc->host_id_len, MQF_MSG_KEEP_DATA);
+    osrc_add_creds(op->os, op->creds, msg);
+
+    klen = (op->key != NULL) ? strlen(op->key) : 0;
+    bufsize = 4096 + klen;
+    tbx_type_malloc(buffer, unsigned char, bufsize);
+    do {
+        again = 0;
+        bpos = 0;
+
+        bpos += tbx_zigzag_encode(osrc->timeout, buffer);
+        bpos += tbx_zigzag_encode(sizeof(op->my_id), &(buffer[bpos]));
+        memcpy(&(buffer[bpos]), &(op->my_id), sizeof(op->my_id));
+        bpos += sizeof(op->my_id);
+        bpos += tbx_zigzag_encode(osrc->spin_fail, &(buffer[bpos]));
+        bpos += tbx_zigzag_encode(op->recurse_depth, &(buffer[bpos]));
+        bpos += tbx_zigzag_encode(op->obj_types, &(buffer[bpos]));
+        bpos += tbx_zigzag_encode(op->agg->max_depth, &(buffer[bpos]));
+        bpos += tbx_zigzag_encode(klen, &(buffer[bpos]));
+        if (klen > 0) memcpy(&(buffer[bpos]), op->key, klen);
+        bpos += klen;
+
+        n = os_regex_table_pack(op->path, &(buffer[(again==0) ? bpos : 0]), bufsize-bpos);
+        if (n < 0) {
+            again = 1;
+            n = -n;
+        }
+        bpos += n;
+
+        n = os_regex_table_pack(op->object_regex, &(buffer[(again==0) ? bpos : 0]), bufsize-bpos);
+        if (n < 0) {
+            again = 1;
+            n = -n;
+        }
+        bpos += n;
+
+        if (again == 1) {
+            bufsize = bpos + 10;
+            free(buffer);
+            tbx_type_malloc(buffer, unsigned char, bufsize);
+        }
+    } while (again == 1);
+
+    gop_mq_msg_append_mem(msg, buffer, bpos, MQF_MSG_AUTO_FREE);
+    gop_mq_msg_append_mem(msg, NULL, 0, MQF_MSG_KEEP_DATA);
+
+    //** Make the gop and submit it
+    gop = gop_mq_op_new(osrc->mqc, msg, osrc_response_aggregate, op, NULL, osrc->timeout);
+    gop_start_execution(gop);
+
+    //** Wait for it to complete Sending hearbeats as needed
+    while ((g = gop_waitany_timed(gop, osrc->spin_interval)) == NULL) {
+        spin = gop_mq_make_exec_core_msg(osrc->remote_host, 0);
+        gop_mq_msg_append_mem(spin, OSR_SPIN_HB_KEY, OSR_SPIN_HB_SIZE, MQF_MSG_KEEP_DATA);
+        gop_mq_msg_append_mem(spin, osrc->host_id, osrc->host_id_len, MQF_MSG_KEEP_DATA);
+        osrc_add_creds(op->os, op->creds, spin);
+        gop_mq_msg_append_mem(spin, &(op->my_id), sizeof(op->my_id), MQF_MSG_KEEP_DATA);
+
+        g = gop_mq_op_new(osrc->mqc, spin, NULL, NULL, NULL, osrc->timeout);
+        gop_set_auto_destroy(g, 1);
+        gop_start_execution(g);
+    }
+
+    gop_waitall(gop);
+    status = gop_get_status(gop);
+    gop_free(gop, OP_DESTROY);
+
+    log_printf(5, "END status=%d\n", status.op_status);
+
+    return(status);
+}
+
+//***********************************************************************
+// osrc_aggregate - Has the remote server tally the matching objects and
+//   the key attribute per depth instead of streaming back every object
+//***********************************************************************
+
+gop_op_generic_t *osrc_aggregate(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int obj_types, int recurse_depth, char *key, lio_os_aggregate_t *agg)
+{
+    lio_osrc_priv_t *osrc = (lio_osrc_priv_t *)os->priv;
+    osrc_aggregate_t *op;
+
+    tbx_type_malloc(op, osrc_aggregate_t, 1);
+    op->os = os;
+    op->creds = creds;
+    op->path = path;
+    op->object_regex = object_regex;
+    op->obj_types = obj_types;
+    op->recurse_depth = recurse_depth;
+    op->key = key;
+    op->agg = agg;
+    op->my_id = 0;
+    tbx_random_get_bytes(&(op->my_id), sizeof(op->my_id));
+
+    return(gop_tp_op_new(osrc->tpc, NULL, osrc_aggregate_func, (void *)op, free, 1));
+}
+
+//***********************************************************************
+// osrc_abort_aggregate - Aborts an ongoing aggregate call
+//***********************************************************************
+
+gop_op_generic_t *osrc_abort_aggregate(lio_object_service_fn_t *os, gop_op_generic_t *gop)
+{
+    lio_osrc_priv_t *osrc = (lio_osrc_priv_t *)os->priv;
+    osrc_aggregate_t *op;
+    mq_msg_t *msg;
+
+    log_printf(5, "START\n");
+    op = gop_get_private(gop);
+
+    //** Form the message.  The server finds the walk using the spin heartbeat ID
+    msg = gop_mq_make_exec_core_msg(osrc->remote_host, 1);
+    gop_mq_msg_append_mem(msg, OSR_ABORT_AGGREGATE_KEY, OSR_ABORT_AGGREGATE_SIZE, MQF_MSG_KEEP_DATA);
+    gop_mq_msg_append_mem(msg, osrc->host_id, osrc->host_id_len, MQF_MSG_KEEP_DATA);
+    osrc_add_creds(os, op->creds, msg);
+    gop_mq_msg_append_mem(msg, &(op->my_id), sizeof(op->my_id), MQF_MSG_KEEP_DATA);
+    gop_mq_msg_append_mem(msg, NULL, 0, MQF_MSG_KEEP_DATA);
+
+    log_printf(5, "END\n");
+
+    return(gop_mq_op_new(osrc->mqc, msg, osrc_response_status, NULL, NULL, osrc->timeout));
+}
+
 //***********************************************************************
 // osrc_remove_object - Makes a remove object operation
 //***********************************************************************
@@ -1887,13 +2103,13 @@ os_object_iter_t *osrc_create_object_iter(lio_object_service_fn_t *os, lio_creds
 }
 
 //***********************************************************************
-// osrc_create_object_iter_alist - Creates an object iterator to selectively
-//  retreive object/attribute from a fixed attr list
-//
+// _osrc_object_iter_alist - Creates an object iterator to selectively
+//  retreive object/attribute from a fixed attr list.  If a predicate is
+//  given only the matching objects are sent back by the server.
 //***********************************************************************
 
-os_object_iter_t *osrc_create_object_iter_alist(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types,
-        int recurse_depth, char **key, void **val, int *v_size, int n_keys)
+os_object_iter_t *_osrc_object_iter_alist(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types,
+        int recurse_depth, lio_os_predicate_t *pred, char **key, void **val, int *v_size, int n_keys)
 {
     lio_osrc_priv_t *osrc = (lio_osrc_priv_t *)os->priv;
     osrc_object_iter_t *it;
@@ -1907,7 +2123,11 @@ os_object_iter_t *osrc_create_object_iter_alist(lio_object_service_fn_t *os, lio
 
     //** Form the message
     msg = gop_mq_make_exec_core_msg(osrc->remote_host, 1);
-    gop_mq_msg_append_mem(msg, OSR_OBJECT_ITER_ALIST_KEY, OSR_OBJECT_ITER_ALIST_SIZE, MQF_MSG_KEEP_DATA);
+    if (pred == NULL) {
+        gop_mq_msg_append_mem(msg, OSR_OBJECT_ITER_ALIST_KEY, OSR_OBJECT_ITER_ALIST_SIZE, MQF_MSG_KEEP_DATA);
+    } else {
+        gop_mq_msg_append_mem(msg, OSR_OBJECT_ITER_PRED_KEY, OSR_OBJECT_ITER_PRED_SIZE, MQF_MSG_KEEP_DATA);
+    }
     gop_mq_msg_append_mem(msg, osrc->host_id, osrc->host_id_len, MQF_MSG_KEEP_DATA);
     osrc_add_creds(os, creds, msg);
 
@@ -1950,6 +2170,15 @@ os_object_iter_t *osrc_create_object_iter_alist(lio_object_service_fn_t *os, lio
         }
         bpos += n;
 
+        if (pred != NULL) {
+            n = os_predicate_pack(pred, &(buffer[(again==0) ? bpos : 0]), bufsize-bpos);
+            if (n < 0) {
+                again = 1;
+                n = -n;
+            }
+            bpos += n;
+        }
+
 
         if (again == 1) {
             bufsize = bpos + 10;
@@ -1987,6 +2216,28 @@ os_object_iter_t *osrc_create_object_iter_alist(lio_object_service_fn_t *os, lio
     return(it);
 }
 
+//***********************************************************************
+// osrc_create_object_iter_alist - Creates an object iterator to selectively
+//  retreive object/attribute from a fixed attr list
+//***********************************************************************
+
+os_object_iter_t *osrc_create_object_iter_alist(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types,
+        int recurse_depth, char **key, void **val, int *v_size, int n_keys)
+{
+    return(_osrc_object_iter_alist(os, creds, path, object_regex, object_types, recurse_depth, NULL, key, val, v_size, n_keys));
+}
+
+//***********************************************************************
+// osrc_create_object_iter_predicate - Same as the alist iterator but the
+//  predicate is evaluated on the server
+//***********************************************************************
+
+os_object_iter_t *osrc_create_object_iter_predicate(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types,
+        int recurse_depth, lio_os_predicate_t *pred, char **key, void **val, int *v_size, int n_keys)
+{
+    return(_osrc_object_iter_alist(os, creds, path, object_regex, object_types, recurse_depth, pred, key, val, v_size, n_keys));
+}
+
 //***********************************************************************
 // osrc_destroy_object_iter - Destroy the object iterator
 //***********************************************************************
@@ -2459,7 +2710,7 @@ lio_object_service_fn_t *object_service_remote_client_create(lio_service_manager
     lio_osrc_priv_t *osrc;
     unsigned int n;
     char *str, *asection, *atype;
-    char hostname[1024], buffer[1024];
+    char hostname[1024], buffer[1024], pack[16];
     authn_create_t *authn_create;
 
     log_printf(10, "START\n");
@@ -2501,7 +2752,8 @@ lio_object_service_fn_t *object_service_remote_client_create(lio_service_manager
     apr_gethostname(hostname, sizeof(hostname), osrc->mpool);
     n = 0;
     tbx_random_get_bytes(&n, sizeof(n));
-    snprintf(buffer, sizeof(buffer), "%d:%s:%s:%u", osrc->heartbeat, hostname, _lio_exe_name, n);
+    gop_mqs_pack_offer(pack, sizeof(pack));  //** Let the server know which stream pack types we can read
+    snprintf(buffer, sizeof(buffer), "%d:%s:%s:%u:" MQS_PACK_KEY "%s", osrc->heartbeat, hostname, _lio_exe_name, n, pack);
     osrc->host_id = strdup(buffer);
     osrc->host_id_len = strlen(osrc->host_id)+1;
 
@@ -2532,6 +2784,7 @@ lio_object_service_fn_t *object_service_remote_client_create(lio_service_manager
     os->hardlink_object = osrc_hardlink_object;
     os->create_object_iter = osrc_create_object_iter;
     os->create_object_iter_alist = osrc_create_object_iter_alist;
+    os->create_object_iter_predicate = osrc_create_object_iter_predicate;
     os->next_object = osrc_next_object;
     os->destroy_object_iter = osrc_destroy_object_iter;
     os->open_object = osrc_open_object;
@@ -2557,6 +2810,8 @@ lio_object_service_fn_t *object_service_remote_client_create(lio_service_manager
     os->destroy_fsck_iter = osrc_destroy_fsck_iter;
     os->next_fsck = osrc_next_fsck;
     os->fsck_object = osrc_fsck_object;
+    os->aggregate = osrc_aggregate;
+    os->abort_aggregate = osrc_abort_aggregate;
 
     log_printf(10, "END\n");
 
@@ -141,6 +141,20 @@ void signal_print_active_table(int sig)
     return;
 }
 
+//***********************************************************************
+// osrs_pack_type - Picks the stream pack type based on what the client
+//    advertised in it's host ID
+//***********************************************************************
+
+char osrs_pack_type(lio_osrs_priv_t *osrs, gop_mq_frame_t *hid)
+{
+    char *host_id;
+    int len;
+
+    gop_mq_get_frame(hid, (void **)&host_id, &len);
+    return(gop_mqs_pack_negotiate(host_id, len, osrs->pack_preferred));
+}
+
 //***********************************************************************
 // osrs_update_active_table - Updates the active table
 //    NOTE:  Currently this only tracks callbacks that use streams
@@ -431,6 +445,68 @@ void osrs_spin_hb_cb(void *arg, gop_mq_task_t *task)
     log_printf(5, "END\n");
 }
 
+//***********************************************************************
+// osrs_abort_aggregate_cb - Flags an ongoing aggregate for abort.  The
+//    aggregate itself notices and kills the walk.
+//***********************************************************************
+
+void osrs_abort_aggregate_cb(void *arg, gop_mq_task_t *task)
+{
+    lio_object_service_fn_t *os = (lio_object_service_fn_t *)arg;
+    lio_osrs_priv_t *osrs = (lio_osrs_priv_t *)os->priv;
+    gop_mq_frame_t *fcred, *fspin, *fid;
+    char *spin_hb;
+    spin_hb_t *spin;
+    lio_creds_t *creds;
+    int fsize;
+    gop_op_status_t status;
+    mq_msg_t *msg, *response;
+
+    log_printf(5, "Processing incoming request\n");
+
+    status = gop_failure_status;  //** Store a default response
+
+    //** Parse the command.
+    msg = task->msg;
+    gop_mq_remove_header(msg, 0);
+
+    gop_mq_frame_destroy(mq_msg_pop(msg));  //** This is the ID
+    gop_mq_frame_destroy(mq_msg_pop(msg));  //** Drop the application command frame
+    fid = mq_msg_pop(msg);  //** Host/user ID
+
+    fcred = mq_msg_pop(msg);  //** This has the creds
+    creds = osrs_get_creds(os, fcred);
+
+    fspin = mq_msg_pop(msg);  //** This has the Spin ID
+    gop_mq_get_frame(fspin, (void **)&spin_hb, &fsize);
+
+    //** Now check if the handle is valid
+    apr_thread_mutex_lock(osrs->lock);
+    if ((creds != NULL) && ((spin = apr_hash_get(osrs->spin, spin_hb, fsize)) != NULL)) {
+        spin->abort = 1;
+        status = gop_success_status;
+    } else {
+        log_printf(5, "Invalid handle!\n");
+    }
+    apr_thread_mutex_unlock(osrs->lock);
+
+    //** Form the response
+    response = gop_mq_make_response_core_msg(msg, fid);
+    gop_mq_msg_append_frame(response, gop_mq_make_status_frame(status));
+    gop_mq_msg_append_mem(response, NULL, 0, MQF_MSG_KEEP_DATA);  //** Empty frame
+
+    log_printf(5, "status.op_status=%d\n", status.op_status);
+    //** Lastly send it
+    gop_mq_submit(osrs->server_portal, gop_mq_task_new(osrs->mqc, response, NULL, NULL, 30));
+
+    osrs_release_creds(os, creds);
+
+    gop_mq_frame_destroy(fspin);
+    gop_mq_frame_destroy(fcred);
+
+    log_printf(5, "END\n");
+}
+
 //***********************************************************************
 // osrs_create_object_cb - Processes the create object command
 //***********************************************************************
@@ -608,14 +684,14 @@ void osrs_remove_regex_object_cb(void *arg, gop_mq_task_t *task)
         timeout = 60;
 
         //** Create the stream so we can get the heartbeating while we work
-        mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, osrs->max_stream, timeout, msg, fid, hid, 0);
+        mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, hid), osrs->max_stream, timeout, msg, fid, hid, 0);
 
         goto fail;
     }
     bpos += n;
 
     //** Create the stream so we can get the heartbeating while we work
-    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, osrs->max_stream, timeout, msg, fid, hid, 0);
+    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, hid), osrs->max_stream, timeout, msg, fid, hid, 0);
 
 
     //** Get the spin heartbeat handle ID
@@ -1282,7 +1358,7 @@ void osrs_get_mult_attr_cb(void *arg, gop_mq_task_t *task)
     }
 
     //** Create the stream
-    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, max_stream, timeout, msg, fid, hid, 0);
+    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, hid), max_stream, timeout, msg, fid, hid, 0);
     osrs_update_active_table(os, hid);  //** Update the active log
 
     //** Return the results
@@ -1634,7 +1710,7 @@ void osrs_regex_set_mult_attr_cb(void *arg, gop_mq_task_t *task)
     }
 
     //** Create the stream so we can get the heartbeating while we work
-    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, osrs->max_stream, timeout, msg, fid, hid, 0);
+    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, hid), osrs->max_stream, timeout, msg, fid, hid, 0);
     if (n < 0) goto fail;
 
     //** Get the spin heartbeat handle ID
@@ -2272,7 +2348,8 @@ fail:
 }
 
 //***********************************************************************
-// osrs_object_iter_alist_cb - Handles the alist object iterator
+// osrs_object_iter_alist_cb - Handles the alist object iterator.  This
+//    also handles the predicate version which just adds the predicate at the end.
 //***********************************************************************
 
 void osrs_object_iter_alist_cb(void *arg, gop_mq_task_t *task)
@@ -2287,6 +2364,7 @@ void osrs_object_iter_alist_cb(void *arg, gop_mq_task_t *task)
     char **val;
     char *fname;
     lio_os_regex_table_t *path, *object_regex;
+    lio_os_predicate_t *pred;
     lio_creds_t *creds;
     int fsize, bpos, n, i, err, ftype, prefix_len;
     int64_t recurse_depth, obj_types, timeout, n_attrs, len;
@@ -2301,6 +2379,7 @@ void osrs_object_iter_alist_cb(void *arg, gop_mq_task_t *task)
     val = NULL, v_size = NULL;
     n_attrs = 0;
     it = NULL;
+    pred = NULL;
 
     //** Parse the command.
     msg = task->msg;
@@ -2326,13 +2405,13 @@ void osrs_object_iter_alist_cb(void *arg, gop_mq_task_t *task)
     if (n < 0) {
         timeout = 60;
         //** Create the stream so we can get the heartbeating while we work.  We need the timeout is why we do it here,
-        mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, osrs->max_stream, timeout, msg, fid, hid, 0);
+        mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, hid), osrs->max_stream, timeout, msg, fid, hid, 0);
         goto fail;
     }
     bpos += n;
 
     //** Create the stream so we can get the heartbeating while we work.  We need the timeout is why we do it here,
-    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, osrs->max_stream, timeout, msg, fid, hid, 0);
+    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, hid), osrs->max_stream, timeout, msg, fid, hid, 0);
 
     n = tbx_zigzag_decode(&(buffer[bpos]), fsize-bpos, &recurse_depth);
     if (n < 0) goto fail;
@@ -2386,11 +2465,22 @@ void osrs_object_iter_alist_cb(void *arg, gop_mq_task_t *task)
 
     log_printf(15, "2. bpos=%d fsize=%d\n", bpos, fsize);
 
+    //** Anything left is the predicate
+    if (bpos < fsize) {
+        pred = os_predicate_unpack(&(buffer[bpos]), fsize-bpos, &n);
+        if (pred == NULL) goto fail;
+        bpos += n;
+    }
+
     //** run the task
-    if (creds != NULL) {
-        it = os_create_object_iter_alist(osrs->os_child, creds, path, object_regex, obj_types, recurse_depth, key, (void **)val, v_size, n_attrs);
-    } else {
+    if (creds == NULL) {
         it = NULL;
+    } else if (pred != NULL) {
+        if (osrs->os_child->create_object_iter_predicate != NULL) {
+            it = os_create_object_iter_predicate(osrs->os_child, creds, path, object_regex, obj_types, recurse_depth, pred, key, (void **)val, v_size, n_attrs);
+        }
+    } else {
+        it = os_create_object_iter_alist(osrs->os_child, creds, path, object_regex, obj_types, recurse_depth, key, (void **)val, v_size, n_attrs);
     }
 
 fail:
@@ -2453,6 +2543,7 @@ finished:
     //** Clean up
     if (path != NULL) lio_os_regex_table_destroy(path);
     if (object_regex != NULL) lio_os_regex_table_destroy(object_regex);
+    if (pred != NULL) lio_os_predicate_destroy(pred);
 
     if (key != NULL) {
         for (i=0; i<n_attrs; i++) {
@@ -2520,7 +2611,7 @@ void osrs_object_iter_aregex_cb(void *arg, gop_mq_task_t *task)
         timeout = 60;
 
         //** Create the stream so things don't break
-        mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, osrs->max_stream, timeout, msg, fid, hid, 0);
+        mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, hid), osrs->max_stream, timeout, msg, fid, hid, 0);
 
         goto fail;
     }
@@ -2528,7 +2619,7 @@ void osrs_object_iter_aregex_cb(void *arg, gop_mq_task_t *task)
 
 
     //** Create the stream so we can get the heartbeating while we work
-    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, osrs->max_stream, timeout, msg, fid, hid, 0);
+    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, hid), osrs->max_stream, timeout, msg, fid, hid, 0);
 
 
     n = tbx_zigzag_decode(&(buffer[bpos]), fsize-bpos, &recurse_depth);
@@ -2703,7 +2794,7 @@ void osrs_attr_iter_cb(void *arg, gop_mq_task_t *task)
 
         //** Create the stream so we can get the heartbeating while we work
         timeout = 60;
-        mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, osrs->max_stream, timeout, msg, fid, fhid, 0);
+        mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, fhid), osrs->max_stream, timeout, msg, fid, fhid, 0);
         osrs_update_active_table(os, fhid);  //** Update the active log
 
         goto fail;
@@ -2727,14 +2818,14 @@ void osrs_attr_iter_cb(void *arg, gop_mq_task_t *task)
         timeout = 60;
 
         //** Create the stream so we can get the heartbeating while we work
-        mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, osrs->max_stream, timeout, msg, fid, fhid, 0);
+        mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, fhid), osrs->max_stream, timeout, msg, fid, fhid, 0);
         osrs_update_active_table(os, fhid);  //** Update the active log
         goto fail;
     }
     bpos += n;
 
     //** Create the stream so we can get the heartbeating while we work
-    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, osrs->max_stream, timeout, msg, fid, fhid, 0);
+    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, fhid), osrs->max_stream, timeout, msg, fid, fhid, 0);
     osrs_update_active_table(os, fhid);  //** Update the active log
 
 
@@ -2875,7 +2966,7 @@ void osrs_fsck_iter_cb(void *arg, gop_mq_task_t *task)
     gop_mq_frame_destroy(fdata);
 
     //** Create the stream so we can get the heartbeating while we work
-    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, MQS_PACK_COMPRESS, osrs->max_stream, timeout, msg, fid, fhid, 0);
+    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, fhid), osrs->max_stream, timeout, msg, fid, fhid, 0);
 
     log_printf(5, "1.err=%d\n", err);
 
@@ -3025,6 +3116,200 @@ void osrs_fsck_object_cb(void *arg, gop_mq_task_t *task)
 }
 
 
+//***********************************************************************
+// osrs_aggregate_cb - Runs the aggregation locally and only sends back
+//   the per depth tallies
+//***********************************************************************
+
+void osrs_aggregate_cb(void *arg, gop_mq_task_t *task)
+{
+    lio_object_service_fn_t *os = (lio_object_service_fn_t *)arg;
+    lio_osrs_priv_t *osrs = (lio_osrs_priv_t *)os->priv;
+    gop_mq_frame_t *fid, *fcred, *fdata, *hid;
+    unsigned char *buffer;
+    unsigned char tbuf[32];
+    lio_os_regex_table_t *path, *object_regex;
+    lio_os_aggregate_t *agg;
+    lio_os_agg_level_t *l;
+    lio_creds_t *creds;
+    char *key;
+    int fsize, bpos, n, i, j, nbins;
+    int64_t recurse_depth, obj_types, max_depth, timeout, len, hb_timeout, loop;
+    mq_msg_t *msg;
+    apr_time_t expire;
+    gop_op_generic_t *g, *gop;
+    gop_mq_stream_t *mqs;
+    gop_op_status_t status;
+    spin_hb_t spin;
+
+    log_printf(5, "Processing incoming request\n");
+
+    status = gop_failure_status;
+    memset(&spin, 0, sizeof(spin));
+    key = NULL;
+    agg = NULL;
+
+    //** Parse the command.
+    msg = task->msg;
+    gop_mq_remove_header(msg, 0);
+
+    fid = mq_msg_pop(msg);  //** This is the ID
+    gop_mq_frame_destroy(mq_msg_pop(msg));  //** Drop the application command frame
+    hid = mq_msg_pop(msg);  //** This is the Host ID
+
+    fcred = mq_msg_pop(msg);  //** This has the creds
+    creds = osrs_get_creds(os, fcred);
+
+    fdata = mq_msg_pop(msg);  //** This has the data
+    gop_mq_get_frame(fdata, (void **)&buffer, &fsize);
+
+    //** Parse the buffer
+    path = NULL;
+    object_regex = NULL;
+    bpos = 0;
+
+    n = tbx_zigzag_decode(&(buffer[bpos]), fsize-bpos, &timeout);
+    if (n < 0) {
+        timeout = 60;
+
+        //** Create the stream so we can get the heartbeating while we work
+        mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, hid), osrs->max_stream, timeout, msg, fid, hid, 0);
+
+        goto fail;
+    }
+    bpos += n;
+
+    //** Create the stream so we can get the heartbeating while we work
+    mqs = gop_mq_stream_write_create(osrs->mqc, osrs->server_portal, osrs->ongoing, osrs_pack_type(osrs, hid), osrs->max_stream, timeout, msg, fid, hid, 0);
+
+    //** Get the spin heartbeat handle ID
+    n = tbx_zigzag_decode(&(buffer[bpos]), fsize-bpos, &len);
+    if (n < 0)  goto fail;
+    bpos += n;
+
+    if ((bpos+len) > fsize) goto fail;
+    tbx_type_malloc(spin.key, char, len+1);
+    memcpy(spin.key, &(buffer[bpos]), len);
+    spin.key[len] = 0;
+    spin.key_len = len;
+    spin.last_hb = apr_time_now();
+    bpos += len;
+    apr_thread_mutex_lock(osrs->lock);
+    apr_hash_set(osrs->spin, spin.key, spin.key_len, &spin);
+    apr_thread_mutex_unlock(osrs->lock);
+
+    //** Spin Heartbeat timeout
+    n = tbx_zigzag_decode(&(buffer[bpos]), fsize-bpos, &hb_timeout);
+    if (n < 0) goto fail;
+    bpos += n;
+
+    n = tbx_zigzag_decode(&(buffer[bpos]), fsize-bpos, &recurse_depth);
+    if (n < 0) goto fail;
+    bpos += n;
+
+    n = tbx_zigzag_decode(&(buffer[bpos]), fsize-bpos, &obj_types);
+    if (n < 0) goto fail;
+    bpos += n;
+
+    n = tbx_zigzag_decode(&(buffer[bpos]), fsize-bpos, &max_depth);
+    if ((n < 0) || (max_depth < 0)) goto fail;
+    bpos += n;
+
+    //** And the attribute to tally.  An empty key means just count the objects
+    n = tbx_zigzag_decode(&(buffer[bpos]), fsize-bpos, &len);
+    if (n < 0)  goto fail;
+    bpos += n;
+    if ((bpos+len) > fsize) goto fail;
+    if (len > 0) {
+        tbx_type_malloc(key, char, len+1);
+        memcpy(key, &(buffer[bpos]), len);
+        key[len] = 0;
+        bpos += len;
+    }
+
+    path = os_regex_table_unpack(&(buffer[bpos]), fsize-bpos, &n);
+    if (n == 0) goto fail;
+    bpos += n;
+
+    object_regex = os_regex_table_unpack(&(buffer[bpos]), fsize-bpos, &n);
+    if (n == 0) goto fail;
+
+    //** run the task
+    if ((creds != NULL) && (osrs->os_child->aggregate != NULL)) {
+        agg = lio_os_aggregate_create(max_depth);
+        gop = os_aggregate(osrs->os_child, creds, path, object_regex, obj_types, recurse_depth, key, agg);
+
+        loop = 0;
+        while ((g = gop_waitany_timed(gop, 1)) == NULL) {
+            if ((loop%10) == 0) osrs_update_active_table(os, hid);
+            loop++;
+
+            expire = apr_time_now() - apr_time_from_sec(hb_timeout);
+            apr_thread_mutex_lock(osrs->lock);
+            n = ((expire > spin.last_hb) || (spin.abort > 0)) ? 1 : 0;
+            apr_thread_mutex_unlock(osrs->lock);
+
+            if ((n == 1) && (osrs->os_child->abort_aggregate != NULL)) { //** Client went away so kill the gop
+                log_printf(1, "Aborting gop=%d\n", gop_id(gop));
+                g = os_abort_aggregate(osrs->os_child, gop);
+                gop_waitall(g);
+                gop_free(g, OP_DESTROY);
+                break;
+            }
+        }
+
+        gop_waitall(gop);
+        status = gop_get_status(gop);
+        gop_free(gop, OP_DESTROY);
+    } else {
+        status = gop_failure_status;
+    }
+
+fail:
+    if (spin.key != NULL) {
+        apr_thread_mutex_lock(osrs->lock);
+        apr_hash_set(osrs->spin, spin.key, spin.key_len, NULL);
+        free(spin.key);
+        apr_thread_mutex_unlock(osrs->lock);
+    }
+
+    osrs_release_creds(os, creds);
+
+    gop_mq_frame_destroy(fdata);
+    gop_mq_frame_destroy(fcred);
+
+    if (path != NULL) lio_os_regex_table_destroy(path);
+    if (object_regex != NULL) lio_os_regex_table_destroy(object_regex);
+    if (key != NULL) free(key);
+
+    //** Send the response
+    n = tbx_zigzag_encode(status.op_status, tbuf);
+    n = n + tbx_zigzag_encode(status.error_code, &(tbuf[n]));
+    gop_mq_stream_write(mqs, tbuf, n);
+
+    //** And the tallies if everything worked.  Trailing empty bins aren't sent.
+    if (status.op_status == OP_STATE_SUCCESS) {
+        gop_mq_stream_write_varint(mqs, agg->n_levels);
+        for (i=0; i<agg->n_levels; i++) {
+            l = &(agg->level[i]);
+            gop_mq_stream_write_varint(mqs, l->n_objects);
+            gop_mq_stream_write_varint(mqs, l->n_dirs);
+            gop_mq_stream_write_varint(mqs, l->n_values);
+            gop_mq_stream_write_varint(mqs, l->sum);
+            for (nbins=OS_AGG_HIST_BINS; nbins>0; nbins--) {
+                if (l->hist[nbins-1] != 0) break;
+            }
+            gop_mq_stream_write_varint(mqs, nbins);
+            for (j=0; j<nbins; j++) gop_mq_stream_write_varint(mqs, l->hist[j]);
+        }
+    }
+
+    gop_mq_stream_destroy(mqs);
+
+    if (agg != NULL) lio_os_aggregate_destroy(agg);
+}
+
+
 //***********************************************************************
 // os_remote_server_destroy
 //***********************************************************************
@@ -3072,6 +3357,7 @@ void os_remote_server_destroy(lio_object_service_fn_t *os)
 
     free(osrs->hostname);
     if (osrs->fname_active) free(osrs->fname_active);
+    if (osrs->pack_preferred) free(osrs->pack_preferred);
     free(osrs);
     free(os);
 }
@@ -3123,6 +3409,7 @@ lio_object_service_fn_t *object_service_remote_server_create(lio_service_manager
 
     //** Max Stream size
     osrs->max_stream = tbx_inip_get_integer(fd, section, "max_stream", 1024*1024);
+    osrs->pack_preferred = tbx_inip_get_string(fd, section, "pack_types", MQS_PACK_PREFERRED);
 
     //** Start the child OS.
     stype = tbx_inip_get_string(fd, section, "os_local", NULL);
@@ -3180,10 +3467,13 @@ lio_object_service_fn_t *object_service_remote_server_create(lio_service_manager
     gop_mq_command_set(ctable, OSR_MOVE_MULTIPLE_ATTR_KEY, OSR_MOVE_MULTIPLE_ATTR_SIZE, os, osrs_move_mult_attr_cb);
     gop_mq_command_set(ctable, OSR_SYMLINK_MULTIPLE_ATTR_KEY, OSR_SYMLINK_MULTIPLE_ATTR_SIZE, os, osrs_symlink_mult_attr_cb);
     gop_mq_command_set(ctable, OSR_OBJECT_ITER_ALIST_KEY, OSR_OBJECT_ITER_ALIST_SIZE, os, osrs_object_iter_alist_cb);
+    gop_mq_command_set(ctable, OSR_OBJECT_ITER_PRED_KEY, OSR_OBJECT_ITER_PRED_SIZE, os, osrs_object_iter_alist_cb);
     gop_mq_command_set(ctable, OSR_OBJECT_ITER_AREGEX_KEY, OSR_OBJECT_ITER_AREGEX_SIZE, os, osrs_object_iter_aregex_cb);
     gop_mq_command_set(ctable, OSR_ATTR_ITER_KEY, OSR_ATTR_ITER_SIZE, os, osrs_attr_iter_cb);
     gop_mq_command_set(ctable, OSR_FSCK_ITER_KEY, OSR_FSCK_ITER_SIZE, os, osrs_fsck_iter_cb);
     gop_mq_command_set(ctable, OSR_FSCK_OBJECT_KEY, OSR_FSCK_OBJECT_SIZE, os, osrs_fsck_object_cb);
+    gop_mq_command_set(ctable, OSR_AGGREGATE_KEY, OSR_AGGREGATE_SIZE, os, osrs_aggregate_cb);
+    gop_mq_command_set(ctable, OSR_ABORT_AGGREGATE_KEY, OSR_ABORT_AGGREGATE_SIZE, os, osrs_abort_aggregate_cb);
 
     //** Make the ongoing checker
     osrs->ongoing = gop_mq_ongoing_create(osrs->mqc, osrs->server_portal, osrs->ongoing_interval, ONGOING_SERVER);
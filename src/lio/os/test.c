@@ -15,6 +15,8 @@
 */
 
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
 //#include <apr_thread_pool.h>
 #include <gop/tp.h>
 #include <gop/gop.h>
@@ -2229,3 +2231,247 @@ int os_locking_tests(char *prefix)
     log_printf(0, "PASSED!\n");
     return(nfailed);
 }
+
+// **********************************************************************************
+//  agg_create - Creates an object and optionally sets the size attribute
+// **********************************************************************************
+
+int agg_create(char *path, int ftype, char *size)
+{
+    lio_object_service_fn_t *os = lio_gc->os;
+    lio_creds_t  *creds = lio_gc->creds;
+    os_fd_t *fd;
+    int err;
+
+    err = gop_sync_exec(os_create_object(os, creds, path, ftype, "me"));
+    if (err != OP_STATE_SUCCESS) {
+        log_printf(0, "ERROR: creating object: %s err=%d\n", path, err);
+        return(1);
+    }
+    if (size == NULL) return(0);
+
+    err = gop_sync_exec(os_open_object(os, creds, path, OS_MODE_READ_IMMEDIATE, "me", &fd, wait_time));
+    if (err != OP_STATE_SUCCESS) {
+        log_printf(0, "ERROR: opening object: %s err=%d\n", path, err);
+        return(1);
+    }
+    err = gop_sync_exec(os_set_attr(os, creds, fd, "user.agg_size", size, strlen(size)));
+    if (err != OP_STATE_SUCCESS) log_printf(0, "ERROR: setting attr: %s err=%d\n", path, err);
+    gop_sync_exec(os_close_object(os, fd));
+
+    return((err == OP_STATE_SUCCESS) ? 0 : 1);
+}
+
+// **********************************************************************************
+//  os_aggregate_tests - Checks the object and attribute tallies.  The directory
+//     name has a glob character in it to make sure it's taken literally.
+// **********************************************************************************
+
+int os_aggregate_tests(char *prefix)
+{
+    lio_object_service_fn_t *os = lio_gc->os;
+    lio_creds_t  *creds = lio_gc->creds;
+    char path[PATH_LEN], dir[PATH_LEN];
+    lio_os_regex_table_t *regex;
+    lio_os_aggregate_t *agg;
+    lio_os_agg_level_t total;
+    int err;
+    int nfailed = 0;
+
+    if (os->aggregate == NULL) {
+        log_printf(0, "Aggregation not supported.  Skipping\n");
+        return(0);
+    }
+
+    //** agg_*dir/{f1,f2,sub/f3} and a decoy that agg_*dir/* as a glob would also pick up
+    snprintf(dir, PATH_LEN, "%s/agg_*dir", prefix);
+    nfailed += agg_create(dir, OS_OBJECT_DIR_FLAG, NULL);
+    snprintf(path, PATH_LEN, "%s/f1", dir);
+    nfailed += agg_create(path, OS_OBJECT_FILE_FLAG, "100");
+    snprintf(path, PATH_LEN, "%s/f2", dir);
+    nfailed += agg_create(path, OS_OBJECT_FILE_FLAG, "28");
+    snprintf(path, PATH_LEN, "%s/sub", dir);
+    nfailed += agg_create(path, OS_OBJECT_DIR_FLAG, NULL);
+    snprintf(path, PATH_LEN, "%s/sub/f3", dir);
+    nfailed += agg_create(path, OS_OBJECT_FILE_FLAG, "1000");
+    snprintf(path, PATH_LEN, "%s/agg_Xdir", prefix);
+    nfailed += agg_create(path, OS_OBJECT_DIR_FLAG, NULL);
+    snprintf(path, PATH_LEN, "%s/agg_Xdir/g1", prefix);
+    nfailed += agg_create(path, OS_OBJECT_FILE_FLAG, "5");
+    if (nfailed > 0) goto cleanup;
+
+    regex = lio_os_path_children2regex(dir);
+    agg = lio_os_aggregate_create(4);
+    err = gop_sync_exec(os_aggregate(os, creds, regex, NULL, OS_OBJECT_ANY_FLAG, 1000, "user.agg_size", agg));
+    if (err != OP_STATE_SUCCESS) {
+        nfailed++;
+        log_printf(0, "ERROR: aggregate failed: %s err=%d\n", dir, err);
+    } else {
+        lio_os_aggregate_total(agg, &total);
+        if ((total.n_objects != 4) || (total.n_dirs != 1) || (total.n_values != 3) || (total.sum != 1128)) {
+            nfailed++;
+            log_printf(0, "ERROR: aggregate mismatch n_objects=" I64T " n_dirs=" I64T " n_values=" I64T " sum=" I64T " should be 4 1 3 1128\n", total.n_objects, total.n_dirs, total.n_values, total.sum);
+        }
+        if ((total.hist[7] != 1) || (total.hist[5] != 1) || (total.hist[10] != 1)) {
+            nfailed++;
+            log_printf(0, "ERROR: aggregate histogram mismatch hist[5]=" I64T " hist[7]=" I64T " hist[10]=" I64T "\n", total.hist[5], total.hist[7], total.hist[10]);
+        }
+    }
+    lio_os_aggregate_destroy(agg);
+    lio_os_regex_table_destroy(regex);
+
+cleanup:
+    snprintf(path, PATH_LEN, "%s/agg_*", prefix);
+    regex = lio_os_path_glob2regex(path);
+    err = gop_sync_exec(os_remove_regex_object(os, creds, regex, NULL, OS_OBJECT_ANY_FLAG, 1000));
+    lio_os_regex_table_destroy(regex);
+    if (err != OP_STATE_SUCCESS) {
+        nfailed++;
+        log_printf(0, "ERROR: removing the aggregate objects err=%d\n", err);
+    }
+
+    if (nfailed == 0) log_printf(0, "PASSED!\n");
+    return(nfailed);
+}
+
+// **********************************************************************************
+//  os_bench_phase - Runs a batch of ops and reports the rate
+// **********************************************************************************
+
+int os_bench_phase(char *label, gop_opque_t *q, int n, apr_time_t start)
+{
+    int err;
+    double dt;
+
+    err = opque_waitall(q);
+    dt = apr_time_now() - start;
+    dt /= APR_USEC_PER_SEC;
+    if (dt <= 0) dt = 1e-6;
+
+    log_printf(0, "BENCH %-10s n=%d time=%lfs ops/sec=%lf\n", label, n, dt, n/dt);
+
+    if (err != OP_STATE_SUCCESS) {
+        log_printf(0, "ERROR: %s phase had %d failed tasks\n", label, gop_opque_tasks_failed(q));
+        return(1);
+    }
+
+    return(0);
+}
+
+// **********************************************************************************
+//  os_metadata_benchmark - Measures the metadata ops/sec for the OS.  Each phase
+//     issues n_objects concurrent ops so the internal lock striping is exercised.
+// **********************************************************************************
+
+int os_metadata_benchmark(char *prefix, int n_objects)
+{
+    lio_object_service_fn_t *os = lio_gc->os;
+    lio_creds_t  *creds = lio_gc->creds;
+    gop_opque_t *q;
+    apr_time_t start;
+    char **path;
+    os_fd_t **fd;
+    char *key[2];
+    void *val[2];
+    int v_size[2];
+    char **rval;
+    int *rsize;
+    int i, n, nfailed;
+
+    nfailed = 0;
+    tbx_type_malloc_clear(path, char *, n_objects);
+    tbx_type_malloc_clear(fd, os_fd_t *, n_objects);
+    tbx_type_malloc_clear(rval, char *, 2*n_objects);
+    tbx_type_malloc_clear(rsize, int, 2*n_objects);
+    for (i=0; i<n_objects; i++) {
+        tbx_type_malloc(path[i], char, PATH_LEN);
+        snprintf(path[i], PATH_LEN, "%s/bench-%d", prefix, i);
+    }
+
+    key[0] = "user.bench1"; val[0] = "value1"; v_size[0] = strlen(val[0]);
+    key[1] = "user.bench2"; val[1] = "value2"; v_size[1] = strlen(val[1]);
+
+    //** Create
+    q = gop_opque_new();
+    start = apr_time_now();
+    for (i=0; i<n_objects; i++) {
+        gop_opque_add(q, os_create_object(os, creds, path[i], OS_OBJECT_FILE_FLAG, "me"));
+    }
+    nfailed += os_bench_phase("create", q, n_objects, start);
+    gop_opque_free(q, OP_DESTROY);
+    if (nfailed) goto cleanup;
+
+    //** Exists
+    q = gop_opque_new();
+    start = apr_time_now();
+    for (i=0; i<n_objects; i++) {
+        gop_opque_add(q, os_exists(os, creds, path[i]));
+    }
+    nfailed += os_bench_phase("exists", q, n_objects, start);
+    gop_opque_free(q, OP_DESTROY);
+
+    //** Open
+    q = gop_opque_new();
+    start = apr_time_now();
+    for (i=0; i<n_objects; i++) {
+        gop_opque_add(q, os_open_object(os, creds, path[i], OS_MODE_READ_IMMEDIATE, "me", &(fd[i]), wait_time));
+    }
+    nfailed += os_bench_phase("open", q, n_objects, start);
+    gop_opque_free(q, OP_DESTROY);
+    if (nfailed) goto close_fds;  //** Some of them may have opened
+
+    //** Set attrs
+    q = gop_opque_new();
+    start = apr_time_now();
+    for (i=0; i<n_objects; i++) {
+        gop_opque_add(q, os_set_multiple_attrs(os, creds, fd[i], key, val, v_size, 2));
+    }
+    nfailed += os_bench_phase("setattr", q, n_objects, start);
+    gop_opque_free(q, OP_DESTROY);
+
+    //** Get attrs
+    q = gop_opque_new();
+    start = apr_time_now();
+    for (i=0; i<n_objects; i++) {
+        rsize[2*i] = rsize[2*i+1] = -100;
+        gop_opque_add(q, os_get_multiple_attrs(os, creds, fd[i], key, (void **)&(rval[2*i]), &(rsize[2*i]), 2));
+    }
+    nfailed += os_bench_phase("getattr", q, n_objects, start);
+    gop_opque_free(q, OP_DESTROY);
+
+close_fds:
+    //** Close
+    q = gop_opque_new();
+    start = apr_time_now();
+    n = 0;
+    for (i=0; i<n_objects; i++) {
+        if (fd[i] == NULL) continue;
+        gop_opque_add(q, os_close_object(os, fd[i]));
+        n++;
+    }
+    if (n > 0) nfailed += os_bench_phase("close", q, n, start);
+    gop_opque_free(q, OP_DESTROY);
+
+cleanup:
+    //** Remove
+    q = gop_opque_new();
+    start = apr_time_now();
+    for (i=0; i<n_objects; i++) {
+        gop_opque_add(q, os_remove_object(os, creds, path[i]));
+    }
+    nfailed += os_bench_phase("remove", q, n_objects, start);
+    gop_opque_free(q, OP_DESTROY);
+
+    for (i=0; i<n_objects; i++) {
+        free(path[i]);
+        if (rval[2*i]) free(rval[2*i]);
+        if (rval[2*i+1]) free(rval[2*i+1]);
+    }
+    free(path);
+    free(fd);
+    free(rval);
+    free(rsize);
+
+    if (nfailed == 0) log_printf(0, "PASSED!\n");
+    return(nfailed);
+}
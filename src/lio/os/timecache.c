@@ -23,6 +23,7 @@
 #include <apr_errno.h>
 #include <apr_hash.h>
 #include <apr_pools.h>
+#include <apr_strings.h>
 #include <apr_thread_cond.h>
 #include <apr_thread_mutex.h>
 #include <apr_thread_proc.h>
@@ -57,6 +58,10 @@
 
 #define OSTC_MAX_RECURSE 500
 
+#define OSTC_LISTING_NONE   0   //** Not a simple directory listing
+#define OSTC_LISTING_RECORD 1   //** Recording the listing as it streams from the child
+#define OSTC_LISTING_SNAP   2   //** Serving the listing from the cache
+
 #define OS_ATTR_LINK "os.attr_link"
 #define OS_ATTR_LINK_LEN 12
 #define OS_LINK "os.link"
@@ -78,8 +83,21 @@ typedef struct {
     apr_hash_t *objects;
     apr_hash_t *attrs;
     apr_time_t expire;
+    apr_time_t listing_expire;  //** If valid the objects table is a complete directory listing
 } ostcdb_object_t;
 
+typedef struct {
+    char *fname;
+    apr_time_t expire;
+} ostcdb_negative_t;
+
+typedef struct {
+    char *fname;
+    int ftype;
+    void **val;
+    int *v_size;
+} ostc_snap_entry_t;
+
 typedef struct {
     char *fname;
     int mode;
@@ -123,6 +141,12 @@ typedef struct {
     int v_max;
     ostc_cacheprep_t cp;
     int iter_type;
+    char *listing_dir;      //** Directory being listed if this is a simple "dir/*" listing
+    int listing_gen;        //** Invalidation generation when the listing started
+    int listing_state;
+    apr_pool_t *mpool;
+    apr_hash_t *seen;       //** Entries seen while recording a listing
+    tbx_stack_t *snap;      //** Directory snapshot we're serving from the cache
 } ostc_object_iter_t;
 
 typedef struct {
@@ -147,6 +171,8 @@ typedef struct {
     lio_creds_t *creds;
     char *src_path;
     char *dest_path;
+    char *id;
+    int type;
 } ostc_move_op_t;
 
 typedef struct {
@@ -157,6 +183,9 @@ typedef struct {
     apr_pool_t *mpool;
     gop_thread_pool_context_t *tpc;
     ostcdb_object_t *cache_root;
+    apr_hash_t *negative;   //** Paths known not to exist
+    int max_negative;
+    int listing_gen;        //** Bumped whenever a directory listing could change
     apr_time_t entry_timeout;
     apr_time_t cleanup_interval;
     apr_thread_t *cleanup_thread;
@@ -261,6 +290,7 @@ ostcdb_object_t *new_ostcdb_object(char *entry, int ftype, apr_time_t expire, ap
     obj->expire = expire;
     obj->ftype = ftype;
     obj->link = NULL;
+    obj->listing_expire = 0;
     apr_pool_create(&(obj->mpool), NULL);
     obj->objects = (ftype & OS_OBJECT_DIR_FLAG) ? apr_hash_make(mpool) : NULL;
     obj->attrs = apr_hash_make(mpool);
@@ -282,12 +312,15 @@ int _ostc_cleanup(lio_object_service_fn_t *os, ostcdb_object_t *obj, apr_time_t
 
     if (obj == NULL) return(0);  //** Nothing to do so return
 
-    //** Recursively prune the objects
+    if (obj->listing_expire < expired) obj->listing_expire = 0;  //** Directory snapshot has expired
+
+    //** Recursively prune the objects.  Entries in a valid directory snapshot are kept
     okept = 0;
     if (obj->objects) {
         for (hi = apr_hash_first(NULL, obj->objects); hi != NULL; hi = apr_hash_next(hi)) {
             apr_hash_this(hi, NULL, NULL, (void **) &o);
             result = _ostc_cleanup(os, o, expired);
+            if ((result == 0) && (obj->listing_expire != 0)) result = 1;
             okept += result;
             if (result == 0) {
                 apr_hash_set(obj->objects, o->fname, APR_HASH_KEY_STRING, NULL);
@@ -309,10 +342,91 @@ int _ostc_cleanup(lio_object_service_fn_t *os, ostcdb_object_t *obj, apr_time_t
         }
     }
 
+    if (obj->listing_expire != 0) akept++;
+
     log_printf(5, "fname=%s akept=%d okept=%d o+a=%d\n", obj->fname, akept, okept, akept+okept);
     return(akept + okept);
 }
 
+//***********************************************************************
+// _ostc_negative_cleanup - Removes expired negative entries
+//     NOTE: ostc->lock must be held by the calling process
+//***********************************************************************
+
+void _ostc_negative_cleanup(lio_object_service_fn_t *os, apr_time_t expired)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    ostcdb_negative_t *ne;
+    apr_hash_index_t *hi;
+
+    for (hi = apr_hash_first(NULL, ostc->negative); hi != NULL; hi = apr_hash_next(hi)) {
+        apr_hash_this(hi, NULL, NULL, (void **) &ne);
+        if (ne->expire < expired) {
+            apr_hash_set(ostc->negative, ne->fname, APR_HASH_KEY_STRING, NULL);
+            free(ne->fname);
+            free(ne);
+        }
+    }
+}
+
+//***********************************************************************
+// _ostc_negative_add - Flags the path as not existing
+//     NOTE: ostc->lock must be held by the calling process
+//***********************************************************************
+
+void _ostc_negative_add(lio_object_service_fn_t *os, char *path)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    ostcdb_negative_t *ne;
+
+    if (ostc->max_negative <= 0) return;
+
+    ne = apr_hash_get(ostc->negative, path, APR_HASH_KEY_STRING);
+    if (ne == NULL) {
+        if ((int)apr_hash_count(ostc->negative) >= ostc->max_negative) {  //** Full so try and make some space
+            _ostc_negative_cleanup(os, apr_time_now());
+            if ((int)apr_hash_count(ostc->negative) >= ostc->max_negative) return;
+        }
+        tbx_type_malloc(ne, ostcdb_negative_t, 1);
+        ne->fname = strdup(path);
+        apr_hash_set(ostc->negative, ne->fname, APR_HASH_KEY_STRING, ne);
+    }
+    ne->expire = apr_time_now() + ostc->entry_timeout;
+}
+
+//***********************************************************************
+// _ostc_negative_remove - Removes the negative entry for the path and
+//     optionally everything under it.
+//     NOTE: ostc->lock must be held by the calling process
+//***********************************************************************
+
+void _ostc_negative_remove(lio_object_service_fn_t *os, char *path, int do_prefix)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    ostcdb_negative_t *ne;
+    apr_hash_index_t *hi;
+    int n;
+
+    ne = apr_hash_get(ostc->negative, path, APR_HASH_KEY_STRING);
+    if (ne != NULL) {
+        apr_hash_set(ostc->negative, ne->fname, APR_HASH_KEY_STRING, NULL);
+        free(ne->fname);
+        free(ne);
+    }
+
+    if (do_prefix == 0) return;
+
+    n = strlen(path);
+    for (hi = apr_hash_first(NULL, ostc->negative); hi != NULL; hi = apr_hash_next(hi)) {
+        apr_hash_this(hi, NULL, NULL, (void **) &ne);
+        if ((strncmp(ne->fname, path, n) == 0) && (ne->fname[n] == '/')) {
+            apr_hash_set(ostc->negative, ne->fname, APR_HASH_KEY_STRING, NULL);
+            free(ne->fname);
+            free(ne);
+        }
+    }
+}
+
 //***********************************************************************
 // ostc_cache_compact_thread - Thread for cleaning out the cache
 //***********************************************************************
@@ -327,7 +441,9 @@ void *ostc_cache_compact_thread(apr_thread_t *th, void *data)
         apr_thread_cond_timedwait(ostc->cond, ostc->lock, ostc->cleanup_interval);
 
         log_printf(5, "START: Running an attribute cleanup\n");
+        ostc->listing_gen++;  //** Entries being recorded could get pruned
         _ostc_cleanup(os, ostc->cache_root, apr_time_now());
+        _ostc_negative_cleanup(os, apr_time_now());
         log_printf(5, "END: cleanup finished\n");
     }
     OSTC_UNLOCK(ostc);
@@ -658,6 +774,49 @@ finished:
 }
 
 
+//***********************************************************************
+// _ostc_listing_invalidate - Flags the directory snapshot containing the
+//     path as stale.
+//     NOTE: ostc->lock must be held by the calling process
+//***********************************************************************
+
+void _ostc_listing_invalidate(lio_object_service_fn_t *os, char *path)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    tbx_stack_t tree;
+    ostcdb_object_t *obj;
+    char *dir, *file;
+
+    ostc->listing_gen++;  //** Kick any listings currently being recorded
+
+    lio_os_path_split(path, &dir, &file);
+    tbx_stack_init(&tree);
+    if (_ostc_lio_cache_tree_walk(os, dir, &tree, NULL, 0, OSTC_MAX_RECURSE) == 0) {
+        tbx_stack_move_to_bottom(&tree);
+        obj = tbx_stack_get_current_data(&tree);
+        if (obj) obj->listing_expire = 0;
+    }
+    tbx_stack_empty(&tree, 0);
+    free(dir);
+    free(file);
+}
+
+//***********************************************************************
+//  ostc_cache_new_object - Updates the negative and listing caches for a
+//     newly created object.  If do_prefix is set then any negative entries
+//     below the path are also dropped.
+//***********************************************************************
+
+void ostc_cache_new_object(lio_object_service_fn_t *os, char *path, int do_prefix)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+
+    OSTC_LOCK(ostc);
+    _ostc_negative_remove(os, path, do_prefix);
+    _ostc_listing_invalidate(os, path);
+    OSTC_UNLOCK(ostc);
+}
+
 //***********************************************************************
 //  ostc_cache_move_object - Moves an existing cache object within the cache
 //***********************************************************************
@@ -672,6 +831,12 @@ void ostc_cache_move_object(lio_object_service_fn_t *os, lio_creds_t *creds, cha
     tbx_stack_init(&tree);
 
     OSTC_LOCK(ostc);
+
+    //** The destination and anything under it now exists and the source is gone
+    _ostc_negative_remove(os, dest_path, 1);
+    _ostc_listing_invalidate(os, dest_path);
+    _ostc_negative_add(os, src_path);
+
     if (_ostc_lio_cache_tree_walk(os, src_path, &tree, NULL, 0, OSTC_MAX_RECURSE) == 0) {
         tbx_stack_move_to_bottom(&tree);
         obj = tbx_stack_get_current_data(&tree);  //** Snag what we want to move
@@ -714,6 +879,7 @@ void ostc_cache_remove_object(lio_object_service_fn_t *os, char *path)
     tbx_stack_init(&tree);
 
     OSTC_LOCK(ostc);
+    ostc->listing_gen++;
     if (_ostc_lio_cache_tree_walk(os, path, &tree, NULL, 0, OSTC_MAX_RECURSE) == 0) {
         tbx_stack_move_to_bottom(&tree);
         obj = tbx_stack_get_current_data(&tree);
@@ -722,6 +888,10 @@ void ostc_cache_remove_object(lio_object_service_fn_t *os, char *path)
         apr_hash_set(parent->objects, obj->fname, APR_HASH_KEY_STRING, NULL);
         free_ostcdb_object(obj);
     }
+
+    //** It's gone so we can remember that
+    _ostc_negative_remove(os, path, 1);
+    _ostc_negative_add(os, path);
     OSTC_UNLOCK(ostc);
 
     tbx_stack_empty(&tree, 0);
@@ -901,12 +1071,12 @@ finished:
 
 
 //***********************************************************************
-// ostc_cache_fetch - Attempts to process the attribute request from cached data
+// _ostc_cache_fetch - Attempts to process the attribute request from cached data
+//     NOTE: ostc->lock must be held by the calling process
 //***********************************************************************
 
-gop_op_status_t ostc_cache_fetch(lio_object_service_fn_t *os, char *fname, char **key, void **val, int *v_size, int n)
+gop_op_status_t _ostc_cache_fetch(lio_object_service_fn_t *os, char *fname, char **key, void **val, int *v_size, int n)
 {
-    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
     tbx_stack_t tree;
     ostcdb_object_t *obj, *lobj;
     ostcdb_attr_t *attr;
@@ -918,8 +1088,6 @@ gop_op_status_t ostc_cache_fetch(lio_object_service_fn_t *os, char *fname, char
     tbx_stack_init(&tree);
     oops = 0;
 
-//log_printf(5, "fname=%s\n", fname);
-    OSTC_LOCK(ostc);
     if (_ostc_lio_cache_tree_walk(os, fname, &tree, NULL, 0, OSTC_MAX_RECURSE) != 0) goto finished;
 
     tbx_stack_move_to_bottom(&tree);
@@ -949,8 +1117,6 @@ gop_op_status_t ostc_cache_fetch(lio_object_service_fn_t *os, char *fname, char
     status = gop_success_status;
 
 finished:
-    OSTC_UNLOCK(ostc);
-
     if (oops == 1) { //** Got to unroll the values stored
         oops = i;
         for (i=0; i<oops; i++) {
@@ -969,6 +1135,22 @@ finished:
 }
 
 
+//***********************************************************************
+// ostc_cache_fetch - Attempts to process the attribute request from cached data
+//***********************************************************************
+
+gop_op_status_t ostc_cache_fetch(lio_object_service_fn_t *os, char *fname, char **key, void **val, int *v_size, int n)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    gop_op_status_t status;
+
+    OSTC_LOCK(ostc);
+    status = _ostc_cache_fetch(os, fname, key, val, v_size, n);
+    OSTC_UNLOCK(ostc);
+
+    return(status);
+}
+
 //***********************************************************************
 // ostc_cache_update_attrs - Updates the attributes alredy cached.
 //     Attributes that aren't cached are ignored.
@@ -1119,6 +1301,7 @@ gop_op_status_t ostc_remove_regex_object_fn(void *arg, int tid)
     //** Since we don't know what was removed we're going to purge everything to make life easy.
     if (status.op_status == OP_STATE_SUCCESS) {
         apr_thread_mutex_lock(ostc->lock);
+        ostc->listing_gen++;
         _ostc_cleanup(op->os, ostc->cache_root, apr_time_now() + 4*ostc->entry_timeout);
         apr_thread_mutex_unlock(ostc->lock);
     }
@@ -1234,6 +1417,81 @@ gop_op_generic_t *ostc_abort_regex_object_set_multiple_attrs(lio_object_service_
 }
 
 
+//***********************************************************************
+// _ostc_cache_exists - Checks the negative and directory snapshot caches
+//     for the object.  Returns the object type if it exists, 0 if it's known
+//     not to exist, and -1 if we can't tell.
+//     NOTE: ostc->lock must be held by the calling process
+//***********************************************************************
+
+int _ostc_cache_exists(lio_object_service_fn_t *os, char *path)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    ostcdb_negative_t *ne;
+    ostcdb_object_t *obj;
+    tbx_stack_t tree;
+    char *dir, *file;
+    int ftype;
+
+    ne = apr_hash_get(ostc->negative, path, APR_HASH_KEY_STRING);
+    if (ne != NULL) {
+        if (ne->expire >= apr_time_now()) return(0);
+    }
+
+    //** See if the parent has a complete listing
+    ftype = -1;
+    lio_os_path_split(path, &dir, &file);
+    tbx_stack_init(&tree);
+    if (_ostc_lio_cache_tree_walk(os, dir, &tree, NULL, 0, OSTC_MAX_RECURSE) == 0) {
+        tbx_stack_move_to_bottom(&tree);
+        obj = tbx_stack_get_current_data(&tree);
+        if ((obj != NULL) && (obj->objects != NULL) && (obj->listing_expire >= apr_time_now())) {
+            obj = apr_hash_get(obj->objects, file, APR_HASH_KEY_STRING);
+            ftype = (obj == NULL) ? 0 : obj->ftype;
+        }
+    }
+    tbx_stack_empty(&tree, 0);
+    free(dir);
+    free(file);
+
+    return(ftype);
+}
+
+//***********************************************************************
+// ostc_exists_fn - Checks the cache and if needed the child for the object
+//***********************************************************************
+
+gop_op_status_t ostc_exists_fn(void *arg, int tid)
+{
+    ostc_move_op_t *op = (ostc_move_op_t *)arg;
+    ostc_priv_t *ostc = (ostc_priv_t *)op->os->priv;
+    gop_op_status_t status;
+    int ftype, gen;
+
+    OSTC_LOCK(ostc);
+    ftype = _ostc_cache_exists(op->os, op->src_path);
+    gen = ostc->listing_gen;
+    OSTC_UNLOCK(ostc);
+
+    if (ftype >= 0) {
+        log_printf(10, "EXISTS_CACHE_HIT: fname=%s ftype=%d\n", op->src_path, ftype);
+        status = (ftype == 0) ? gop_failure_status : gop_success_status;
+        status.error_code = ftype;
+        return(status);
+    }
+
+    status = gop_sync_exec_status(os_exists(ostc->os_child, op->creds, op->src_path));
+
+    //** Only remember real misses and only if nothing changed while we were asking
+    if ((status.op_status == OP_STATE_FAILURE) && (status.error_code == 0)) {
+        OSTC_LOCK(ostc);
+        if (gen == ostc->listing_gen) _ostc_negative_add(op->os, op->src_path);
+        OSTC_UNLOCK(ostc);
+    }
+
+    return(status);
+}
+
 //***********************************************************************
 //  ostc_exists - Returns the object type  and 0 if it doesn't exist
 //***********************************************************************
@@ -1241,8 +1499,34 @@ gop_op_generic_t *ostc_abort_regex_object_set_multiple_attrs(lio_object_service_
 gop_op_generic_t *ostc_exists(lio_object_service_fn_t *os, lio_creds_t *creds, char *path)
 {
     ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    ostc_move_op_t *op;
+
+    if (path == NULL) return(gop_dummy(gop_failure_status));
+
+    tbx_type_malloc_clear(op, ostc_move_op_t, 1);
+    op->os = os;
+    op->creds = creds;
+    op->src_path = path;
+
+    return(gop_tp_op_new(ostc->tpc, NULL, ostc_exists_fn, (void *)op, free, 1));
+}
+
+//***********************************************************************
+// ostc_create_object_fn - Handles the actual object creation
+//***********************************************************************
+
+gop_op_status_t ostc_create_object_fn(void *arg, int tid)
+{
+    ostc_move_op_t *op = (ostc_move_op_t *)arg;
+    ostc_priv_t *ostc = (ostc_priv_t *)op->os->priv;
+    gop_op_status_t status;
+
+    status = gop_sync_exec_status(os_create_object(ostc->os_child, op->creds, op->src_path, op->type, op->id));
 
-    return(os_exists(ostc->os_child, creds, path));
+    //** Update the cache even on failure since it may already exist
+    ostc_cache_new_object(op->os, op->src_path, ((op->type & OS_OBJECT_FILE_FLAG) ? 0 : 1));
+
+    return(status);
 }
 
 //***********************************************************************
@@ -1252,10 +1536,39 @@ gop_op_generic_t *ostc_exists(lio_object_service_fn_t *os, lio_creds_t *creds, c
 gop_op_generic_t *ostc_create_object(lio_object_service_fn_t *os, lio_creds_t *creds, char *path, int type, char *id)
 {
     ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    ostc_move_op_t *op;
+
+    tbx_type_malloc_clear(op, ostc_move_op_t, 1);
+    op->os = os;
+    op->creds = creds;
+    op->src_path = path;
+    op->type = type;
+    op->id = id;
 
-    return(os_create_object(ostc->os_child, creds, path, type, id));
+    return(gop_tp_op_new(ostc->tpc, NULL, ostc_create_object_fn, (void *)op, free, 1));
 }
 
+//***********************************************************************
+// ostc_link_object_fn - Handles the actual symlink or hardlink creation
+//***********************************************************************
+
+gop_op_status_t ostc_link_object_fn(void *arg, int tid)
+{
+    ostc_move_op_t *op = (ostc_move_op_t *)arg;
+    ostc_priv_t *ostc = (ostc_priv_t *)op->os->priv;
+    gop_op_status_t status;
+
+    if (op->type == OS_OBJECT_SYMLINK_FLAG) {
+        status = gop_sync_exec_status(os_symlink_object(ostc->os_child, op->creds, op->src_path, op->dest_path, op->id));
+    } else {
+        status = gop_sync_exec_status(os_hardlink_object(ostc->os_child, op->creds, op->src_path, op->dest_path, op->id));
+    }
+
+    //** A link can expose anything under the target so drop everything below it
+    ostc_cache_new_object(op->os, op->dest_path, 1);
+
+    return(status);
+}
 
 //***********************************************************************
 // ostc_symlink_object - Generates a symbolic link object operation
@@ -1264,8 +1577,17 @@ gop_op_generic_t *ostc_create_object(lio_object_service_fn_t *os, lio_creds_t *c
 gop_op_generic_t *ostc_symlink_object(lio_object_service_fn_t *os, lio_creds_t *creds, char *src_path, char *dest_path, char *id)
 {
     ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    ostc_move_op_t *op;
+
+    tbx_type_malloc_clear(op, ostc_move_op_t, 1);
+    op->os = os;
+    op->creds = creds;
+    op->src_path = src_path;
+    op->dest_path = dest_path;
+    op->id = id;
+    op->type = OS_OBJECT_SYMLINK_FLAG;
 
-    return(os_symlink_object(ostc->os_child, creds, src_path, dest_path, id));
+    return(gop_tp_op_new(ostc->tpc, NULL, ostc_link_object_fn, (void *)op, free, 1));
 }
 
 
@@ -1276,8 +1598,17 @@ gop_op_generic_t *ostc_symlink_object(lio_object_service_fn_t *os, lio_creds_t *
 gop_op_generic_t *ostc_hardlink_object(lio_object_service_fn_t *os, lio_creds_t *creds, char *src_path, char *dest_path, char *id)
 {
     ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    ostc_move_op_t *op;
+
+    tbx_type_malloc_clear(op, ostc_move_op_t, 1);
+    op->os = os;
+    op->creds = creds;
+    op->src_path = src_path;
+    op->dest_path = dest_path;
+    op->id = id;
+    op->type = OS_OBJECT_HARDLINK_FLAG;
 
-    return(os_hardlink_object(ostc->os_child, creds, src_path, dest_path, id));
+    return(gop_tp_op_new(ostc->tpc, NULL, ostc_link_object_fn, (void *)op, free, 1));
 }
 
 //***********************************************************************
@@ -1805,6 +2136,247 @@ void ostc_destroy_attr_iter(os_attr_iter_t *oit)
     free(it);
 }
 
+//***********************************************************************
+// ostc_listing_dir - Returns the directory if the iterator is a simple
+//     "dir/*" listing of a single directory, otherwise NULL.
+//***********************************************************************
+
+char *ostc_listing_dir(lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types, int recurse_depth)
+{
+    char *dir;
+    int n;
+
+    if ((object_regex != NULL) || (recurse_depth != 0) || (path == NULL)) return(NULL);
+    if ((object_types & OS_OBJECT_ANY_FLAG) != OS_OBJECT_ANY_FLAG) return(NULL);
+    if ((path->n < 1) || (path->n > 2)) return(NULL);
+
+    //** The last level has to be a "*"
+    if ((path->regex_entry[path->n-1].fixed == 1) || (strcmp(path->regex_entry[path->n-1].expression, "^.*$") != 0)) return(NULL);
+
+    if (path->n == 1) return(strdup("/"));
+
+    if (path->regex_entry[0].fixed != 1) return(NULL);
+    n = strlen(path->regex_entry[0].expression) + 2;
+    tbx_type_malloc(dir, char, n);
+    snprintf(dir, n, "/%s", path->regex_entry[0].expression);
+    return(dir);
+}
+
+//***********************************************************************
+// ostc_snap_entry_destroy - Destroys a directory snapshot entry
+//***********************************************************************
+
+void ostc_snap_entry_destroy(ostc_snap_entry_t *e, int n_keys)
+{
+    int i;
+
+    if (e->fname) free(e->fname);
+    if (e->val) {
+        for (i=0; i<n_keys; i++) {
+            if (e->val[i]) free(e->val[i]);
+        }
+        free(e->val);
+    }
+    if (e->v_size) free(e->v_size);
+    free(e);
+}
+
+//***********************************************************************
+// ostc_cache_listing_snapshot - Makes a snapshot of the directory listing
+//     along with the requested attributes if everything is cached.
+//     Returns NULL if the listing can't be served from the cache.
+//***********************************************************************
+
+tbx_stack_t *ostc_cache_listing_snapshot(lio_object_service_fn_t *os, char *dir, int object_types, char **key, int n_keys)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    tbx_stack_t tree;
+    tbx_stack_t *snap;
+    ostcdb_object_t *obj, *o;
+    ostc_snap_entry_t *e;
+    apr_hash_index_t *hi;
+    char fname[OS_PATH_MAX];
+    int i;
+
+    snap = NULL;
+    tbx_stack_init(&tree);
+
+    OSTC_LOCK(ostc);
+    if (_ostc_lio_cache_tree_walk(os, dir, &tree, NULL, 0, OSTC_MAX_RECURSE) != 0) goto finished;
+    tbx_stack_move_to_bottom(&tree);
+    obj = tbx_stack_get_current_data(&tree);
+    if ((obj == NULL) || (obj->objects == NULL) || (obj->listing_expire < apr_time_now())) goto finished;
+
+    snap = tbx_stack_new();
+    for (hi = apr_hash_first(NULL, obj->objects); hi != NULL; hi = apr_hash_next(hi)) {
+        apr_hash_this(hi, NULL, NULL, (void **) &o);
+        if ((o->ftype & object_types) == 0) continue;
+
+        snprintf(fname, OS_PATH_MAX, "%s/%s", ((dir[1] == 0) ? "" : dir), o->fname);
+        tbx_type_malloc_clear(e, ostc_snap_entry_t, 1);
+        e->fname = strdup(fname);
+        e->ftype = o->ftype;
+        tbx_stack_push(snap, e);
+
+        if (n_keys == 0) continue;
+
+        tbx_type_malloc_clear(e->val, void *, n_keys);
+        tbx_type_malloc(e->v_size, int, n_keys);
+        for (i=0; i<n_keys; i++) e->v_size[i] = -1;
+        if (_ostc_cache_fetch(os, fname, key, e->val, e->v_size, n_keys).op_status != OP_STATE_SUCCESS) {
+            log_printf(10, "LISTING_CACHE_MISS dir=%s fname=%s missing attrs\n", dir, fname);
+            while ((e = tbx_stack_pop(snap)) != NULL) {
+                ostc_snap_entry_destroy(e, n_keys);
+            }
+            tbx_stack_free(snap, 0);
+            snap = NULL;
+            goto finished;
+        }
+    }
+
+finished:
+    OSTC_UNLOCK(ostc);
+    tbx_stack_empty(&tree, 0);
+
+    return(snap);
+}
+
+//***********************************************************************
+// ostc_cache_listing_add - Adds an entry seen while recording a listing
+//***********************************************************************
+
+void ostc_cache_listing_add(ostc_object_iter_t *it, char *fname, int ftype)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)it->os->priv;
+    tbx_stack_t tree;
+    char *entry;
+
+    entry = strrchr(fname, '/');
+    entry = (entry == NULL) ? fname : entry + 1;
+    entry = apr_pstrdup(it->mpool, entry);
+    apr_hash_set(it->seen, entry, APR_HASH_KEY_STRING, entry);
+
+    if (it->iter_type == OSTC_ITER_ALIST) return;  //** Already added when the attrs were processed
+
+    tbx_stack_init(&tree);
+    OSTC_LOCK(ostc);
+    _ostc_lio_cache_tree_walk(it->os, fname, &tree, NULL, ftype, OSTC_MAX_RECURSE);
+    OSTC_UNLOCK(ostc);
+    tbx_stack_empty(&tree, 0);
+}
+
+//***********************************************************************
+// ostc_cache_listing_complete - Flags the directory as having a complete
+//     listing if nothing changed while it was being recorded.  Stale entries
+//     not seen in the listing are dropped.
+//***********************************************************************
+
+void ostc_cache_listing_complete(ostc_object_iter_t *it)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)it->os->priv;
+    tbx_stack_t tree;
+    ostcdb_object_t *obj, *o;
+    apr_hash_index_t *hi;
+
+    tbx_stack_init(&tree);
+
+    OSTC_LOCK(ostc);
+    if (it->listing_gen != ostc->listing_gen) goto finished;
+    if (_ostc_lio_cache_tree_walk(it->os, it->listing_dir, &tree, NULL, 0, OSTC_MAX_RECURSE) != 0) goto finished;
+    tbx_stack_move_to_bottom(&tree);
+    obj = tbx_stack_get_current_data(&tree);
+    if ((obj == NULL) || (obj->objects == NULL)) goto finished;
+
+    for (hi = apr_hash_first(NULL, obj->objects); hi != NULL; hi = apr_hash_next(hi)) {
+        apr_hash_this(hi, NULL, NULL, (void **) &o);
+        if (apr_hash_get(it->seen, o->fname, APR_HASH_KEY_STRING) == NULL) {
+            apr_hash_set(obj->objects, o->fname, APR_HASH_KEY_STRING, NULL);
+            free_ostcdb_object(o);
+        }
+    }
+
+    obj->listing_expire = apr_time_now() + ostc->entry_timeout;
+    log_printf(10, "LISTING_CACHE_STORE dir=%s n=%u\n", it->listing_dir, apr_hash_count(obj->objects));
+
+finished:
+    OSTC_UNLOCK(ostc);
+    tbx_stack_empty(&tree, 0);
+}
+
+//***********************************************************************
+// ostc_listing_setup - Determines if the iterator is a directory listing
+//     and if so either loads the snapshot or prepares to record it.
+//***********************************************************************
+
+void ostc_listing_setup(ostc_object_iter_t *it, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types, int recurse_depth, char **key, int n_keys, int can_snap)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)it->os->priv;
+    tbx_stack_t tree;
+    int err;
+
+    it->listing_state = OSTC_LISTING_NONE;
+    it->listing_dir = ostc_listing_dir(path, object_regex, object_types, recurse_depth);
+    if (it->listing_dir == NULL) return;
+
+    if (can_snap == 1) {
+        it->snap = ostc_cache_listing_snapshot(it->os, it->listing_dir, object_types, key, n_keys);
+        if (it->snap != NULL) {
+            log_printf(10, "LISTING_CACHE_HIT dir=%s n=%d\n", it->listing_dir, tbx_stack_count(it->snap));
+            it->listing_state = OSTC_LISTING_SNAP;
+            return;
+        }
+    }
+
+    //** Make sure the directory itself is in the cache so the entries have somewhere to go
+    _ostc_cache_populate_prefix(it->os, creds, it->listing_dir, 0);
+
+    tbx_stack_init(&tree);
+    OSTC_LOCK(ostc);
+    err = _ostc_lio_cache_tree_walk(it->os, it->listing_dir, &tree, NULL, 0, OSTC_MAX_RECURSE);
+    it->listing_gen = ostc->listing_gen;
+    OSTC_UNLOCK(ostc);
+    tbx_stack_empty(&tree, 0);
+    if (err != 0) return;
+
+    apr_pool_create(&(it->mpool), NULL);
+    it->seen = apr_hash_make(it->mpool);
+    it->listing_state = OSTC_LISTING_RECORD;
+}
+
+//***********************************************************************
+// ostc_next_snap_object - Returns the next object from the directory snapshot
+//***********************************************************************
+
+int ostc_next_snap_object(ostc_object_iter_t *it, char **fname, int *prefix_len)
+{
+    ostc_snap_entry_t *e;
+    int ftype, i;
+
+    e = tbx_stack_pop(it->snap);
+    if (e == NULL) {
+        *fname = NULL;
+        *prefix_len = -1;
+        return(0);
+    }
+
+    *fname = e->fname;
+    e->fname = NULL;
+    *prefix_len = (it->listing_dir[1] == 0) ? 0 : strlen(it->listing_dir);
+    ftype = e->ftype;
+
+    if (it->iter_type == OSTC_ITER_ALIST) {
+        for (i=0; i<it->n_keys; i++) {
+            it->v_size[i] = it->v_size_initial[i];
+            if (it->v_size[i] < 0) it->val[i] = NULL;
+            osf_store_val(e->val[i], e->v_size[i], &(it->val[i]), &(it->v_size[i]));
+        }
+    }
+
+    ostc_snap_entry_destroy(e, it->n_keys);
+
+    return(ftype);
+}
+
 //***********************************************************************
 // ostc_next_object - Returns the iterators next matching object
 //***********************************************************************
@@ -1822,9 +2394,15 @@ int ostc_next_object(os_object_iter_t *oit, char **fname, int *prefix_len)
         return(-2);
     }
 
+    if (it->listing_state == OSTC_LISTING_SNAP) return(ostc_next_snap_object(it, fname, prefix_len));
+
     ftype = os_next_object(ostc->os_child, it->it_child, fname, prefix_len);
     //** Last object so return
     if (ftype <= 0) {
+        if ((ftype == 0) && (it->listing_state == OSTC_LISTING_RECORD)) {
+            ostc_cache_listing_complete(it);
+            it->listing_state = OSTC_LISTING_NONE;
+        }
         *fname = NULL;
         *prefix_len = -1;
         log_printf(5, "No more objects\n");
@@ -1845,6 +2423,8 @@ int ostc_next_object(os_object_iter_t *oit, char **fname, int *prefix_len)
         }
     }
 
+    if (it->listing_state == OSTC_LISTING_RECORD) ostc_cache_listing_add(it, *fname, ftype);
+
     log_printf(5, "END\n");
 
     return(ftype);
@@ -1858,12 +2438,22 @@ void ostc_destroy_object_iter(os_object_iter_t *oit)
 {
     ostc_object_iter_t *it = (ostc_object_iter_t *)oit;
     ostc_priv_t *ostc = (ostc_priv_t *)it->os->priv;
+    ostc_snap_entry_t *e;
 
     if (it == NULL) {
         log_printf(0, "ERROR: it=NULL\n");
         return;
     }
 
+    if (it->snap != NULL) {
+        while ((e = tbx_stack_pop(it->snap)) != NULL) {
+            ostc_snap_entry_destroy(e, it->n_keys);
+        }
+        tbx_stack_free(it->snap, 0);
+    }
+    if (it->listing_dir != NULL) free(it->listing_dir);
+    if (it->mpool != NULL) apr_pool_destroy(it->mpool);
+
     if (it->it_child != NULL) os_destroy_object_iter(ostc->os_child, it->it_child);
     if (it->iter_type == OSTC_ITER_ALIST) ostc_attr_cacheprep_destroy(&(it->cp));
 
@@ -1910,6 +2500,13 @@ os_object_iter_t *ostc_create_object_iter(lio_object_service_fn_t *os, lio_creds
         *it_attr = (os_attr_iter_t *)&(it->it_attr);
     }
 
+    //** See if we can serve it from a directory snapshot.  Only possible if no attrs are wanted
+    ostc_listing_setup(it, creds, path, object_regex, object_types, recurse_depth, NULL, 0, (((attr == NULL) && (it_attr == NULL)) ? 1 : 0));
+    if (it->listing_state == OSTC_LISTING_SNAP) {
+        log_printf(5, "END\n");
+        return(it);
+    }
+
     //** Make the gop and execute it
     it->it_child = os_create_object_iter(ostc->os_child, creds,  path, object_regex, object_types, attr, recurse_depth, achild, v_max);
 
@@ -1953,6 +2550,12 @@ os_object_iter_t *ostc_create_object_iter_alist(lio_object_service_fn_t *os, lio
     tbx_type_malloc(it->v_size_initial, int, n_keys);
     memcpy(it->v_size_initial, it->v_size, n_keys*sizeof(int));
 
+    ostc_listing_setup(it, creds, path, object_regex, object_types, recurse_depth, key, n_keys, 1);
+    if (it->listing_state == OSTC_LISTING_SNAP) {
+        log_printf(5, "END\n");
+        return(it);
+    }
+
     //** Make the gop and execute it
     it->it_child = os_create_object_iter_alist(ostc->os_child, creds, path, object_regex, object_types,
                    recurse_depth, it->cp.key, it->cp.val, it->cp.v_size, it->cp.n_keys_total);
@@ -1970,6 +2573,45 @@ os_object_iter_t *ostc_create_object_iter_alist(lio_object_service_fn_t *os, lio
 }
 
 
+//***********************************************************************
+// ostc_create_object_iter_predicate - Creates a predicate filtered alist
+//  iterator.  The results aren't a complete listing so they are never
+//  recorded or served from the listing cache.
+//***********************************************************************
+
+os_object_iter_t *ostc_create_object_iter_predicate(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int object_types,
+        int recurse_depth, lio_os_predicate_t *pred, char **key, void **val, int *v_size, int n_keys)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+    ostc_object_iter_t *it;
+
+    if (pred == NULL) return(ostc_create_object_iter_alist(os, creds, path, object_regex, object_types, recurse_depth, key, val, v_size, n_keys));
+    if (ostc->os_child->create_object_iter_predicate == NULL) return(NULL);
+
+    //** Make the iterator handle
+    tbx_type_malloc_clear(it, ostc_object_iter_t, 1);
+    it->iter_type = OSTC_ITER_ALIST;
+    it->os = os;
+    it->val = val;
+    it->v_size = v_size;
+    it->n_keys = n_keys;
+    it->listing_state = OSTC_LISTING_NONE;
+    ostc_attr_cacheprep_setup(&(it->cp), it->n_keys, key, val, v_size, 0);
+
+    tbx_type_malloc(it->v_size_initial, int, n_keys);
+    memcpy(it->v_size_initial, it->v_size, n_keys*sizeof(int));
+
+    it->it_child = os_create_object_iter_predicate(ostc->os_child, creds, path, object_regex, object_types,
+                   recurse_depth, pred, it->cp.key, it->cp.val, it->cp.v_size, it->cp.n_keys_total);
+    if (it->it_child == NULL) {
+        ostc_destroy_object_iter(it);
+        it = NULL;
+    }
+
+    return(it);
+}
+
+
 //***********************************************************************
 // ostc_open_object_fn - Handles the actual object open
 //***********************************************************************
@@ -2117,6 +2759,30 @@ gop_op_generic_t *ostc_fsck_object(lio_object_service_fn_t *os, lio_creds_t *cre
 }
 
 
+//***********************************************************************
+//  ostc_aggregate - Aggregation walks the namespace so bypass the cache
+//***********************************************************************
+
+gop_op_generic_t *ostc_aggregate(lio_object_service_fn_t *os, lio_creds_t *creds, lio_os_regex_table_t *path, lio_os_regex_table_t *object_regex, int obj_types, int recurse_depth, char *key, lio_os_aggregate_t *agg)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+
+    if (ostc->os_child->aggregate == NULL) return(gop_dummy(gop_failure_status));
+    return(os_aggregate(ostc->os_child, creds, path, object_regex, obj_types, recurse_depth, key, agg));
+}
+
+//***********************************************************************
+//  ostc_abort_aggregate - Aborts an ongoing aggregate
+//***********************************************************************
+
+gop_op_generic_t *ostc_abort_aggregate(lio_object_service_fn_t *os, gop_op_generic_t *gop)
+{
+    ostc_priv_t *ostc = (ostc_priv_t *)os->priv;
+
+    if (ostc->os_child->abort_aggregate == NULL) return(gop_dummy(gop_failure_status));
+    return(os_abort_aggregate(ostc->os_child, gop));
+}
+
 //***********************************************************************
 // ostc_next_fsck - Returns the next problem object
 //***********************************************************************
@@ -2201,6 +2867,7 @@ void ostc_destroy(lio_object_service_fn_t *os)
     //** Dump the cache 1 last time just to be safe
     _ostc_cleanup(os, ostc->cache_root, apr_time_now() + 4*ostc->entry_timeout);
     free_ostcdb_object(ostc->cache_root);
+    _ostc_negative_cleanup(os, apr_time_now() + 4*ostc->entry_timeout);
 
     free(ostc);
     free(os);
@@ -2244,6 +2911,7 @@ lio_object_service_fn_t *object_service_timecache_create(lio_service_manager_t *
 
     ostc->entry_timeout = apr_time_from_sec(tbx_inip_get_integer(fd, section, "entry_timeout", 20));
     ostc->cleanup_interval = apr_time_from_sec(tbx_inip_get_integer(fd, section, "cleanup_interval", 120));
+    ostc->max_negative = tbx_inip_get_integer(fd, section, "max_negative_entries", 100000);
 
     apr_pool_create(&ostc->mpool, NULL);
     apr_thread_mutex_create(&(ostc->lock), APR_THREAD_MUTEX_DEFAULT, ostc->mpool);
@@ -2252,6 +2920,7 @@ lio_object_service_fn_t *object_service_timecache_create(lio_service_manager_t *
 
     //** Make the root node
     ostc->cache_root = new_ostcdb_object(strdup("/"), OS_OBJECT_DIR_FLAG, 0, ostc->mpool);
+    ostc->negative = apr_hash_make(ostc->mpool);
 
     //** Get the thread pool to use
     ostc->tpc = lio_lookup_service(ess, ESS_RUNNING, ESS_TPC_UNLIMITED);FATAL_UNLESS(ostc->tpc != NULL);
@@ -2272,6 +2941,7 @@ lio_object_service_fn_t *object_service_timecache_create(lio_service_manager_t *
     os->hardlink_object = ostc_hardlink_object;
     os->create_object_iter = ostc_create_object_iter;
     os->create_object_iter_alist = ostc_create_object_iter_alist;
+    os->create_object_iter_predicate = ostc_create_object_iter_predicate;
     os->next_object = ostc_next_object;
     os->destroy_object_iter = ostc_destroy_object_iter;
     os->open_object = ostc_open_object;
@@ -2297,6 +2967,8 @@ lio_object_service_fn_t *object_service_timecache_create(lio_service_manager_t *
     os->destroy_fsck_iter = ostc_destroy_fsck_iter;
     os->next_fsck = ostc_next_fsck;
     os->fsck_object = ostc_fsck_object;
+    os->aggregate = ostc_aggregate;
+    os->abort_aggregate = ostc_abort_aggregate;
 
     tbx_thread_create_assert(&(ostc->cleanup_thread), NULL, ostc_cache_compact_thread, (void *)os, ostc->mpool);
 
@@ -0,0 +1,166 @@
+/*
+   Copyright 2016 Vanderbilt University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+//***********************************************************************
+// Routines for limiting the number of copies and bandwidth per RID.
+// Used by migration and placement repair so draining a depot doesn't
+// swamp any single source or destination host.  Bandwidth is paced by
+// giving each RID a time when its budget frees up.  Each copy pushes that
+// time forward by the time the copy should take at the configured rate.
+//***********************************************************************
+
+#define _log_module_index 145
+
+#include <apr_time.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tbx/assert_result.h>
+#include <tbx/fmttypes.h>
+#include <tbx/log.h>
+#include <tbx/type_malloc.h>
+
+#include "rid_throttle.h"
+
+//***************************************************************
+// _rid_throttle_get - Returns the RID's entry creating it if needed
+//    NOTE: Assumes the throttle lock is held
+//***************************************************************
+
+lio_rid_throttle_entry_t *_rid_throttle_get(lio_rid_throttle_t *rt, char *rid_key)
+{
+    lio_rid_throttle_entry_t *r;
+
+    r = apr_hash_get(rt->table, rid_key, APR_HASH_KEY_STRING);
+    if (r == NULL) {
+        tbx_type_malloc_clear(r, lio_rid_throttle_entry_t, 1);
+        r->rid_key = strdup(rid_key);
+        apr_hash_set(rt->table, r->rid_key, APR_HASH_KEY_STRING, r);
+    }
+
+    return(r);
+}
+
+//***************************************************************
+// _rid_throttle_start - Returns the earliest time a copy could start given
+//    when the RID's budget frees up
+//***************************************************************
+
+apr_time_t _rid_throttle_start(apr_time_t next, apr_time_t now)
+{
+    return((next > now) ? next : now);
+}
+
+//***************************************************************
+// lio_rid_throttle_acquire - Waits until both the source and destination
+//    RIDs have a free copy slot and the bandwidth budget for nbytes.
+//    Either RID can be NULL if it isn't known.  Every acquire must be
+//    paired with a release once the copy completes.
+//***************************************************************
+
+void lio_rid_throttle_acquire(lio_rid_throttle_t *rt, char *src_rid, char *dest_rid, ex_off_t nbytes)
+{
+    lio_rid_throttle_entry_t *src, *dest;
+    apr_time_t now, start;
+
+    apr_thread_mutex_lock(rt->lock);
+    src = (src_rid != NULL) ? _rid_throttle_get(rt, src_rid) : NULL;
+    dest = (dest_rid != NULL) ? _rid_throttle_get(rt, dest_rid) : NULL;
+
+    while (((src != NULL) && (rt->src_max > 0) && (src->n_src >= rt->src_max)) ||
+            ((dest != NULL) && (rt->dest_max > 0) && (dest->n_dest >= rt->dest_max))) {
+        apr_thread_cond_wait(rt->cond, rt->lock);
+    }
+    if (src != NULL) src->n_src++;
+    if (dest != NULL) dest->n_dest++;
+
+    //** Now figure out when we can start based on the bandwidth budgets
+    now = apr_time_now();
+    start = now;
+    if ((src != NULL) && (rt->src_bw > 0)) start = _rid_throttle_start(src->src_next, start);
+    if ((dest != NULL) && (rt->dest_bw > 0)) start = _rid_throttle_start(dest->dest_next, start);
+    if ((src != NULL) && (rt->src_bw > 0)) src->src_next = start + (nbytes * APR_USEC_PER_SEC) / rt->src_bw;
+    if ((dest != NULL) && (rt->dest_bw > 0)) dest->dest_next = start + (nbytes * APR_USEC_PER_SEC) / rt->dest_bw;
+    apr_thread_mutex_unlock(rt->lock);
+
+    if (start > now) {
+        log_printf(5, "src=%s dest=%s nbytes=" XOT " delaying dt=" TT "\n", src_rid, dest_rid, nbytes, start - now);
+        apr_sleep(start - now);
+    }
+}
+
+//***************************************************************
+// lio_rid_throttle_release - Releases the copy slots
+//***************************************************************
+
+void lio_rid_throttle_release(lio_rid_throttle_t *rt, char *src_rid, char *dest_rid)
+{
+    lio_rid_throttle_entry_t *r;
+
+    apr_thread_mutex_lock(rt->lock);
+    if (src_rid != NULL) {
+        r = _rid_throttle_get(rt, src_rid);
+        r->n_src--;
+    }
+    if (dest_rid != NULL) {
+        r = _rid_throttle_get(rt, dest_rid);
+        r->n_dest--;
+    }
+    apr_thread_cond_broadcast(rt->cond);
+    apr_thread_mutex_unlock(rt->lock);
+}
+
+//***************************************************************
+// lio_rid_throttle_create - Creates a new throttle.  Use 0 for any limit
+//    that shouldn't be enforced.  Bandwidths are in bytes/sec.
+//***************************************************************
+
+lio_rid_throttle_t *lio_rid_throttle_create(int src_max, int dest_max, ex_off_t src_bw, ex_off_t dest_bw)
+{
+    lio_rid_throttle_t *rt;
+
+    tbx_type_malloc_clear(rt, lio_rid_throttle_t, 1);
+    assert_result(apr_pool_create(&(rt->mpool), NULL), APR_SUCCESS);
+    apr_thread_mutex_create(&(rt->lock), APR_THREAD_MUTEX_DEFAULT, rt->mpool);
+    apr_thread_cond_create(&(rt->cond), rt->mpool);
+    rt->table = apr_hash_make(rt->mpool);
+    rt->src_max = src_max;
+    rt->dest_max = dest_max;
+    rt->src_bw = src_bw;
+    rt->dest_bw = dest_bw;
+
+    return(rt);
+}
+
+//***************************************************************
+// lio_rid_throttle_destroy - Destroys the throttle
+//***************************************************************
+
+void lio_rid_throttle_destroy(lio_rid_throttle_t *rt)
+{
+    apr_hash_index_t *hi;
+    lio_rid_throttle_entry_t *r;
+
+    for (hi=apr_hash_first(NULL, rt->table); hi != NULL; hi = apr_hash_next(hi)) {
+        apr_hash_this(hi, NULL, NULL, (void **)&r);
+        free(r->rid_key);
+        free(r);
+    }
+
+    apr_thread_mutex_destroy(rt->lock);
+    apr_thread_cond_destroy(rt->cond);
+    apr_pool_destroy(rt->mpool);
+    free(rt);
+}
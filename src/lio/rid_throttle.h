@@ -0,0 +1,60 @@
+/*
+   Copyright 2016 Vanderbilt University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+//***********************************************************************
+// Per-RID concurrency and bandwidth limits for depot-to-depot copies
+//***********************************************************************
+
+#ifndef _RID_THROTTLE_H_
+#define _RID_THROTTLE_H_
+
+#include <apr_hash.h>
+#include <apr_pools.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+#include <apr_time.h>
+#include <lio/rid_throttle.h>
+
+#include "ex3/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct lio_rid_throttle_entry_t {
+    char *rid_key;
+    int n_src;                  //** Copies in flight reading from the RID
+    int n_dest;                 //** Copies in flight writing to the RID
+    apr_time_t src_next;        //** When the RID's read budget frees up
+    apr_time_t dest_next;       //** When the RID's write budget frees up
+};
+
+struct lio_rid_throttle_t {
+    apr_pool_t *mpool;
+    apr_thread_mutex_t *lock;
+    apr_thread_cond_t *cond;
+    apr_hash_t *table;
+    int src_max;                //** Max concurrent copies from a RID.  0 is unlimited
+    int dest_max;               //** Max concurrent copies to a RID.  0 is unlimited
+    ex_off_t src_bw;            //** Max bytes/sec read from a RID.  0 is unlimited
+    ex_off_t dest_bw;           //** Max bytes/sec written to a RID.  0 is unlimited
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
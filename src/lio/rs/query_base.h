@@ -30,8 +30,9 @@ extern "C" {
     struct lio_rsq_base_ele_t;
 struct lio_rsq_base_t;
 
-#define RSQ_BASE_OP_MAX_VAL 4
+#define RSQ_BASE_OP_MAX_VAL 5
 #define RSQ_BASE_OP_OR      4
+#define RSQ_BASE_OP_PLACEMENT 5  //** key is the placement mode to use.  Not part of the match
 
 #define RSQ_BASE_KV_MAX_VAL 3
 #define RSQ_BASE_KV_OP_BITMASK 7
@@ -31,8 +31,10 @@
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/stat.h>
 #include <tbx/append_printf.h>
 #include <tbx/apr_wrapper.h>
@@ -77,6 +79,11 @@ typedef struct {
     kvq_ele_t *pickone;
 } kvq_table_t;
 
+#define RSS_BIT_SET(bits, n)  (bits)[(n)>>6] |= ((uint64_t)1 << ((n) & 63))
+#define RSS_BIT_TEST(bits, n) (((bits)[(n)>>6] >> ((n) & 63)) & 1)
+
+#define RSS_WEIGHT_SCALE 1000000
+
 int _rs_simple_refresh(lio_resource_service_fn_t *rs);
 
 //***********************************************************************
@@ -149,7 +156,7 @@ int rss_test(lio_rsq_base_ele_t *q, lio_rss_rid_entry_t *rse, int n_match, kvq_e
                 if (strcmp(val, str_tomatch) != 0) found = 0;
                 break;
             case (RSQ_BASE_KV_PREFIX):
-                if (strncmp(val, str_tomatch, nlen) != 0) found = 0;
+                if (strncmp(val, str_tomatch, strlen(str_tomatch)) != 0) found = 0;
                 break;
             case (RSQ_BASE_KV_ANY):
                 break;
@@ -193,6 +200,385 @@ int rss_test(lio_rsq_base_ele_t *q, lio_rss_rid_entry_t *rse, int n_match, kvq_e
     return(found);
 }
 
+//***********************************************************************
+// rss_placement_parse - Converts the placement mode string
+//***********************************************************************
+
+int rss_placement_parse(char *mode, int default_mode)
+{
+    if (mode == NULL) return(default_mode);
+    if (strcasecmp(mode, "random") == 0) return(RSS_PLACEMENT_RANDOM);
+    if (strcasecmp(mode, "weighted") == 0) return(RSS_PLACEMENT_WEIGHTED);
+
+    log_printf(1, "Unknown placement mode=%s using default=%d\n", mode, default_mode);
+    return(default_mode);
+}
+
+//***********************************************************************
+// rss_index_compare - Sort routine for the attribute index
+//***********************************************************************
+
+int rss_index_compare(const void *p1, const void *p2)
+{
+    const lio_rss_index_ele_t *a = (const lio_rss_index_ele_t *)p1;
+    const lio_rss_index_ele_t *b = (const lio_rss_index_ele_t *)p2;
+    int n;
+
+    n = strcmp(a->key, b->key);
+    if (n != 0) return(n);
+    n = strcmp(a->value, b->value);
+    if (n != 0) return(n);
+    return(a->slot - b->slot);
+}
+
+//***********************************************************************
+// _rss_index_build - Makes the sorted attribute index used to generate
+//    candidate RIDs for a query.
+//   NOTE: No Locking is performed and random_array should already exist
+//***********************************************************************
+
+void _rss_index_build(lio_rs_simple_priv_t *rss)
+{
+    lio_rss_rid_entry_t *rse;
+    tbx_list_iter_t it;
+    char *key, *val;
+    int i, n;
+
+    rss->n_words = (rss->n_rids > 0) ? (rss->n_rids + 63) / 64 : 1;
+
+    n = 0;
+    for (i=0; i<rss->n_rids; i++) n += tbx_list_key_count(rss->random_array[i]->attr);
+    rss->n_index = n;
+    if (n == 0) {
+        rss->attr_index = NULL;
+        return;
+    }
+
+    tbx_type_malloc(rss->attr_index, lio_rss_index_ele_t, n);
+    n = 0;
+    for (i=0; i<rss->n_rids; i++) {
+        rse = rss->random_array[i];
+        it = tbx_list_iter_search(rse->attr, (tbx_list_key_t *)NULL, 0);
+        while ((n < rss->n_index) && (tbx_list_next(&it, (tbx_list_key_t **)&key, (tbx_list_data_t **)&val) == 0)) {
+            rss->attr_index[n].key = key;
+            rss->attr_index[n].value = (val != NULL) ? val : "";
+            rss->attr_index[n].slot = i;
+            n++;
+        }
+    }
+    rss->n_index = n;
+
+    qsort(rss->attr_index, rss->n_index, sizeof(lio_rss_index_ele_t), rss_index_compare);
+
+    log_printf(5, "n_rids=%d n_index=%d\n", rss->n_rids, rss->n_index);
+}
+
+//***********************************************************************
+// _rss_index_lower_bound - Returns the 1st index slot >= (key, val)
+//***********************************************************************
+
+int _rss_index_lower_bound(lio_rs_simple_priv_t *rss, char *key, char *val)
+{
+    lio_rss_index_ele_t *e;
+    int lo, hi, mid, n;
+
+    lo = 0;
+    hi = rss->n_index;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        e = &(rss->attr_index[mid]);
+        n = strcmp(e->key, key);
+        if (n == 0) n = strcmp(e->value, val);
+        if (n < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return(lo);
+}
+
+//***********************************************************************
+// _rss_index_term - Sets the bits for all RIDs matching the KV term.
+//    Returns 1 if the set is exact or 0 if it's a superset because of
+//    unique/pickone constraints which can only be resolved during the scan.
+//***********************************************************************
+
+int _rss_index_term(lio_rs_simple_priv_t *rss, lio_rsq_base_ele_t *q, uint64_t *bits)
+{
+    lio_rss_index_ele_t *e;
+    int k_op, v_op, klen, vlen, i, exact;
+    char *key, *val;
+
+    memset(bits, 0, sizeof(uint64_t)*rss->n_words);
+
+    k_op = q->key_op & RSQ_BASE_KV_OP_BITMASK;
+    v_op = q->val_op & RSQ_BASE_KV_OP_BITMASK;
+    exact = ((q->key_op | q->val_op) & (RSQ_BASE_KV_UNIQUE|RSQ_BASE_KV_PICKONE)) ? 0 : 1;
+    key = (q->key != NULL) ? q->key : "";
+    val = (q->val != NULL) ? q->val : "";
+    klen = strlen(key);
+    vlen = strlen(val);
+
+    //** Find where to start.  The index is sorted by key then value so exact
+    //** and prefix key matches are contiguous.
+    switch (k_op) {
+    case (RSQ_BASE_KV_EXACT):
+        i = _rss_index_lower_bound(rss, key, (v_op == RSQ_BASE_KV_ANY) ? "" : val);
+        break;
+    case (RSQ_BASE_KV_PREFIX):
+        i = _rss_index_lower_bound(rss, key, "");
+        break;
+    case (RSQ_BASE_KV_ANY):
+        i = 0;
+        break;
+    default:
+        return(1);  //** Never matches
+    }
+
+    for (; i<rss->n_index; i++) {
+        e = &(rss->attr_index[i]);
+        if (k_op == RSQ_BASE_KV_EXACT) {
+            if (strcmp(e->key, key) != 0) break;
+        } else if (k_op == RSQ_BASE_KV_PREFIX) {
+            if (strncmp(e->key, key, klen) != 0) break;
+        }
+
+        if (v_op == RSQ_BASE_KV_EXACT) {
+            if (strcmp(e->value, val) != 0) {
+                if (k_op == RSQ_BASE_KV_EXACT) break;  //** Values are sorted so we're done
+                continue;
+            }
+        } else if (v_op == RSQ_BASE_KV_PREFIX) {
+            if (strncmp(e->value, val, vlen) != 0) {
+                if (k_op == RSQ_BASE_KV_EXACT) break;
+                continue;
+            }
+        } else if (v_op != RSQ_BASE_KV_ANY) {
+            break;  //** Invalid value op so nothing matches
+        }
+
+        RSS_BIT_SET(bits, e->slot);
+    }
+
+    return(exact);
+}
+
+//***********************************************************************
+// _rss_query_candidates - Evaluates the query against the attribute index
+//    and stores the bitmap of possible RIDs in cand.  The set is a superset
+//    of the actual matches since unique/pickone terms depend on previous
+//    selections and are still checked with rss_test().
+//    Returns 0 on success and -1 if the query can't be used for filtering.
+//   NOTE: No Locking is performed
+//***********************************************************************
+
+int _rss_query_candidates(lio_resource_service_fn_t *rs, lio_rsq_base_t *query, uint64_t *cand)
+{
+    lio_rs_simple_priv_t *rss = (lio_rs_simple_priv_t *)rs->priv;
+    lio_rsq_base_ele_t *q;
+    uint64_t *stack, *a, *b, mask;
+    int *exact;
+    int n_ele, n_unique, n_pickone, n, i, err;
+
+    rs_query_count(rs, query, &n_ele, &n_unique, &n_pickone);
+    if (n_ele == 0) return(-1);
+
+    tbx_type_malloc(stack, uint64_t, n_ele * rss->n_words);
+    tbx_type_malloc(exact, int, n_ele);
+    mask = ((rss->n_rids & 63) == 0) ? ~(uint64_t)0 : ((uint64_t)1 << (rss->n_rids & 63)) - 1;
+
+    err = 0;
+    n = 0;
+    for (q = query->head; q != NULL; q = q->next) {
+        switch (q->op) {
+        case RSQ_BASE_OP_KV:
+            exact[n] = _rss_index_term(rss, q, &(stack[n*rss->n_words]));
+            n++;
+            break;
+        case RSQ_BASE_OP_PLACEMENT:  //** Not part of the match
+            break;
+        case RSQ_BASE_OP_NOT:
+            if (n < 1) { err = -1; goto finished; }
+            a = &(stack[(n-1)*rss->n_words]);
+            if (exact[n-1] == 1) {
+                for (i=0; i<rss->n_words; i++) a[i] = ~a[i];
+            } else {  //** Can't invert a superset so everything is possible
+                for (i=0; i<rss->n_words; i++) a[i] = ~(uint64_t)0;
+            }
+            a[rss->n_words-1] &= mask;
+            break;
+        case RSQ_BASE_OP_AND:
+        case RSQ_BASE_OP_OR:
+            if (n < 2) { err = -1; goto finished; }
+            a = &(stack[(n-2)*rss->n_words]);
+            b = &(stack[(n-1)*rss->n_words]);
+            if (q->op == RSQ_BASE_OP_AND) {
+                for (i=0; i<rss->n_words; i++) a[i] &= b[i];
+            } else {
+                for (i=0; i<rss->n_words; i++) a[i] |= b[i];
+            }
+            exact[n-2] = exact[n-2] && exact[n-1];
+            n--;
+            break;
+        default:
+            err = -1;
+            goto finished;
+        }
+    }
+
+    if (n < 1) {
+        err = -1;
+    } else {
+        memcpy(cand, &(stack[(n-1)*rss->n_words]), sizeof(uint64_t)*rss->n_words);
+    }
+
+finished:
+    free(stack);
+    free(exact);
+    return(err);
+}
+
+//***********************************************************************
+// rss_bits_next - Returns the next set bit >= n or n_max if none
+//***********************************************************************
+
+int rss_bits_next(uint64_t *bits, int n, int n_max)
+{
+    uint64_t w;
+    int i;
+
+    if (n >= n_max) return(n_max);
+
+    i = n >> 6;
+    w = bits[i] & (~(uint64_t)0 << (n & 63));
+    while (w == 0) {
+        i++;
+        if ((i<<6) >= n_max) return(n_max);
+        w = bits[i];
+    }
+
+    n = i<<6;
+    while ((w & 1) == 0) {
+        w >>= 1;
+        n++;
+    }
+    return((n < n_max) ? n : n_max);
+}
+
+//***********************************************************************
+// _rss_query_eval - Evaluates the global and optional local query against
+//    the RID.  Returns 1 on a match, 0 if not, and -1 on an empty stack.
+//***********************************************************************
+
+int _rss_query_eval(lio_rsq_base_t *query_global, kvq_table_t *kvq_global, lio_rsq_base_t *query_local, kvq_table_t *kvq_local, lio_rss_rid_entry_t *rse, int i, tbx_stack_t *stack)
+{
+    lio_rsq_base_ele_t *q;
+    kvq_table_t *kvq;
+    int loop, loop_end, i_unique, i_pickone, state;
+    int *a, *b, *op_state;
+
+    loop_end = (query_local != NULL) ? 2 : 1;
+
+    tbx_stack_empty(stack, 1);
+    q = query_global->head;
+    kvq = kvq_global;
+    for (loop=0; loop<loop_end; loop++) {
+        i_unique = 0;
+        i_pickone = 0;
+        while (q != NULL) {
+            state = -1;
+            switch (q->op) {
+            case RSQ_BASE_OP_KV:
+                state = rss_test(q, rse, i, kvq->unique[i_unique], &(kvq->pickone[i_pickone]));
+                log_printf(15, "KV: key=%s val=%s i_unique=%d i_pickone=%d loop=%d rss_test=%d rse->rid_key=%s\n", q->key, q->val, i_unique, i_pickone, loop, state, rse->rid_key);
+                if ((q->key_op & RSQ_BASE_KV_UNIQUE) || (q->val_op & RSQ_BASE_KV_UNIQUE)) i_unique++;
+                if ((q->key_op & RSQ_BASE_KV_PICKONE) || (q->val_op & RSQ_BASE_KV_PICKONE)) i_pickone++;
+                break;
+            case RSQ_BASE_OP_NOT:
+                a = (int *)tbx_stack_pop(stack);
+                state = (*a == 0) ? 1 : 0;
+                free(a);
+                break;
+            case RSQ_BASE_OP_AND:
+                a = (int *)tbx_stack_pop(stack);
+                b = (int *)tbx_stack_pop(stack);
+                state = (*a) && (*b);
+                free(a);
+                free(b);
+                break;
+            case RSQ_BASE_OP_OR:
+                a = (int *)tbx_stack_pop(stack);
+                b = (int *)tbx_stack_pop(stack);
+                state = (*a) || (*b);
+                free(a);
+                free(b);
+                break;
+            case RSQ_BASE_OP_PLACEMENT:  //** Not part of the match
+                q = q->next;
+                continue;
+            }
+
+            tbx_type_malloc(op_state, int, 1);
+            *op_state = state;
+            tbx_stack_push(stack, (void *)op_state);
+            log_printf(15, " stack_size=%d loop=%d push state=%d\n",tbx_stack_count(stack), loop, state);
+            q = q->next;
+        }
+
+        if (query_local != NULL) {
+            q = query_local->head;
+            kvq = kvq_local;
+        }
+    }
+
+    op_state = (int *)tbx_stack_pop(stack);
+    if (op_state == NULL) return(-1);
+
+    state = *op_state;
+    free(op_state);
+    return(state);
+}
+
+//***********************************************************************
+// _rss_weight - Returns the placement weight for the RID.  It's scaled by
+//    the free space fraction, the inquiry latency, and the number of recent
+//    allocations sent to the RID.
+//***********************************************************************
+
+int64_t _rss_weight(lio_rs_simple_priv_t *rss, lio_rss_rid_entry_t *rse)
+{
+    double w;
+    int64_t n;
+
+    w = 1.0;
+    if (rse->space_total > 0) {
+        w = (rse->space_free > 0) ? (double)rse->space_free / rse->space_total : 0;
+        if (w > 1) w = 1;
+    }
+    w = w * rss->latency_ref / (rss->latency_ref + rse->latency);
+    w = w / (1 + rse->n_alloc);
+
+    n = RSS_WEIGHT_SCALE * w;
+    return((n > 0) ? n : 1);
+}
+
+//***********************************************************************
+// _rss_placement_mode - Returns the placement mode to use for the query
+//***********************************************************************
+
+int _rss_placement_mode(lio_rs_simple_priv_t *rss, lio_rsq_base_t *query)
+{
+    lio_rsq_base_ele_t *q;
+
+    for (q = query->head; q != NULL; q = q->next) {
+        if (q->op == RSQ_BASE_OP_PLACEMENT) return(rss_placement_parse(q->key, rss->placement));
+    }
+
+    return(rss->placement);
+}
+
 //***********************************************************************
 // rs_simple_request - Processes a simple RS request
 //***********************************************************************
@@ -202,16 +588,18 @@ gop_op_generic_t *rs_simple_request(lio_resource_service_fn_t *arg, data_attr_t
     lio_rs_simple_priv_t *rss = (lio_rs_simple_priv_t *)arg->priv;
     lio_rsq_base_t *query_global = (lio_rsq_base_t *)rsq;
     lio_rsq_base_t *query_local;
-    kvq_table_t kvq_global, kvq_local, *kvq;
+    kvq_table_t kvq_global, kvq_local;
     apr_hash_t *pick_from;
     lio_rid_change_entry_t *rid_change;
     ex_off_t change;
     gop_op_status_t status;
     gop_opque_t *que;
     lio_rss_rid_entry_t *rse;
-    lio_rsq_base_ele_t *q;
-    int slot, rnd_off, i, j, k, i_unique, i_pickone, found, err_cnt, loop, loop_end;
-    int state, *a, *b, *op_state, unique_size;
+    int slot, rnd_off, i, j, k, found, err_cnt;
+    int state, unique_size, mode, weighted;
+    int64_t w, w_total;
+    uint64_t *cand_global, *cand_local, *cand;
+    lio_rss_rid_entry_t *best;
     tbx_stack_t *stack;
 
     log_printf(15, "rs_simple_request: START rss->n_rids=%d n_rid=%d req_size=%d fixed_size=%d\n", rss->n_rids, n_rid, req_size, fixed_size);
@@ -225,8 +613,17 @@ gop_op_generic_t *rs_simple_request(lio_resource_service_fn_t *arg, data_attr_t
         return(gop_dummy(gop_failure_status));
     }
 
+    mode = _rss_placement_mode(rss, query_global);
+
+    //** Generate the candidate RIDs from the attribute index
+    tbx_type_malloc(cand_global, uint64_t, rss->n_words);
+    tbx_type_malloc(cand_local, uint64_t, rss->n_words);
+    if (_rss_query_candidates(arg, query_global, cand_global) != 0) {
+        free(cand_global);  //** Can't use the index so fall back to scanning all the RIDs
+        cand_global = NULL;
+    }
+
     //** Determine the query sizes and make the processing arrays
-    memset(&kvq, 0, sizeof(kvq));
     rs_query_count(arg, rsq, &i, &(kvq_global.n_unique), &(kvq_global.n_pickone));
 
     log_printf(15, "rs_simple_request: n_unique=%d n_pickone=%d\n", kvq_global.n_unique, kvq_global.n_pickone);
@@ -261,14 +658,16 @@ gop_op_generic_t *rs_simple_request(lio_resource_service_fn_t *arg, data_attr_t
 
     for (i=0; i < n_rid; i++) {
         found = 0;
-        loop_end = 1;
         query_local = NULL;
         rnd_off = tbx_random_get_int64(0, rss->n_rids-1);
+        cand = cand_global;
+        best = NULL;
+        w_total = 0;
 
         if (hints_list != NULL) {
             query_local = (lio_rsq_base_t *)hints_list[i].local_rsq;
-            if (query_local != NULL) {
-                loop_end = 2;
+            if (query_local != NULL) {  //** The local query replaces the global one in _rss_query_eval()
+                cand = (_rss_query_candidates(arg, query_local, cand_local) == 0) ? cand_local : NULL;
                 rs_query_count(arg, query_local, &j, &(kvq_local.n_unique), &(kvq_local.n_pickone));
                 if ((kvq_local.n_unique != 0) && (kvq_local.n_pickone != 0)) {
                     log_printf(0, "Unsupported use of pickone/unique in local RSQ hints_list[%d]=%s!\n", i, hints_list[i].fixed_rid_key);
@@ -288,6 +687,7 @@ gop_op_generic_t *rs_simple_request(lio_resource_service_fn_t *arg, data_attr_t
                     continue;   //** Skip the check
                 }
                 rnd_off = rse->slot;
+                cand = NULL;  //** The fixed RID has to be tested directly
             }
         }
 
@@ -301,8 +701,21 @@ gop_op_generic_t *rs_simple_request(lio_resource_service_fn_t *arg, data_attr_t
             }
         }
 
+        weighted = ((mode == RSS_PLACEMENT_WEIGHTED) && (i>=fixed_size) && (pick_from == NULL)) ? 1 : 0;
+
         for (j=0; j<rss->n_rids; j++) {
             slot = (rnd_off+j) % rss->n_rids;
+            if ((cand != NULL) && (RSS_BIT_TEST(cand, slot) == 0)) {  //** Skip to the next candidate
+                k = rss_bits_next(cand, slot, rss->n_rids);
+                if (k == rss->n_rids) {  //** Nothing left before the wrap
+                    if (slot >= rnd_off) j += rss->n_rids - slot - 1;  //** Jump to the wrap point
+                    else j = rss->n_rids;  //** Already wrapped so we're done
+                    continue;
+                }
+                j += k - slot;
+                if (j >= rss->n_rids) break;
+                slot = k;
+            }
             rse = rss->random_array[slot];
             if (pick_from != NULL) {
                 rid_change = apr_hash_get(pick_from, rse->rid_key, APR_HASH_KEY_STRING);
@@ -321,90 +734,20 @@ gop_op_generic_t *rs_simple_request(lio_resource_service_fn_t *arg, data_attr_t
             log_printf(15, "i=%d j=%d slot=%d rse->rid_key=%s rse->status=%d\n", i, j, slot, rse->rid_key, rse->status);
             if ((rse->status != RS_STATUS_UP) && (i>=fixed_size)) continue;  //** Skip this if disabled and not in the fixed list
 
-            tbx_stack_empty(stack, 1);
-            q = query_global->head;
-            kvq = &kvq_global;
-            for (loop=0; loop<loop_end; loop++) {
-                i_unique = 0;
-                i_pickone = 0;
-                while (q != NULL) {
-                    state = -1;
-                    switch (q->op) {
-                    case RSQ_BASE_OP_KV:
-                        state = rss_test(q, rse, i, kvq->unique[i_unique], &(kvq->pickone[i_pickone]));
-                        log_printf(0, "KV: key=%s val=%s i_unique=%d i_pickone=%d loop=%d rss_test=%d rse->rid_key=%s\n", q->key, q->val, i_unique, i_pickone, loop, state, rse->rid_key);
-                        tbx_log_flush();
-                        if ((q->key_op & RSQ_BASE_KV_UNIQUE) || (q->val_op & RSQ_BASE_KV_UNIQUE)) i_unique++;
-                        if ((q->key_op & RSQ_BASE_KV_PICKONE) || (q->val_op & RSQ_BASE_KV_PICKONE)) i_pickone++;
-                        break;
-                    case RSQ_BASE_OP_NOT:
-                        a = (int *)tbx_stack_pop(stack);
-                        state = (*a == 0) ? 1 : 0;
-                        //log_printf(0, "NOT(%d)=%d\n", *a, state);
-                        free(a);
-                        break;
-                    case RSQ_BASE_OP_AND:
-                        a = (int *)tbx_stack_pop(stack);
-                        b = (int *)tbx_stack_pop(stack);
-                        state = (*a) && (*b);
-                        //log_printf(0, "%d AND %d = %d\n", *a, *b, state);
-                        free(a);
-                        free(b);
-                        break;
-                    case RSQ_BASE_OP_OR:
-                        a = (int *)tbx_stack_pop(stack);
-                        b = (int *)tbx_stack_pop(stack);
-                        state = a || b;
-                        //log_printf(0, "%d OR %d = %d\n", *a, *b, state);
-                        free(a);
-                        free(b);
-                        break;
-                    }
-
-                    tbx_type_malloc(op_state, int, 1);
-                    *op_state = state;
-                    tbx_stack_push(stack, (void *)op_state);
-                    log_printf(15, " stack_size=%d loop=%d push state=%d\n",tbx_stack_count(stack), loop, state);
-                    tbx_log_flush();
-                    q = q->next;
-                }
-
-                if (query_local != NULL) {
-                    q = query_local->head;
-                    kvq = &kvq_local;
-                }
-            }
-
-            op_state = (int *)tbx_stack_pop(stack);
-            state = -1;
-            if (op_state != NULL) {
-                state = *op_state;
-                free(op_state);
-            }
-
-            if (op_state == NULL) {
+            state = _rss_query_eval(query_global, &kvq_global, query_local, &kvq_local, rse, i, stack);
+            if (state == -1) {
                 log_printf(1, "rs_simple_request: ERROR processing i=%d EMPTY STACK\n", i);
                 found = 0;
                 status.op_status = OP_STATE_FAILURE;
                 status.error_code = RS_ERROR_EMPTY_STACK;
             } else if  (state == 1) { //** Got one
-                log_printf(15, "rs_simple_request: processing i=%d ds_key=%s\n", i, rse->ds_key);
-                found = 1;
-                if ((i<fixed_size) && hints_list) hints_list[i].status = RS_ERROR_OK;
-
-                for (k=0; k<req_size; k++) {
-                    if (req[k].rid_index == i) {
-                        log_printf(15, "rs_simple_request: i=%d ds_key=%s, rid_key=%s size=" XOT "\n", i, rse->ds_key, rse->rid_key, req[k].size);
-                        req[k].rid_key = strdup(rse->rid_key);
-                        req[k].gop = ds_allocate(rss->ds, rse->ds_key, da, req[k].size, caps[k], timeout);
-                        gop_opque_add(que, req[k].gop);
-                    }
-                }
-
-                if (rid_change != NULL) { //** Flag that I'm tweaking things.  The caller does the source pending/delta half
-                    rid_change->delta -= change;
-                    rid_change->state = ((llabs(rid_change->delta) <= rid_change->tolerance) || (rid_change->tolerance == 0)) ? 1 : 0;
+                if (weighted == 1) {  //** Weighted reservoir sample so keep going
+                    w = _rss_weight(rss, rse);
+                    w_total += w;
+                    if (tbx_random_get_int64(0, w_total-1) < w) best = rse;
+                    continue;
                 }
+                found = 1;
                 break;  //** Got one so exit the RID scan and start the next one
             } else if (i<fixed_size) {  //** This should have worked so flag an error
                 if (hints_list) {
@@ -422,6 +765,35 @@ gop_op_generic_t *rs_simple_request(lio_resource_service_fn_t *arg, data_attr_t
             }
         }
 
+        if (best != NULL) {  //** Re-run the winner so the unique/pickone tables reflect it and not the last match
+            rse = best;
+            for (k=0; k<unique_size; k++) memset(&(kvq_global.unique[k][i]), 0, sizeof(kvq_ele_t));
+            if (i == 0) memset(kvq_global.pickone, 0, sizeof(kvq_ele_t) * ((kvq_global.n_pickone == 0) ? 1 : kvq_global.n_pickone + 1));
+            _rss_query_eval(query_global, &kvq_global, query_local, &kvq_local, rse, i, stack);
+            found = 1;
+            log_printf(15, "rs_simple_request: weighted i=%d rid_key=%s w_total=" I64T "\n", i, rse->rid_key, w_total);
+        }
+
+        if (found == 1) {
+            log_printf(15, "rs_simple_request: processing i=%d ds_key=%s\n", i, rse->ds_key);
+            if ((i<fixed_size) && hints_list) hints_list[i].status = RS_ERROR_OK;
+
+            for (k=0; k<req_size; k++) {
+                if (req[k].rid_index == i) {
+                    log_printf(15, "rs_simple_request: i=%d ds_key=%s, rid_key=%s size=" XOT "\n", i, rse->ds_key, rse->rid_key, req[k].size);
+                    req[k].rid_key = strdup(rse->rid_key);
+                    req[k].gop = ds_allocate(rss->ds, rse->ds_key, da, req[k].size, caps[k], timeout);
+                    gop_opque_add(que, req[k].gop);
+                }
+            }
+            rse->n_alloc++;
+
+            if (rid_change != NULL) { //** Flag that I'm tweaking things.  The caller does the source pending/delta half
+                rid_change->delta -= change;
+                rid_change->state = ((llabs(rid_change->delta) <= rid_change->tolerance) || (rid_change->tolerance == 0)) ? 1 : 0;
+            }
+        }
+
         if ((found == 0) && (i>=fixed_size)) break;
 
     }
@@ -441,6 +813,9 @@ gop_op_generic_t *rs_simple_request(lio_resource_service_fn_t *arg, data_attr_t
 
     tbx_stack_free(stack, 1);
 
+    if (cand_global != NULL) free(cand_global);
+    free(cand_local);
+
     log_printf(15, "rs_simple_request: END n_rid=%d\n", n_rid);
 
     apr_thread_mutex_unlock(rss->lock);
@@ -733,6 +1108,7 @@ int rss_perform_check(lio_resource_service_fn_t *rs)
     gop_opque_t *q;
     gop_op_generic_t *gop;
     lio_blacklist_t *bl;
+    apr_time_t dt;
 
     log_printf(5, "START\n");
 
@@ -767,6 +1143,8 @@ int rss_perform_check(lio_resource_service_fn_t *rs)
         ce = gop_get_private(gop);
         prev_status = ce->re->status;
         if (status.op_status == OP_STATE_SUCCESS) {  //** Got a valid response
+            dt = gop_time_exec(gop);
+            ce->re->latency = (ce->re->latency == 0) ? dt : (3*ce->re->latency + dt) / 4;
             ce->re->space_free = ds_res_inquire_get(rss->ds, DS_INQUIRE_FREE, ce->space);
             ce->re->space_used = ds_res_inquire_get(rss->ds, DS_INQUIRE_USED, ce->space);
             ce->re->space_total = ds_res_inquire_get(rss->ds, DS_INQUIRE_TOTAL, ce->space);
@@ -780,6 +1158,7 @@ int rss_perform_check(lio_resource_service_fn_t *rs)
         } else {  //** No response so mark it as down
             if (ce->re->status != RS_STATUS_IGNORE) ce->re->status = RS_STATUS_DOWN;
         }
+        ce->re->n_alloc /= 2;  //** Age the recent allocation count
         if (prev_status != ce->re->status) status_change = 1;
 
         //** Blacklist it if needed
@@ -950,6 +1329,8 @@ int _rs_simple_load(lio_resource_service_fn_t *res, char *fname)
         }
     }
 
+    _rss_index_build(rss);
+
     tbx_inip_destroy(kf);
 
     log_printf(5, "END n_rids=%d\n", rss->n_rids);
@@ -979,6 +1360,9 @@ int _rs_simple_refresh(lio_resource_service_fn_t *rs)
         rss->modify_time = sbuf.st_mtime;
         if (rss->rid_table != NULL) tbx_list_destroy(rss->rid_table);
         if (rss->random_array != NULL) free(rss->random_array);
+        if (rss->attr_index != NULL) free(rss->attr_index);
+        rss->random_array = NULL;
+        rss->attr_index = NULL;
         err = _rs_simple_load(rs, rss->fname);  //** Load the new file
         _rss_make_check_table(rs);  //** and make the new inquiry table
         apr_thread_cond_signal(rss->cond);  //** Notify the check thread that we made a change
@@ -1017,6 +1401,7 @@ void rs_simple_destroy(lio_resource_service_fn_t *rs)
     if (rss->rid_table != NULL) tbx_list_destroy(rss->rid_table);
 
     free(rss->random_array);
+    if (rss->attr_index != NULL) free(rss->attr_index);
     free(rss->fname);
     free(rss);
     free(rs);
@@ -1032,6 +1417,7 @@ lio_resource_service_fn_t *rs_simple_create(void *arg, tbx_inip_file_t *kf, char
     lio_service_manager_t *ess = (lio_service_manager_t *)arg;
     lio_rs_simple_priv_t *rss;
     lio_resource_service_fn_t *rs;
+    char *str;
 
     //** Create the new RS list
     tbx_type_malloc_clear(rss, lio_rs_simple_priv_t, 1);
@@ -1072,6 +1458,11 @@ lio_resource_service_fn_t *rs_simple_create(void *arg, tbx_inip_file_t *kf, char
     rss->check_interval = tbx_inip_get_integer(kf, section, "check_interval", 300);
     rss->check_timeout = tbx_inip_get_integer(kf, section, "check_timeout", 60);
     rss->min_free = tbx_inip_get_integer(kf, section, "min_free", 100*1024*1024);
+    str = tbx_inip_get_string(kf, section, "placement", "random");
+    rss->placement = rss_placement_parse(str, RSS_PLACEMENT_RANDOM);
+    free(str);
+    rss->latency_ref = tbx_inip_get_integer(kf, section, "latency_ref", 10000);
+    if (rss->latency_ref <= 0) rss->latency_ref = 1;
 
     //** Set the modify time to force a change
     rss->modify_time = 0;
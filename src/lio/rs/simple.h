@@ -21,7 +21,9 @@
 #ifndef _RS_SIMPLE_H_
 #define _RS_SIMPLE_H_
 
+#include <apr_time.h>
 #include <gop/opque.h>
+#include <stdint.h>
 #include <tbx/iniparse.h>
 #include <tbx/list.h>
 
@@ -35,7 +37,11 @@ extern "C" {
 
 #define RS_TYPE_SIMPLE "simple"
 
+#define RSS_PLACEMENT_RANDOM   0   //** 1st matching RID from a random starting point
+#define RSS_PLACEMENT_WEIGHTED 1   //** Weighted by free space, latency, and recent allocations
+
 lio_resource_service_fn_t *rs_simple_create(void *arg, tbx_inip_file_t *fd, char *section);
+int rss_placement_parse(char *mode, int default_mode);
 
 struct lio_rss_rid_entry_t {
     char *rid_key;
@@ -46,8 +52,16 @@ struct lio_rss_rid_entry_t {
     ex_off_t space_total;
     ex_off_t space_used;
     ex_off_t space_free;
+    apr_time_t latency;   //** Running average of the inquiry time in us
+    int n_alloc;          //** Recent allocations sent to the RID.  Aged on each check
 };
 
+typedef struct {       //** Attribute index entry.  Strings belong to the RID's attr list
+    char *key;
+    char *value;
+    int slot;          //** Slot in the random_array
+} lio_rss_index_ele_t;
+
 struct lio_rss_check_entry_t {
     char *ds_key;
     char *rid_key;
@@ -58,6 +72,7 @@ struct lio_rss_check_entry_t {
 struct lio_rs_simple_priv_t {
     tbx_list_t *rid_table;
     lio_rss_rid_entry_t **random_array;
+    lio_rss_index_ele_t *attr_index;  //** All the RID attributes sorted by key, value, and slot
     lio_data_service_fn_t *ds;
     lio_service_manager_t *ess;
     data_attr_t *da;
@@ -73,12 +88,16 @@ struct lio_rs_simple_priv_t {
     char *fname;
     uint64_t min_free;
     int n_rids;
+    int n_index;
+    int n_words;       //** Size of a candidate bitmap in uint64_t words
     int shutdown;
     int dynamic_mapping;
     int unique_rids;
     int check_interval;
     int check_timeout;
     int last_config_size;
+    int placement;        //** Default placement mode
+    int64_t latency_ref;  //** Latency(us) where the latency weight drops by half
 };
 
 
@@ -514,7 +514,7 @@ int cache_rw_pages(lio_segment_t *seg, lio_segment_rw_hints_t *rw_hints, lio_pag
             if (rw_mode == CACHE_READ) {
                 for (j=0; j<cio->n_iov; j++) {
                     log_printf(15, "error with read nullifying data p->offset=" XOT "\n", cio->page[j].p->offset);
-                    free(cio->page[j].data->ptr);  //** Errors are signified by data=NULL;
+                    cache_arena_page_put(s->c->arena, s->page_size, cio->page[j].data->ptr);  //** Errors are signified by data=NULL;
                     error_count++;
                     cio->page[j].data->ptr = NULL;
                 }
@@ -1397,7 +1397,7 @@ int cache_write_pages_get(lio_segment_t *seg, lio_segment_rw_hints_t *rw_hints,
                         i = (p->current_index+1) % 2;
                         if (p->data[i].ptr == NULL) {  //** We can use the COW space
                             s->c->write_temp_overflow_used += s->page_size;
-                            tbx_type_malloc(p->data[i].ptr, char, s->page_size);
+                            p->data[i].ptr = cache_arena_page_get(s->c->arena, s->page_size, 0);
                             memcpy(p->data[i].ptr, p->data[p->current_index].ptr, s->page_size);
                             p->current_index = i;
                             p->curr_data = &(p->data[i]);
@@ -1574,7 +1574,7 @@ int cache_release_pages(int n_pages, lio_page_handle_t *page_list, int rw_mode)
         if (page_list[i].data != page->curr_data) {
             cow_hit = 1;
             if (page_list[i].data->usage_count <= 0) {  //** Clean up a COW
-                free(page_list[i].data->ptr);
+                cache_arena_page_put(s->c->arena, s->page_size, page_list[i].data->ptr);
                 page_list[i].data->ptr = NULL;
                 s->c->write_temp_overflow_used -= s->page_size;
                 log_printf(15, "seg=" XIDT " p->offset=" XOT " COP cleanup used=" XOT " rw_mode=%d usage=%d\n", segment_id(seg), page->offset, s->c->write_temp_overflow_used, rw_mode, page_list[i].data->usage_count);
@@ -1586,11 +1586,13 @@ int cache_release_pages(int n_pages, lio_page_handle_t *page_list, int rw_mode)
             if (page->bit_fields & C_EMPTY) page->bit_fields ^= C_EMPTY;
             if ((page->bit_fields & C_ISDIRTY) == 0) {
                 s->c->fn.adjust_dirty(s->c, s->page_size);
+                s->stats.dirty_bytes += s->page_size;
                 page->bit_fields |= C_ISDIRTY;
             }
         } else if (rw_mode == CACHE_FLUSH) {  //** Flush release so tweak dirty page info
             if (cow_hit == 0) {
                 s->c->fn.adjust_dirty(s->c, -s->page_size);
+                s->stats.dirty_bytes -= s->page_size;
                 page->bit_fields ^= C_ISDIRTY;
             }
         }
@@ -2396,6 +2398,9 @@ gop_op_status_t cache_rw_func(void *arg, int id)
 
     ngot = bpos - cop->boff;
 
+    //** Let the cache push back on writers if it's getting behind on flushing
+    if ((cop->rw_mode == CACHE_WRITE) && (s->c->fn.write_throttle != NULL)) s->c->fn.write_throttle(s->c, seg, mylen);
+
     log_printf(15, "seg=" XIDT " new_size=" XOT " child_size=" XOT "\n", segment_id(cop->seg),new_size, segment_size(cop->seg));
     //** Check for some input range errors
     if (((new_size > segment_size(cop->seg)) && (cop->rw_mode == CACHE_READ)) || (rerr != 0)) {
@@ -2821,6 +2826,11 @@ int lio_cache_stats_get(lio_cache_t *c, lio_cache_stats_get_t *cs)
     cache_lock(c);
 
     *cs = c->stats;
+    apr_thread_mutex_lock(c->arena->lock);
+    cs->arena_slab_bytes = c->arena->slab_bytes;
+    cs->arena_used_bytes = c->arena->used_bytes;
+    cs->arena_huge_slabs = c->arena->huge_slabs;
+    apr_thread_mutex_unlock(c->arena->lock);
     n = tbx_list_key_count(c->segments);
     it = tbx_list_iter_search(c->segments, NULL, 0);
     for (i=0; i<n; i++) {
@@ -2907,6 +2917,20 @@ int lio_cache_stats_get_print(lio_cache_stats_get_t *cs, char *buffer, int *used
     d3 = cs->dirty_bytes * 1.0 / (1024.0*1024.0*1024.0);
     n += tbx_append_printf(buffer, used, nmax, "Dirty: " XOT " bytes (%lf GiB)\n", cs->dirty_bytes, d3);
 
+    dt = cs->write_stall_time;
+    dt = dt / (1.0*APR_USEC_PER_SEC);
+    n += tbx_append_printf(buffer, used, nmax, "Write stalls: " XOT " (%lf sec)  Write-back extents: " XOT "\n", cs->write_stall_count, dt, cs->writeback_extents);
+
+    d1 = cs->arena_slab_bytes * 1.0 / (1024.0*1024.0*1024.0);
+    d2 = (cs->arena_slab_bytes > 0) ? (100.0*cs->arena_used_bytes) / cs->arena_slab_bytes : 0;
+    n += tbx_append_printf(buffer, used, nmax, "Page arena: " XOT " bytes (%lf GiB) in slabs (%lf%% used, " XOT " huge page slabs)\n", cs->arena_slab_bytes, d1, d2, cs->arena_huge_slabs);
+
+    d1 = cs->prefetch.issued_bytes * 1.0 / (1024.0*1024.0*1024.0);
+    d2 = (cs->prefetch.issued_bytes > 0) ? (100.0*cs->prefetch.hit_bytes) / cs->prefetch.issued_bytes : 0;
+    n += tbx_append_printf(buffer, used, nmax, "Prefetch: " XOT " bytes (%lf GiB) in " XOT " ops (%lf%% used)\n", cs->prefetch.issued_bytes, d1, cs->prefetch.issued_count, d2);
+    n += tbx_append_printf(buffer, used, nmax, "Prefetch:: strided=" XOT " backward=" XOT " reader_waits=" XOT " throttled=" XOT "\n",
+                           cs->prefetch.stride_count, cs->prefetch.backward_count, cs->prefetch.wait_count, cs->prefetch.throttled_count);
+
     return(n);
 }
 
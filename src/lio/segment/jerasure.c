@@ -1854,6 +1854,17 @@ ex_off_t segjerase_size(lio_segment_t *seg)
     return(nbytes);
 }
 
+//***********************************************************************
+// segjerase_child_get - Returns the child segment holding the data and parity
+//***********************************************************************
+
+lio_segment_t *segjerase_child_get(lio_segment_t *seg)
+{
+    segjerase_priv_t *s = (segjerase_priv_t *)seg->priv;
+
+    return(s->child_seg);
+}
+
 //***********************************************************************
 // segjerase_signature - Generates the segment signature
 //***********************************************************************
@@ -34,6 +34,7 @@ extern "C" {
 
 lio_segment_t *segment_jerasure_load(void *arg, ex_id_t id, lio_exnode_exchange_t *ex);
 lio_segment_t *segment_jerasure_create(void *arg);
+lio_segment_t *segjerase_child_get(lio_segment_t *seg);
 
 #ifdef __cplusplus
 }
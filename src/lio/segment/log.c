@@ -34,16 +34,14 @@
 #include <tbx/assert_result.h>
 #include <tbx/atomic_counter.h>
 #include <tbx/iniparse.h>
-#include <tbx/interval_skiplist.h>
+#include <tbx/interval_btree.h>
 #include <tbx/log.h>
-#include <tbx/skiplist.h>
 #include <tbx/stack.h>
 #include <tbx/string_token.h>
 #include <tbx/transfer_buffer.h>
 #include <tbx/type_malloc.h>
 
 #include "ex3.h"
-#include "ex3/compare.h"
 #include "ex3/header.h"
 #include "ex3/system.h"
 #include "segment/log.h"
@@ -51,6 +49,8 @@
 // Forward declaration
 const lio_segment_vtable_t lio_seglog_vtable;
 
+#define SLOG_LOAD_CHUNK 65536   //** Number of log table ranges to read at once when loading
+
 typedef struct {
     lio_segment_t *seg;
     ex_tbx_iovec_t rex;
@@ -90,15 +90,46 @@ typedef struct {
     int timeout;
 } seglog_truncate_t;
 
+#define SLOG_MERGE_MAX_INFLIGHT 16       //** Max number of range copies in flight
+#define SLOG_MERGE_MIN_CHUNK (1024*1024)  //** Don't split the buffer into pieces smaller than this
+#define SLOG_MERGE_MAX_IOV 64            //** Max number of log ranges gathered into a single base write
+#define SLOG_MERGE_CHECKPOINT_BYTES (256*1024*1024)  //** How often to notify the caller of merge progress
+
+#define SLOG_MERGE_IDLE  0
+#define SLOG_MERGE_READ  1
+#define SLOG_MERGE_WRITE 2
+
 typedef struct {
     lio_segment_t *seg;
     data_attr_t *da;
     char *buffer;
     ex_off_t bufsize;
+    lio_slog_merge_checkpoint_fn_t cp_fn;
+    void *cp_arg;
     int truncate_old_log;
     int timeout;
 } seglog_merge_t;
 
+typedef struct {
+    tbx_tbuf_t tbuf;
+    ex_tbx_iovec_t rex[SLOG_MERGE_MAX_IOV];
+    ex_tbx_iovec_t wex;
+    int n_rex;
+    int state;
+} slog_merge_slot_t;
+
+typedef struct {
+    lio_slog_range_t *range;
+    slog_merge_slot_t *slot;
+    ex_off_t roff;      //** Offset into the current range
+    ex_off_t chunk;     //** Slot buffer size
+    ex_off_t end;       //** End of the last range
+    ex_off_t fail_lo;   //** Lowest failed offset
+    int ri;             //** Current range
+    int n_ranges;
+    int n_slots;
+} seglog_merge_state_t;
+
 //***********************************************************************
 // _slog_find_base - Recursives though the semgents base until it finds
 //   the root, non-log segment base and returns it.
@@ -130,17 +161,17 @@ int _slog_truncate_range(lio_segment_t *seg, lio_slog_range_t *r)
     int bufmax = 100;
     lio_seglog_priv_t *s = (lio_seglog_priv_t *)seg->priv;
     ex_off_t lo, hi;
-    tbx_isl_iter_t it;
+    tbx_ibt_iter_t it;
     lio_slog_range_t *ir;
     lio_slog_range_t *r_table[bufmax+1];
     int n, i;
 
     lo = r->hi+1;  //** This is the new size
     hi = s->file_size;
-    it = tbx_isl_iter_search(s->mapping, (tbx_sl_key_t *)&lo, (tbx_sl_key_t *)&hi);
-    ir = (lio_slog_range_t *)tbx_isl_next(&it);
+    it = tbx_ibt_iter_search(s->mapping, lo, hi);
+    ir = (lio_slog_range_t *)tbx_ibt_next(&it);
 
-    log_printf(15, "seg=" XIDT " truncating new_size=" XOT " initial_intervals=%d\n", segment_id(seg), lo, tbx_isl_count(s->mapping));
+    log_printf(15, "seg=" XIDT " truncating new_size=" XOT " initial_intervals=%d\n", segment_id(seg), lo, tbx_ibt_count(s->mapping));
     if (ir == NULL) {
         s->file_size = r->hi + 1;
         free(r);
@@ -150,35 +181,35 @@ int _slog_truncate_range(lio_segment_t *seg, lio_slog_range_t *r)
     //** The 1st range is possibly truncated
     n = 0;
     if (ir->lo <= r->hi) { //** Straddles boundary
-        tbx_isl_remove(s->mapping, (tbx_sl_key_t *)&(ir->lo), (tbx_sl_key_t *)&(ir->hi), (tbx_sl_data_t *)ir);
+        tbx_ibt_remove(s->mapping, ir->lo, ir->hi, ir);
         ir->hi = r->hi;
-        tbx_isl_insert(s->mapping, (tbx_sl_key_t *)&(ir->lo), (tbx_sl_key_t *)&(ir->hi), (tbx_sl_data_t *)ir);
+        tbx_ibt_insert(s->mapping, ir->lo, ir->hi, ir);
 
         //** Restart the iter cause of the deletion
-        it = tbx_isl_iter_search(s->mapping, (tbx_sl_key_t *)&lo, (tbx_sl_key_t *)&hi);
-        tbx_isl_next(&it);
+        it = tbx_ibt_iter_search(s->mapping, lo, hi);
+        tbx_ibt_next(&it);
     } else {  //** Completely dropped
         r_table[n] = ir;
         n++;
     }
 
     //** Cycle through the intervals to remove
-    while ((r_table[n] = (lio_slog_range_t *)tbx_isl_next(&it)) != NULL) {
+    while ((r_table[n] = (lio_slog_range_t *)tbx_ibt_next(&it)) != NULL) {
         log_printf(15, "i=%d dropping interval lo=" XOT " hi=" XOT "\n", n, r_table[n]->lo, r_table[n]->hi);
         n++;
         if (n == bufmax) {
             for (i=0; i<n; i++) {
-                tbx_isl_remove(s->mapping, (tbx_sl_key_t *)&(r_table[i]->lo), (tbx_sl_key_t *)&(r_table[i]->hi), (tbx_sl_data_t *)r_table[i]);
+                tbx_ibt_remove(s->mapping, r_table[i]->lo, r_table[i]->hi, r_table[i]);
                 free(r_table[i]);
             }
-            it = tbx_isl_iter_search(s->mapping, (tbx_sl_key_t *)&lo, (tbx_sl_key_t *)&hi);
+            it = tbx_ibt_iter_search(s->mapping, lo, hi);
             n = 0;
         }
     }
 
     if (n>0) {
         for (i=0; i<n; i++) {
-            tbx_isl_remove(s->mapping, (tbx_sl_key_t *)&(r_table[i]->lo), (tbx_sl_key_t *)&(r_table[i]->hi), (tbx_sl_data_t *)r_table[i]);
+            tbx_ibt_remove(s->mapping, r_table[i]->lo, r_table[i]->hi, r_table[i]);
             free(r_table[i]);
         }
     }
@@ -189,7 +220,7 @@ int _slog_truncate_range(lio_segment_t *seg, lio_slog_range_t *r)
     //** and free the range ptr
     free(r);
 
-    log_printf(15, "new_log_intervals=%d\n", tbx_isl_count(s->mapping));
+    log_printf(15, "new_log_intervals=%d\n", tbx_ibt_count(s->mapping));
 
     return(0);
 }
@@ -204,28 +235,28 @@ int _slog_insert_range(lio_segment_t *seg, lio_slog_range_t *r)
 {
     lio_seglog_priv_t *s = (lio_seglog_priv_t *)seg->priv;
     ex_off_t irlo;
-    tbx_isl_iter_t it;
+    tbx_ibt_iter_t it;
     lio_slog_range_t *ir, *ir2;
 
     //** If a truncate just do it and return
     if (r->lo == -1) return(_slog_truncate_range(seg, r));
 
-    it = tbx_isl_iter_search(s->mapping, (tbx_sl_key_t *)&(r->lo), (tbx_sl_key_t *)&(r->hi));
-    while ((ir = (lio_slog_range_t *)tbx_isl_next(&it)) != NULL) {
-        tbx_isl_remove(s->mapping, (tbx_sl_key_t *)&(ir->lo), (tbx_sl_key_t *)&(ir->hi), (tbx_sl_data_t *)ir);
+    it = tbx_ibt_iter_search(s->mapping, r->lo, r->hi);
+    while ((ir = (lio_slog_range_t *)tbx_ibt_next(&it)) != NULL) {
+        tbx_ibt_remove(s->mapping, ir->lo, ir->hi, ir);
         if (ir->lo < r->lo) {  //** Need to truncate the 1st portion (and maybe the end)
             if (ir->hi > r->hi) {  //** Straddles r
                 tbx_type_malloc(ir2, lio_slog_range_t, 1);  //** Do the end first
                 ir2->lo = r->hi+1;
                 ir2->hi = ir->hi;
                 ir2->data_offset = ir->data_offset + (ir2->lo - ir->lo);
-                tbx_isl_insert(s->mapping, (tbx_sl_key_t *)&(ir2->lo), (tbx_sl_key_t *)&(ir2->hi), (tbx_sl_data_t *)ir2);
+                tbx_ibt_insert(s->mapping, ir2->lo, ir2->hi, ir2);
 
                 ir->hi = r->lo-1;  //** Now do the front portion
-                tbx_isl_insert(s->mapping, (tbx_sl_key_t *)&(ir->lo), (tbx_sl_key_t *)&(ir->hi), (tbx_sl_data_t *)ir);
+                tbx_ibt_insert(s->mapping, ir->lo, ir->hi, ir);
             } else {  //** Truncate 1st half
                 ir->hi = r->lo-1;
-                tbx_isl_insert(s->mapping, (tbx_sl_key_t *)&(ir->lo), (tbx_sl_key_t *)&(ir->hi), (tbx_sl_data_t *)ir);
+                tbx_ibt_insert(s->mapping, ir->lo, ir->hi, ir);
             }
         } else if (ir->hi <= r->hi) {  //** Completely contained in r so drop
             free(ir);
@@ -233,27 +264,27 @@ int _slog_insert_range(lio_segment_t *seg, lio_slog_range_t *r)
             irlo = ir->lo;
             ir->lo = r->hi+1;
             ir->data_offset = ir->data_offset + (ir->lo - irlo);
-            tbx_isl_insert(s->mapping, (tbx_sl_key_t *)&(ir->lo), (tbx_sl_key_t *)&(ir->hi), (tbx_sl_data_t *)ir);
+            tbx_ibt_insert(s->mapping, ir->lo, ir->hi, ir);
         }
 
-        it = tbx_isl_iter_search(s->mapping, (tbx_sl_key_t *)&(r->lo), (tbx_sl_key_t *)&(r->hi));
+        it = tbx_ibt_iter_search(s->mapping, r->lo, r->hi);
     }
 
     //** Check if this range can be combined with the previous
     irlo = r->lo - 1;
-    it = tbx_isl_iter_search(s->mapping, (tbx_sl_key_t *)&irlo, (tbx_sl_key_t *)&(r->hi));
-    ir = (lio_slog_range_t *)tbx_isl_next(&it);
+    it = tbx_ibt_iter_search(s->mapping, irlo, r->hi);
+    ir = (lio_slog_range_t *)tbx_ibt_next(&it);
     if (ir != NULL) {
         irlo = ir->data_offset + ir->hi - ir->lo + 1;
         if (irlo == r->data_offset) {  //** Can combine ranges
             r->lo = ir->lo;
             r->data_offset = ir->data_offset;
-            tbx_isl_remove(s->mapping, (tbx_sl_key_t *)&(ir->lo), (tbx_sl_key_t *)&(ir->hi), (tbx_sl_data_t *)ir);
+            tbx_ibt_remove(s->mapping, ir->lo, ir->hi, ir);
         }
     }
 
     //** Insert the new range
-    tbx_isl_insert(s->mapping, (tbx_sl_key_t *)&(r->lo), (tbx_sl_key_t *)&(r->hi), (tbx_sl_data_t *)r);
+    tbx_ibt_insert(s->mapping, r->lo, r->hi, r);
 
     log_printf(15, "r->lo=" XOT " r->hi=" XOT " r->data_offset=" XOT " curr_file_size=" XOT "\n", r->lo, r->hi, r->data_offset, s->file_size);
 
@@ -372,7 +403,7 @@ gop_op_status_t seglog_read_func(void *arg, int id)
 {
     seglog_rw_t *sw = (seglog_rw_t *)arg;
     lio_seglog_priv_t *s = (lio_seglog_priv_t *)sw->seg->priv;
-    tbx_isl_iter_t it;
+    tbx_ibt_iter_t it;
     lio_slog_range_t *ir;
     gop_opque_t *q;
     gop_op_generic_t *gop;
@@ -393,7 +424,7 @@ gop_op_status_t seglog_read_func(void *arg, int id)
     for (i=0; i< sw->n_iov; i++) {
         lo = iov[i].offset;
         hi = lo + iov[i].len - 1;
-        n_iov += 2*tbx_isl_range_count(s->mapping, (tbx_sl_key_t *)&lo, (tbx_sl_key_t *)&hi) + 1;
+        n_iov += 2*tbx_ibt_range_count(s->mapping, lo, hi) + 1;
     }
     n_iov += 10;  //** Just to be safe
     tbx_type_malloc(ex_iov, ex_tbx_iovec_t, n_iov);
@@ -406,8 +437,8 @@ gop_op_status_t seglog_read_func(void *arg, int id)
         hi = lo + iov[i].len - 1;
         pos = lo;
         prev_end = -1;
-        it = tbx_isl_iter_search(s->mapping, (tbx_sl_key_t *)&lo, (tbx_sl_key_t *)&hi);
-        while ((ir = (lio_slog_range_t *)tbx_isl_next(&it)) != NULL) {
+        it = tbx_ibt_iter_search(s->mapping, lo, hi);
+        while ((ir = (lio_slog_range_t *)tbx_ibt_next(&it)) != NULL) {
             if (prev_end == -1) {  //** 1st time through
                 if (ir->lo > lo) {  //** Have a hole
                     prev_end = lo;
@@ -514,18 +545,40 @@ gop_op_generic_t *seglog_read(lio_segment_t *seg, data_attr_t *da, lio_segment_r
 
 
 //***********************************************************************
-// slog_load - Loads the intitial mapping table
+// _slog_load_range - Validates and adds a range read from the log table.
+//    Returns 0 if the range was added and 1 if it was bad.
+//***********************************************************************
+
+int _slog_load_range(lio_segment_t *seg, lio_slog_range_t *r, ex_off_t offset)
+{
+    if (((r->lo == 0) && (r->hi == 0) && (r->data_offset == 0)) || ((r->hi == 0) && (r->lo != -1))) {  //** This is a failed write so ignore it
+        log_printf(0, "seg=" XIDT " Blank/bad range!  offset=" XOT "\n", segment_id(seg), offset);
+        free(r);
+        return(1);
+    }
+
+    log_printf(15, "r->lo=" XOT " r->len(hi)=" XOT " r->data_offset=" XOT "\n", r->lo, r->hi, r->data_offset);
+
+    r->hi = r->lo + r->hi - 1;  //** On disk this is actually the length
+    _slog_insert_range(seg, r);
+    return(0);
+}
+
+//***********************************************************************
+// slog_load - Loads the intitial mapping table.  The table is read in large
+//    chunks and only if a chunk fails do we fall back to reading it a range
+//    at a time.  Once everything is replayed the mapping is repacked.
 //***********************************************************************
 
 int _slog_load(lio_segment_t *seg)
 {
     lio_seglog_priv_t *s = (lio_seglog_priv_t *)seg->priv;
     int timeout = 20;
-    ex_off_t i;
-    int last_bad, err_count;
+    ex_off_t i, pos, nbytes;
+    int last_bad, err_count, j, n;
     gop_op_generic_t *gop;
     data_attr_t *da;
-    lio_slog_range_t *r;
+    lio_slog_range_t *r, *table;
     ex_tbx_iovec_t ex_iov;
     tbx_tbuf_t tbuf;
 
@@ -537,37 +590,62 @@ int _slog_load(lio_segment_t *seg)
 
     log_printf(15, "INITIAL:  fsize=" XOT " lsize=" XOT " dsize=" XOT "\n", s->file_size, s->log_size, s->data_size);
 
+    tbx_type_malloc(table, lio_slog_range_t, SLOG_LOAD_CHUNK);
     last_bad = 0;
     err_count = 0;
-    for (i=0; i<s->log_size; i += sizeof(lio_slog_range_t)) {
-        tbx_type_malloc_clear(r, lio_slog_range_t, 1);
-        ex_iovec_single(&ex_iov, i, sizeof(lio_slog_range_t));
-        tbx_tbuf_single(&tbuf, sizeof(lio_slog_range_t), (char *)r);
+    for (pos=0; pos<s->log_size; pos += nbytes) {
+        nbytes = s->log_size - pos;
+        if (nbytes > (ex_off_t)(SLOG_LOAD_CHUNK*sizeof(lio_slog_range_t))) nbytes = SLOG_LOAD_CHUNK*sizeof(lio_slog_range_t);
+        n = nbytes / sizeof(lio_slog_range_t);
+        if (n == 0) {  //** Partial range at the end from a failed write
+            log_printf(0, "seg=" XIDT " Truncated range!  offset=" XOT "\n", segment_id(seg), pos);
+            last_bad = 1;
+            err_count++;
+            break;
+        }
+        nbytes = n * sizeof(lio_slog_range_t);
+
+        ex_iovec_single(&ex_iov, pos, nbytes);
+        tbx_tbuf_single(&tbuf, nbytes, (char *)table);
         gop = segment_read(s->table_seg, da, NULL, 1, &ex_iov, &tbuf, 0, timeout);
         if (gop_waitall(gop) == OP_STATE_SUCCESS) {
-            if (((r->lo == 0) && (r->hi == 0) && (r->data_offset == 0)) || ((r->hi == 0) && (r->lo != -1))) {  //** This is a failed write so ignore it
-                log_printf(0, "seg=" XIDT " Blank/bad range!  offset=" XOT "\n", segment_id(seg), i);
+            for (j=0; j<n; j++) {
+                tbx_type_malloc(r, lio_slog_range_t, 1);
+                *r = table[j];
+                last_bad = _slog_load_range(seg, r, pos + j*sizeof(lio_slog_range_t));
+                err_count += last_bad;
+            }
+            gop_free(gop, OP_DESTROY);
+            continue;
+        }
+        gop_free(gop, OP_DESTROY);
+
+        //** Chunk failed so try and salvage what we can a range at a time
+        log_printf(1, "seg=" XIDT " Error loading table chunk!  offset=" XOT " len=" XOT "\n", segment_id(seg), pos, nbytes);
+        for (i=pos; i<pos+nbytes; i += sizeof(lio_slog_range_t)) {
+            tbx_type_malloc_clear(r, lio_slog_range_t, 1);
+            ex_iovec_single(&ex_iov, i, sizeof(lio_slog_range_t));
+            tbx_tbuf_single(&tbuf, sizeof(lio_slog_range_t), (char *)r);
+            gop = segment_read(s->table_seg, da, NULL, 1, &ex_iov, &tbuf, 0, timeout);
+            if (gop_waitall(gop) == OP_STATE_SUCCESS) {
+                last_bad = _slog_load_range(seg, r, i);
+                err_count += last_bad;
+            } else {
+                log_printf(0, "seg=" XIDT " Error loading range!  offset=" XOT "\n", segment_id(seg), i);
                 last_bad = 1;
                 err_count++;
                 free(r);
-            } else {
-                log_printf(15, "r->lo=" XOT " r->len(hi)=" XOT " r->data_offset=" XOT "\n", r->lo, r->hi, r->data_offset);
-
-                r->hi = r->lo + r->hi - 1;  //** On disk this is actually the length
-                _slog_insert_range(seg, r);
-                last_bad = 0;
             }
-        } else {
-            log_printf(0, "seg=" XIDT " Error loading range!  offset=" XOT "\n", segment_id(seg), i);
-            last_bad = 1;
-            err_count++;
-            free(r);
-        }
 
-        gop_free(gop, OP_DESTROY);
+            gop_free(gop, OP_DESTROY);
+        }
     }
+    free(table);
 
-    log_printf(15, "FINAL:  fsize=" XOT " lsize=" XOT " dsize=" XOT "\n", s->file_size, s->log_size, s->data_size);
+    //** Replaying the log leaves the tree's nodes half full so pack them back up
+    tbx_ibt_repack(s->mapping);
+
+    log_printf(15, "FINAL:  fsize=" XOT " lsize=" XOT " dsize=" XOT " n_ranges=%d\n", s->file_size, s->log_size, s->data_size, tbx_ibt_count(s->mapping));
 
     ds_attr_destroy(s->ds, da);
 
@@ -590,7 +668,7 @@ int _slog_load(lio_segment_t *seg)
 ex_off_t slog_changes(lio_segment_t *seg, ex_off_t lo, ex_off_t hi, tbx_stack_t *stack)
 {
     lio_seglog_priv_t *s = (lio_seglog_priv_t *)seg->priv;
-    tbx_isl_iter_t it;
+    tbx_ibt_iter_t it;
     lio_slog_range_t *ir;
     slog_changes_t *clog;
     ex_off_t nbytes, prev_end;
@@ -601,8 +679,8 @@ ex_off_t slog_changes(lio_segment_t *seg, ex_off_t lo, ex_off_t hi, tbx_stack_t
 
     segment_lock(seg);
     prev_end = -1;
-    it = tbx_isl_iter_search(s->mapping, (tbx_sl_key_t *)&lo, (tbx_sl_key_t *)&hi);
-    while ((ir = (lio_slog_range_t *)tbx_isl_next(&it)) != NULL) {
+    it = tbx_ibt_iter_search(s->mapping, lo, hi);
+    while ((ir = (lio_slog_range_t *)tbx_ibt_next(&it)) != NULL) {
         if (prev_end == -1) {  //** 1st time through
             if (ir->lo > lo) {  //** Have a hole
                 prev_end = lo;
@@ -1114,6 +1192,12 @@ int seglog_serialize_text(lio_segment_t *seg, lio_exnode_exchange_t *exp)
     exnode_exchange_append(exp, child_exp);
     exnode_exchange_free(child_exp);
 
+    //** Store any partial merge progress so it can be restarted
+    if (s->merge_log_size > 0) {
+        tbx_append_printf(segbuf, &sused, bufsize, "merge_checkpoint=" XOT "\n", s->merge_checkpoint);
+        tbx_append_printf(segbuf, &sused, bufsize, "merge_log_size=" XOT "\n", s->merge_log_size);
+    }
+
     //** And finally the the container
     exnode_exchange_append_text(exp, segbuf);
     lio_exnode_exchange_destroy(child_exp);
@@ -1187,6 +1271,14 @@ int seglog_deserialize_text(lio_segment_t *seg, ex_id_t id, lio_exnode_exchange_
     //** Load the log table which will also set the size
     _slog_load(seg);
 
+    //** See if we have an interrupted merge.  It's only valid if the log hasn't changed since
+    s->merge_checkpoint = tbx_inip_get_integer(fd, seggrp, "merge_checkpoint", 0);
+    s->merge_log_size = tbx_inip_get_integer(fd, seggrp, "merge_log_size", 0);
+    if (s->merge_log_size != s->log_size) {
+        s->merge_checkpoint = 0;
+        s->merge_log_size = 0;
+    }
+
     log_printf(15, "seglog_deserialize_text: seg=" XIDT "\n", segment_id(seg));
     return(0);
 }
@@ -1225,9 +1317,6 @@ void seglog_destroy(tbx_ref_t *ref)
 {
     tbx_obj_t *obj = container_of(ref, tbx_obj_t, refcount);
     lio_segment_t *seg = container_of(obj, lio_segment_t, obj);
-    int i, n;
-    tbx_isl_iter_t it;
-    lio_slog_range_t **r_list;
     lio_seglog_priv_t *s = (lio_seglog_priv_t *)seg->priv;
 
     //** Check if it's still in use
@@ -1244,17 +1333,8 @@ void seglog_destroy(tbx_ref_t *ref)
         tbx_obj_put(&s->base_seg->obj);
     }
 
-    //** Now free the mapping table
-    n = tbx_isl_count(s->mapping);
-    tbx_type_malloc_clear(r_list, lio_slog_range_t *, n);
-    it = tbx_isl_iter_search(s->mapping, (tbx_sl_key_t *)NULL, (tbx_sl_key_t *)NULL);
-    for (i=0; i<n; i++) {
-        r_list[i] = (lio_slog_range_t *)tbx_isl_next(&it);
-    }
-    tbx_isl_del(s->mapping);
-
-    for (i=0; i<n; i++) free(r_list[i]);
-    free(r_list);
+    //** Now free the mapping table.  The ranges are released by the tree
+    tbx_ibt_del(s->mapping);
 
     free(s);
 
@@ -1280,7 +1360,7 @@ lio_segment_t *segment_log_create(void *arg)
     tbx_type_malloc_clear(seg, lio_segment_t, 1);
     tbx_type_malloc_clear(s, lio_seglog_priv_t, 1);
 
-    s->mapping = tbx_isl_new(&skiplist_compare_ex_off, NULL, NULL, NULL);
+    s->mapping = tbx_ibt_new(free);
     seg->priv = s;
     s->file_size = 0;
 
@@ -1337,113 +1417,216 @@ lio_segment_t *slog_make(lio_service_manager_t *sm, lio_segment_t *table, lio_se
 }
 
 //***********************************************************************
-// seglog_merge_with_base_func - Merges the log with the base
+// _slog_merge_unit_next - Fills the slot with the next unit of work.  Ranges
+//    that are adjacent in the file are coalesced into a single base write
+//    with the log reads gathered into the slot's buffer.
+//    Returns 1 if the slot was filled and 0 if no work is left.
+//***********************************************************************
+
+int _slog_merge_unit_next(seglog_merge_state_t *ms, slog_merge_slot_t *slot)
+{
+    lio_slog_range_t *r;
+    ex_off_t len, rlen, take;
+    int n;
+
+    if (ms->ri >= ms->n_ranges) return(0);
+
+    r = &(ms->range[ms->ri]);
+    slot->wex.offset = r->lo + ms->roff;
+    len = 0;
+    n = 0;
+    while ((ms->ri < ms->n_ranges) && (n < SLOG_MERGE_MAX_IOV) && (len < ms->chunk)) {
+        r = &(ms->range[ms->ri]);
+        if ((len > 0) && (r->lo != slot->wex.offset + len)) break;  //** Not adjacent so stop
+
+        rlen = r->hi - r->lo + 1;
+        take = rlen - ms->roff;
+        if (take > ms->chunk - len) take = ms->chunk - len;
+
+        if ((n > 0) && (slot->rex[n-1].offset + slot->rex[n-1].len == r->data_offset + ms->roff)) {
+            slot->rex[n-1].len += take;  //** Contiguous in the log as well
+        } else {
+            ex_iovec_single(&(slot->rex[n]), r->data_offset + ms->roff, take);
+            n++;
+        }
+
+        len += take;
+        ms->roff += take;
+        if (ms->roff >= rlen) {
+            ms->ri++;
+            ms->roff = 0;
+        }
+    }
+
+    slot->wex.len = len;
+    slot->n_rex = n;
+    slot->state = SLOG_MERGE_READ;
+    return(1);
+}
+
+//***********************************************************************
+// _slog_merge_watermark - Returns the offset below which every range has
+//    been merged.  Units are handed out in file order so this is just the
+//    lowest offset still outstanding.
+//***********************************************************************
+
+ex_off_t _slog_merge_watermark(seglog_merge_state_t *ms)
+{
+    ex_off_t mark;
+    int i;
+
+    mark = (ms->ri < ms->n_ranges) ? ms->range[ms->ri].lo + ms->roff : ms->end;
+    if (ms->fail_lo < mark) mark = ms->fail_lo;
+    for (i=0; i<ms->n_slots; i++) {
+        if ((ms->slot[i].state != SLOG_MERGE_IDLE) && (ms->slot[i].wex.offset < mark)) mark = ms->slot[i].wex.offset;
+    }
+
+    return(mark);
+}
+
+//***********************************************************************
+// _slog_merge_issue - Starts the next operation for the slot
+//***********************************************************************
+
+void _slog_merge_issue(seglog_merge_t *sm, gop_opque_t *q, slog_merge_slot_t *slot, int i)
+{
+    lio_seglog_priv_t *s = (lio_seglog_priv_t *)sm->seg->priv;
+    gop_op_generic_t *gop;
+
+    if (slot->state == SLOG_MERGE_READ) {
+        gop = segment_read(s->data_seg, sm->da, NULL, slot->n_rex, slot->rex, &(slot->tbuf), 0, sm->timeout);
+    } else {
+        gop = segment_write(s->base_seg, sm->da, NULL, 1, &(slot->wex), &(slot->tbuf), 0, sm->timeout);
+    }
+    gop_set_myid(gop, i);
+    gop_opque_add(q, gop);
+}
+
+//***********************************************************************
+// seglog_merge_with_base_func - Merges the log with the base.
+//    The caller's buffer is split into slots with each slot having a
+//    read from the log followed by a write to the base in flight.
+//    Progress is recorded in the segment as a checkpoint so an interrupted
+//    merge picks up where it left off if the exnode was saved.
 //***********************************************************************
 
 gop_op_status_t seglog_merge_with_base_func(void *arg, int id)
 {
     seglog_merge_t *sm = (seglog_merge_t *)arg;
     lio_seglog_priv_t *s = (lio_seglog_priv_t *)sm->seg->priv;
-    gop_opque_t *qin, *qout;
+    seglog_merge_state_t ms;
+    slog_merge_slot_t *slot;
+    gop_opque_t *q;
     gop_op_generic_t *gop;
-    ex_tbx_iovec_t *ex_in, *ex_out;
-    lio_slog_range_t *r;
-    tbx_tbuf_t tbuf;
-    ex_off_t pos, len, blen, bpos;
-    int i, n_iov, err;
-    tbx_isl_iter_t it;
+    lio_slog_range_t *r, *rr;
+    ex_off_t start, mark, last_cp, nbytes;
+    int i, n, err;
+    tbx_ibt_iter_t it;
 
-    qin = gop_opque_new();
-    qout = gop_opque_new();
-
-    n_iov = tbx_isl_count(s->mapping);
-    tbx_type_malloc(ex_in, ex_tbx_iovec_t, n_iov);
-    tbx_type_malloc(ex_out, ex_tbx_iovec_t, n_iov);
-    tbx_tbuf_single(&tbuf, sm->bufsize, sm->buffer);
+    memset(&ms, 0, sizeof(ms));
 
     segment_lock(sm->seg);
 
-    it = tbx_isl_iter_search(s->mapping, (tbx_sl_key_t *)NULL, (tbx_sl_key_t *)NULL);
-    pos = 0;
-    for (i=0; i<=n_iov; i++) {
-        if (i < n_iov) {
-            r = (lio_slog_range_t *)tbx_isl_next(&it);
-            ex_in[i].offset = r->data_offset;
-            len = r->hi - r->lo + 1;
-            ex_in[i].len = len;
-            ex_out[i].offset = r->lo;
-            ex_out[i].len = len;
-            log_printf(15, "i=%d in.offset=" XOT " in.len=" XOT " out.offset=" XOT " pos=" XOT " bufsize=" XOT "\n", i, ex_in[i].offset, len, ex_out[i].offset, pos, sm->bufsize);
+    //** See if we can pick up from a previous merge
+    start = (s->merge_log_size == s->log_size) ? s->merge_checkpoint : 0;
+    s->merge_checkpoint = start;
+    s->merge_log_size = s->log_size;
+
+    //** Snapshot the mapping skipping anything already merged and coalescing ranges contiguous in both the file and log
+    n = tbx_ibt_count(s->mapping);
+    tbx_type_malloc(ms.range, lio_slog_range_t, n+1);
+    it = tbx_ibt_iter_search(s->mapping, TBX_IBT_KEY_MIN, TBX_IBT_KEY_MAX);
+    nbytes = 0;
+    while ((r = (lio_slog_range_t *)tbx_ibt_next(&it)) != NULL) {
+        if (r->hi < start) continue;
+        rr = (ms.n_ranges > 0) ? &(ms.range[ms.n_ranges-1]) : NULL;
+        if ((rr != NULL) && (rr->hi+1 == r->lo) && (rr->data_offset + rr->hi - rr->lo + 1 == r->data_offset)) {
+            rr->hi = r->hi;
         } else {
-            len = sm->bufsize;
+            rr = &(ms.range[ms.n_ranges]);
+            *rr = *r;
+            ms.n_ranges++;
         }
-
-        if ((len > sm->bufsize) || ((pos+len) > sm->bufsize)) {  //** Buffer fill so flush it
-            log_printf(15, "i=%d flushing\n", i);
-            err = opque_waitall(qin);
-            if (err != OP_STATE_SUCCESS) {
-                segment_unlock(sm->seg);
-                log_printf(1, "seg=" XIDT " Error reading segment!\n", segment_id(sm->seg));
-                return(gop_failure_status);
-            }
-            err = opque_waitall(qout);
-            if (err != OP_STATE_SUCCESS) {
-                segment_unlock(sm->seg);
-                log_printf(1, "seg=" XIDT " Error writing segment!\n", segment_id(sm->seg));
-                return(gop_failure_status);
-            }
-            gop_opque_free(qout, OP_DESTROY);
-            qout = gop_opque_new();
-            pos = 0;
+        if (rr->lo < start) {   //** Straddles the checkpoint so skip the front
+            rr->data_offset += start - rr->lo;
+            rr->lo = start;
         }
+        nbytes += r->hi - r->lo + 1;
+    }
+    ms.end = (ms.n_ranges > 0) ? ms.range[ms.n_ranges-1].hi + 1 : start;
+    ms.fail_lo = ms.end;
 
-        if (i == n_iov) break;  //** Exit loop
-
-        if (len > sm->bufsize) { //** Got to do it in chunks
-            log_printf(15, "i=%d len>bufsize so chunking\n", i);
+    //** Carve up the buffer.  We want as many ops in flight as possible without making them too small
+    ms.n_slots = sm->bufsize / SLOG_MERGE_MIN_CHUNK;
+    if (ms.n_slots > SLOG_MERGE_MAX_INFLIGHT) ms.n_slots = SLOG_MERGE_MAX_INFLIGHT;
+    if (ms.n_slots < 1) ms.n_slots = 1;
+    ms.chunk = sm->bufsize / ms.n_slots;
+    tbx_type_malloc_clear(ms.slot, slog_merge_slot_t, ms.n_slots);
 
-            for (bpos=0; bpos<len; bpos += sm->bufsize) {
-                blen = (bpos+sm->bufsize) > len ? len - bpos : len;
-                ex_in[i].len = blen;
-                ex_out[i].len = blen;
-                log_printf(15, "i=%d bpos=" XOT " in.offset=" XOT " out.offset=" XOT " len=" XOT "\n", i, bpos, ex_in[i].len, ex_out[i].len, blen);
+    log_printf(15, "seg=" XIDT " start=" XOT " n_ranges=%d nbytes=" XOT " n_slots=%d chunk=" XOT "\n", segment_id(sm->seg), start, ms.n_ranges, nbytes, ms.n_slots, ms.chunk);
 
-                gop = segment_read(s->data_seg, sm->da, NULL, 1, &(ex_in[i]), &tbuf, 0, sm->timeout);
-                gop_opque_add(qin, gop);
-                err = opque_waitall(qin);
-                if (err != OP_STATE_SUCCESS) {
-                    segment_unlock(sm->seg);
-                    log_printf(1, "seg=" XIDT " Error reading segment!\n", segment_id(sm->seg));
-                    return(gop_failure_status);
-                }
+    //** Prime the pump
+    q = gop_opque_new();
+    for (i=0; i<ms.n_slots; i++) {
+        slot = &(ms.slot[i]);
+        tbx_tbuf_single(&(slot->tbuf), ms.chunk, sm->buffer + i*ms.chunk);
+        if (_slog_merge_unit_next(&ms, slot) == 0) break;
+        _slog_merge_issue(sm, q, slot, i);
+    }
 
-                gop = segment_write(s->base_seg, sm->da, NULL, 1, &(ex_out[i]), &tbuf, 0, sm->timeout);
-                gop_opque_add(qout, gop);
-                if (err != OP_STATE_SUCCESS) {
-                    segment_unlock(sm->seg);
-                    log_printf(1, "seg=" XIDT " Error writing segment!\n", segment_id(sm->seg));
-                    return(gop_failure_status);
-                }
+    //** And process the tasks as they complete
+    last_cp = start;
+    err = OP_STATE_SUCCESS;
+    while ((gop = opque_waitany(q)) != NULL) {
+        i = gop_get_myid(gop);
+        slot = &(ms.slot[i]);
+        if (gop_completed_successfully(gop) != OP_STATE_SUCCESS) {
+            log_printf(1, "seg=" XIDT " Error %s segment! offset=" XOT " len=" XOT "\n", segment_id(sm->seg),
+                       ((slot->state == SLOG_MERGE_READ) ? "reading" : "writing"), slot->wex.offset, slot->wex.len);
+            if (slot->wex.offset < ms.fail_lo) ms.fail_lo = slot->wex.offset;
+            slot->state = SLOG_MERGE_IDLE;
+            err = OP_STATE_FAILURE;
+        } else if (slot->state == SLOG_MERGE_READ) {  //** Got the data so push it to the base
+            slot->state = SLOG_MERGE_WRITE;
+            _slog_merge_issue(sm, q, slot, i);
+        } else {  //** Finished the unit so get the next one
+            slot->state = SLOG_MERGE_IDLE;
+            if ((err == OP_STATE_SUCCESS) && (_slog_merge_unit_next(&ms, slot) == 1)) _slog_merge_issue(sm, q, slot, i);
+        }
+        gop_free(gop, OP_DESTROY);
 
-                ex_in[i].offset += blen;
-                ex_out[i].offset += blen;
+        //** Update the checkpoint
+        mark = _slog_merge_watermark(&ms);
+        if (mark > s->merge_checkpoint) {
+            s->merge_checkpoint = mark;
+            if ((sm->cp_fn != NULL) && ((mark - last_cp) >= SLOG_MERGE_CHECKPOINT_BYTES)) {
+                sm->cp_fn(sm->cp_arg, sm->seg, mark);
+                last_cp = mark;
             }
-            pos = 0;
-        } else {
-            gop = segment_read(s->data_seg, sm->da, NULL, 1, &(ex_in[i]), &tbuf, pos, sm->timeout);
-            gop_opque_add(qin, gop);
-            gop = segment_write(s->base_seg, sm->da, NULL, 1, &(ex_out[i]), &tbuf, pos, sm->timeout);
-            gop_opque_add(qout, gop);
-            pos = pos + ex_in[i].len;
         }
     }
 
+    gop_opque_free(q, OP_DESTROY);
+    free(ms.slot);
+    free(ms.range);
+
+    if (err != OP_STATE_SUCCESS) {
+        log_printf(1, "seg=" XIDT " Merge failed. checkpoint=" XOT "\n", segment_id(sm->seg), s->merge_checkpoint);
+        if (sm->cp_fn != NULL) sm->cp_fn(sm->cp_arg, sm->seg, s->merge_checkpoint);
+        segment_unlock(sm->seg);
+        return(gop_failure_status);
+    }
+
+    //** Everything made it to the base so the checkpoint is no longer needed
+    s->merge_checkpoint = 0;
+    s->merge_log_size = 0;
+
     //** If needed get rid of the old log
-    err = OP_STATE_SUCCESS;
     if (sm->truncate_old_log == 1) {
         log_printf(15, "truncating old log\n");
-        gop_opque_add(qin, lio_segment_truncate(s->table_seg, sm->da, 0, sm->timeout));
-        gop_opque_add(qin, lio_segment_truncate(s->data_seg, sm->da, 0, sm->timeout));
+        q = gop_opque_new();
+        gop_opque_add(q, lio_segment_truncate(s->table_seg, sm->da, 0, sm->timeout));
+        gop_opque_add(q, lio_segment_truncate(s->data_seg, sm->da, 0, sm->timeout));
 
         //** empty the log table
         tbx_type_malloc(r, lio_slog_range_t, 1);
@@ -1453,19 +1636,16 @@ gop_op_status_t seglog_merge_with_base_func(void *arg, int id)
         _slog_truncate_range(sm->seg, r);  //** r is released in the truncate call
 
         //** Wait of everything to complete
-        err = opque_waitall(qin);
+        err = opque_waitall(q);
+        gop_opque_free(q, OP_DESTROY);
 
         s->log_size = 0;
         s->data_size = 0;
     }
 
-    segment_unlock(sm->seg);
-
-    gop_opque_free(qin, OP_DESTROY);
-    gop_opque_free(qout, OP_DESTROY);
+    if (sm->cp_fn != NULL) sm->cp_fn(sm->cp_arg, sm->seg, ms.end);
 
-    free(ex_in);
-    free(ex_out);
+    segment_unlock(sm->seg);
 
     if (err != OP_STATE_SUCCESS) {
         log_printf(1, "seg=" XIDT " Error truncating table/data logs!\n", segment_id(sm->seg));
@@ -1479,12 +1659,16 @@ gop_op_status_t seglog_merge_with_base_func(void *arg, int id)
 
 
 //***********************************************************************
-// lio_slog_merge_with_base_gop - Merges the log (table/data segments) with the base.
+// lio_slog_merge_with_base_cp_gop - Merges the log (table/data segments) with the base.
 //   If truncate_old_log == 1 then the old log is truncated back to 0.
 //   Otherwise the old log is not touched and left intact (and superfluos).
+//   The buffer is split up so multiple ranges are copied in parallel.
+//   If cp_fn is provided it's called periodically with the segment locked
+//   as the merge progresses so the caller can persist the exnode.  If the
+//   merge is interrupted the saved exnode lets it resume from the checkpoint.
 //***********************************************************************
 
-gop_op_generic_t *lio_slog_merge_with_base_gop(lio_segment_t *seg, data_attr_t *da, ex_off_t bufsize, char *buffer, int truncate_old_log, int timeout)
+gop_op_generic_t *lio_slog_merge_with_base_cp_gop(lio_segment_t *seg, data_attr_t *da, ex_off_t bufsize, char *buffer, int truncate_old_log, lio_slog_merge_checkpoint_fn_t cp_fn, void *cp_arg, int timeout)
 {
     seglog_merge_t *st;
     lio_seglog_priv_t *s = (lio_seglog_priv_t *)seg->priv;
@@ -1495,12 +1679,24 @@ gop_op_generic_t *lio_slog_merge_with_base_gop(lio_segment_t *seg, data_attr_t *
     st->truncate_old_log = truncate_old_log;
     st->bufsize = bufsize;
     st->buffer = buffer;
+    st->cp_fn = cp_fn;
+    st->cp_arg = cp_arg;
     st->timeout = timeout;
     st->da = da;
 
     return(gop_tp_op_new(s->tpc, NULL, seglog_merge_with_base_func, (void *)st, free, 1));
 }
 
+//***********************************************************************
+// lio_slog_merge_with_base_gop - Merges the log with the base without
+//   any checkpoint notifications
+//***********************************************************************
+
+gop_op_generic_t *lio_slog_merge_with_base_gop(lio_segment_t *seg, data_attr_t *da, ex_off_t bufsize, char *buffer, int truncate_old_log, int timeout)
+{
+    return(lio_slog_merge_with_base_cp_gop(seg, da, bufsize, buffer, truncate_old_log, NULL, NULL, timeout));
+}
+
 const lio_segment_vtable_t lio_seglog_vtable = {
     .base.name = "segment_log",
     .base.free_fn = seglog_destroy,
@@ -21,7 +21,7 @@
 #include <gop/types.h>
 #include <lio/visibility.h>
 #include <lio/segment.h>
-#include <tbx/interval_skiplist.h>
+#include <tbx/interval_btree.h>
 
 #include "ds.h"
 #include "ex3.h"
@@ -49,11 +49,13 @@ struct lio_seglog_priv_t {
     lio_segment_t *data_seg;
     lio_segment_t *base_seg;
     lio_data_service_fn_t *ds;
-    tbx_isl_t *mapping;
+    tbx_ibt_t *mapping;
     gop_thread_pool_context_t *tpc;
     ex_off_t file_size;
     ex_off_t log_size;
     ex_off_t data_size;
+    ex_off_t merge_checkpoint;  //** Everything in the log below this offset has already been merged into the base
+    ex_off_t merge_log_size;    //** Log table size when the checkpoint was taken.  Any log change invalidates it
     int soft_errors;
     int hard_errors;
 };
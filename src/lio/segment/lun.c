@@ -64,6 +64,8 @@
 #include "segment/lun.h"
 #include "service_manager.h"
 
+#define SLUN_DIRECT_COPY_MAX (64*1024*1024)  //** Largest single depot-to-depot copy for seglun_direct_copy_gop
+
 // Forward declaration
 const lio_segment_vtable_t lio_seglun_vtable;
 
@@ -107,6 +109,49 @@ typedef struct {
     int timeout;
 } seglun_inspect_t;
 
+typedef struct {
+    lio_rid_throttle_t *throttle;
+    data_attr_t *da;
+    lio_data_block_t *src;
+    lio_data_block_t *dest;
+    ex_off_t src_offset;
+    ex_off_t len;
+    int timeout;
+} slun_copy_t;
+
+typedef struct {
+    lio_segment_t *seg;
+    data_attr_t *da;
+    lio_inspect_args_t args;    //** Copy of the inspect args using the segment's placement query
+    rs_query_t *check_query;    //** Query used to flag allocations for migration
+    seglun_row_t *b;
+    int *block_status;
+    int *block_copy;
+    tbx_stack_t *db_cleanup;
+    int soft_error_fail;
+    int fixed;          //** Set if we attempted to fix the row
+    int nbad;           //** Number of allocations needing to be moved
+    int nleft;          //** Number that still need to be moved after the fix
+    int timeout;
+} slun_migrate_row_t;
+
+typedef struct {
+    lio_segment_t *sseg;
+    lio_segment_t *dseg;
+    data_attr_t *da;
+    ex_off_t len;
+    int max_inflight;
+    int timeout;
+} seglun_direct_copy_t;
+
+typedef struct {         //** A contiguous depot-to-depot copy between blocks
+    lio_data_block_t *src;
+    lio_data_block_t *dest;
+    ex_off_t src_offset;
+    ex_off_t dest_offset;
+    ex_off_t len;
+} slun_copy_extent_t;
+
 typedef struct {
     lio_segment_t *seg;
     data_attr_t *da;
@@ -168,6 +213,59 @@ void _slun_perform_remap(lio_segment_t *seg)
 }
 
 
+//***********************************************************************
+// slun_throttled_copy_func - Does a depot-to-depot copy after getting the
+//    go ahead from the RID throttle
+//***********************************************************************
+
+gop_op_status_t slun_throttled_copy_func(void *arg, int id)
+{
+    slun_copy_t *sc = (slun_copy_t *)arg;
+    gop_op_generic_t *gop;
+    gop_op_status_t status;
+
+    lio_rid_throttle_acquire(sc->throttle, sc->src->rid_key, sc->dest->rid_key, sc->len);
+    gop = ds_copy(sc->src->ds, sc->da, DS_PUSH, NS_TYPE_SOCK, "",
+                  ds_get_cap(sc->src->ds, sc->src->cap, DS_CAP_READ), sc->src_offset,
+                  ds_get_cap(sc->dest->ds, sc->dest->cap, DS_CAP_WRITE), 0,
+                  sc->len, sc->timeout);
+    gop_waitall(gop);
+    status = gop_get_status(gop);
+    gop_free(gop, OP_DESTROY);
+    lio_rid_throttle_release(sc->throttle, sc->src->rid_key, sc->dest->rid_key);
+
+    return(status);
+}
+
+//***********************************************************************
+// slun_block_copy_gop - Generates a depot-to-depot copy of a block honoring
+//    any per-RID limits
+//***********************************************************************
+
+gop_op_generic_t *slun_block_copy_gop(lio_segment_t *seg, data_attr_t *da, lio_inspect_args_t *args, lio_data_block_t *src, ex_off_t src_offset, lio_data_block_t *dest, ex_off_t len, int timeout)
+{
+    lio_seglun_priv_t *s = (lio_seglun_priv_t *)seg->priv;
+    slun_copy_t *sc;
+
+    if ((args == NULL) || (args->throttle == NULL)) {
+        return(ds_copy(src->ds, da, DS_PUSH, NS_TYPE_SOCK, "",
+                       ds_get_cap(src->ds, src->cap, DS_CAP_READ), src_offset,
+                       ds_get_cap(dest->ds, dest->cap, DS_CAP_WRITE), 0,
+                       len, timeout));
+    }
+
+    tbx_type_malloc(sc, slun_copy_t, 1);
+    sc->throttle = args->throttle;
+    sc->da = da;
+    sc->src = src;
+    sc->src_offset = src_offset;
+    sc->dest = dest;
+    sc->len = len;
+    sc->timeout = timeout;
+
+    return(gop_tp_op_new(s->tpc, NULL, slun_throttled_copy_func, (void *)sc, free, 1));
+}
+
 //***********************************************************************
 // slun_row_placement_check - Checks the placement of each allocation
 //***********************************************************************
@@ -241,7 +339,7 @@ int slun_row_placement_check(lio_segment_t *seg, data_attr_t *da, seglun_row_t *
 //     constraints
 //***********************************************************************
 
-int slun_row_placement_fix(lio_segment_t *seg, data_attr_t *da, seglun_row_t *b, int *block_status, int n_devices, lio_inspect_args_t *args, int timeout)
+int slun_row_placement_fix(lio_segment_t *seg, data_attr_t *da, seglun_row_t *b, int *block_status, int n_devices, lio_inspect_args_t *args, tbx_stack_t *db_cleanup, int timeout)
 {
     lio_seglun_priv_t *s = (lio_seglun_priv_t *)seg->priv;
     int i, j, k, nbad, ngood, loop, cleanup_index;
@@ -344,11 +442,8 @@ int slun_row_placement_fix(lio_segment_t *seg, data_attr_t *da, seglun_row_t *b,
                 db[j]->rid_key = req[j].rid_key;
                 req[j].rid_key = NULL;  //** Cleanup
 
-                //** Make the copy operation
-                gop = ds_copy(b->block[i].data->ds, da, DS_PUSH, NS_TYPE_SOCK, "",
-                              ds_get_cap(b->block[i].data->ds, b->block[i].data->cap, DS_CAP_READ), b->block[i].cap_offset,
-                              ds_get_cap(db[j]->ds, db[j]->cap, DS_CAP_WRITE), 0,
-                              b->block_len, timeout);
+                //** Make the depot-to-depot copy operation
+                gop = slun_block_copy_gop(seg, da, args, b->block[i].data, b->block[i].cap_offset, db[j], b->block_len, timeout);
                 gop_set_myid(gop, j);
                 gop_opque_add(q, gop);
             } else {  //** Make sure we exclude the RID key on the next round due to the failure
@@ -410,8 +505,7 @@ int slun_row_placement_fix(lio_segment_t *seg, data_attr_t *da, seglun_row_t *b,
                         gop = ds_remove(dbd->ds, da, ds_get_cap(dbd->ds, dbd->cap, DS_CAP_MANAGE), timeout);
                         gop_opque_add(args->qf, gop);  //** This gets placed on the failed queue so we can roll it back if needed
                     }
-                    if (s->db_cleanup == NULL) s->db_cleanup = tbx_stack_new();
-                    tbx_stack_push(s->db_cleanup, dbs);  //** Dump the data block here cause the cap is needed for the gop.  We'll cleanup up on destroy()
+                    tbx_stack_push(db_cleanup, dbs);  //** Dump the data block here cause the cap is needed for the gop.  We'll cleanup up on destroy()
                 } else {  //** Copy failed so remove the destintation
                     gop_free(gop, OP_DESTROY);
                     gop = ds_remove(db[j]->ds, da, ds_get_cap(db[j]->ds, db[j]->cap, DS_CAP_MANAGE), timeout);
@@ -1871,7 +1965,32 @@ gop_op_generic_t *seglun_remove(lio_segment_t *seg, data_attr_t *da, int timeout
 }
 
 //***********************************************************************
-// seglun_migrate_func - Attempts to migrate any flagged allocations
+// slun_migrate_row_func - Checks the placement of a single row and moves
+//    any allocations that need it.  Rows are independent so these run in
+//    parallel.
+//***********************************************************************
+
+gop_op_status_t slun_migrate_row_func(void *arg, int id)
+{
+    slun_migrate_row_t *mr = (slun_migrate_row_t *)arg;
+    lio_seglun_priv_t *s = (lio_seglun_priv_t *)mr->seg->priv;
+
+    memset(mr->block_status, 0, sizeof(int)*s->n_devices);
+    mr->nbad = slun_row_placement_check(mr->seg, mr->da, mr->b, mr->block_status, s->n_devices, mr->soft_error_fail, mr->check_query, &(mr->args), mr->timeout);
+    memcpy(mr->block_copy, mr->block_status, sizeof(int)*s->n_devices);
+
+    if ((mr->nbad > 0) || (mr->args.rid_changes != NULL)) {
+        mr->fixed = 1;
+        mr->nleft = slun_row_placement_fix(mr->seg, mr->da, mr->b, mr->block_status, s->n_devices, &(mr->args), mr->db_cleanup, mr->timeout);
+    }
+
+    return(gop_success_status);
+}
+
+//***********************************************************************
+// seglun_migrate_func - Attempts to migrate any flagged allocations.
+//    Up to args->max_rows rows are processed at once and the results are
+//    reported in row order once everything completes.
 //***********************************************************************
 
 gop_op_status_t seglun_migrate_func(void *arg, int id)
@@ -1883,25 +2002,78 @@ gop_op_status_t seglun_migrate_func(void *arg, int id)
     char info[bufsize];
     ex_off_t sstripe, estripe;
     int used;
-    int block_status[s->n_devices], block_copy[s->n_devices];
-    int nattempted, nmigrated, err, i;
+    int *block_status, *block_copy;
+    int nattempted, nmigrated, err, i, j, n, max_rows, running;
     int soft_error_fail;
+    slun_migrate_row_t *mr, *row;
+    rs_query_t *query;
+    gop_opque_t *q;
+    gop_op_generic_t *gop;
+    void *db;
 
     gop_op_status_t status = gop_success_status;
     tbx_isl_iter_t it;
 
     soft_error_fail = (si->inspect_mode & INSPECT_SOFT_ERROR_FAIL);
+    max_rows = (si->args->max_rows > 0) ? si->args->max_rows : INSPECT_MIGRATE_ROWS;
 
     segment_lock(si->seg);
 
+    //** Form the query to use for placing the new allocations
+    query = rs_query_dup(s->rs, s->rsq);
+    if (si->args->query != NULL) {  //** Local query needs to be added
+        rs_query_append(s->rs, query, si->args->query);
+        rs_query_add(s->rs, &query, RSQ_BASE_OP_AND, NULL, 0, NULL, 0);
+    }
+
     info_printf(si->fd, 1, XIDT ": segment information: n_devices=%d n_shift=%d chunk_size=" XOT "  used_size=" XOT " total_size=" XOT " mode=%d\n", segment_id(si->seg), s->n_devices, s->n_shift, s->chunk_size, s->used_size, s->total_size, si->inspect_mode);
 
-    nattempted = 0;
-    nmigrated = 0;
+    //** Set up the work for each row
+    n = tbx_isl_count(s->isl);
+    tbx_type_malloc_clear(mr, slun_migrate_row_t, n+1);
+    tbx_type_malloc_clear(block_status, int, 2*(n+1)*s->n_devices);
+    block_copy = block_status + (n+1)*s->n_devices;
     it = tbx_isl_iter_search(s->isl, (tbx_sl_key_t *)NULL, (tbx_sl_key_t *)NULL);
-    for (b = (seglun_row_t *)tbx_isl_next(&it); b != NULL; b = (seglun_row_t *)tbx_isl_next(&it)) {
-        for (i=0; i < s->n_devices; i++) block_status[i] = 0;
+    for (i=0; i<n; i++) {
+        row = &(mr[i]);
+        row->b = (seglun_row_t *)tbx_isl_next(&it);
+        row->seg = si->seg;
+        row->da = si->da;
+        row->args = *(si->args);
+        row->args.query = query;
+        row->check_query = si->args->query;
+        row->block_status = block_status + i*s->n_devices;
+        row->block_copy = block_copy + i*s->n_devices;
+        row->db_cleanup = tbx_stack_new();
+        row->soft_error_fail = soft_error_fail;
+        row->timeout = si->timeout;
+    }
 
+    //** Process the rows keeping max_rows in flight
+    q = gop_opque_new();
+    running = 0;
+    for (i=0; i<n; i++) {
+        gop = gop_tp_op_new(s->tpc, NULL, slun_migrate_row_func, (void *)&(mr[i]), NULL, 1);
+        gop_set_myid(gop, i);
+        gop_opque_add(q, gop);
+        running++;
+        if (running >= max_rows) {
+            gop = opque_waitany(q);
+            gop_free(gop, OP_DESTROY);
+            running--;
+        }
+    }
+    while ((gop = opque_waitany(q)) != NULL) {
+        gop_free(gop, OP_DESTROY);
+    }
+    gop_opque_free(q, OP_DESTROY);
+
+    //** Now report the results in order
+    nattempted = 0;
+    nmigrated = 0;
+    for (j=0; j<n; j++) {
+        row = &(mr[j]);
+        b = row->b;
         sstripe = b->seg_offset / s->stripe_size;
         estripe = b->seg_end / s->stripe_size;
         info_printf(si->fd, 1, XIDT ": Checking row: (" XOT ", " XOT ", " XOT ")   Stripe: (" XOT ", " XOT ")\n", segment_id(si->seg), b->seg_offset, b->seg_end, b->row_len, sstripe, estripe);
@@ -1910,26 +2082,22 @@ gop_op_status_t seglun_migrate_func(void *arg, int id)
             info_printf(si->fd, 3, XIDT ":     dev=%i rcap=%s\n", segment_id(si->seg), i, (char *)ds_get_cap(s->ds, b->block[i].data->cap, DS_CAP_READ));
         }
 
-        for (i=0; i < s->n_devices; i++) block_status[i] = 0;
-        err = slun_row_placement_check(si->seg, si->da, b, block_status, s->n_devices, soft_error_fail, si->args->query, si->args, si->timeout);
+        err = row->nbad;
         used = 0;
         tbx_append_printf(info, &used, bufsize, XIDT ":     slun_row_placement_check:", segment_id(si->seg));
-        for (i=0; i < s->n_devices; i++) tbx_append_printf(info, &used, bufsize, " %d", block_status[i]);
+        for (i=0; i < s->n_devices; i++) tbx_append_printf(info, &used, bufsize, " %d", row->block_copy[i]);
         info_printf(si->fd, 1, "%s\n", info);
-        if ((err > 0) || (si->args->rid_changes != NULL)) {
-            memcpy(block_copy, block_status, sizeof(int)*s->n_devices);
-
-            i = slun_row_placement_fix(si->seg, si->da, b, block_status, s->n_devices, s->rsq, si->timeout);
-            nmigrated +=  err - i;
+        if (row->fixed) {
+            nmigrated +=  err - row->nleft;
             nattempted += err;
 
             for (i=0; i < s->n_devices; i++) {
-                if (block_copy[i] != 0) {
-                    if (block_status[i] == 0) {
+                if (row->block_copy[i] != 0) {
+                    if (row->block_status[i] == 0) {
                         info_printf(si->fd, 2, XIDT ":     dev=%i moved to rcap=%s\n", segment_id(si->seg), i, (char *)ds_get_cap(s->ds, b->block[i].data->cap, DS_CAP_READ));
-                    } else if (block_status[i] == -103) { //** Can't opportunistically move the allocation so unflagg it
+                    } else if (row->block_status[i] == -103) { //** Can't opportunistically move the allocation so unflagg it
                         log_printf(0, "OPPORTUNISTIC mv failed i=%d\n", i);
-                        block_status[i] = 0;
+                        row->block_status[i] = 0;
                         nattempted--;
                         nmigrated--;  //** Adjust the totals
                     }
@@ -1938,16 +2106,26 @@ gop_op_status_t seglun_migrate_func(void *arg, int id)
 
             used =0;
             tbx_append_printf(info, &used, bufsize, XIDT ":     slun_row_placement_fix:", segment_id(si->seg));
-            for (i=0; i < s->n_devices; i++) tbx_append_printf(info, &used, bufsize, " %d", block_status[i]);
+            for (i=0; i < s->n_devices; i++) tbx_append_printf(info, &used, bufsize, " %d", row->block_status[i]);
             info_printf(si->fd, 1, "%s\n", info);
         } else {
             nattempted = nattempted + err;
         }
 
+        //** Keep the old data blocks around until the segment is destroyed
+        while ((db = tbx_stack_pop(row->db_cleanup)) != NULL) {
+            if (s->db_cleanup == NULL) s->db_cleanup = tbx_stack_new();
+            tbx_stack_push(s->db_cleanup, db);
+        }
+        tbx_stack_free(row->db_cleanup, 0);
     }
 
     segment_unlock(si->seg);
 
+    rs_query_destroy(s->rs, query);
+    free(block_status);
+    free(mr);
+
     if (nattempted != nmigrated) {
         info_printf(si->fd, 1, XIDT ": status: FAILURE (%d needed migrating, %d migrated)\n", segment_id(si->seg), nattempted, nmigrated);
         status = gop_failure_status;
@@ -2110,7 +2288,8 @@ gop_op_status_t seglun_inspect_func(void *arg, int id)
         if ((err > 0) && ((option == INSPECT_QUICK_REPAIR) || (option == INSPECT_SCAN_REPAIR) || (option == INSPECT_FULL_REPAIR))) {
             if (force_reconstruct == 0) {
                 memcpy(block_copy, block_status, sizeof(int)*s->n_devices);
-                i = slun_row_placement_fix(si->seg, si->da, b, block_status, s->n_devices, &args, si->timeout);
+                if (s->db_cleanup == NULL) s->db_cleanup = tbx_stack_new();
+                i = slun_row_placement_fix(si->seg, si->da, b, block_status, s->n_devices, &args, s->db_cleanup, si->timeout);
                 nmigrated += err - i;
                 memcpy(block_tmp, block_status, sizeof(int)*s->n_devices);
 
@@ -2491,6 +2670,169 @@ gop_op_generic_t *seglun_clone(lio_segment_t *seg, data_attr_t *da, lio_segment_
     return(gop);
 }
 
+//***********************************************************************
+// _slun_locate - Maps the row relative offset to the block holding it.
+//    Returns the block slot, the offset in the block's cap, and the number
+//    of contiguous bytes available in the block from that point.
+//***********************************************************************
+
+void _slun_locate(lio_seglun_priv_t *s, seglun_row_t *b, ex_off_t off, int *slot, ex_off_t *cap_off, ex_off_t *nleft)
+{
+    ex_off_t ss, pos, dev, n;
+
+    ss = off / s->stripe_size;
+    pos = off % s->stripe_size;
+    dev = pos / s->chunk_size;
+    *slot = (dev - ((ss * s->n_shift) % s->n_devices) + s->n_devices) % s->n_devices;
+    *cap_off = b->block[*slot].cap_offset + ss * s->chunk_size + (pos % s->chunk_size);
+    *nleft = s->chunk_size - (pos % s->chunk_size);
+    n = b->seg_end - b->seg_offset + 1 - off;
+    if (*nleft > n) *nleft = n;
+}
+
+//***********************************************************************
+// _slun_row_get - Returns the row containing the offset or NULL
+//***********************************************************************
+
+seglun_row_t *_slun_row_get(lio_seglun_priv_t *s, ex_off_t off)
+{
+    tbx_isl_iter_t it;
+
+    it = tbx_isl_iter_search(s->isl, (tbx_sl_key_t *)&off, (tbx_sl_key_t *)&off);
+    return((seglun_row_t *)tbx_isl_next(&it));
+}
+
+//***********************************************************************
+// seglun_direct_copy_func - Copies the source LUN to the destination LUN
+//    using depot-to-depot copies.  The layouts can differ.  Each source
+//    chunk is mapped to where it lands in the destination and adjacent
+//    pieces are coalesced so a matching stripe becomes a single copy.
+//***********************************************************************
+
+gop_op_status_t seglun_direct_copy_func(void *arg, int id)
+{
+    seglun_direct_copy_t *dc = (seglun_direct_copy_t *)arg;
+    lio_seglun_priv_t *ss = (lio_seglun_priv_t *)dc->sseg->priv;
+    lio_seglun_priv_t *sd = (lio_seglun_priv_t *)dc->dseg->priv;
+    seglun_row_t *bs, *bd;
+    slun_copy_extent_t ext, piece;
+    gop_opque_t *q;
+    gop_op_generic_t *gop;
+    gop_op_status_t status;
+    ex_off_t pos, soff, doff, sleft, dleft, n;
+    int sslot, dslot, running, err, nops;
+
+    if (segment_size(dc->dseg) < dc->len) {
+        status = gop_sync_exec_status(lio_segment_truncate(dc->dseg, dc->da, dc->len, dc->timeout));
+        if (status.op_status != OP_STATE_SUCCESS) {
+            log_printf(1, "sseg=" XIDT " dseg=" XIDT " Failed growing the destination to len=" XOT "\n", segment_id(dc->sseg), segment_id(dc->dseg), dc->len);
+            return(status);
+        }
+    }
+
+    segment_lock(dc->sseg);
+    segment_lock(dc->dseg);
+
+    q = gop_opque_new();
+    running = err = nops = 0;
+    bs = bd = NULL;
+    memset(&ext, 0, sizeof(ext));
+    pos = 0;
+    while ((pos <= dc->len) && (err == 0)) {
+        if (pos < dc->len) {  //** Map the next piece
+            if ((bs == NULL) || (pos > bs->seg_end)) bs = _slun_row_get(ss, pos);
+            if ((bd == NULL) || (pos > bd->seg_end)) bd = _slun_row_get(sd, pos);
+            if ((bs == NULL) || (bd == NULL)) {
+                log_printf(1, "sseg=" XIDT " dseg=" XIDT " Missing row for pos=" XOT "\n", segment_id(dc->sseg), segment_id(dc->dseg), pos);
+                err++;
+                break;
+            }
+
+            _slun_locate(ss, bs, pos - bs->seg_offset, &sslot, &soff, &sleft);
+            _slun_locate(sd, bd, pos - bd->seg_offset, &dslot, &doff, &dleft);
+            n = (sleft < dleft) ? sleft : dleft;
+            if (n > dc->len - pos) n = dc->len - pos;
+
+            piece.src = bs->block[sslot].data;
+            piece.dest = bd->block[dslot].data;
+            piece.src_offset = soff;
+            piece.dest_offset = doff;
+            piece.len = n;
+            pos += n;
+
+            //** See if we can just extend the current extent
+            if ((ext.len > 0) && (ext.src == piece.src) && (ext.dest == piece.dest) &&
+                    (ext.src_offset + ext.len == piece.src_offset) && (ext.dest_offset + ext.len == piece.dest_offset) &&
+                    (ext.len + piece.len <= SLUN_DIRECT_COPY_MAX)) {
+                ext.len += piece.len;
+                continue;
+            }
+        } else {
+            pos++;  //** Flush the last extent and kick out
+            piece.len = 0;
+        }
+
+        if (ext.len > 0) {  //** Issue the copy for the current extent
+            log_printf(15, "src_rid=%s src_off=" XOT " dest_rid=%s dest_off=" XOT " len=" XOT "\n", ext.src->rid_key, ext.src_offset, ext.dest->rid_key, ext.dest_offset, ext.len);
+            gop = ds_copy(ext.src->ds, dc->da, DS_PUSH, NS_TYPE_SOCK, "",
+                          ds_get_cap(ext.src->ds, ext.src->cap, DS_CAP_READ), ext.src_offset,
+                          ds_get_cap(ext.dest->ds, ext.dest->cap, DS_CAP_WRITE), ext.dest_offset,
+                          ext.len, dc->timeout);
+            gop_opque_add(q, gop);
+            nops++;
+            running++;
+            if (running >= dc->max_inflight) {
+                gop = opque_waitany(q);
+                if (gop_completed_successfully(gop) != OP_STATE_SUCCESS) err++;
+                gop_free(gop, OP_DESTROY);
+                running--;
+            }
+        }
+        ext = piece;
+    }
+
+    while ((gop = opque_waitany(q)) != NULL) {
+        if (gop_completed_successfully(gop) != OP_STATE_SUCCESS) err++;
+        gop_free(gop, OP_DESTROY);
+    }
+    gop_opque_free(q, OP_DESTROY);
+
+    if ((err == 0) && (sd->used_size < dc->len)) sd->used_size = dc->len;
+
+    segment_unlock(dc->dseg);
+    segment_unlock(dc->sseg);
+
+    log_printf(5, "sseg=" XIDT " dseg=" XIDT " len=" XOT " nops=%d err=%d\n", segment_id(dc->sseg), segment_id(dc->dseg), dc->len, nops, err);
+
+    return((err == 0) ? gop_success_status : gop_failure_status);
+}
+
+//***********************************************************************
+// seglun_direct_copy_gop - Copies len bytes from the source LUN to the
+//    destination LUN without the data passing through the client.  The
+//    destination is grown if needed.  Both segments must be LUNs.
+//***********************************************************************
+
+gop_op_generic_t *seglun_direct_copy_gop(data_attr_t *da, lio_segment_t *src, lio_segment_t *dest, ex_off_t len, int max_inflight, int timeout)
+{
+    lio_seglun_priv_t *s = (lio_seglun_priv_t *)dest->priv;
+    seglun_direct_copy_t *dc;
+
+    if ((strcmp(src->header.type, SEGMENT_TYPE_LUN) != 0) || (strcmp(dest->header.type, SEGMENT_TYPE_LUN) != 0)) {
+        return(gop_dummy(gop_failure_status));
+    }
+
+    tbx_type_malloc(dc, seglun_direct_copy_t, 1);
+    dc->sseg = src;
+    dc->dseg = dest;
+    dc->da = da;
+    dc->len = (len < 0) ? segment_size(src) : len;
+    dc->max_inflight = (max_inflight > 0) ? max_inflight : 1;
+    dc->timeout = timeout;
+
+    return(gop_tp_op_new(s->tpc, NULL, seglun_direct_copy_func, (void *)dc, free, 1));
+}
+
 //***********************************************************************
 // seglun_size - Returns the segment size.
 //***********************************************************************
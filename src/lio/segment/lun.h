@@ -24,6 +24,7 @@
 #include <gop/opque.h>
 #include <lio/blacklist.h>
 #include <tbx/fmttypes.h>
+#include <tbx/interval_skiplist.h>
 
 #include "ex3.h"
 #include "ex3/types.h"
@@ -37,6 +38,7 @@ extern "C" {
 lio_segment_t *segment_lun_load(void *arg, ex_id_t id, lio_exnode_exchange_t *ex);
 lio_segment_t *segment_lun_create(void *arg);
 int seglun_row_decompose_test();
+gop_op_generic_t *seglun_direct_copy_gop(data_attr_t *da, lio_segment_t *src, lio_segment_t *dest, ex_off_t len, int max_inflight, int timeout);
 
 struct lio_seglun_priv_t {
     ex_off_t used_size;
@@ -0,0 +1,174 @@
+/*
+   Copyright 2016 Vanderbilt University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+//***********************************************************************
+// Adler32 checksum.  The portable kernel follows zlib.  On x86_64 an AVX2
+// kernel is selected at runtime which handles 32 bytes per iteration.
+// Checksums of separate blocks can be merged with tbx_adler32_combine().
+//***********************************************************************
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tbx/adler32.h"
+
+#define ADLER_BASE 65521U  //** Largest prime smaller than 65536
+#define ADLER_NMAX 5552    //** Largest n such that 255n(n+1)/2 + (n+1)(BASE-1) <= 2^32-1
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define ADLER_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+//***********************************************************************
+// _adler32_portable - Plain C kernel
+//***********************************************************************
+
+static uint32_t _adler32_portable(uint32_t adler, const unsigned char *buf, size_t len)
+{
+    uint32_t s1 = adler & 0xffff;
+    uint32_t s2 = (adler >> 16) & 0xffff;
+    size_t n;
+
+    while (len > 0) {
+        n = (len < ADLER_NMAX) ? len : ADLER_NMAX;
+        len -= n;
+
+        while (n >= 8) {
+            s1 += buf[0]; s2 += s1;
+            s1 += buf[1]; s2 += s1;
+            s1 += buf[2]; s2 += s1;
+            s1 += buf[3]; s2 += s1;
+            s1 += buf[4]; s2 += s1;
+            s1 += buf[5]; s2 += s1;
+            s1 += buf[6]; s2 += s1;
+            s1 += buf[7]; s2 += s1;
+            buf += 8;
+            n -= 8;
+        }
+        while (n > 0) {
+            s1 += *buf++; s2 += s1;
+            n--;
+        }
+
+        s1 %= ADLER_BASE;
+        s2 %= ADLER_BASE;
+    }
+
+    return((s2 << 16) | s1);
+}
+
+#ifdef ADLER_HAVE_AVX2
+
+//***********************************************************************
+// _adler32_hsum256 - Sums the 8 32-bit lanes
+//***********************************************************************
+
+__attribute__((target("avx2")))
+static inline uint32_t _adler32_hsum256(__m256i v)
+{
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return((uint32_t)_mm_cvtsi128_si32(s));
+}
+
+//***********************************************************************
+// _adler32_avx2 - AVX2 kernel.  Each 32 byte block adds sum(b[i]) to s1
+//    and 32*s1 + sum((32-i)*b[i]) to s2.  The block sums are kept in
+//    vector lanes and only reduced once per NMAX chunk.
+//***********************************************************************
+
+__attribute__((target("avx2")))
+static uint32_t _adler32_avx2(uint32_t adler, const unsigned char *buf, size_t len)
+{
+    uint32_t s1 = adler & 0xffff;
+    uint32_t s2 = (adler >> 16) & 0xffff;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                                             16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    __m256i vs1, vs2, vs3, v;
+    size_t n;
+
+    while (len >= 32) {
+        n = (len < ADLER_NMAX) ? len : ADLER_NMAX;
+        n &= ~(size_t)31;
+        len -= n;
+
+        vs1 = _mm256_setr_epi32(s1, 0, 0, 0, 0, 0, 0, 0);
+        vs2 = _mm256_setr_epi32(s2, 0, 0, 0, 0, 0, 0, 0);
+        vs3 = zero;   //** Running total of s1 at the start of each block
+
+        while (n > 0) {
+            v = _mm256_loadu_si256((const __m256i *)buf);
+            vs3 = _mm256_add_epi32(vs3, vs1);
+            vs1 = _mm256_add_epi32(vs1, _mm256_sad_epu8(v, zero));
+            vs2 = _mm256_add_epi32(vs2, _mm256_madd_epi16(_mm256_maddubs_epi16(v, weights), ones));
+            buf += 32;
+            n -= 32;
+        }
+
+        vs2 = _mm256_add_epi32(vs2, _mm256_slli_epi32(vs3, 5));
+        s1 = _adler32_hsum256(vs1) % ADLER_BASE;
+        s2 = _adler32_hsum256(vs2) % ADLER_BASE;
+    }
+
+    if (len == 0) return((s2 << 16) | s1);
+    return(_adler32_portable((s2 << 16) | s1, buf, len));
+}
+
+#endif
+
+//***********************************************************************
+// tbx_adler32 - Updates the running checksum using the best kernel
+//***********************************************************************
+
+uint32_t tbx_adler32(uint32_t adler, const unsigned char *buf, size_t len)
+{
+#ifdef ADLER_HAVE_AVX2
+    static int have_avx2 = -1;
+
+    if (have_avx2 < 0) have_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    if (have_avx2 && (len >= 64)) return(_adler32_avx2(adler, buf, len));
+#endif
+
+    return(_adler32_portable(adler, buf, len));
+}
+
+//***********************************************************************
+// tbx_adler32_combine - Merges the checksums of two adjacent blocks
+//***********************************************************************
+
+uint32_t tbx_adler32_combine(uint32_t adler1, uint32_t adler2, int64_t len2)
+{
+    uint64_t sum1, sum2, rem;
+
+    if (len2 < 0) return(0xffffffffU);
+
+    rem = (uint64_t)len2 % ADLER_BASE;
+    sum1 = adler1 & 0xffff;
+    sum2 = (rem * sum1) % ADLER_BASE;
+    sum1 += (adler2 & 0xffff) + ADLER_BASE - 1;
+    sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + ADLER_BASE - rem;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum2 >= ((uint64_t)ADLER_BASE << 1)) sum2 -= ((uint64_t)ADLER_BASE << 1);
+    if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+
+    return((uint32_t)((sum2 << 16) | sum1));
+}
@@ -18,6 +18,11 @@
 //
 //  Provides a simple DNS cache
 //
+//  The table is split into shards, each with its own lock, and the lock is
+//  never held while resolving.  Entries expire individually.  An expired
+//  entry is still returned while a background thread refreshes it so
+//  callers only block on names that have never been seen.
+//
 //**************************************************************************
 
 #define _log_module_index 115
@@ -26,10 +31,13 @@
 #include <apr_hash.h>
 #include <apr_network_io.h>
 #include <apr_pools.h>
+#include <apr_thread_cond.h>
 #include <apr_thread_mutex.h>
+#include <apr_thread_proc.h>
 #include <apr_time.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <sys/socket.h>
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
@@ -40,123 +48,322 @@
 #include "tbx/fmttypes.h"
 #include "tbx/log.h"
 #include "tbx/string_token.h"
+#include "tbx/type_malloc.h"
 
 #define BUF_SIZE 128
+#define DNS_SHARDS 16
+#define DNS_TTL_DEFAULT 600   //** Seconds an entry is good for
+#define DNS_RETRY 30          //** Seconds before retrying a failed refresh
 
 typedef struct {
     char name[BUF_SIZE];
-    unsigned char addr[DNS_ADDR_MAX];
-    char ip_addr[256];
-    tbx_dns_ip_t family;
+    unsigned char addr[2][DNS_ADDR_MAX6];  //** Indexed by tbx_dns_ip_t
+    char ip_addr[2][256];
+    int valid[2];
+    apr_time_t expire;
+    apr_time_t last_used;
+    int refreshing;
 } DNS_entry_t;
 
 typedef struct {
     apr_pool_t *mpool;
-    apr_pool_t *lockpool;
     apr_hash_t *table;
-    unsigned int size;
-    apr_time_t restart_time;
     apr_thread_mutex_t *lock;
+} DNS_shard_t;
+
+typedef struct DNS_refresh_t DNS_refresh_t;
+struct DNS_refresh_t {
+    char name[BUF_SIZE];
+    DNS_refresh_t *next;
+};
+
+typedef struct {
+    apr_pool_t *lockpool;
+    DNS_shard_t shard[DNS_SHARDS];
+    unsigned int size;            //** Max entries per shard
+    apr_time_t ttl;
+    apr_thread_mutex_t *lock;     //** Protects the refresh queue
+    apr_thread_cond_t *cond;
+    apr_thread_t *thread;
+    DNS_refresh_t *refresh;
+    int shutdown;
 } DNS_cache_t;
 
 DNS_cache_t *_cache = NULL;
 
 
 //**************************************************************************
-//  wipe_entries - Wipes the existing entries and resets the timer
+// hostname2ip - Resolves the host's IPv4 and IPv6 addresses into the entry.
+//     Returns 0 if at least one was found.
 //**************************************************************************
 
-void wipe_entries(DNS_cache_t *cache)
+int hostname2ip(const char *name, DNS_entry_t *h)
 {
-    if (cache->mpool != NULL) apr_pool_destroy(cache->mpool);
+    struct addrinfo hints, *res, *ai;
+    void *a;
+    int n, fam;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(name, NULL, &hints, &res) != 0) return(-1);
+
+    h->valid[DNS_IPV4] = h->valid[DNS_IPV6] = 0;
+    for (ai = res; ai != NULL; ai = ai->ai_next) {
+        if (ai->ai_family == AF_INET) {
+            fam = DNS_IPV4;
+            a = &(((struct sockaddr_in *)ai->ai_addr)->sin_addr);
+            n = 4;
+        } else if (ai->ai_family == AF_INET6) {
+            fam = DNS_IPV6;
+            a = &(((struct sockaddr_in6 *)ai->ai_addr)->sin6_addr);
+            n = 16;
+        } else {
+            continue;
+        }
+
+        if (h->valid[fam]) continue;  //** Keep the 1st of each family
+        memset(h->addr[fam], 0, DNS_ADDR_MAX6);
+        memcpy(h->addr[fam], a, n);
+        inet_ntop(ai->ai_family, a, h->ip_addr[fam], sizeof(h->ip_addr[fam]));
+        h->valid[fam] = 1;
+    }
+    freeaddrinfo(res);
+
+    return((h->valid[DNS_IPV4] || h->valid[DNS_IPV6]) ? 0 : -1);
+}
+
+//**************************************************************************
+// _dnsc_shard - Returns the shard holding the name
+//**************************************************************************
 
-    assert_result(apr_pool_create(&(cache->mpool), NULL), APR_SUCCESS);
-    cache->table = apr_hash_make(cache->mpool);FATAL_UNLESS(cache->table != NULL);
+DNS_shard_t *_dnsc_shard(const char *name)
+{
+    unsigned int h = 5381;
 
-    cache->restart_time = apr_time_now() + apr_time_make(600, 0);
+    while (*name != '\0') h = (h * 33) ^ (unsigned char)*name++;
+    return(&(_cache->shard[h % DNS_SHARDS]));
 }
 
 //**************************************************************************
-// hostname2ip - Return the host's IP address
+// _dnsc_evict - Drops the least recently used entry in the shard
+//     NOTE: Shard lock should be held by the calling thread
 //**************************************************************************
 
-int hostname2ip(const char *name, char *ip_bytes, char *ip_text, int ip_text_size)
+void _dnsc_evict(DNS_shard_t *s)
 {
-    struct hostent *he;
-    struct in_addr **al;
+    apr_hash_index_t *hi;
+    DNS_entry_t *h, *lru;
 
-    if ((he = gethostbyname(name)) == NULL) return(-1);
+    lru = NULL;
+    for (hi = apr_hash_first(NULL, s->table); hi != NULL; hi = apr_hash_next(hi)) {
+        apr_hash_this(hi, NULL, NULL, (void **)&h);
+        if ((lru == NULL) || (h->last_used < lru->last_used)) lru = h;
+    }
 
-    al = (struct in_addr **)he->h_addr_list;
-    if (ip_bytes) memcpy(ip_bytes, al[0], 4);
-    if (ip_text) inet_ntop(AF_INET, al[0], ip_text, ip_text_size);
+    if (lru == NULL) return;
 
-    return(0);
+    log_printf(15, "evicting host=%s\n", lru->name);
+    apr_hash_set(s->table, lru->name, APR_HASH_KEY_STRING, NULL);
+    free(lru);
+}
+
+//**************************************************************************
+// _dnsc_copy - Copies the address for the requested family out of the entry.
+//     If strict is 0 the other family is used when the requested one is
+//     missing.  Returns the family used or -1 if none.
+//**************************************************************************
+
+int _dnsc_copy(DNS_entry_t *h, int family, int strict, char *byte_addr, char *ip_addr)
+{
+    int n;
+
+    if (!h->valid[family]) {
+        if (strict) return(-1);
+        family = (family == DNS_IPV4) ? DNS_IPV6 : DNS_IPV4;
+        if (!h->valid[family]) return(-1);
+    }
+
+    n = (family == DNS_IPV4) ? DNS_ADDR_MAX : DNS_ADDR_MAX6;
+    if (ip_addr != NULL) strcpy(ip_addr, h->ip_addr[family]);
+    if (byte_addr != NULL) memcpy(byte_addr, h->addr[family], n);
+
+    return(family);
 }
 
+//**************************************************************************
+// _dnsc_refresh_queue - Queues the name for a background refresh
+//**************************************************************************
+
+void _dnsc_refresh_queue(const char *name)
+{
+    DNS_refresh_t *r;
+
+    tbx_type_malloc(r, DNS_refresh_t, 1);
+    strcpy(r->name, name);
+
+    apr_thread_mutex_lock(_cache->lock);
+    r->next = _cache->refresh;
+    _cache->refresh = r;
+    apr_thread_cond_signal(_cache->cond);
+    apr_thread_mutex_unlock(_cache->lock);
+}
 
 //**************************************************************************
-//  lookup_host - Looks up the host.  Make sure that the lock/unlock routines
-//      are used to make it threadsafe!
-//
+// _dnsc_refresh_thread - Re-resolves expired entries
 //**************************************************************************
 
-int tbx_dnsc_lookup(const char *name, char *byte_addr, char *ip_addr)
+void *_dnsc_refresh_thread(apr_thread_t *th, void *arg)
 {
-    char ip_buffer[256];
+    DNS_cache_t *cache = (DNS_cache_t *)arg;
+    DNS_refresh_t *r;
+    DNS_shard_t *s;
+    DNS_entry_t res, *h;
     int err;
-    DNS_entry_t *h;
-    struct in_addr sa;
 
-    log_printf(20, "lookup_host: start time=" TT " name=%s\n", apr_time_now(), name);
-    if (_cache == NULL) log_printf(20, "lookup_host: _cache == NULL\n");
+    apr_thread_mutex_lock(cache->lock);
+    while (cache->shutdown == 0) {
+        if (cache->refresh == NULL) {
+            apr_thread_cond_wait(cache->cond, cache->lock);
+            continue;
+        }
+
+        r = cache->refresh;
+        cache->refresh = r->next;
+        apr_thread_mutex_unlock(cache->lock);
+
+        memset(&res, 0, sizeof(res));
+        err = hostname2ip(r->name, &res);
+        log_printf(15, "refresh host=%s err=%d\n", r->name, err);
+
+        s = _dnsc_shard(r->name);
+        apr_thread_mutex_lock(s->lock);
+        h = (DNS_entry_t *)apr_hash_get(s->table, r->name, APR_HASH_KEY_STRING);
+        if (h != NULL) {   //** Could have been evicted in the meantime
+            if (err == 0) {
+                memcpy(h->addr, res.addr, sizeof(h->addr));
+                memcpy(h->ip_addr, res.ip_addr, sizeof(h->ip_addr));
+                memcpy(h->valid, res.valid, sizeof(h->valid));
+                h->expire = apr_time_now() + cache->ttl;
+            } else {  //** Keep serving the old address and try again later
+                h->expire = apr_time_now() + apr_time_from_sec(DNS_RETRY);
+            }
+            h->refreshing = 0;
+        }
+        apr_thread_mutex_unlock(s->lock);
+        free(r);
+
+        apr_thread_mutex_lock(cache->lock);
+    }
+    apr_thread_mutex_unlock(cache->lock);
 
-    if (name[0] == '\0') return(1);  //** Return early if name is NULL
+    return(NULL);
+}
 
-    apr_thread_mutex_lock(_cache->lock);
+//**************************************************************************
+// _dnsc_lookup - Looks up the host returning the address for the family.
+//     Returns the family used or -1 on failure.
+//**************************************************************************
+
+int _dnsc_lookup(const char *name, int family, int strict, char *byte_addr, char *ip_addr)
+{
+    DNS_shard_t *s;
+    DNS_entry_t *h, *nh;
+    apr_time_t now;
+    int err, stale;
 
-    if ((apr_time_now() > _cache->restart_time) || (apr_hash_count(_cache->table) > _cache->size)) wipe_entries(_cache);
+    log_printf(20, "lookup_host: start time=" TT " name=%s\n", apr_time_now(), name);
+    if (_cache == NULL) log_printf(20, "lookup_host: _cache == NULL\n");
 
-    h = (DNS_entry_t *)apr_hash_get(_cache->table, name, APR_HASH_KEY_STRING);
+    if (name[0] == '\0') return(-1);  //** Return early if name is NULL
 
+    s = _dnsc_shard(name);
+    now = apr_time_now();
+
+    apr_thread_mutex_lock(s->lock);
+    h = (DNS_entry_t *)apr_hash_get(s->table, name, APR_HASH_KEY_STRING);
     if (h != NULL) {  //** Got a hit!!
-        if (ip_addr != NULL)
-            strcpy(ip_addr, h->ip_addr);
-        if (byte_addr != NULL)
-            memcpy(byte_addr, h->addr, DNS_ADDR_MAX);
-        apr_thread_mutex_unlock(_cache->lock);
-        return(0);
+        h->last_used = now;
+        stale = ((h->expire < now) && (h->refreshing == 0));
+        if (stale) h->refreshing = 1;
+        err = _dnsc_copy(h, family, strict, byte_addr, ip_addr);
+        apr_thread_mutex_unlock(s->lock);
+
+        if (stale) _dnsc_refresh_queue(name);
+        return(err);
     }
+    apr_thread_mutex_unlock(s->lock);
 
     //** If we made it here that means we have to look it up
-    err = hostname2ip(name, (char *)&sa, ip_buffer, sizeof(ip_buffer));
-    if (err != 0) {
-        apr_thread_mutex_unlock(_cache->lock);
+    tbx_type_malloc_clear(nh, DNS_entry_t, 1);
+    if (hostname2ip(name, nh) != 0) {
+        free(nh);
         return(-1);
     }
-    h = (DNS_entry_t *)apr_palloc(_cache->mpool, sizeof(DNS_entry_t)); //** This is created withthe pool for easy cleanup
-    memset(h, 0, sizeof(DNS_entry_t));
+    strncpy(nh->name, name, sizeof(nh->name));
+    nh->name[sizeof(nh->name)-1] = '\0';
+    nh->expire = now + _cache->ttl;
+    nh->last_used = now;
+
+    log_printf(20, "lookup_host: end host=%s ipv4=%s ipv6=%s\n", name, nh->ip_addr[DNS_IPV4], nh->ip_addr[DNS_IPV6]);
+
+    //** Add the entry to the table unless someone beat us to it
+    apr_thread_mutex_lock(s->lock);
+    h = (DNS_entry_t *)apr_hash_get(s->table, nh->name, APR_HASH_KEY_STRING);
+    if (h == NULL) {
+        if (apr_hash_count(s->table) >= _cache->size) _dnsc_evict(s);
+        apr_hash_set(s->table, nh->name, APR_HASH_KEY_STRING, nh);
+        h = nh;
+        nh = NULL;
+    }
+    err = _dnsc_copy(h, family, strict, byte_addr, ip_addr);
+    apr_thread_mutex_unlock(s->lock);
+
+    if (nh != NULL) free(nh);
+
+    return(err);
+}
 
-    strncpy(h->name, name, sizeof(h->name));
-    h->name[sizeof(h->name)-1] = '\0';
-    h->family = DNS_IPV4;
-    memcpy(h->addr, &sa, sizeof(sa));
-    strcpy(h->ip_addr, ip_buffer);
+//**************************************************************************
+//  tbx_dnsc_lookup - Looks up the host's IPv4 address.  byte_addr must hold
+//      DNS_ADDR_MAX bytes.
+//**************************************************************************
 
-    log_printf(20, "lookup_host: end host=%s address=%s\n", name, ip_buffer);
+int tbx_dnsc_lookup(const char *name, char *byte_addr, char *ip_addr)
+{
+    if (name[0] == '\0') return(1);  //** Return early if name is NULL
 
-    //** Add the enry to the table
-    apr_hash_set(_cache->table, h->name, APR_HASH_KEY_STRING, h);
+    return((_dnsc_lookup(name, DNS_IPV4, 1, byte_addr, ip_addr) == DNS_IPV4) ? 0 : -1);
+}
 
-    //** Return the address
-    if (ip_addr != NULL) strcpy(ip_addr, h->ip_addr);
-    if (byte_addr != NULL) memcpy(byte_addr, h->addr, sizeof(sa));
+//**************************************************************************
+//  tbx_dnsc_lookup_family - Looks up the host preferring the address
+//      family in *family and falling back to the other one.  On success
+//      *family holds the family returned.  byte_addr must hold
+//      DNS_ADDR_MAX6 bytes.
+//**************************************************************************
 
-    apr_thread_mutex_unlock(_cache->lock);
+int tbx_dnsc_lookup_family(const char *name, tbx_dns_ip_t *family, char *byte_addr, char *ip_addr)
+{
+    int fam;
+
+    fam = _dnsc_lookup(name, *family, 0, byte_addr, ip_addr);
+    if (fam < 0) return(-1);
 
+    *family = fam;
     return(0);
 }
 
+//**************************************************************************
+// tbx_dnsc_ttl_set - Sets how long in seconds a resolved address is used
+//     before it's refreshed
+//**************************************************************************
+
+void tbx_dnsc_ttl_set(int ttl)
+{
+    if (_cache != NULL) _cache->ttl = apr_time_from_sec(ttl);
+}
+
 //**************************************************************************
 
 int tbx_dnsc_startup()
@@ -168,17 +375,27 @@ int tbx_dnsc_startup()
 
 int tbx_dnsc_startup_sized(int size)
 {
+    int i;
+
     if (_cache != NULL) return 0;
 
-    _cache = (DNS_cache_t *)malloc(sizeof(DNS_cache_t));
-    FATAL_UNLESS(_cache != NULL);
+    tbx_type_malloc_clear(_cache, DNS_cache_t, 1);
+
+    _cache->size = size / DNS_SHARDS;
+    if (_cache->size < 4) _cache->size = 4;
+    _cache->ttl = apr_time_from_sec(DNS_TTL_DEFAULT);
 
-    _cache->size = size;
-    _cache->mpool = NULL;
     assert_result(apr_pool_create(&(_cache->lockpool), NULL), APR_SUCCESS);
     apr_thread_mutex_create(&(_cache->lock), APR_THREAD_MUTEX_DEFAULT,_cache->lockpool);
+    apr_thread_cond_create(&(_cache->cond), _cache->lockpool);
+    for (i=0; i<DNS_SHARDS; i++) {
+        assert_result(apr_pool_create(&(_cache->shard[i].mpool), NULL), APR_SUCCESS);
+        apr_thread_mutex_create(&(_cache->shard[i].lock), APR_THREAD_MUTEX_DEFAULT,_cache->shard[i].mpool);
+        _cache->shard[i].table = apr_hash_make(_cache->shard[i].mpool);FATAL_UNLESS(_cache->shard[i].table != NULL);
+    }
+
+    assert_result(apr_thread_create(&(_cache->thread), NULL, _dnsc_refresh_thread, (void *)_cache, _cache->lockpool), APR_SUCCESS);
 
-    wipe_entries(_cache);
     return 0;
 }
 
@@ -186,9 +403,35 @@ int tbx_dnsc_startup_sized(int size)
 
 int tbx_dnsc_shutdown()
 {
-    apr_thread_mutex_destroy(_cache->lock);
+    apr_hash_index_t *hi;
+    DNS_entry_t *h;
+    DNS_refresh_t *r;
+    apr_status_t val;
+    int i;
+
+    //** Stop the refresh thread
+    apr_thread_mutex_lock(_cache->lock);
+    _cache->shutdown = 1;
+    apr_thread_cond_signal(_cache->cond);
+    apr_thread_mutex_unlock(_cache->lock);
+    apr_thread_join(&val, _cache->thread);
+
+    while ((r = _cache->refresh) != NULL) {
+        _cache->refresh = r->next;
+        free(r);
+    }
 
-    if (_cache->mpool != NULL) apr_pool_destroy(_cache->mpool);
+    for (i=0; i<DNS_SHARDS; i++) {
+        for (hi = apr_hash_first(NULL, _cache->shard[i].table); hi != NULL; hi = apr_hash_next(hi)) {
+            apr_hash_this(hi, NULL, NULL, (void **)&h);
+            free(h);
+        }
+        apr_thread_mutex_destroy(_cache->shard[i].lock);
+        apr_pool_destroy(_cache->shard[i].mpool);
+    }
+
+    apr_thread_cond_destroy(_cache->cond);
+    apr_thread_mutex_destroy(_cache->lock);
     if (_cache->lockpool != NULL) apr_pool_destroy(_cache->lockpool);
 
     free(_cache);
@@ -196,5 +439,3 @@ int tbx_dnsc_shutdown()
     _cache = NULL;
     return 0;
 }
-
-
@@ -0,0 +1,625 @@
+/*
+   Copyright 2016 Vanderbilt University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+//*********************************************************************************
+// Interval B+tree.  Intervals are kept sorted by (lo, hi, data) in wide leaves
+// with each internal node tracking the smallest interval and the largest hi
+// for every child.  The largest hi lets overlap searches skip whole subtrees
+// and since everything is sorted by lo a search stops as soon as it passes
+// the end of the query range.  Overlap queries are O(log n + k) for disjoint
+// intervals like a log segment's mapping.
+//
+// NOTE: Modifying the tree invalidates any outstanding iterators.
+//*********************************************************************************
+
+#define _log_module_index 108
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tbx/assert_result.h"
+#include "tbx/fmttypes.h"
+#include "tbx/interval_btree.h"
+#include "tbx/log.h"
+#include "tbx/type_malloc.h"
+
+#define IBT_MIN (TBX_IBT_ORDER/2)
+
+struct tbx_ibt_node_t {
+    int leaf;
+    int n;
+    tbx_ibt_entry_t entry[TBX_IBT_ORDER];  //** Leaf: the intervals.  Internal: smallest interval in each child
+    int64_t cmax[TBX_IBT_ORDER];           //** Internal only: largest hi in each child
+    tbx_ibt_node_t *child[TBX_IBT_ORDER];  //** Internal only
+};
+
+//** Leaves don't need the child tables so they are allocated shorter
+#define IBT_LEAF_SIZE offsetof(tbx_ibt_node_t, cmax)
+
+//*********************************************************************************
+// _ibt_cmp - Orders intervals by lo then hi then the data pointer
+//*********************************************************************************
+
+static inline int _ibt_cmp(const tbx_ibt_entry_t *a, const tbx_ibt_entry_t *b)
+{
+    if (a->lo != b->lo) return((a->lo < b->lo) ? -1 : 1);
+    if (a->hi != b->hi) return((a->hi < b->hi) ? -1 : 1);
+    if (a->data != b->data) return(((uintptr_t)a->data < (uintptr_t)b->data) ? -1 : 1);
+    return(0);
+}
+
+static int _ibt_qsort_cmp(const void *a, const void *b)
+{
+    return(_ibt_cmp((const tbx_ibt_entry_t *)a, (const tbx_ibt_entry_t *)b));
+}
+
+//*********************************************************************************
+// _ibt_node_new - Makes a new empty node
+//*********************************************************************************
+
+tbx_ibt_node_t *_ibt_node_new(int leaf)
+{
+    tbx_ibt_node_t *node;
+
+    node = malloc((leaf) ? IBT_LEAF_SIZE : sizeof(tbx_ibt_node_t));
+    FATAL_UNLESS(node != NULL);
+    node->leaf = leaf;
+    node->n = 0;
+
+    return(node);
+}
+
+//*********************************************************************************
+// _ibt_node_max - Returns the largest hi in the node
+//*********************************************************************************
+
+int64_t _ibt_node_max(tbx_ibt_node_t *node)
+{
+    int64_t hi;
+    int i;
+
+    hi = TBX_IBT_KEY_MIN;
+    if (node->leaf) {
+        for (i=0; i<node->n; i++) {
+            if (node->entry[i].hi > hi) hi = node->entry[i].hi;
+        }
+    } else {
+        for (i=0; i<node->n; i++) {
+            if (node->cmax[i] > hi) hi = node->cmax[i];
+        }
+    }
+
+    return(hi);
+}
+
+//*********************************************************************************
+// _ibt_child_fix - Refreshes the parent's summary of child i
+//*********************************************************************************
+
+static inline void _ibt_child_fix(tbx_ibt_node_t *node, int i)
+{
+    node->entry[i] = node->child[i]->entry[0];
+    node->cmax[i] = _ibt_node_max(node->child[i]);
+}
+
+//*********************************************************************************
+// _ibt_upper_bound - Returns the 1st slot with an entry > e
+//*********************************************************************************
+
+int _ibt_upper_bound(tbx_ibt_node_t *node, tbx_ibt_entry_t *e)
+{
+    int lo, hi, mid;
+
+    lo = 0;
+    hi = node->n;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (_ibt_cmp(&(node->entry[mid]), e) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return(lo);
+}
+
+//*********************************************************************************
+// _ibt_find_child - Returns the child that should contain e
+//*********************************************************************************
+
+static inline int _ibt_find_child(tbx_ibt_node_t *node, tbx_ibt_entry_t *e)
+{
+    int i = _ibt_upper_bound(node, e) - 1;
+    return((i < 0) ? 0 : i);
+}
+
+//*********************************************************************************
+// _ibt_move - Moves slots between nodes.  The ranges may overlap.
+//*********************************************************************************
+
+void _ibt_move(tbx_ibt_node_t *dst, int dpos, tbx_ibt_node_t *src, int spos, int n)
+{
+    if (n <= 0) return;
+
+    memmove(&(dst->entry[dpos]), &(src->entry[spos]), n*sizeof(tbx_ibt_entry_t));
+    if (!src->leaf) {
+        memmove(&(dst->cmax[dpos]), &(src->cmax[spos]), n*sizeof(int64_t));
+        memmove(&(dst->child[dpos]), &(src->child[spos]), n*sizeof(tbx_ibt_node_t *));
+    }
+}
+
+//*********************************************************************************
+// _ibt_split - Moves the upper half of the node to a new right sibling
+//*********************************************************************************
+
+tbx_ibt_node_t *_ibt_split(tbx_ibt_node_t *node)
+{
+    tbx_ibt_node_t *right;
+    int nleft;
+
+    right = _ibt_node_new(node->leaf);
+    nleft = node->n / 2;
+    right->n = node->n - nleft;
+    _ibt_move(right, 0, node, nleft, right->n);
+    node->n = nleft;
+
+    return(right);
+}
+
+//*********************************************************************************
+// _ibt_insert - Recursively inserts the interval returning the new right
+//    sibling if the node had to be split or NULL otherwise.
+//*********************************************************************************
+
+tbx_ibt_node_t *_ibt_insert(tbx_ibt_node_t *node, tbx_ibt_entry_t *e)
+{
+    tbx_ibt_node_t *right, *split, *dst;
+    int i, pos;
+
+    if (node->leaf) {
+        right = (node->n == TBX_IBT_ORDER) ? _ibt_split(node) : NULL;
+        dst = ((right != NULL) && (_ibt_cmp(e, &(right->entry[0])) >= 0)) ? right : node;
+        pos = _ibt_upper_bound(dst, e);
+        _ibt_move(dst, pos+1, dst, pos, dst->n - pos);
+        dst->entry[pos] = *e;
+        dst->n++;
+        return(right);
+    }
+
+    i = _ibt_find_child(node, e);
+    split = _ibt_insert(node->child[i], e);
+    _ibt_child_fix(node, i);
+    if (split == NULL) return(NULL);
+
+    //** The child split so add the new sibling after it
+    right = NULL;
+    dst = node;
+    pos = i + 1;
+    if (node->n == TBX_IBT_ORDER) {
+        right = _ibt_split(node);
+        if (pos > node->n) {
+            dst = right;
+            pos -= node->n;
+        }
+    }
+    _ibt_move(dst, pos+1, dst, pos, dst->n - pos);
+    dst->child[pos] = split;
+    dst->n++;
+    _ibt_child_fix(dst, pos);
+
+    return(right);
+}
+
+//*********************************************************************************
+// tbx_ibt_insert - Adds the interval [lo, hi] to the tree
+//*********************************************************************************
+
+int tbx_ibt_insert(tbx_ibt_t *t, int64_t lo, int64_t hi, void *data)
+{
+    tbx_ibt_entry_t e;
+    tbx_ibt_node_t *right, *root;
+
+    e.lo = lo;
+    e.hi = hi;
+    e.data = data;
+
+    if (t->root == NULL) {
+        t->root = _ibt_node_new(1);
+        t->height = 1;
+    }
+
+    right = _ibt_insert(t->root, &e);
+    if (right != NULL) {  //** Root split so grow the tree
+        FATAL_UNLESS(t->height < TBX_IBT_MAX_DEPTH);
+        root = _ibt_node_new(0);
+        root->n = 2;
+        root->child[0] = t->root;
+        root->child[1] = right;
+        _ibt_child_fix(root, 0);
+        _ibt_child_fix(root, 1);
+        t->root = root;
+        t->height++;
+    }
+
+    t->n_intervals++;
+
+    return(0);
+}
+
+//*********************************************************************************
+// _ibt_rebalance - Merges or evens out the underfull child i with a sibling
+//*********************************************************************************
+
+void _ibt_rebalance(tbx_ibt_node_t *node, int i)
+{
+    tbx_ibt_node_t *left, *right;
+    int li, n;
+
+    if (node->n < 2) return;
+
+    li = (i+1 < node->n) ? i : i-1;
+    left = node->child[li];
+    right = node->child[li+1];
+
+    if (left->n + right->n <= TBX_IBT_ORDER) {  //** Merge them
+        _ibt_move(left, left->n, right, 0, right->n);
+        left->n += right->n;
+        free(right);
+        _ibt_move(node, li+1, node, li+2, node->n - li - 2);
+        node->n--;
+        _ibt_child_fix(node, li);
+        return;
+    }
+
+    //** Split the slots evenly
+    n = (left->n + right->n) / 2;
+    if (left->n < n) {  //** Shift from the right
+        n = n - left->n;
+        _ibt_move(left, left->n, right, 0, n);
+        left->n += n;
+        _ibt_move(right, 0, right, n, right->n - n);
+        right->n -= n;
+    } else {  //** Shift from the left
+        n = left->n - n;
+        _ibt_move(right, n, right, 0, right->n);
+        _ibt_move(right, 0, left, left->n - n, n);
+        right->n += n;
+        left->n -= n;
+    }
+    _ibt_child_fix(node, li);
+    _ibt_child_fix(node, li+1);
+}
+
+//*********************************************************************************
+// _ibt_remove - Recursively removes the interval.  Returns 1 if found.
+//*********************************************************************************
+
+int _ibt_remove(tbx_ibt_node_t *node, tbx_ibt_entry_t *e)
+{
+    tbx_ibt_node_t *child;
+    int i;
+
+    if (node->leaf) {
+        i = _ibt_upper_bound(node, e) - 1;
+        if ((i < 0) || (_ibt_cmp(&(node->entry[i]), e) != 0)) return(0);
+        _ibt_move(node, i, node, i+1, node->n - i - 1);
+        node->n--;
+        return(1);
+    }
+
+    i = _ibt_find_child(node, e);
+    child = node->child[i];
+    if (_ibt_remove(child, e) == 0) return(0);
+
+    if (child->n == 0) {  //** Drop the empty child
+        free(child);
+        _ibt_move(node, i, node, i+1, node->n - i - 1);
+        node->n--;
+    } else {
+        _ibt_child_fix(node, i);
+        if (child->n < IBT_MIN) _ibt_rebalance(node, i);
+    }
+
+    return(1);
+}
+
+//*********************************************************************************
+// tbx_ibt_remove - Removes the interval.  Returns 0 on success or 1 if the
+//    interval wasn't found.
+//*********************************************************************************
+
+int tbx_ibt_remove(tbx_ibt_t *t, int64_t lo, int64_t hi, void *data)
+{
+    tbx_ibt_entry_t e;
+    tbx_ibt_node_t *root;
+
+    if (t->root == NULL) return(1);
+
+    e.lo = lo;
+    e.hi = hi;
+    e.data = data;
+
+    if (_ibt_remove(t->root, &e) == 0) {
+        log_printf(15, "Missing interval! lo=" I64T " hi=" I64T " data=%p\n", lo, hi, data);
+        return(1);
+    }
+
+    t->n_intervals--;
+
+    //** Shrink the tree if needed
+    root = t->root;
+    if (root->n == 0) {
+        free(root);
+        t->root = NULL;
+        t->height = 0;
+    } else if ((root->leaf == 0) && (root->n == 1)) {
+        t->root = root->child[0];
+        t->height--;
+        free(root);
+    }
+
+    return(0);
+}
+
+//*********************************************************************************
+// tbx_ibt_iter_init - Initializes an iterator over all intervals overlapping
+//    [lo, hi].  Use TBX_IBT_KEY_MIN/MAX to iterate over everything.
+//*********************************************************************************
+
+void tbx_ibt_iter_init(tbx_ibt_iter_t *it, tbx_ibt_t *t, int64_t lo, int64_t hi)
+{
+    it->t = t;
+    it->lo = lo;
+    it->hi = hi;
+    it->depth = -1;
+    if (t->root != NULL) {
+        it->depth = 0;
+        it->node[0] = t->root;
+        it->slot[0] = 0;
+    }
+}
+
+//*********************************************************************************
+// tbx_ibt_iter_search - Returns an iterator for intervals overlapping [lo, hi]
+//*********************************************************************************
+
+tbx_ibt_iter_t tbx_ibt_iter_search(tbx_ibt_t *t, int64_t lo, int64_t hi)
+{
+    tbx_ibt_iter_t it;
+
+    tbx_ibt_iter_init(&it, t, lo, hi);
+    return(it);
+}
+
+//*********************************************************************************
+// tbx_ibt_next - Returns the data for the next overlapping interval in lo
+//    order or NULL when done.
+//*********************************************************************************
+
+void *tbx_ibt_next(tbx_ibt_iter_t *it)
+{
+    tbx_ibt_node_t *node;
+    int i;
+
+    while (it->depth >= 0) {
+        node = it->node[it->depth];
+        i = it->slot[it->depth];
+        if (i >= node->n) {  //** Finished with this node
+            it->depth--;
+            continue;
+        }
+
+        it->slot[it->depth]++;
+        if (node->entry[i].lo > it->hi) {  //** Everything after this starts past the range
+            it->depth = -1;
+            break;
+        }
+
+        if (node->leaf) {
+            if (node->entry[i].hi >= it->lo) return(node->entry[i].data);
+        } else if (node->cmax[i] >= it->lo) {  //** Only descend if something in the child can overlap
+            it->depth++;
+            it->node[it->depth] = node->child[i];
+            it->slot[it->depth] = 0;
+        }
+    }
+
+    return(NULL);
+}
+
+//*********************************************************************************
+// tbx_ibt_range_count - Returns the number of intervals overlapping [lo, hi]
+//*********************************************************************************
+
+int tbx_ibt_range_count(tbx_ibt_t *t, int64_t lo, int64_t hi)
+{
+    tbx_ibt_iter_t it;
+    int n;
+
+    n = 0;
+    tbx_ibt_iter_init(&it, t, lo, hi);
+    while (tbx_ibt_next(&it) != NULL) n++;
+
+    return(n);
+}
+
+//*********************************************************************************
+// _ibt_node_free - Recursively frees the nodes and optionally the data
+//*********************************************************************************
+
+void _ibt_node_free(tbx_ibt_node_t *node, tbx_ibt_data_free_fn_t data_free)
+{
+    int i;
+
+    if (node->leaf) {
+        if (data_free != NULL) {
+            for (i=0; i<node->n; i++) data_free(node->entry[i].data);
+        }
+    } else {
+        for (i=0; i<node->n; i++) _ibt_node_free(node->child[i], data_free);
+    }
+
+    free(node);
+}
+
+//*********************************************************************************
+// _ibt_build_level - Packs the nodes evenly into parents returning the number
+//    of parents.  The parents replace the nodes in the array.
+//*********************************************************************************
+
+int _ibt_build_level(tbx_ibt_node_t **nodes, int n)
+{
+    tbx_ibt_node_t *p;
+    int np, i, j, k, m;
+
+    np = (n + TBX_IBT_ORDER - 1) / TBX_IBT_ORDER;
+    k = 0;
+    for (i=0; i<np; i++) {
+        m = n / np + ((i < (n % np)) ? 1 : 0);
+        p = _ibt_node_new(0);
+        for (j=0; j<m; j++) {
+            p->child[j] = nodes[k+j];
+            p->n++;
+            _ibt_child_fix(p, j);
+        }
+        k += m;
+        nodes[i] = p;
+    }
+
+    return(np);
+}
+
+//*********************************************************************************
+// tbx_ibt_bulk_load - Builds the tree from the array of intervals.  This is
+//    much faster than individual inserts and packs the leaves full.  The
+//    array is sorted in place and the tree must be empty.
+//*********************************************************************************
+
+int tbx_ibt_bulk_load(tbx_ibt_t *t, tbx_ibt_entry_t *entry, int n)
+{
+    tbx_ibt_node_t **nodes, *leaf;
+    int nl, i, k, m, height;
+
+    if (t->root != NULL) {
+        log_printf(0, "ERROR: Tree isn't empty! n_intervals=%d\n", t->n_intervals);
+        return(1);
+    }
+    if (n <= 0) return(0);
+
+    qsort(entry, n, sizeof(tbx_ibt_entry_t), _ibt_qsort_cmp);
+
+    //** Make the leaves spreading the entries evenly
+    nl = (n + TBX_IBT_ORDER - 1) / TBX_IBT_ORDER;
+    tbx_type_malloc(nodes, tbx_ibt_node_t *, nl);
+    k = 0;
+    for (i=0; i<nl; i++) {
+        m = n / nl + ((i < (n % nl)) ? 1 : 0);
+        leaf = _ibt_node_new(1);
+        memcpy(leaf->entry, &(entry[k]), m*sizeof(tbx_ibt_entry_t));
+        leaf->n = m;
+        k += m;
+        nodes[i] = leaf;
+    }
+
+    //** And build up the internal levels
+    height = 1;
+    while (nl > 1) {
+        nl = _ibt_build_level(nodes, nl);
+        height++;
+    }
+    FATAL_UNLESS(height <= TBX_IBT_MAX_DEPTH);
+
+    t->root = nodes[0];
+    t->height = height;
+    t->n_intervals = n;
+    free(nodes);
+
+    return(0);
+}
+
+//*********************************************************************************
+// tbx_ibt_repack - Rebuilds the tree with full leaves.  Useful after lots of
+//    inserts have left the leaves half empty.
+//*********************************************************************************
+
+int tbx_ibt_repack(tbx_ibt_t *t)
+{
+    tbx_ibt_entry_t *entry;
+    tbx_ibt_iter_t it;
+    tbx_ibt_node_t *node;
+    int n, i;
+
+    n = t->n_intervals;
+    if (n == 0) return(0);
+
+    //** Walk the leaves directly since we need the keys as well as the data
+    tbx_type_malloc(entry, tbx_ibt_entry_t, n);
+    i = 0;
+    tbx_ibt_iter_init(&it, t, TBX_IBT_KEY_MIN, TBX_IBT_KEY_MAX);
+    while (it.depth >= 0) {
+        node = it.node[it.depth];
+        if (it.slot[it.depth] >= node->n) {
+            it.depth--;
+        } else if (node->leaf) {
+            memcpy(&(entry[i]), node->entry, node->n*sizeof(tbx_ibt_entry_t));
+            i += node->n;
+            it.slot[it.depth] = node->n;
+        } else {
+            it.depth++;
+            it.node[it.depth] = node->child[it.slot[it.depth-1]];
+            it.slot[it.depth-1]++;
+            it.slot[it.depth] = 0;
+        }
+    }
+    FATAL_UNLESS(i == n);
+
+    _ibt_node_free(t->root, NULL);
+    t->root = NULL;
+    t->height = 0;
+    t->n_intervals = 0;
+    tbx_ibt_bulk_load(t, entry, n);
+
+    free(entry);
+    return(0);
+}
+
+//*********************************************************************************
+// tbx_ibt_new - Creates a new interval B+tree.  If provided data_free is
+//    called on each interval's data when the tree is destroyed.
+//*********************************************************************************
+
+tbx_ibt_t *tbx_ibt_new(tbx_ibt_data_free_fn_t data_free)
+{
+    tbx_ibt_t *t;
+
+    tbx_type_malloc_clear(t, tbx_ibt_t, 1);
+    t->data_free = data_free;
+
+    return(t);
+}
+
+//*********************************************************************************
+// tbx_ibt_del - Destroys the tree
+//*********************************************************************************
+
+void tbx_ibt_del(tbx_ibt_t *t)
+{
+    if (t->root != NULL) _ibt_node_free(t->root, t->data_free);
+    free(t);
+}
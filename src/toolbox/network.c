@@ -46,6 +46,12 @@ int tbx_ns_getid(tbx_ns_t *ns) {
 void tbx_ns_setid(tbx_ns_t *ns, int id) {
     ns->id = id;
 }
+int tbx_ns_proto_flags_get(tbx_ns_t *ns) {
+    return ns->proto_flags;
+}
+void tbx_ns_proto_flags_set(tbx_ns_t *ns, int flags) {
+    ns->proto_flags = flags;
+}
 
 char *tbx_nm_host_get(tbx_ns_monitor_t *nm) {return(nm->address); }
 int tbx_nm_port_get(tbx_ns_monitor_t *nm) {return(nm->port); }
@@ -390,6 +396,7 @@ void _ns_init(tbx_ns_t *ns, int incid)
     ns->last_write = apr_time_now();
     ns->start = 0;
     ns->end = -1;
+    ns->proto_flags = 0;
     memset(ns->peer_address, 0, sizeof(ns->peer_address));
 
     memset(&(ns->write_chksum), 0, sizeof(tbx_ns_chksum_t));
@@ -716,6 +723,7 @@ void _close_ns(tbx_ns_t *ns)
     tbx_log_flush();
 
     ns->cuid = -1;
+    ns->proto_flags = 0;  //** Any negotiated protocol options die with the connection
     if (ns->sock == NULL) return;
 
     if (ns->sock_status(ns->sock) != 1) return;
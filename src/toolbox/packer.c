@@ -75,6 +75,11 @@ int pack_read_zlib(tbx_pack_t *pack, unsigned char *data, int len)
     if (len == 0) return(0);
 
     nbytes = inflate(&(p->z), Z_NO_FLUSH);
+    if ((nbytes == Z_NEED_DICT) && (p->dict != NULL)) {  //** Stream was made with a dictionary
+        if (inflateSetDictionary(&(p->z), p->dict, p->dict_size) == Z_OK) {
+            nbytes = inflate(&(p->z), Z_NO_FLUSH);
+        }
+    }
     log_printf(15, "inflate=%d\n", nbytes);
 
     if ((nbytes == Z_OK) ||
@@ -225,7 +230,7 @@ int pack_write_flush_zlib(tbx_pack_t *pack)
 // pack_init_zlib - Initializes a ZLIB pack object
 //***********************************************************************
 
-void pack_init_zlib(tbx_pack_t *pack, int type, int mode, unsigned char *buffer, unsigned int bufsize)
+void pack_init_zlib(tbx_pack_t *pack, int type, int mode, unsigned char *buffer, unsigned int bufsize, int level, unsigned char *dict, int dict_size)
 {
     tbx_pack_zlib_t *p = &(pack->data.zlib);
 
@@ -236,6 +241,8 @@ void pack_init_zlib(tbx_pack_t *pack, int type, int mode, unsigned char *buffer,
     p->buffer = buffer;
     p->bufsize = bufsize;
     p->bpos = 0;
+    p->dict = dict;
+    p->dict_size = dict_size;
 
     pack->end = pack_end_zlib;
 
@@ -255,7 +262,8 @@ void pack_init_zlib(tbx_pack_t *pack, int type, int mode, unsigned char *buffer,
         p->z.zalloc = Z_NULL;
         p->z.zfree = Z_NULL;
         p->z.opaque = Z_NULL;
-        assert_result(deflateInit(&(p->z), Z_DEFAULT_COMPRESSION), Z_OK);
+        assert_result(deflateInit(&(p->z), (level == 0) ? Z_DEFAULT_COMPRESSION : level), Z_OK);
+        if (dict != NULL) assert_result(deflateSetDictionary(&(p->z), dict, dict_size), Z_OK);
         p->z.avail_in = 0;
         p->z.next_in = Z_NULL;
         p->z.avail_out = bufsize;
@@ -269,6 +277,441 @@ void pack_init_zlib(tbx_pack_t *pack, int type, int mode, unsigned char *buffer,
 }
 
 
+#ifdef HAVE_ZSTD
+//***********************************************************************
+//----------------------- Zstandard routines ----------------------------
+//***********************************************************************
+
+//***********************************************************************
+// pack_read_zstd - Retreives data from the buffer and returns the number
+//    of bytes retreived.
+//***********************************************************************
+
+int pack_read_zstd(tbx_pack_t *pack, unsigned char *data, int len)
+{
+    tbx_pack_zstd_t *p = &(pack->data.zstd);
+    ZSTD_outBuffer out;
+    size_t err, in_pos, out_pos;
+
+    if (len == 0) return(0);
+
+    out.dst = data;
+    out.size = len;
+    out.pos = 0;
+
+    //** Keep going as long as we make progress since a call can stop at a block boundary
+    do {
+        in_pos = p->in.pos;
+        out_pos = out.pos;
+        err = ZSTD_decompressStream(p->dctx, &out, &(p->in));
+        if (ZSTD_isError(err)) {
+            log_printf(0, "ERROR: %s\n", ZSTD_getErrorName(err));
+            return(PACK_ERROR);
+        }
+    } while ((out.pos < out.size) && ((out.pos != out_pos) || (p->in.pos != in_pos)));
+
+    log_printf(15, "len=%d nbytes=%d in.pos=%zu in.size=%zu\n", len, (int)out.pos, p->in.pos, p->in.size);
+    return(out.pos);
+}
+
+//***********************************************************************
+// pack_read_new_data_zstd - Replaces the current data array with that
+//    provided.  The old data array should have been completely consumed!
+//***********************************************************************
+
+int pack_read_new_data_zstd(tbx_pack_t *pack, unsigned char *buffer, unsigned int bufsize)
+{
+    tbx_pack_zstd_t *p = &(pack->data.zstd);
+    int err = 0;
+
+    if (p->in.pos < p->in.size) err = PACK_ERROR;
+
+    p->in.src = buffer;
+    p->in.size = bufsize;
+    p->in.pos = 0;
+
+    return(err);
+}
+
+//***********************************************************************
+// pack_write_zstd - Stores data in the buffer and returns the number
+//    of bytes consumed.
+//***********************************************************************
+
+int pack_write_zstd(tbx_pack_t *pack, unsigned char *data, int len)
+{
+    tbx_pack_zstd_t *p = &(pack->data.zstd);
+    ZSTD_inBuffer in;
+    size_t err;
+
+    if (len == 0) return(0);
+
+    in.src = data;
+    in.size = len;
+    in.pos = 0;
+    err = ZSTD_compressStream2(p->cctx, &(p->out), &in, ZSTD_e_continue);
+    if (ZSTD_isError(err)) {
+        log_printf(0, "ERROR: %s\n", ZSTD_getErrorName(err));
+        return(PACK_ERROR);
+    }
+
+    return(in.pos);
+}
+
+//***********************************************************************
+// pack_write_resized_zstd - Replaces the re-allocated data array with the
+//    expanded one.  The old data should have been copied to the new array
+//***********************************************************************
+
+void pack_write_resized_zstd(tbx_pack_t *pack, unsigned char *buffer, unsigned int bufsize)
+{
+    tbx_pack_zstd_t *p = &(pack->data.zstd);
+
+    FATAL_UNLESS(bufsize >= p->out.pos);
+
+    p->out.dst = buffer;
+    p->out.size = bufsize;
+}
+
+//***********************************************************************
+// pack_consumed_zstd - Flags the write data as consumed.  Resetting the buffer
+//***********************************************************************
+
+void pack_consumed_zstd(tbx_pack_t *pack)
+{
+    pack->data.zstd.out.pos = 0;
+}
+
+//***********************************************************************
+// pack_end_zstd - Cleans up the Zstandard pack structure
+//***********************************************************************
+
+void pack_end_zstd(tbx_pack_t *pack)
+{
+    tbx_pack_zstd_t *p = &(pack->data.zstd);
+
+    if (p->cctx) ZSTD_freeCCtx(p->cctx);
+    if (p->dctx) ZSTD_freeDCtx(p->dctx);
+}
+
+//***********************************************************************
+// pack_used_zstd - Returns the number of buffer bytes used
+//***********************************************************************
+
+int pack_used_zstd(tbx_pack_t *pack)
+{
+    return(pack->data.zstd.out.pos);
+}
+
+//***********************************************************************
+// pack_write_flush_zstd - Ends the frame.  Depending on space available
+//    this routine may need to be called multiple times.
+//***********************************************************************
+
+int pack_write_flush_zstd(tbx_pack_t *pack)
+{
+    tbx_pack_zstd_t *p = &(pack->data.zstd);
+    ZSTD_inBuffer in;
+    size_t err;
+
+    in.src = NULL;
+    in.size = 0;
+    in.pos = 0;
+    err = ZSTD_compressStream2(p->cctx, &(p->out), &in, ZSTD_e_end);
+    log_printf(5, "out.pos=%zu remaining=%zu\n", p->out.pos, err);
+
+    if (ZSTD_isError(err)) return(PACK_ERROR);
+    return((err == 0) ? PACK_FINISHED : PACK_NONE);
+}
+
+//***********************************************************************
+// pack_init_zstd - Initializes a Zstandard pack object
+//***********************************************************************
+
+int pack_init_zstd(tbx_pack_t *pack, int type, int mode, unsigned char *buffer, unsigned int bufsize, int level, unsigned char *dict, int dict_size)
+{
+    tbx_pack_zstd_t *p = &(pack->data.zstd);
+    size_t err;
+
+    memset(pack, 0, sizeof(tbx_pack_t));
+
+    pack->type = type;
+    pack->mode = mode;
+
+    pack->end = pack_end_zstd;
+
+    if (mode == PACK_READ) {
+        p->dctx = ZSTD_createDCtx();
+        if (p->dctx == NULL) return(PACK_ERROR);
+        err = (dict != NULL) ? ZSTD_DCtx_loadDictionary(p->dctx, dict, dict_size) : 0;
+        p->in.src = buffer;
+        p->in.size = bufsize;
+        p->in.pos = 0;
+        pack->read_new_data = pack_read_new_data_zstd;
+        pack->read = pack_read_zstd;
+        pack->used = pack_used_zstd;
+    } else {
+        p->cctx = ZSTD_createCCtx();
+        if (p->cctx == NULL) return(PACK_ERROR);
+        err = ZSTD_CCtx_setParameter(p->cctx, ZSTD_c_compressionLevel, (level == 0) ? TBX_PACK_ZSTD_LEVEL : level);
+        if ((!ZSTD_isError(err)) && (dict != NULL)) err = ZSTD_CCtx_loadDictionary(p->cctx, dict, dict_size);
+        p->out.dst = buffer;
+        p->out.size = bufsize;
+        p->out.pos = 0;
+        pack->write_resized = pack_write_resized_zstd;
+        pack->write = pack_write_zstd;
+        pack->used = pack_used_zstd;
+        pack->consumed = pack_consumed_zstd;
+        pack->write_flush = pack_write_flush_zstd;
+    }
+
+    if (ZSTD_isError(err)) {
+        log_printf(0, "ERROR: %s\n", ZSTD_getErrorName(err));
+        pack_end_zstd(pack);
+        return(PACK_ERROR);
+    }
+
+    return(0);
+}
+#endif
+
+#ifdef HAVE_LZ4
+//***********************************************************************
+//-------------------------- LZ4 routines -------------------------------
+//***********************************************************************
+
+//***********************************************************************
+// _pack_lz4_drain - Copies as much of the staged compressed data as will fit
+//    into the pack buffer.  Returns the number of staged bytes left.
+//***********************************************************************
+
+size_t _pack_lz4_drain(tbx_pack_lz4_t *p)
+{
+    size_t n;
+
+    n = p->stage_len - p->stage_pos;
+    if (n > p->bufsize - p->bpos) n = p->bufsize - p->bpos;
+    if (n > 0) {
+        memcpy(&(p->buffer[p->bpos]), &(p->stage[p->stage_pos]), n);
+        p->bpos += n;
+        p->stage_pos += n;
+    }
+
+    if (p->stage_pos == p->stage_len) p->stage_pos = p->stage_len = 0;
+
+    return(p->stage_len - p->stage_pos);
+}
+
+//***********************************************************************
+// pack_read_lz4 - Retreives data from the buffer and returns the number
+//    of bytes retreived.
+//***********************************************************************
+
+int pack_read_lz4(tbx_pack_t *pack, unsigned char *data, int len)
+{
+    tbx_pack_lz4_t *p = &(pack->data.lz4);
+    size_t err, nin, nout, pos;
+
+    if (len == 0) return(0);
+
+    pos = 0;
+    do {
+        nin = p->bufsize - p->bpos;
+        nout = len - pos;
+        err = LZ4F_decompress(p->dctx, &(data[pos]), &nout, &(p->buffer[p->bpos]), &nin, NULL);
+        if (LZ4F_isError(err)) {
+            log_printf(0, "ERROR: %s\n", LZ4F_getErrorName(err));
+            return(PACK_ERROR);
+        }
+        p->bpos += nin;
+        pos += nout;
+    } while ((pos < (size_t)len) && ((nin > 0) || (nout > 0)));
+
+    log_printf(15, "len=%d nbytes=%d bpos=%u bufsize=%u\n", len, (int)pos, p->bpos, p->bufsize);
+    return(pos);
+}
+
+//***********************************************************************
+// pack_read_new_data_lz4 - Replaces the current data array with that
+//    provided.  The old data array should have been completely consumed!
+//***********************************************************************
+
+int pack_read_new_data_lz4(tbx_pack_t *pack, unsigned char *buffer, unsigned int bufsize)
+{
+    tbx_pack_lz4_t *p = &(pack->data.lz4);
+    int err = 0;
+
+    if (p->bpos < p->bufsize) err = PACK_ERROR;
+
+    p->buffer = buffer;
+    p->bufsize = bufsize;
+    p->bpos = 0;
+
+    return(err);
+}
+
+//***********************************************************************
+// pack_write_lz4 - Stores data in the buffer and returns the number
+//    of bytes consumed.  Nothing is consumed until the previously
+//    staged data has been copied out.
+//***********************************************************************
+
+int pack_write_lz4(tbx_pack_t *pack, unsigned char *data, int len)
+{
+    tbx_pack_lz4_t *p = &(pack->data.lz4);
+    size_t err;
+    int n;
+
+    if (len == 0) return(0);
+
+    if (_pack_lz4_drain(p) > 0) return(0);
+
+    n = (len > TBX_PACK_LZ4_CHUNK) ? TBX_PACK_LZ4_CHUNK : len;
+    err = LZ4F_compressUpdate(p->cctx, p->stage, p->stage_size, data, n, NULL);
+    if (LZ4F_isError(err)) {
+        log_printf(0, "ERROR: %s\n", LZ4F_getErrorName(err));
+        return(PACK_ERROR);
+    }
+    p->stage_len = err;
+    _pack_lz4_drain(p);
+
+    return(n);
+}
+
+//***********************************************************************
+// pack_write_resized_lz4 - Replaces the re-allocated data array with the
+//    expanded one.  The old data should have been copied to the new array.
+//    Any staged data is moved over to the new array.
+//***********************************************************************
+
+void pack_write_resized_lz4(tbx_pack_t *pack, unsigned char *buffer, unsigned int bufsize)
+{
+    tbx_pack_lz4_t *p = &(pack->data.lz4);
+
+    FATAL_UNLESS(bufsize >= p->bpos);
+
+    p->buffer = buffer;
+    p->bufsize = bufsize;
+    if (buffer != NULL) _pack_lz4_drain(p);
+}
+
+//***********************************************************************
+// pack_consumed_lz4 - Flags the write data as consumed.  Resetting the buffer.
+//    The caller may still own the old buffer so staged data isn't copied
+//    until the next write, flush, or resize.
+//***********************************************************************
+
+void pack_consumed_lz4(tbx_pack_t *pack)
+{
+    pack->data.lz4.bpos = 0;
+}
+
+//***********************************************************************
+// pack_end_lz4 - Cleans up the LZ4 pack structure
+//***********************************************************************
+
+void pack_end_lz4(tbx_pack_t *pack)
+{
+    tbx_pack_lz4_t *p = &(pack->data.lz4);
+
+    if (p->cctx) LZ4F_freeCompressionContext(p->cctx);
+    if (p->dctx) LZ4F_freeDecompressionContext(p->dctx);
+    if (p->stage) free(p->stage);
+}
+
+//***********************************************************************
+// pack_used_lz4 - Returns the number of buffer bytes used
+//***********************************************************************
+
+int pack_used_lz4(tbx_pack_t *pack)
+{
+    return(pack->data.lz4.bpos);
+}
+
+//***********************************************************************
+// pack_write_flush_lz4 - Ends the frame.  Depending on space available
+//    this routine may need to be called multiple times.
+//***********************************************************************
+
+int pack_write_flush_lz4(tbx_pack_t *pack)
+{
+    tbx_pack_lz4_t *p = &(pack->data.lz4);
+    size_t err;
+
+    if (_pack_lz4_drain(p) > 0) return(PACK_NONE);
+    if (p->ended == 1) return(PACK_FINISHED);
+
+    err = LZ4F_compressEnd(p->cctx, p->stage, p->stage_size, NULL);
+    if (LZ4F_isError(err)) {
+        log_printf(0, "ERROR: %s\n", LZ4F_getErrorName(err));
+        return(PACK_ERROR);
+    }
+    p->stage_len = err;
+    p->ended = 1;
+
+    return((_pack_lz4_drain(p) > 0) ? PACK_NONE : PACK_FINISHED);
+}
+
+//***********************************************************************
+// pack_init_lz4 - Initializes a LZ4 pack object.  LZ4 frames don't
+//    support dictionaries through the stable API so dict is ignored.
+//***********************************************************************
+
+int pack_init_lz4(tbx_pack_t *pack, int type, int mode, unsigned char *buffer, unsigned int bufsize, int level, unsigned char *dict, int dict_size)
+{
+    tbx_pack_lz4_t *p = &(pack->data.lz4);
+    LZ4F_preferences_t prefs;
+    size_t err;
+
+    memset(pack, 0, sizeof(tbx_pack_t));
+
+    pack->type = type;
+    pack->mode = mode;
+    p->buffer = buffer;
+    p->bufsize = bufsize;
+    p->bpos = 0;
+
+    pack->end = pack_end_lz4;
+
+    if (dict != NULL) log_printf(1, "Dictionaries aren't supported with LZ4.  Ignoring\n");
+
+    if (mode == PACK_READ) {
+        err = LZ4F_createDecompressionContext(&(p->dctx), LZ4F_VERSION);
+        pack->read_new_data = pack_read_new_data_lz4;
+        pack->read = pack_read_lz4;
+        pack->used = pack_used_lz4;
+    } else {
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+        prefs.compressionLevel = level;
+        p->stage_size = LZ4F_compressBound(TBX_PACK_LZ4_CHUNK, &prefs);
+        if (p->stage_size < LZ4F_HEADER_SIZE_MAX) p->stage_size = LZ4F_HEADER_SIZE_MAX;
+        tbx_type_malloc(p->stage, unsigned char, p->stage_size);
+        err = LZ4F_createCompressionContext(&(p->cctx), LZ4F_VERSION);
+        if (!LZ4F_isError(err)) {  //** Stage the frame header
+            err = LZ4F_compressBegin(p->cctx, p->stage, p->stage_size, &prefs);
+            if (!LZ4F_isError(err)) {
+                p->stage_len = err;
+                _pack_lz4_drain(p);
+            }
+        }
+        pack->write_resized = pack_write_resized_lz4;
+        pack->write = pack_write_lz4;
+        pack->used = pack_used_lz4;
+        pack->consumed = pack_consumed_lz4;
+        pack->write_flush = pack_write_flush_lz4;
+    }
+
+    if (LZ4F_isError(err)) {
+        log_printf(0, "ERROR: %s\n", LZ4F_getErrorName(err));
+        pack_end_lz4(pack);
+        return(PACK_ERROR);
+    }
+
+    return(0);
+}
+#endif
+
 //***********************************************************************
 //-------------------------- Raw routines -------------------------------
 //***********************************************************************
@@ -444,31 +887,92 @@ void tbx_pack_destroy(tbx_pack_t *pack)
 }
 
 //***********************************************************************
-// pack_init - Initializes a pack structure
+// tbx_pack_type_supported - Returns 1 if the pack type was compiled in
 //***********************************************************************
 
-void pack_init(tbx_pack_t *pack, int type, int mode, unsigned char *buffer, unsigned int bufsize)
+int tbx_pack_type_supported(int type)
 {
-    if (type == PACK_COMPRESS) {
-        pack_init_zlib(pack, type, mode, buffer, bufsize);
-    } else {
+    switch (type) {
+    case PACK_NONE:
+    case PACK_COMPRESS:
+        return(1);
+#ifdef HAVE_ZSTD
+    case PACK_ZSTD:
+        return(1);
+#endif
+#ifdef HAVE_LZ4
+    case PACK_LZ4:
+        return(1);
+#endif
+    }
+
+    return(0);
+}
+
+//***********************************************************************
+// pack_init_full - Initializes a pack structure using the given
+//    compression level and dictionary.  A level of 0 uses the codec's
+//    default.  The dictionary must remain valid for the life of the pack.
+//    Returns 0 on success or PACK_ERROR if the type isn't available.
+//***********************************************************************
+
+int pack_init_full(tbx_pack_t *pack, int type, int mode, unsigned char *buffer, unsigned int bufsize, int level, unsigned char *dict, int dict_size)
+{
+    switch (type) {
+    case PACK_NONE:
         pack_init_raw(pack, type, mode, buffer, bufsize);
+        return(0);
+    case PACK_COMPRESS:
+        pack_init_zlib(pack, type, mode, buffer, bufsize, level, dict, dict_size);
+        return(0);
+#ifdef HAVE_ZSTD
+    case PACK_ZSTD:
+        return(pack_init_zstd(pack, type, mode, buffer, bufsize, level, dict, dict_size));
+#endif
+#ifdef HAVE_LZ4
+    case PACK_LZ4:
+        return(pack_init_lz4(pack, type, mode, buffer, bufsize, level, dict, dict_size));
+#endif
     }
+
+    log_printf(0, "ERROR: Unsupported pack type=%d\n", type);
+    return(PACK_ERROR);
 }
 
+//***********************************************************************
+// pack_init - Initializes a pack structure
+//***********************************************************************
+
+void pack_init(tbx_pack_t *pack, int type, int mode, unsigned char *buffer, unsigned int bufsize)
+{
+    assert_result(pack_init_full(pack, type, mode, buffer, bufsize, 0, NULL, 0), 0);
+}
 
 //***********************************************************************
-// pack_create - Creates a new pack structure and initializes it
+// tbx_pack_create_full - Creates a new pack structure using the given
+//    level and dictionary.  Returns NULL if the type isn't available.
 //***********************************************************************
 
-tbx_pack_t *tbx_pack_create(int type, int mode, unsigned char *buffer, unsigned int bufsize)
+tbx_pack_t *tbx_pack_create_full(int type, int mode, unsigned char *buffer, unsigned int bufsize, int level, unsigned char *dict, int dict_size)
 {
     tbx_pack_t *pack;
 
-    log_printf(15, "type=%d mode=%d\n", type, mode);
+    log_printf(15, "type=%d mode=%d level=%d dict_size=%d\n", type, mode, level, dict_size);
 
     tbx_type_malloc(pack, tbx_pack_t, 1);
-    pack_init(pack, type, mode, buffer, bufsize);
+    if (pack_init_full(pack, type, mode, buffer, bufsize, level, dict, dict_size) != 0) {
+        free(pack);
+        return(NULL);
+    }
     return(pack);
 }
 
+//***********************************************************************
+// pack_create - Creates a new pack structure and initializes it
+//***********************************************************************
+
+tbx_pack_t *tbx_pack_create(int type, int mode, unsigned char *buffer, unsigned int bufsize)
+{
+    return(tbx_pack_create_full(type, mode, buffer, bufsize, 0, NULL, 0));
+}
+
@@ -23,6 +23,13 @@
 
 #include <zlib.h>
 
+#include "toolbox_config.h"
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
 #include "tbx/packer.h"
 
 #ifdef __cplusplus
@@ -31,6 +38,9 @@ id (*write_resized)(tbx_pack_t *pack, unsigned char *buffer, unsigned int bufsiz
 extern "C" {
 #endif
 
+#define TBX_PACK_ZSTD_LEVEL 1             //** Default zstd level.  These are mostly network streams so favor speed
+#define TBX_PACK_LZ4_CHUNK  (64*1024)     //** Max bytes compressed per LZ4 write
+
 struct tbx_pack_raw_t {
     unsigned char *buffer;
     unsigned int bufsize;
@@ -42,15 +52,47 @@ struct tbx_pack_zlib_t {
     unsigned char *buffer;
     unsigned int bufsize;
     unsigned int bpos;
+    unsigned char *dict;     //** Preset dictionary.  Owned by the caller
+    int dict_size;
     z_stream z;
 };
 
+#ifdef HAVE_ZSTD
+struct tbx_pack_zstd_t {
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+    ZSTD_inBuffer in;        //** Compressed data being read
+    ZSTD_outBuffer out;      //** Compressed data being written
+};
+#endif
+
+#ifdef HAVE_LZ4
+struct tbx_pack_lz4_t {
+    LZ4F_cctx *cctx;
+    LZ4F_dctx *dctx;
+    unsigned char *buffer;
+    unsigned int bufsize;
+    unsigned int bpos;       //** Write: bytes used in buffer.  Read: bytes consumed from buffer
+    unsigned char *stage;    //** LZ4 frames need worst case space so compress here and then copy out
+    size_t stage_size;
+    size_t stage_pos;
+    size_t stage_len;
+    int ended;
+};
+#endif
+
 struct tbx_pack_t {
     int type;
     int mode;
     union {
         tbx_pack_raw_t raw;
         tbx_pack_zlib_t zlib;
+#ifdef HAVE_ZSTD
+        tbx_pack_zstd_t zstd;
+#endif
+#ifdef HAVE_LZ4
+        tbx_pack_lz4_t lz4;
+#endif
     } data;
     void (*end)(tbx_pack_t *pack);
     void (*write_resized)(tbx_pack_t *pack, unsigned char *buffer, unsigned int bufsize);
@@ -62,6 +104,7 @@ struct tbx_pack_t {
     int (*write_flush)(tbx_pack_t *pack);
 };
 void pack_init(tbx_pack_t *pack, int type, int mode, unsigned char *buffer, unsigned int bufsize);
+int pack_init_full(tbx_pack_t *pack, int type, int mode, unsigned char *buffer, unsigned int bufsize, int level, unsigned char *dict, int dict_size);
 
 //void tbx_pack_end(tbx_pack_t *pack);
 //void tbx_pack_write_resized(tbx_pack_t *pack, char *buffer, int bufsize);
@@ -0,0 +1,57 @@
+/*
+   Copyright 2016 Vanderbilt University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+#ifndef ACCRE_ADLER32_H_INCLUDED
+#define ACCRE_ADLER32_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tbx/visibility.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Functions
+
+/*! @brief Updates a running adler32 checksum
+ *
+ * Produces the same result as zlib's adler32() but uses a vectorized kernel
+ * when the CPU supports it.
+ * @param adler Running checksum.  Start with 1 for an empty buffer.
+ * @param buf Data to add
+ * @param len Number of bytes in buf
+ * @returns The updated checksum
+ */
+TBX_API uint32_t tbx_adler32(uint32_t adler, const unsigned char *buf, size_t len);
+
+/*! @brief Combines the checksums of two adjacent blocks
+ *
+ * Same as zlib's adler32_combine().  Lets blocks be summed independently,
+ * in any order, and then merged in offset order.
+ * @param adler1 Checksum of the first block
+ * @param adler2 Checksum of the second block
+ * @param len2 Length of the second block
+ * @returns Checksum of the two blocks concatenated
+ */
+TBX_API uint32_t tbx_adler32_combine(uint32_t adler1, uint32_t adler2, int64_t len2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -46,6 +46,7 @@ TBX_API int *tbx_a_thread_id_ptr();
 #define tbx_atomic_set(v, n) apr_atomic_set32(&(v), n)
 #define tbx_atomic_get(v) apr_atomic_read32(&(v))
 #define tbx_atomic_exchange(a, v) apr_atomic_xchg32(&a, v)
+#define tbx_atomic_cas(v, newval, cmp) apr_atomic_cas32(&(v), newval, cmp)
 #define tbx_atomic_thread_id (*tbx_a_thread_id_ptr())
 
 #ifdef __cplusplus
@@ -33,12 +33,15 @@ enum tbx_dns_ip_t {
 
 // Functions
 TBX_API int tbx_dnsc_lookup(const char * name, char * byte_addr, char * ip_addr);
+TBX_API int tbx_dnsc_lookup_family(const char * name, tbx_dns_ip_t * family, char * byte_addr, char * ip_addr);
+TBX_API void tbx_dnsc_ttl_set(int ttl);
 TBX_API int tbx_dnsc_shutdown();
 TBX_API int tbx_dnsc_startup();
 TBX_API int tbx_dnsc_startup_sized(int size);
 
 // Preprocessor macros
 #define DNS_ADDR_MAX 4
+#define DNS_ADDR_MAX6 16
 
 #ifdef __cplusplus
 }
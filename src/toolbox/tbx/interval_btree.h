@@ -0,0 +1,87 @@
+/*
+   Copyright 2016 Vanderbilt University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+#ifndef ACCRE_INTERVAL_BTREE_H_INCLUDED
+#define ACCRE_INTERVAL_BTREE_H_INCLUDED
+
+#include <stdint.h>
+#include <tbx/visibility.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Types
+typedef struct tbx_ibt_entry_t tbx_ibt_entry_t;
+
+typedef struct tbx_ibt_iter_t tbx_ibt_iter_t;
+
+typedef struct tbx_ibt_node_t tbx_ibt_node_t;
+
+typedef struct tbx_ibt_t tbx_ibt_t;
+
+typedef void (*tbx_ibt_data_free_fn_t)(void *a);
+
+// Functions
+TBX_API int tbx_ibt_bulk_load(tbx_ibt_t *t, tbx_ibt_entry_t *entry, int n);
+TBX_API void tbx_ibt_del(tbx_ibt_t *t);
+TBX_API int tbx_ibt_insert(tbx_ibt_t *t, int64_t lo, int64_t hi, void *data);
+TBX_API tbx_ibt_iter_t tbx_ibt_iter_search(tbx_ibt_t *t, int64_t lo, int64_t hi);
+TBX_API void tbx_ibt_iter_init(tbx_ibt_iter_t *it, tbx_ibt_t *t, int64_t lo, int64_t hi);
+TBX_API tbx_ibt_t *tbx_ibt_new(tbx_ibt_data_free_fn_t data_free);
+TBX_API void *tbx_ibt_next(tbx_ibt_iter_t *it);
+TBX_API int tbx_ibt_range_count(tbx_ibt_t *t, int64_t lo, int64_t hi);
+TBX_API int tbx_ibt_remove(tbx_ibt_t *t, int64_t lo, int64_t hi, void *data);
+TBX_API int tbx_ibt_repack(tbx_ibt_t *t);
+
+// Preprocessor constants
+#define TBX_IBT_ORDER     32   //** Max intervals per leaf and children per internal node
+#define TBX_IBT_MAX_DEPTH 16
+#define TBX_IBT_KEY_MIN INT64_MIN
+#define TBX_IBT_KEY_MAX INT64_MAX
+
+// Preprocessor macros
+#define tbx_ibt_count(a) (a)->n_intervals
+
+// Exposed for bulk loading and so iterators can live on the stack
+struct tbx_ibt_entry_t {
+    int64_t lo;
+    int64_t hi;
+    void *data;
+};
+
+struct tbx_ibt_iter_t {
+    tbx_ibt_t *t;
+    int64_t lo;
+    int64_t hi;
+    tbx_ibt_node_t *node[TBX_IBT_MAX_DEPTH];
+    int slot[TBX_IBT_MAX_DEPTH];
+    int depth;
+};
+
+struct tbx_ibt_t {  //** Interval B+tree container
+    tbx_ibt_node_t *root;
+    tbx_ibt_data_free_fn_t data_free;
+    int n_intervals;
+    int height;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
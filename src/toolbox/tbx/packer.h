@@ -31,12 +31,18 @@ typedef struct tbx_pack_t tbx_pack_t;
 
 typedef struct tbx_pack_zlib_t tbx_pack_zlib_t;
 
+typedef struct tbx_pack_zstd_t tbx_pack_zstd_t;
+
+typedef struct tbx_pack_lz4_t tbx_pack_lz4_t;
+
 // Functions
 TBX_API void tbx_pack_consumed(tbx_pack_t *pack);
 TBX_API tbx_pack_t *tbx_pack_create(int type, int mode, unsigned char *buffer, unsigned int bufsize);
+TBX_API tbx_pack_t *tbx_pack_create_full(int type, int mode, unsigned char *buffer, unsigned int bufsize, int level, unsigned char *dict, int dict_size);
 TBX_API void tbx_pack_destroy(tbx_pack_t *pack);
 TBX_API int tbx_pack_read(tbx_pack_t *pack, unsigned char *data, int nbytes);
 TBX_API int tbx_pack_read_new_data(tbx_pack_t *pack, unsigned char *buffer, unsigned int bufsize);
+TBX_API int tbx_pack_type_supported(int type);
 TBX_API int tbx_pack_used(tbx_pack_t *pack);
 TBX_API int tbx_pack_write(tbx_pack_t *pack, unsigned char *data, int nbytes);
 TBX_API int tbx_pack_write_flush(tbx_pack_t *pack);
@@ -47,7 +53,9 @@ TBX_API void tbx_pack_write_resized(tbx_pack_t *pack, unsigned char *buffer, uns
 #define PACK_ERROR   -2
 #define PACK_FULL    -1
 #define PACK_NONE     0
-#define PACK_COMPRESS 1
+#define PACK_COMPRESS 1    //** zlib
+#define PACK_ZSTD     2
+#define PACK_LZ4      3
 #define PACK_READ     0
 #define PACK_WRITE    1
 
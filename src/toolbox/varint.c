@@ -52,7 +52,8 @@ int varint_encode(uint64_t value, uint8_t *buffer)
 
 //*******************************************************************************
 //  varint_decode - Decodes an integer using base 128 variants.
-//     The number of bytes used from the buffer are returned.
+//     The number of bytes used from the buffer are returned or -1 if the
+//     buffer ends first or the value is too long to fit in 64 bits.
 //*******************************************************************************
 
 int varint_decode(uint8_t *buffer, int bufsize, uint64_t *value)
@@ -61,6 +62,7 @@ int varint_decode(uint8_t *buffer, int bufsize, uint64_t *value)
 
     *value = 0;
     for (i=0, bits = 0; i<bufsize; i++, bits += 7) {
+        if (bits >= 64) return(-1);  //** Overlong.  Can't shift any further
         *value += (uint64_t)(buffer[i] & 0x7F) << bits;
 //printf("vd: b[%d]=%u value=" U64T "\n", i, buffer[i], *value);
         if ((buffer[i] & 0x80) == 0) {  //** Last byte
@@ -155,6 +157,14 @@ int tbx_varint_test()
         }
     }
 
+    //** Overlong values should be rejected
+    memset(buffer, 0x80, sizeof(buffer));
+    bytes = varint_decode(buffer, 20, &result);
+    if (bytes != -1) {
+        printf("VARINT DECODE accepted an overlong value used=%d\n", bytes);
+        abort();
+    }
+
     return(0);
 }
 
@@ -30,6 +30,8 @@ http://www.accre.vanderbilt.edu
 #define _log_module_index 187
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include <tbx/list.h>
 #include <lio/authn.h>
 #include <lio/ds.h>
@@ -46,15 +48,16 @@ http://www.accre.vanderbilt.edu
 void print_help()
 {
     printf("\n");
-    printf("os_test LIO_COMMON_OPTIONS path\n");
+    printf("os_test LIO_COMMON_OPTIONS [-bench n_objects] path\n");
     lio_print_options(stdout);
+    printf("    -bench n_objects - Also run the metadata ops/sec benchmark using n_objects files\n");
     printf("    path  - Path prefix to use\n");
     printf("\n");
 }
 
 int main(int argc, char **argv)
 {
-    int nfailed;
+    int nfailed, n_bench, start;
     lio_path_tuple_t tuple;
 
     if (argc < 2) {
@@ -64,11 +67,19 @@ int main(int argc, char **argv)
 
     lio_init(&argc, &argv);
 
-    if (argc < 1) {
+    n_bench = 0;
+    start = 1;
+    if ((argc > 2) && (strcmp(argv[1], "-bench") == 0)) {
+        n_bench = atoi(argv[2]);
+        start = 3;
+    }
+
+    if (argc <= start) {
         printf("Missing PATH!\n");
         print_help();
+        return(1);
     }
-    tuple = lio_path_resolve(lio_gc->auto_translate, argv[1]);
+    tuple = lio_path_resolve(lio_gc->auto_translate, argv[start]);
 
     log_printf(0, "--------------------------------------------------------------------\n");
     log_printf(0, "Using prefix=%s\n", tuple.path);
@@ -84,6 +95,14 @@ int main(int argc, char **argv)
     nfailed = os_locking_tests(tuple.path);
     if (nfailed > 0) goto oops;
 
+    nfailed = os_aggregate_tests(tuple.path);
+    if (nfailed > 0) goto oops;
+
+    if (n_bench > 0) {
+        nfailed = os_metadata_benchmark(tuple.path, n_bench);
+        if (nfailed > 0) goto oops;
+    }
+
 oops:
     log_printf(0, "--------------------------------------------------------------------\n");
     log_printf(0, "Tasks failed: %d\n", nfailed);
@@ -0,0 +1,99 @@
+#include "task.h"
+#include <apr_time.h>
+#include <lio/rid_throttle.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define RT_BW     (1024*1024)   // 1MB/s so a 100KB copy takes ~100ms
+#define RT_NBYTES (100*1024)
+#define RT_DT     (100*1000)    // Expected delay in usec
+
+typedef struct {
+    lio_rid_throttle_t *rt;
+    char *src;
+    char *dest;
+    volatile int acquired;
+} rt_arg_t;
+
+static void *rt_acquire_thread(void *arg) {
+    rt_arg_t *a = (rt_arg_t *)arg;
+
+    lio_rid_throttle_acquire(a->rt, a->src, a->dest, 0);
+    a->acquired = 1;
+    return NULL;
+}
+
+// Returns how long the acquire took in usec
+static apr_time_t rt_timed_acquire(lio_rid_throttle_t *rt, char *src, char *dest, ex_off_t nbytes) {
+    apr_time_t start = apr_time_now();
+
+    lio_rid_throttle_acquire(rt, src, dest, nbytes);
+    return apr_time_now() - start;
+}
+
+TEST_IMPL(lio_rid_throttle) {
+    lio_rid_throttle_t *rt;
+    rt_arg_t arg;
+    pthread_t th;
+
+    // Slots: only 1 copy from a source RID at a time
+    rt = lio_rid_throttle_create(1, 0, 0, 0);
+    lio_rid_throttle_acquire(rt, "A", "B", 0);
+    lio_rid_throttle_acquire(rt, "C", "B", 0);  // Different source and no dest limit
+    lio_rid_throttle_acquire(rt, NULL, "B", 0);  // Unknown source isn't limited
+
+    arg.rt = rt;
+    arg.src = "A";
+    arg.dest = "D";
+    arg.acquired = 0;
+    ASSERT(pthread_create(&th, NULL, rt_acquire_thread, &arg) == 0);
+    usleep(RT_DT);
+    ASSERT(arg.acquired == 0);  // Still waiting on A's slot
+    lio_rid_throttle_release(rt, "A", "B");
+    ASSERT(pthread_join(th, NULL) == 0);
+    ASSERT(arg.acquired == 1);
+
+    lio_rid_throttle_release(rt, "A", "D");
+    lio_rid_throttle_release(rt, "C", "B");
+    lio_rid_throttle_release(rt, NULL, "B");
+    lio_rid_throttle_destroy(rt);
+
+    // Same for the destination
+    rt = lio_rid_throttle_create(0, 1, 0, 0);
+    lio_rid_throttle_acquire(rt, "A", "B", 0);
+    arg.rt = rt;
+    arg.src = "C";
+    arg.dest = "B";
+    arg.acquired = 0;
+    ASSERT(pthread_create(&th, NULL, rt_acquire_thread, &arg) == 0);
+    usleep(RT_DT);
+    ASSERT(arg.acquired == 0);
+    lio_rid_throttle_release(rt, "A", "B");
+    ASSERT(pthread_join(th, NULL) == 0);
+    ASSERT(arg.acquired == 1);
+    lio_rid_throttle_release(rt, "C", "B");
+    lio_rid_throttle_destroy(rt);
+
+    // Bandwidth: the first copy starts right away and the next one from
+    // the same source waits for the budget.  Other sources aren't affected.
+    rt = lio_rid_throttle_create(0, 0, RT_BW, 0);
+    ASSERT(rt_timed_acquire(rt, "A", "B", RT_NBYTES) < RT_DT/2);
+    ASSERT(rt_timed_acquire(rt, "C", "B", RT_NBYTES) < RT_DT/2);
+    ASSERT(rt_timed_acquire(rt, "A", "B", RT_NBYTES) >= RT_DT*9/10);
+    lio_rid_throttle_release(rt, "A", "B");
+    lio_rid_throttle_release(rt, "C", "B");
+    lio_rid_throttle_release(rt, "A", "B");
+    lio_rid_throttle_destroy(rt);
+
+    // Destination bandwidth
+    rt = lio_rid_throttle_create(0, 0, 0, RT_BW);
+    ASSERT(rt_timed_acquire(rt, "A", "B", RT_NBYTES) < RT_DT/2);
+    ASSERT(rt_timed_acquire(rt, "A", "C", RT_NBYTES) < RT_DT/2);
+    ASSERT(rt_timed_acquire(rt, "D", "B", RT_NBYTES) >= RT_DT*9/10);
+    lio_rid_throttle_release(rt, "A", "B");
+    lio_rid_throttle_release(rt, "A", "C");
+    lio_rid_throttle_release(rt, "D", "B");
+    lio_rid_throttle_destroy(rt);
+
+    return 0;
+}
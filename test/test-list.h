@@ -1,17 +1,27 @@
 TEST_DECLARE(always_win)
+TEST_DECLARE(tb_adler32)
+TEST_DECLARE(tb_dns_cache)
 TEST_DECLARE(tb_object)
 TEST_DECLARE(tb_object_api)
+TEST_DECLARE(tb_packer)
 TEST_DECLARE(tb_ref)
 TEST_DECLARE(tb_stack)
 TEST_DECLARE(tb_stk_escape_text)
 TEST_DECLARE(tb_iniparse)
+TEST_DECLARE(tb_interval_btree)
+TEST_DECLARE(lio_rid_throttle)
 
 TASK_LIST_START
     TEST_ENTRY(always_win)
+    TEST_ENTRY(tb_adler32)
+    TEST_ENTRY(tb_dns_cache)
     TEST_ENTRY(tb_object)
     TEST_ENTRY(tb_object_api)
+    TEST_ENTRY(tb_packer)
     TEST_ENTRY(tb_ref)
     TEST_ENTRY(tb_stack)
     TEST_ENTRY(tb_stk_escape_text)
     TEST_ENTRY(tb_iniparse)
+    TEST_ENTRY(tb_interval_btree)
+    TEST_ENTRY(lio_rid_throttle)
 TASK_LIST_END
@@ -0,0 +1,51 @@
+#include "task.h"
+#include <tbx/adler32.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Byte at a time reference from the definition
+static uint32_t ref_adler32(uint32_t adler, const unsigned char *buf, size_t len) {
+    uint32_t s1 = adler & 0xffff;
+    uint32_t s2 = adler >> 16;
+    size_t i;
+    for (i = 0; i < len; i++) {
+        s1 = (s1 + buf[i]) % 65521;
+        s2 = (s2 + s1) % 65521;
+    }
+    return (s2 << 16) | s1;
+}
+
+TEST_IMPL(tb_adler32) {
+    size_t size = 3*5552 + 1000;
+    unsigned char *buf = malloc(size);
+    size_t i, len, split;
+    ASSERT(buf != NULL);
+
+    // Known values
+    ASSERT(tbx_adler32(1, NULL, 0) == 1);
+    ASSERT(tbx_adler32(1, (const unsigned char *)"Wikipedia", 9) == 0x11E60398);
+
+    // Lengths around the vector width and the modulo interval. All 0xff is
+    // the worst case for overflowing the running sums.
+    for (int pass = 0; pass < 2; pass++) {
+        for (i = 0; i < size; i++) {
+            buf[i] = (pass == 0) ? (unsigned char)(i * 131 + 7) : 0xff;
+        }
+        for (len = 0; len < 300; len++) {
+            ASSERT(tbx_adler32(1, buf, len) == ref_adler32(1, buf, len));
+        }
+        ASSERT(tbx_adler32(1, buf, size) == ref_adler32(1, buf, size));
+        ASSERT(tbx_adler32(1, buf + 3, size - 3) == ref_adler32(1, buf + 3, size - 3));
+
+        // Combining pieces matches one pass over the whole buffer
+        for (split = 0; split <= size; split += 997) {
+            uint32_t a = tbx_adler32(1, buf, split);
+            uint32_t b = tbx_adler32(1, buf + split, size - split);
+            ASSERT(tbx_adler32_combine(a, b, size - split) == ref_adler32(1, buf, size));
+        }
+    }
+
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "task.h"
+#include <tbx/dns_cache.h>
+#include <stdio.h>
+#include <string.h>
+
+TEST_IMPL(tb_dns_cache) {
+    char addr[DNS_ADDR_MAX6];
+    char ip[256];
+    unsigned char v4[4] = { 127, 0, 0, 1 };
+    unsigned char v6[16] = { 0 };
+    tbx_dns_ip_t family;
+    int i;
+
+    v6[15] = 1;
+    ASSERT(tbx_dnsc_startup_sized(32) == 0);
+
+    // IPv4 and repeated lookups served from the cache
+    for (i = 0; i < 3; i++) {
+        memset(addr, 0, sizeof(addr));
+        ASSERT(tbx_dnsc_lookup("127.0.0.1", addr, ip) == 0);
+        ASSERT(memcmp(addr, v4, 4) == 0);
+        ASSERT(strcmp(ip, "127.0.0.1") == 0);
+    }
+
+    // IPv6 only hosts aren't returned by the IPv4 lookup
+    ASSERT(tbx_dnsc_lookup("::1", addr, ip) != 0);
+    family = DNS_IPV4;
+    ASSERT(tbx_dnsc_lookup_family("::1", &family, addr, ip) == 0);
+    ASSERT(family == DNS_IPV6);
+    ASSERT(memcmp(addr, v6, 16) == 0);
+    ASSERT(strcmp(ip, "::1") == 0);
+
+    // Expired entries are still served while they are refreshed
+    tbx_dnsc_ttl_set(0);
+    v4[3] = 2;
+    for (i = 0; i < 3; i++) {
+        ASSERT(tbx_dnsc_lookup("127.0.0.2", addr, NULL) == 0);
+        ASSERT(memcmp(addr, v4, 4) == 0);
+    }
+
+    // More names than the cache holds
+    for (i = 0; i < 100; i++) {
+        snprintf(ip, sizeof(ip), "10.0.%d.%d", i / 256, i % 256);
+        ASSERT(tbx_dnsc_lookup(ip, addr, NULL) == 0);
+        ASSERT((unsigned char)addr[0] == 10);
+        ASSERT((unsigned char)addr[3] == i % 256);
+    }
+
+    ASSERT(tbx_dnsc_lookup("", addr, NULL) != 0);
+
+    ASSERT(tbx_dnsc_shutdown() == 0);
+    return 0;
+}
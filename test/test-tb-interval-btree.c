@@ -0,0 +1,115 @@
+#include "task.h"
+#include <tbx/interval_btree.h>
+#include <stdlib.h>
+
+#define N_INTERVALS 5000
+#define KEY_RANGE 100000
+
+typedef struct {
+    int64_t lo;
+    int64_t hi;
+    int live;
+} interval_t;
+
+static int brute_count(interval_t *d, int n, int64_t lo, int64_t hi) {
+    int i, count = 0;
+    for (i = 0; i < n; i++) {
+        if (d[i].live && (d[i].hi >= lo) && (d[i].lo <= hi)) count++;
+    }
+    return count;
+}
+
+static int check_query(tbx_ibt_t *t, interval_t *d, int n, int64_t lo, int64_t hi) {
+    tbx_ibt_iter_t it;
+    interval_t *p;
+    int64_t prev = TBX_IBT_KEY_MIN;
+    int count = 0;
+
+    it = tbx_ibt_iter_search(t, lo, hi);
+    while ((p = tbx_ibt_next(&it)) != NULL) {
+        if (!p->live || (p->hi < lo) || (p->lo > hi) || (p->lo < prev)) return -1;
+        prev = p->lo;
+        count++;
+    }
+    return (count == brute_count(d, n, lo, hi)) ? 0 : -1;
+}
+
+TEST_IMPL(tb_interval_btree) {
+    interval_t *d;
+    tbx_ibt_entry_t *e;
+    tbx_ibt_t *t;
+    int64_t lo;
+    int i, k, n, live;
+
+    d = calloc(N_INTERVALS, sizeof(interval_t));
+    e = calloc(N_INTERVALS, sizeof(tbx_ibt_entry_t));
+    ASSERT(d != NULL);
+    ASSERT(e != NULL);
+    srand(1);
+
+    // Empty tree
+    t = tbx_ibt_new(NULL);
+    ASSERT(tbx_ibt_count(t) == 0);
+    ASSERT(tbx_ibt_range_count(t, TBX_IBT_KEY_MIN, TBX_IBT_KEY_MAX) == 0);
+    ASSERT(tbx_ibt_remove(t, 0, 1, d) != 0);
+
+    // Random inserts and removes checked against a brute force scan
+    live = 0;
+    for (i = 0; i < 20 * N_INTERVALS; i++) {
+        k = rand() % N_INTERVALS;
+        if (!d[k].live) {
+            d[k].lo = rand() % KEY_RANGE;
+            d[k].hi = d[k].lo + rand() % ((rand() % 2) ? 10 : 2000);
+            d[k].live = 1;
+            ASSERT(tbx_ibt_insert(t, d[k].lo, d[k].hi, &d[k]) == 0);
+            live++;
+        } else if (rand() % 2) {
+            ASSERT(tbx_ibt_remove(t, d[k].lo, d[k].hi, &d[k]) == 0);
+            d[k].live = 0;
+            live--;
+        }
+        ASSERT(tbx_ibt_count(t) == live);
+
+        if ((i % 1000) == 0) {
+            lo = rand() % KEY_RANGE;
+            ASSERT(check_query(t, d, N_INTERVALS, lo, lo + rand() % 1000) == 0);
+            ASSERT(check_query(t, d, N_INTERVALS, lo, lo) == 0);
+        }
+        if ((i % 10000) == 0) ASSERT(tbx_ibt_repack(t) == 0);
+    }
+    ASSERT(tbx_ibt_range_count(t, TBX_IBT_KEY_MIN, TBX_IBT_KEY_MAX) == live);
+
+    // Removing an interval that isn't there fails
+    ASSERT(tbx_ibt_remove(t, -10, -5, d) != 0);
+
+    // Bulk loading gives the same answers
+    n = 0;
+    for (i = 0; i < N_INTERVALS; i++) {
+        if (!d[i].live) continue;
+        e[n].lo = d[i].lo;
+        e[n].hi = d[i].hi;
+        e[n].data = &d[i];
+        n++;
+    }
+    tbx_ibt_del(t);
+    t = tbx_ibt_new(NULL);
+    ASSERT(tbx_ibt_bulk_load(t, e, n) == 0);
+    ASSERT(tbx_ibt_count(t) == n);
+    ASSERT(tbx_ibt_bulk_load(t, e, n) != 0);
+    for (i = 0; i < 100; i++) {
+        lo = rand() % KEY_RANGE;
+        ASSERT(check_query(t, d, N_INTERVALS, lo, lo + rand() % 1000) == 0);
+    }
+
+    // Drain it
+    for (i = 0; i < N_INTERVALS; i++) {
+        if (d[i].live) ASSERT(tbx_ibt_remove(t, d[i].lo, d[i].hi, &d[i]) == 0);
+    }
+    ASSERT(tbx_ibt_count(t) == 0);
+    ASSERT(tbx_ibt_range_count(t, TBX_IBT_KEY_MIN, TBX_IBT_KEY_MAX) == 0);
+
+    tbx_ibt_del(t);
+    free(e);
+    free(d);
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "task.h"
+#include <tbx/packer.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PK_DATA_SIZE (300*1024)
+#define PK_BUF_SIZE  97      // Small so the streams have to be drained often
+
+// Sends the packet.  With swap the buffer is replaced like mq_stream
+// does: consumed and resized to a new buffer *before* the old packet is
+// copied out.  Returns the new buffer.
+static unsigned char *pk_send(tbx_pack_t *pack, unsigned char *buf, int swap, int last, unsigned char *packed, int *used) {
+    unsigned char *old = buf;
+    int n = tbx_pack_used(pack);
+
+    tbx_pack_consumed(pack);
+    if (swap) {
+        buf = (last) ? NULL : malloc(PK_BUF_SIZE);
+        tbx_pack_write_resized(pack, buf, (last) ? 0 : PK_BUF_SIZE);
+    }
+    memcpy(&(packed[*used]), old, n);
+    *used += n;
+    if (swap) free(old);
+    return(buf);
+}
+
+// Packs the data the way mq_stream does.  Draining the buffer whenever
+// it fills.  Returns the packed size.
+static int pk_write(int type, int swap, unsigned char *data, int len, unsigned char *dict, int dict_size, unsigned char *packed) {
+    unsigned char *buf;
+    tbx_pack_t *pack;
+    int pos, n, used, err;
+
+    buf = malloc(PK_BUF_SIZE);
+    ASSERT(buf != NULL);
+    pack = tbx_pack_create_full(type, PACK_WRITE, buf, PK_BUF_SIZE, 0, dict, dict_size);
+    ASSERT(pack != NULL);
+
+    used = 0;
+    pos = 0;
+    while (pos < len) {
+        n = tbx_pack_write(pack, &(data[pos]), ((len - pos) > 5000) ? 5000 : len - pos);
+        ASSERT(n != PACK_ERROR);
+        if (n > 0) pos += n;
+        if ((pos < len) && (n <= 0)) buf = pk_send(pack, buf, swap, 0, packed, &used);
+    }
+
+    do {
+        err = tbx_pack_write_flush(pack);
+        ASSERT(err != PACK_ERROR);
+        buf = pk_send(pack, buf, swap, (err == PACK_FINISHED), packed, &used);
+    } while (err != PACK_FINISHED);
+
+    tbx_pack_destroy(pack);
+    if (buf) free(buf);
+    return used;
+}
+
+// Unpacks feeding the packed data in odd sized pieces
+static void pk_read(int type, unsigned char *packed, int plen, unsigned char *dict, int dict_size, unsigned char *data, int len) {
+    tbx_pack_t *pack;
+    int pos, ppos, n, chunk;
+
+    chunk = 1;
+    ppos = (plen > chunk) ? chunk : plen;
+    pack = tbx_pack_create_full(type, PACK_READ, packed, ppos, 0, dict, dict_size);
+    ASSERT(pack != NULL);
+
+    pos = 0;
+    while (pos < len) {
+        n = tbx_pack_read(pack, &(data[pos]), len - pos);
+        ASSERT(n >= 0);
+        pos += n;
+        if (pos < len) {
+            ASSERT(ppos < plen);
+            chunk = (chunk * 7 + 13) % 1500 + 1;
+            n = (plen - ppos > chunk) ? chunk : plen - ppos;
+            ASSERT(tbx_pack_read_new_data(pack, &(packed[ppos]), n) == 0);
+            ppos += n;
+        }
+    }
+
+    tbx_pack_destroy(pack);
+}
+
+TEST_IMPL(tb_packer) {
+    int types[] = { PACK_NONE, PACK_COMPRESS, PACK_ZSTD, PACK_LZ4 };
+    unsigned char dict[] = "system.exnode system.inode os.type os.create user.name";
+    unsigned char *data, *packed, *check;
+    int i, t, swap, plen;
+
+    data = malloc(PK_DATA_SIZE);
+    check = malloc(PK_DATA_SIZE);
+    packed = malloc(2*PK_DATA_SIZE);
+    ASSERT((data != NULL) && (check != NULL) && (packed != NULL));
+
+    // Text like data with some noise so it compresses but not trivially
+    for (i = 0; i < PK_DATA_SIZE; i++) {
+        data[i] = ((i % 1000) < 900) ? dict[(i * 7) % (sizeof(dict) - 1)] : (unsigned char)(i * 2654435761U >> 24);
+    }
+
+    ASSERT(tbx_pack_type_supported(PACK_NONE) == 1);
+    ASSERT(tbx_pack_type_supported(PACK_COMPRESS) == 1);
+    ASSERT(tbx_pack_type_supported(99) == 0);
+    ASSERT(tbx_pack_create(99, PACK_WRITE, data, 100) == NULL);
+
+    for (t = 0; t < 4; t++) {
+        if (tbx_pack_type_supported(types[t]) == 0) continue;
+
+        // Reusing the buffer and swapping it for a new one each packet like mq_stream
+        for (swap = 0; swap < 2; swap++) {
+            memset(check, 0, PK_DATA_SIZE);
+            plen = pk_write(types[t], swap, data, PK_DATA_SIZE, NULL, 0, packed);
+            if (types[t] != PACK_NONE) ASSERT(plen < PK_DATA_SIZE);
+            pk_read(types[t], packed, plen, NULL, 0, check, PK_DATA_SIZE);
+            ASSERT(memcmp(data, check, PK_DATA_SIZE) == 0);
+
+            // And with a dictionary
+            memset(check, 0, PK_DATA_SIZE);
+            plen = pk_write(types[t], swap, data, PK_DATA_SIZE, dict, sizeof(dict) - 1, packed);
+            pk_read(types[t], packed, plen, dict, sizeof(dict) - 1, check, PK_DATA_SIZE);
+            ASSERT(memcmp(data, check, PK_DATA_SIZE) == 0);
+        }
+    }
+
+    free(data);
+    free(check);
+    free(packed);
+    return 0;
+}